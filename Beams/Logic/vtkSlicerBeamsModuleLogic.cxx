@@ -26,6 +26,7 @@
 #include "vtkMRMLRTPlanNode.h"
 #include "vtkMRMLRTBeamNode.h"
 #include "vtkMRMLRTIonRangeShifterNode.h"
+#include "vtkMRMLRTDoseInfluenceMatrixStorageNode.h"
 
 // MRML includes
 #include <vtkMRMLScene.h>
@@ -88,6 +89,10 @@ void vtkSlicerBeamsModuleLogic::RegisterNodes()
   {
     scene->RegisterNodeClass(vtkSmartPointer<vtkMRMLRTBeamNode>::New());
   }
+  if (!scene->IsNodeClassRegistered("vtkMRMLRTDoseInfluenceMatrixStorageNode"))
+  {
+    scene->RegisterNodeClass(vtkSmartPointer<vtkMRMLRTDoseInfluenceMatrixStorageNode>::New());
+  }
 }
 
 //---------------------------------------------------------------------------
@@ -34,6 +34,7 @@
 #include <vtkMRMLLinearTransformNode.h>
 #include <vtkMRMLSubjectHierarchyNode.h>
 #include <vtkMRMLSubjectHierarchyConstants.h>
+#include <vtkMRMLStorageNode.h>
 
 // VTK includes
 #include <vtkCommand.h>
@@ -285,6 +286,33 @@ void vtkMRMLRTBeamNode::CreateDefaultDisplayNodes()
   }
 }
 
+//----------------------------------------------------------------------------
+std::string vtkMRMLRTBeamNode::GetDefaultStorageNodeClassName(const char* vtkNotUsed(filename))
+{
+  if (this->DoseInfluenceMatrix.nonZeros() == 0)
+  {
+    return "";
+  }
+  return "vtkMRMLRTDoseInfluenceMatrixStorageNode";
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLStorageNode* vtkMRMLRTBeamNode::CreateDefaultStorageNode()
+{
+  vtkMRMLScene* scene = this->GetScene();
+  if (!scene)
+  {
+    vtkErrorMacro("CreateDefaultStorageNode: Invalid MRML scene");
+    return nullptr;
+  }
+  std::string storageNodeClassName = this->GetDefaultStorageNodeClassName();
+  if (storageNodeClassName.empty())
+  {
+    return nullptr;
+  }
+  return vtkMRMLStorageNode::SafeDownCast(scene->CreateNodeByClass(storageNodeClassName.c_str()));
+}
+
 //----------------------------------------------------------------------------
 void vtkMRMLRTBeamNode::CreateDefaultTransformNode()
 {
@@ -1003,6 +1031,15 @@ void vtkMRMLRTBeamNode::SetDoseInfluenceMatrixFromTriplets(
   }
 }
 
+//---------------------------------------------------------------------------
+vtkMRMLRTBeamNode::DoseInfluenceMatrixType& vtkMRMLRTBeamNode::AllocateDoseInfluenceMatrix(
+  int numRows, int numCols, int numNonZeros)
+{
+  this->DoseInfluenceMatrix = DoseInfluenceMatrixType(numRows, numCols);
+  this->DoseInfluenceMatrix.resizeNonZeros(numNonZeros);
+  return this->DoseInfluenceMatrix;
+}
+
 //---------------------------------------------------------------------------
 int vtkMRMLRTBeamNode::GetDoseInfluenceMatrixRowCount()
 {
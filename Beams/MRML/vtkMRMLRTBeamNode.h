@@ -99,6 +99,15 @@ public:
   /// Create and observe default display node
   void CreateDefaultDisplayNodes() override;
 
+  /// Get the class name of the default storage node, which stores the dose influence matrix.
+  /// The beam model is not stored, as it is generated from the beam parameters, so if the dose
+  /// influence matrix is empty then an empty string is returned, as there is no data to store.
+  std::string GetDefaultStorageNodeClassName(const char* filename=nullptr) override;
+
+  /// Create default storage node, which stores the dose influence matrix.
+  /// \return nullptr if the dose influence matrix is empty
+  vtkMRMLStorageNode* CreateDefaultStorageNode() override;
+
   /// Create transform node that places the beam poly data in the right position based on geometry.
   /// Only creates it if missing
   virtual void CreateDefaultTransformNode();
@@ -266,6 +275,11 @@ public:
     int* doseGridDim = nullptr,
     double* doseGridSpacing = nullptr
   );
+  /// Resize dose influence matrix in compressed form with uninitialized contents, to be filled directly
+  /// through its outerIndexPtr (numCols+1 values), innerIndexPtr and valuePtr (numNonZeros values).
+  /// Used by \sa vtkMRMLRTDoseInfluenceMatrixStorageNode
+  DoseInfluenceMatrixType& AllocateDoseInfluenceMatrix(int numRows, int numCols, int numNonZeros);
+
   /// Get dose influence matrix as triplets
   vtkSmartPointer<vtkDoubleArray> GetDoseInfluenceMatrixTriplets();
 
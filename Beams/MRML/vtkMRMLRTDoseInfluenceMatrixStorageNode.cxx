@@ -0,0 +1,500 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Csaba Pinter, PerkLab, Queen's University
+  and was supported through the Applied Cancer Research Unit program of Cancer Care
+  Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
+
+==============================================================================*/
+
+// Beams includes
+#include "vtkMRMLRTDoseInfluenceMatrixStorageNode.h"
+#include "vtkMRMLRTBeamNode.h"
+
+// VTK includes
+#include <vtkObjectFactory.h>
+#include <vtkStringArray.h>
+#include <vtksys/Encoding.hxx>
+#include <vtksys/FStream.hxx>
+
+// STD includes
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+//----------------------------------------------------------------------------
+vtkMRMLNodeNewMacro(vtkMRMLRTDoseInfluenceMatrixStorageNode);
+
+namespace
+{
+//----------------------------------------------------------------------------
+const char FILE_MAGIC[8] = { 'S', 'L', 'R', 'T', 'D', 'I', 'M', '\0' };
+const uint32_t FILE_VERSION = 1;
+const uint32_t FILE_BYTE_ORDER_MARK = 0x01020304;
+/// Row indices are delta encoded within each column as unsigned LEB128 integers
+const uint32_t FILE_FLAG_DELTA_ENCODED_INDICES = 0x1;
+
+//----------------------------------------------------------------------------
+/// File header, followed by the values (double[nonZeros]), the column start offsets
+/// (int32[columns+1]), then the row indices (int32[nonZeros] or the delta encoded stream of IndicesSize bytes)
+struct FileHeader
+{
+  char Magic[8];
+  uint32_t Version;
+  uint32_t Flags;
+  int32_t NumberOfRows;
+  int32_t NumberOfColumns;
+  int64_t NumberOfNonZeros;
+  int32_t DoseGridDim[3];
+  uint32_t ByteOrderMark;
+  double DoseGridSpacing[3];
+  uint64_t IndicesSize;
+  uint8_t Reserved[16];
+};
+static_assert(sizeof(FileHeader) == 96, "Dose influence matrix file header must be 96 bytes");
+
+//----------------------------------------------------------------------------
+/// Read-only memory mapping of a whole file
+class MappedFile
+{
+public:
+  MappedFile() = default;
+  ~MappedFile() { this->Close(); }
+
+  bool Open(const std::string& fileName)
+  {
+    this->Close();
+#ifdef _WIN32
+    std::wstring wideFileName = vtksys::Encoding::ToWide(fileName);
+    this->FileHandle = CreateFileW(wideFileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+      OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (this->FileHandle == INVALID_HANDLE_VALUE)
+    {
+      return false;
+    }
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(this->FileHandle, &fileSize))
+    {
+      this->Close();
+      return false;
+    }
+    this->Size = static_cast<size_t>(fileSize.QuadPart);
+    if (this->Size == 0)
+    {
+      return true;
+    }
+    this->MappingHandle = CreateFileMappingW(this->FileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!this->MappingHandle)
+    {
+      this->Close();
+      return false;
+    }
+    this->Data = static_cast<const char*>(MapViewOfFile(this->MappingHandle, FILE_MAP_READ, 0, 0, 0));
+#else
+    this->FileDescriptor = open(fileName.c_str(), O_RDONLY);
+    if (this->FileDescriptor < 0)
+    {
+      return false;
+    }
+    struct stat fileStat;
+    if (fstat(this->FileDescriptor, &fileStat) != 0)
+    {
+      this->Close();
+      return false;
+    }
+    this->Size = static_cast<size_t>(fileStat.st_size);
+    if (this->Size == 0)
+    {
+      return true;
+    }
+    void* data = mmap(nullptr, this->Size, PROT_READ, MAP_PRIVATE, this->FileDescriptor, 0);
+    if (data == MAP_FAILED)
+    {
+      this->Close();
+      return false;
+    }
+    // The file is read from the beginning to the end
+    madvise(data, this->Size, MADV_SEQUENTIAL);
+    this->Data = static_cast<const char*>(data);
+#endif
+    if (!this->Data)
+    {
+      this->Close();
+      return false;
+    }
+    return true;
+  }
+
+  void Close()
+  {
+#ifdef _WIN32
+    if (this->Data)
+    {
+      UnmapViewOfFile(this->Data);
+    }
+    if (this->MappingHandle)
+    {
+      CloseHandle(this->MappingHandle);
+      this->MappingHandle = nullptr;
+    }
+    if (this->FileHandle != INVALID_HANDLE_VALUE)
+    {
+      CloseHandle(this->FileHandle);
+      this->FileHandle = INVALID_HANDLE_VALUE;
+    }
+#else
+    if (this->Data)
+    {
+      munmap(const_cast<char*>(this->Data), this->Size);
+    }
+    if (this->FileDescriptor >= 0)
+    {
+      close(this->FileDescriptor);
+      this->FileDescriptor = -1;
+    }
+#endif
+    this->Data = nullptr;
+    this->Size = 0;
+  }
+
+  const char* GetData() const { return this->Data; }
+  size_t GetSize() const { return this->Size; }
+
+private:
+  MappedFile(const MappedFile&) = delete;
+  void operator=(const MappedFile&) = delete;
+
+  const char* Data{ nullptr };
+  size_t Size{ 0 };
+#ifdef _WIN32
+  HANDLE FileHandle{ INVALID_HANDLE_VALUE };
+  HANDLE MappingHandle{ nullptr };
+#else
+  int FileDescriptor{ -1 };
+#endif
+};
+
+//----------------------------------------------------------------------------
+/// Number of bytes of an unsigned LEB128 integer
+inline size_t GetEncodedSize(uint32_t value)
+{
+  size_t size = 1;
+  while (value >= 0x80)
+  {
+    value >>= 7;
+    ++size;
+  }
+  return size;
+}
+
+//----------------------------------------------------------------------------
+inline char* EncodeValue(uint32_t value, char* output)
+{
+  while (value >= 0x80)
+  {
+    *(output++) = static_cast<char>((value & 0x7F) | 0x80);
+    value >>= 7;
+  }
+  *(output++) = static_cast<char>(value);
+  return output;
+}
+
+//----------------------------------------------------------------------------
+/// Decode an unsigned LEB128 integer. Returns nullptr if the stream ends or the value does not fit in 32 bits.
+inline const unsigned char* DecodeValue(const unsigned char* input, const unsigned char* end, uint32_t& value)
+{
+  value = 0;
+  for (int shift = 0; shift < 35 && input < end; shift += 7)
+  {
+    unsigned char byte = *(input++);
+    value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+    if (!(byte & 0x80))
+    {
+      return input;
+    }
+  }
+  return nullptr;
+}
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLRTDoseInfluenceMatrixStorageNode::vtkMRMLRTDoseInfluenceMatrixStorageNode() = default;
+
+//----------------------------------------------------------------------------
+vtkMRMLRTDoseInfluenceMatrixStorageNode::~vtkMRMLRTDoseInfluenceMatrixStorageNode() = default;
+
+//----------------------------------------------------------------------------
+bool vtkMRMLRTDoseInfluenceMatrixStorageNode::CanReadInReferenceNode(vtkMRMLNode* refNode)
+{
+  return refNode->IsA("vtkMRMLRTBeamNode");
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLRTDoseInfluenceMatrixStorageNode::InitializeSupportedReadFileTypes()
+{
+  this->SupportedReadFileTypes->InsertNextValue("Dose influence matrix (.rtdim)");
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLRTDoseInfluenceMatrixStorageNode::InitializeSupportedWriteFileTypes()
+{
+  this->SupportedWriteFileTypes->InsertNextValue("Dose influence matrix (.rtdim)");
+}
+
+//----------------------------------------------------------------------------
+const char* vtkMRMLRTDoseInfluenceMatrixStorageNode::GetDefaultWriteFileExtension()
+{
+  return "rtdim";
+}
+
+//----------------------------------------------------------------------------
+int vtkMRMLRTDoseInfluenceMatrixStorageNode::ReadDataInternal(vtkMRMLNode* refNode)
+{
+  vtkMRMLRTBeamNode* beamNode = vtkMRMLRTBeamNode::SafeDownCast(refNode);
+  if (!beamNode)
+  {
+    vtkErrorMacro("ReadDataInternal: Reference node is not a beam node");
+    return 0;
+  }
+
+  std::string fullName = this->GetFullNameFromFileName();
+  if (fullName.empty())
+  {
+    vtkErrorMacro("ReadDataInternal: File name not specified");
+    return 0;
+  }
+
+  MappedFile file;
+  if (!file.Open(fullName))
+  {
+    vtkErrorMacro("ReadDataInternal: Failed to open file " << fullName);
+    return 0;
+  }
+
+  FileHeader header;
+  if (file.GetSize() < sizeof(FileHeader))
+  {
+    vtkErrorMacro("ReadDataInternal: File " << fullName << " is too short to be a dose influence matrix file");
+    return 0;
+  }
+  memcpy(&header, file.GetData(), sizeof(FileHeader));
+  if (memcmp(header.Magic, FILE_MAGIC, sizeof(FILE_MAGIC)) != 0)
+  {
+    vtkErrorMacro("ReadDataInternal: File " << fullName << " is not a dose influence matrix file");
+    return 0;
+  }
+  if (header.ByteOrderMark != FILE_BYTE_ORDER_MARK)
+  {
+    vtkErrorMacro("ReadDataInternal: File " << fullName << " was written with a different byte order");
+    return 0;
+  }
+  if (header.Version != FILE_VERSION)
+  {
+    vtkErrorMacro("ReadDataInternal: Unsupported dose influence matrix file version " << header.Version);
+    return 0;
+  }
+
+  const int numRows = header.NumberOfRows;
+  const int numCols = header.NumberOfColumns;
+  const int64_t numNonZeros = header.NumberOfNonZeros;
+  const bool deltaEncoded = (header.Flags & FILE_FLAG_DELTA_ENCODED_INDICES) != 0;
+  const uint64_t valuesSize = static_cast<uint64_t>(numNonZeros) * sizeof(double);
+  const uint64_t indptrSize = (static_cast<uint64_t>(numCols) + 1) * sizeof(int32_t);
+  const uint64_t indicesSize = deltaEncoded ? header.IndicesSize : static_cast<uint64_t>(numNonZeros) * sizeof(int32_t);
+  if (numRows < 0 || numCols < 0 || numNonZeros < 0 || numNonZeros > INT32_MAX
+    || sizeof(FileHeader) + valuesSize + indptrSize + indicesSize != file.GetSize())
+  {
+    vtkErrorMacro("ReadDataInternal: Invalid matrix size in dose influence matrix file " << fullName);
+    return 0;
+  }
+
+  const char* valuesData = file.GetData() + sizeof(FileHeader);
+  const char* indptrData = valuesData + valuesSize;
+  const char* indicesData = indptrData + indptrSize;
+
+  vtkMRMLRTBeamNode::DoseInfluenceMatrixType& matrix =
+    beamNode->AllocateDoseInfluenceMatrix(numRows, numCols, static_cast<int>(numNonZeros));
+  int* outerIndex = matrix.outerIndexPtr();
+  int* innerIndex = matrix.innerIndexPtr();
+  if (numNonZeros > 0)
+  {
+    memcpy(matrix.valuePtr(), valuesData, valuesSize);
+  }
+  memcpy(outerIndex, indptrData, indptrSize);
+
+  // Column start offsets are validated before the indices are decoded into them
+  bool valid = (outerIndex[0] == 0 && outerIndex[numCols] == numNonZeros);
+  for (int col = 0; valid && col < numCols; ++col)
+  {
+    valid = (outerIndex[col] <= outerIndex[col + 1]);
+  }
+
+  if (valid && deltaEncoded)
+  {
+    const unsigned char* input = reinterpret_cast<const unsigned char*>(indicesData);
+    const unsigned char* inputEnd = input + indicesSize;
+    for (int col = 0; valid && col < numCols; ++col)
+    {
+      int64_t row = -1;
+      for (int k = outerIndex[col]; k < outerIndex[col + 1]; ++k)
+      {
+        uint32_t delta = 0;
+        input = DecodeValue(input, inputEnd, delta);
+        // The first index of a column is stored as is, the others as the difference from the previous one
+        row = (k == outerIndex[col] ? 0 : row) + delta;
+        if (!input || row >= numRows)
+        {
+          valid = false;
+          break;
+        }
+        innerIndex[k] = static_cast<int>(row);
+      }
+    }
+    valid = valid && (input == inputEnd);
+  }
+  else if (valid && numNonZeros > 0)
+  {
+    memcpy(innerIndex, indicesData, indicesSize);
+    for (int64_t k = 0; valid && k < numNonZeros; ++k)
+    {
+      valid = (innerIndex[k] >= 0 && innerIndex[k] < numRows);
+    }
+  }
+
+  if (!valid)
+  {
+    beamNode->AllocateDoseInfluenceMatrix(0, 0, 0);
+    vtkErrorMacro("ReadDataInternal: Corrupt index data in dose influence matrix file " << fullName);
+    return 0;
+  }
+
+  beamNode->SetDoseGridDim(header.DoseGridDim);
+  beamNode->SetDoseGridSpacing(header.DoseGridSpacing);
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+int vtkMRMLRTDoseInfluenceMatrixStorageNode::WriteDataInternal(vtkMRMLNode* refNode)
+{
+  vtkMRMLRTBeamNode* beamNode = vtkMRMLRTBeamNode::SafeDownCast(refNode);
+  if (!beamNode)
+  {
+    vtkErrorMacro("WriteDataInternal: Reference node is not a beam node");
+    return 0;
+  }
+
+  std::string fullName = this->GetFullNameFromFileName();
+  if (fullName.empty())
+  {
+    vtkErrorMacro("WriteDataInternal: File name not specified");
+    return 0;
+  }
+
+  // The arrays reference the matrix of the beam without copying
+  vtkSmartPointer<vtkDoubleArray> data = beamNode->GetDoseInfluenceMatrixData();
+  vtkSmartPointer<vtkIntArray> indices = beamNode->GetDoseInfluenceMatrixIndices();
+  vtkSmartPointer<vtkIntArray> indptr = beamNode->GetDoseInfluenceMatrixIndptr();
+  const int numRows = beamNode->GetDoseInfluenceMatrixRowCount();
+  const int numCols = beamNode->GetDoseInfluenceMatrixColumnCount();
+  const int numNonZeros = static_cast<int>(data->GetNumberOfValues());
+  const int* outerIndex = indptr->GetPointer(0);
+  const int* innerIndex = indices->GetPointer(0);
+  if (indptr->GetNumberOfValues() != numCols + 1 || outerIndex[0] != 0 || outerIndex[numCols] != numNonZeros)
+  {
+    vtkErrorMacro("WriteDataInternal: Dose influence matrix of beam " << beamNode->GetName() << " is not in compressed form");
+    return 0;
+  }
+
+  FileHeader header;
+  memset(&header, 0, sizeof(FileHeader));
+  memcpy(header.Magic, FILE_MAGIC, sizeof(FILE_MAGIC));
+  header.Version = FILE_VERSION;
+  header.ByteOrderMark = FILE_BYTE_ORDER_MARK;
+  header.Flags = (this->UseCompression ? FILE_FLAG_DELTA_ENCODED_INDICES : 0);
+  header.NumberOfRows = numRows;
+  header.NumberOfColumns = numCols;
+  header.NumberOfNonZeros = numNonZeros;
+  beamNode->GetDoseGridDim(header.DoseGridDim);
+  beamNode->GetDoseGridSpacing(header.DoseGridSpacing);
+
+  // Delta encode the row indices. Rows are sorted within each column, so the differences are positive.
+  std::vector<char> encodedIndices;
+  if (this->UseCompression)
+  {
+    size_t encodedSize = 0;
+    for (int col = 0; col < numCols; ++col)
+    {
+      for (int k = outerIndex[col]; k < outerIndex[col + 1]; ++k)
+      {
+        int previousRow = (k == outerIndex[col] ? 0 : innerIndex[k - 1]);
+        if (innerIndex[k] < previousRow)
+        {
+          vtkErrorMacro("WriteDataInternal: Row indices of dose influence matrix of beam " << beamNode->GetName() << " are not sorted");
+          return 0;
+        }
+        encodedSize += GetEncodedSize(static_cast<uint32_t>(innerIndex[k] - previousRow));
+      }
+    }
+    encodedIndices.resize(encodedSize);
+    char* output = encodedIndices.data();
+    for (int col = 0; col < numCols; ++col)
+    {
+      for (int k = outerIndex[col]; k < outerIndex[col + 1]; ++k)
+      {
+        int previousRow = (k == outerIndex[col] ? 0 : innerIndex[k - 1]);
+        output = EncodeValue(static_cast<uint32_t>(innerIndex[k] - previousRow), output);
+      }
+    }
+    header.IndicesSize = encodedSize;
+  }
+  else
+  {
+    header.IndicesSize = static_cast<uint64_t>(numNonZeros) * sizeof(int32_t);
+  }
+
+  vtksys::ofstream outputFile(fullName.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!outputFile.is_open())
+  {
+    vtkErrorMacro("WriteDataInternal: Failed to open file " << fullName << " for writing");
+    return 0;
+  }
+  outputFile.write(reinterpret_cast<const char*>(&header), sizeof(FileHeader));
+  outputFile.write(reinterpret_cast<const char*>(data->GetPointer(0)), static_cast<std::streamsize>(numNonZeros) * sizeof(double));
+  outputFile.write(reinterpret_cast<const char*>(outerIndex), (static_cast<std::streamsize>(numCols) + 1) * sizeof(int32_t));
+  if (this->UseCompression)
+  {
+    outputFile.write(encodedIndices.data(), static_cast<std::streamsize>(encodedIndices.size()));
+  }
+  else
+  {
+    outputFile.write(reinterpret_cast<const char*>(innerIndex), static_cast<std::streamsize>(numNonZeros) * sizeof(int32_t));
+  }
+  outputFile.close();
+  if (outputFile.fail())
+  {
+    vtkErrorMacro("WriteDataInternal: Failed to write file " << fullName);
+    return 0;
+  }
+
+  return 1;
+}
@@ -0,0 +1,81 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Csaba Pinter, PerkLab, Queen's University
+  and was supported through the Applied Cancer Research Unit program of Cancer Care
+  Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
+
+==============================================================================*/
+
+#ifndef __vtkMRMLRTDoseInfluenceMatrixStorageNode_h
+#define __vtkMRMLRTDoseInfluenceMatrixStorageNode_h
+
+// Beams includes
+#include "vtkSlicerBeamsModuleMRMLExport.h"
+
+// MRML includes
+#include <vtkMRMLStorageNode.h>
+
+/// \ingroup SlicerRt_QtModules_Beams
+/// \brief Storage node for the dose influence matrix of beam nodes
+///
+/// The beam geometry is saved in the scene file and the beam model is generated from it, so the only
+/// bulk data of a beam is its dose influence matrix. It is stored in a binary file (.rtdim) containing
+/// the compressed sparse column arrays of the matrix (see \sa vtkMRMLRTBeamNode::GetDoseInfluenceMatrixData,
+/// GetDoseInfluenceMatrixIndices, GetDoseInfluenceMatrixIndptr) and the dose grid dimensions and spacing.
+///
+/// The file is memory mapped when read, and the arrays are copied to the matrix in a single pass.
+/// If compression is enabled (default) then the row indices are delta encoded within each column as
+/// variable length integers, which typically reduces them from four bytes to one, as the voxels hit by
+/// a bixel are mostly adjacent. The values are always stored without loss.
+class VTK_SLICER_BEAMS_MODULE_MRML_EXPORT vtkMRMLRTDoseInfluenceMatrixStorageNode : public vtkMRMLStorageNode
+{
+public:
+  static vtkMRMLRTDoseInfluenceMatrixStorageNode* New();
+  vtkTypeMacro(vtkMRMLRTDoseInfluenceMatrixStorageNode, vtkMRMLStorageNode);
+
+  vtkMRMLNode* CreateNodeInstance() override;
+
+  /// Get node XML tag name (like Storage, Model)
+  const char* GetNodeTagName() override { return "RTDoseInfluenceMatrixStorage"; };
+
+  /// Return true if the node can be read in
+  bool CanReadInReferenceNode(vtkMRMLNode* refNode) override;
+
+  /// Return default file extension for writing
+  const char* GetDefaultWriteFileExtension() override;
+
+protected:
+  /// Initialize all the supported read file types
+  void InitializeSupportedReadFileTypes() override;
+
+  /// Initialize all the supported write file types
+  void InitializeSupportedWriteFileTypes() override;
+
+  /// Read dose influence matrix into the referenced beam node
+  int ReadDataInternal(vtkMRMLNode* refNode) override;
+
+  /// Write dose influence matrix of the referenced beam node
+  int WriteDataInternal(vtkMRMLNode* refNode) override;
+
+protected:
+  vtkMRMLRTDoseInfluenceMatrixStorageNode();
+  ~vtkMRMLRTDoseInfluenceMatrixStorageNode() override;
+
+private:
+  vtkMRMLRTDoseInfluenceMatrixStorageNode(const vtkMRMLRTDoseInfluenceMatrixStorageNode&) = delete;
+  void operator=(const vtkMRMLRTDoseInfluenceMatrixStorageNode&) = delete;
+};
+
+#endif
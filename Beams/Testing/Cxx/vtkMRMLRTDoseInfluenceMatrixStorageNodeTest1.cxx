@@ -0,0 +1,227 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Csaba Pinter, PerkLab, Queen's University
+  and was supported through the Applied Cancer Research Unit program of Cancer Care
+  Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
+
+==============================================================================*/
+
+// Beams includes
+#include "vtkMRMLRTBeamNode.h"
+#include "vtkMRMLRTDoseInfluenceMatrixStorageNode.h"
+#include "vtkMRMLRTPlanNode.h"
+#include "vtkSlicerBeamsModuleLogic.h"
+
+// MRML includes
+#include <vtkMRMLScene.h>
+
+// VTK includes
+#include <vtkNew.h>
+
+// STD includes
+#include <cstring>
+#include <iostream>
+#include <string>
+
+//----------------------------------------------------------------------------
+/// Compare dose influence matrices and dose grids of two beams
+bool AreDoseInfluenceMatricesEqual(vtkMRMLRTBeamNode* beamNode1, vtkMRMLRTBeamNode* beamNode2)
+{
+  vtkMRMLRTBeamNode::DoseInfluenceMatrixType matrix1 = beamNode1->GetDoseInfluenceMatrix();
+  vtkMRMLRTBeamNode::DoseInfluenceMatrixType matrix2 = beamNode2->GetDoseInfluenceMatrix();
+  if (matrix1.rows() != matrix2.rows() || matrix1.cols() != matrix2.cols() || matrix1.nonZeros() != matrix2.nonZeros())
+  {
+    std::cerr << "Matrix size mismatch: " << matrix1.rows() << "x" << matrix1.cols() << " (" << matrix1.nonZeros()
+      << " non-zeros) != " << matrix2.rows() << "x" << matrix2.cols() << " (" << matrix2.nonZeros() << " non-zeros)" << std::endl;
+    return false;
+  }
+  // Values must be restored exactly
+  if (memcmp(matrix1.outerIndexPtr(), matrix2.outerIndexPtr(), (matrix1.cols() + 1) * sizeof(int)) != 0
+    || (matrix1.nonZeros() > 0
+      && (memcmp(matrix1.innerIndexPtr(), matrix2.innerIndexPtr(), matrix1.nonZeros() * sizeof(int)) != 0
+        || memcmp(matrix1.valuePtr(), matrix2.valuePtr(), matrix1.nonZeros() * sizeof(double)) != 0)))
+  {
+    std::cerr << "Matrix content mismatch" << std::endl;
+    return false;
+  }
+  int* dim1 = beamNode1->GetDoseGridDim();
+  int* dim2 = beamNode2->GetDoseGridDim();
+  double* spacing1 = beamNode1->GetDoseGridSpacing();
+  double* spacing2 = beamNode2->GetDoseGridSpacing();
+  for (int i = 0; i < 3; ++i)
+  {
+    if (dim1[i] != dim2[i] || spacing1[i] != spacing2[i])
+    {
+      std::cerr << "Dose grid mismatch" << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+int vtkMRMLRTDoseInfluenceMatrixStorageNodeTest1(int argc, char* argv[])
+{
+  std::string temporaryDirectory;
+  if (argc > 2 && strcmp(argv[1], "-TemporaryDirectory") == 0)
+  {
+    temporaryDirectory = argv[2];
+  }
+  else
+  {
+    std::cerr << "Usage: vtkMRMLRTDoseInfluenceMatrixStorageNodeTest1 -TemporaryDirectory <path>" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Create a matrix with long runs of adjacent voxels in each column (small deltas), isolated voxels
+  // (large deltas), and empty columns
+  int doseGridDim[3] = { 64, 48, 40 };
+  double doseGridSpacing[3] = { 2.5, 2.5, 3.0 };
+  int numRows = doseGridDim[0] * doseGridDim[1] * doseGridDim[2];
+  int numCols = 300;
+  vtkMRMLRTBeamNode::DoseInfluenceMatrixIndexVector rows;
+  vtkMRMLRTBeamNode::DoseInfluenceMatrixIndexVector columns;
+  vtkMRMLRTBeamNode::DoseInfluenceMatrixValueVector values;
+  for (int col = 0; col < numCols; ++col)
+  {
+    if (col % 7 == 3)
+    {
+      continue;
+    }
+    int start = (col * 7919) % (numRows - 1000);
+    for (int row = start; row < start + 500; ++row)
+    {
+      rows.push_back(row);
+      columns.push_back(col);
+      values.push_back(1.0 / (1.0 + row - start) + col * 1e-7);
+    }
+    rows.push_back(numRows - 1 - col);
+    columns.push_back(col);
+    values.push_back(1e-300 * col);
+  }
+
+  vtkNew<vtkMRMLRTBeamNode> beamNode;
+  beamNode->SetDoseInfluenceMatrixFromTriplets(numRows, numCols, rows, columns, values, doseGridDim, doseGridSpacing);
+
+  for (int useCompression = 0; useCompression <= 1; ++useCompression)
+  {
+    std::string fileName = temporaryDirectory + "/DoseInfluenceMatrixTest" + (useCompression ? "_Compressed" : "") + ".rtdim";
+
+    vtkNew<vtkMRMLRTDoseInfluenceMatrixStorageNode> storageNode;
+    storageNode->SetFileName(fileName.c_str());
+    storageNode->SetUseCompression(useCompression);
+    if (!storageNode->WriteData(beamNode))
+    {
+      std::cerr << "Failed to write dose influence matrix to " << fileName << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    vtkNew<vtkMRMLRTBeamNode> readBeamNode;
+    if (!storageNode->ReadData(readBeamNode))
+    {
+      std::cerr << "Failed to read dose influence matrix from " << fileName << std::endl;
+      return EXIT_FAILURE;
+    }
+    if (!AreDoseInfluenceMatricesEqual(beamNode, readBeamNode))
+    {
+      std::cerr << "Dose influence matrix read from " << fileName << " differs from the written one" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  // Empty matrix
+  vtkNew<vtkMRMLRTBeamNode> emptyBeamNode;
+  std::string emptyFileName = temporaryDirectory + "/DoseInfluenceMatrixTest_Empty.rtdim";
+  vtkNew<vtkMRMLRTDoseInfluenceMatrixStorageNode> emptyStorageNode;
+  emptyStorageNode->SetFileName(emptyFileName.c_str());
+  vtkNew<vtkMRMLRTBeamNode> readEmptyBeamNode;
+  if (!emptyStorageNode->WriteData(emptyBeamNode) || !emptyStorageNode->ReadData(readEmptyBeamNode)
+    || !AreDoseInfluenceMatricesEqual(emptyBeamNode, readEmptyBeamNode))
+  {
+    std::cerr << "Failed to write and read empty dose influence matrix" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Save and reload the matrix with the scene, using the default storage node of the beam
+  vtkNew<vtkMRMLScene> mrmlScene;
+  vtkNew<vtkSlicerBeamsModuleLogic> beamsLogic;
+  beamsLogic->SetMRMLScene(mrmlScene);
+
+  vtkNew<vtkMRMLRTBeamNode> sceneBeamNode;
+  mrmlScene->AddNode(sceneBeamNode);
+  vtkNew<vtkMRMLRTPlanNode> planNode;
+  mrmlScene->AddNode(planNode);
+  planNode->AddBeam(sceneBeamNode);
+
+  // No file is needed for beams without dose influence matrix
+  if (!sceneBeamNode->AddDefaultStorageNode() || sceneBeamNode->GetStorageNode())
+  {
+    std::cerr << "Storage node is added to beam with empty dose influence matrix" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  sceneBeamNode->SetDoseInfluenceMatrixFromTriplets(numRows, numCols, rows, columns, values, doseGridDim, doseGridSpacing);
+  if (!sceneBeamNode->AddDefaultStorageNode())
+  {
+    std::cerr << "Failed to add default storage node to beam" << std::endl;
+    return EXIT_FAILURE;
+  }
+  vtkMRMLRTDoseInfluenceMatrixStorageNode* sceneStorageNode =
+    vtkMRMLRTDoseInfluenceMatrixStorageNode::SafeDownCast(sceneBeamNode->GetStorageNode());
+  if (!sceneStorageNode)
+  {
+    std::cerr << "Default storage node of beam is not a dose influence matrix storage node" << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::string sceneMatrixFileName = temporaryDirectory + "/DoseInfluenceMatrixTest_Scene.rtdim";
+  sceneStorageNode->SetFileName(sceneMatrixFileName.c_str());
+  if (!sceneStorageNode->WriteData(sceneBeamNode))
+  {
+    std::cerr << "Failed to write dose influence matrix to " << sceneMatrixFileName << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::string sceneFileName = temporaryDirectory + "/DoseInfluenceMatrixTest.mrml";
+  std::string beamNodeID = sceneBeamNode->GetID();
+  mrmlScene->SetURL(sceneFileName.c_str());
+  mrmlScene->Commit();
+  mrmlScene->Clear(1);
+
+  mrmlScene->SetURL(sceneFileName.c_str());
+  if (!mrmlScene->Connect())
+  {
+    std::cerr << "Failed to load scene " << sceneFileName << std::endl;
+    return EXIT_FAILURE;
+  }
+  vtkMRMLRTBeamNode* loadedBeamNode = vtkMRMLRTBeamNode::SafeDownCast(mrmlScene->GetNodeByID(beamNodeID.c_str()));
+  if (!loadedBeamNode)
+  {
+    std::cerr << "Beam node is not found in loaded scene " << sceneFileName << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (!vtkMRMLRTDoseInfluenceMatrixStorageNode::SafeDownCast(loadedBeamNode->GetStorageNode()))
+  {
+    std::cerr << "Dose influence matrix storage node of beam is not found in loaded scene " << sceneFileName << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (!AreDoseInfluenceMatricesEqual(beamNode, loadedBeamNode))
+  {
+    std::cerr << "Dose influence matrix loaded with scene " << sceneFileName << " differs from the saved one" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "Dose influence matrix storage test passed" << std::endl;
+  return EXIT_SUCCESS;
+}
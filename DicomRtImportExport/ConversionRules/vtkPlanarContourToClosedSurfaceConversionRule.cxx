@@ -33,6 +33,7 @@
 #include <vtkPolyDataToImageStencil.h>
 #include <vtkPolygon.h>
 #include <vtkPriorityQueue.h>
+#include <vtkSMPTools.h>
 #include <vtkStripper.h>
 #include <vtkTextureMapToPlane.h>
 #include <vtkTransform.h>
@@ -45,6 +46,8 @@
 
 // STD includes
 #include <algorithm>
+#include <array>
+#include <cmath>
 
 // SegmentationCore includes
 #if Slicer_VERSION_MAJOR >= 5 || (Slicer_VERSION_MAJOR >= 4 && Slicer_VERSION_MINOR >= 11)
@@ -65,6 +68,123 @@ enum CappingDirection
 };
 static const CappingDirection CappingDirections[] = { CAPPING_BELOW, CAPPING_ABOVE };
 
+namespace
+{
+//----------------------------------------------------------------------------
+/// Uniform grid on the XY bounding boxes of the lines of a plane for finding overlap candidates.
+/// Each line is registered in all the grid cells that its bounding box covers.
+class LineBoundsGrid
+{
+public:
+  /// Build grid from the bounds of lines [firstLineId, endLineId)
+  void Build(const std::vector<std::array<double, 6> >& lineBounds, vtkIdType firstLineId, vtkIdType endLineId)
+  {
+    this->FirstLineId = firstLineId;
+    this->EndLineId = endLineId;
+    this->CellLineIds.clear();
+    vtkIdType numberOfLines = endLineId - firstLineId;
+    if (numberOfLines <= MinimumNumberOfLinesForGrid)
+    {
+      // Testing all lines is faster than building a grid for only a few lines
+      return;
+    }
+
+    this->Origin[0] = this->Origin[1] = VTK_DOUBLE_MAX;
+    double maximum[2] = { VTK_DOUBLE_MIN, VTK_DOUBLE_MIN };
+    for (vtkIdType lineId = firstLineId; lineId < endLineId; ++lineId)
+    {
+      for (int axis = 0; axis < 2; ++axis)
+      {
+        this->Origin[axis] = std::min(this->Origin[axis], lineBounds[lineId][2 * axis]);
+        maximum[axis] = std::max(maximum[axis], lineBounds[lineId][2 * axis + 1]);
+      }
+    }
+    // About one line per cell if the lines are evenly distributed
+    int resolution = std::max(1, static_cast<int>(std::ceil(std::sqrt(static_cast<double>(numberOfLines)))));
+    for (int axis = 0; axis < 2; ++axis)
+    {
+      this->Dimensions[axis] = resolution;
+      this->CellSize[axis] = std::max((maximum[axis] - this->Origin[axis]) / resolution, VTK_DBL_EPSILON);
+    }
+
+    this->CellLineIds.resize(this->Dimensions[0] * this->Dimensions[1]);
+    for (vtkIdType lineId = firstLineId; lineId < endLineId; ++lineId)
+    {
+      int cellRange[4] = { 0, 0, 0, 0 };
+      this->GetCellRange(lineBounds[lineId].data(), cellRange);
+      for (int y = cellRange[2]; y <= cellRange[3]; ++y)
+      {
+        for (int x = cellRange[0]; x <= cellRange[1]; ++x)
+        {
+          this->CellLineIds[y * this->Dimensions[0] + x].push_back(lineId);
+        }
+      }
+    }
+  }
+
+  /// Get the ids of the lines whose grid cells intersect the given bounds, in increasing order
+  void FindCandidates(const double bounds[6], std::vector<vtkIdType>& candidateLineIds) const
+  {
+    candidateLineIds.clear();
+    if (this->CellLineIds.empty())
+    {
+      for (vtkIdType lineId = this->FirstLineId; lineId < this->EndLineId; ++lineId)
+      {
+        candidateLineIds.push_back(lineId);
+      }
+      return;
+    }
+
+    int cellRange[4] = { 0, 0, 0, 0 };
+    if (!this->GetCellRange(bounds, cellRange))
+    {
+      return;
+    }
+    for (int y = cellRange[2]; y <= cellRange[3]; ++y)
+    {
+      for (int x = cellRange[0]; x <= cellRange[1]; ++x)
+      {
+        const std::vector<vtkIdType>& cellLineIds = this->CellLineIds[y * this->Dimensions[0] + x];
+        candidateLineIds.insert(candidateLineIds.end(), cellLineIds.begin(), cellLineIds.end());
+      }
+    }
+    std::sort(candidateLineIds.begin(), candidateLineIds.end());
+    candidateLineIds.erase(std::unique(candidateLineIds.begin(), candidateLineIds.end()), candidateLineIds.end());
+  }
+
+protected:
+  /// Get the range of grid cells covered by the bounds, clamped to the grid
+  /// \return False if the bounds are completely outside the grid
+  bool GetCellRange(const double bounds[6], int cellRange[4]) const
+  {
+    for (int axis = 0; axis < 2; ++axis)
+    {
+      double gridMaximum = this->Origin[axis] + this->CellSize[axis] * this->Dimensions[axis];
+      if (bounds[2 * axis + 1] < this->Origin[axis] || bounds[2 * axis] > gridMaximum)
+      {
+        return false;
+      }
+      int first = static_cast<int>(std::floor((bounds[2 * axis] - this->Origin[axis]) / this->CellSize[axis]));
+      int last = static_cast<int>(std::floor((bounds[2 * axis + 1] - this->Origin[axis]) / this->CellSize[axis]));
+      cellRange[2 * axis] = std::min(std::max(first, 0), this->Dimensions[axis] - 1);
+      cellRange[2 * axis + 1] = std::min(std::max(last, 0), this->Dimensions[axis] - 1);
+    }
+    return true;
+  }
+
+protected:
+  static const vtkIdType MinimumNumberOfLinesForGrid = 8;
+
+  vtkIdType FirstLineId = 0;
+  vtkIdType EndLineId = 0;
+  double Origin[2] = { 0.0, 0.0 };
+  double CellSize[2] = { 1.0, 1.0 };
+  int Dimensions[2] = { 1, 1 };
+  /// Ids of the lines registered in each grid cell (row-major)
+  std::vector<std::vector<vtkIdType> > CellLineIds;
+};
+}
+
 //----------------------------------------------------------------------------
 vtkSegmentationConverterRuleNewMacro(vtkPlanarContourToClosedSurfaceConversionRule);
 
@@ -195,128 +315,109 @@ bool vtkPlanarContourToClosedSurfaceConversionRule::Convert(vtkDataObject* sourc
 
   double spacing = this->GetSpacingBetweenLines(inputContoursCopy);
 
-  std::vector<vtkSmartPointer<vtkPointLocator> > pointLocators(numberOfLines);
+  // Extract the point ids and bounds of each line up front, so that the plane pairs
+  // can be processed concurrently without accessing the cells of the poly data
   std::vector<vtkSmartPointer<vtkIdList> > linePointIdLists(numberOfLines);
+  std::vector<std::array<double, 6> > lineBounds(numberOfLines);
   for (int lineIndex = 0; lineIndex < numberOfLines; ++lineIndex)
   {
-    vtkSmartPointer<vtkLine> currentLine = vtkSmartPointer<vtkLine>::New();
-    currentLine->DeepCopy(inputContoursCopy->GetCell(lineIndex));
-    linePointIdLists[lineIndex] = currentLine->GetPointIds();
-    vtkSmartPointer<vtkPolyData> linePolyData = vtkSmartPointer<vtkPolyData>::New();
-    linePolyData->SetPoints(currentLine->GetPoints());
-    pointLocators[lineIndex] = vtkSmartPointer<vtkPointLocator>::New();
-    pointLocators[lineIndex]->SetDataSet(linePolyData);
-    pointLocators[lineIndex]->BuildLocator();
+    vtkSmartPointer<vtkIdList> linePointIds = vtkSmartPointer<vtkIdList>::New();
+    inputContoursCopy->GetCellPoints(lineIndex, linePointIds);
+    linePointIdLists[lineIndex] = linePointIds;
+
+    vtkSmartPointer<vtkPoints> linePoints = vtkSmartPointer<vtkPoints>::New();
+    outputPoints->GetPoints(linePointIds, linePoints);
+    linePoints->GetBounds(lineBounds[lineIndex].data());
   }
 
   // Vector of booleans to determine which lines are triangulated from above and from below.
-  std::vector< bool > lineTriganulatedToAbove(numberOfLines);
-  std::vector< bool > lineTriganulatedToBelow(numberOfLines);
-  for (int i = 0; i < numberOfLines; ++i)
+  std::vector< bool > lineTriganulatedToAbove(numberOfLines, false);
+  std::vector< bool > lineTriganulatedToBelow(numberOfLines, false);
+
+  // Find the first line of each plane. Plane i contains lines [planeStartLineIndices[i], planeStartLineIndices[i+1])
+  std::vector<vtkIdType> planeStartLineIndices;
+  for (vtkIdType firstLineOnPlaneIndex = 0; firstLineOnPlaneIndex < numberOfLines;
+    firstLineOnPlaneIndex += this->GetNumberOfLinesOnPlane(inputContoursCopy, firstLineOnPlaneIndex, spacing))
   {
-    lineTriganulatedToAbove[i] = false;
-    lineTriganulatedToBelow[i] = false;
+    planeStartLineIndices.push_back(firstLineOnPlaneIndex);
   }
+  planeStartLineIndices.push_back(numberOfLines);
+  int numberOfPlanePairs = std::max(static_cast<int>(planeStartLineIndices.size()) - 2, 0);
 
-  // Get two consecutive planes.
-  vtkIdType firstLineOnPlane1Index = 0; // pointer to first line on plane 1.
-  int numberOfLinesInPlane1 = this->GetNumberOfLinesOnPlane(inputContoursCopy, 0, spacing);
-
-  // Loop through all of the contours in the polydata
-  while (firstLineOnPlane1Index + numberOfLinesInPlane1 < numberOfLines)
+  // Find the overlapping lines between each pair of consecutive planes
+  std::vector<PlanePairTriangulation> planePairTriangulations(numberOfPlanePairs);
+  vtkSMPTools::For(0, numberOfPlanePairs, 1, [&](vtkIdType beginPairIndex, vtkIdType endPairIndex)
   {
-    vtkIdType firstLineOnPlane2Index = firstLineOnPlane1Index + numberOfLinesInPlane1; // pointer to first line on plane 2
-    int numberOfLinesInPlane2 = this->GetNumberOfLinesOnPlane(inputContoursCopy, firstLineOnPlane2Index, spacing); // number of lines on plane 2
-
-    // initialize overlaps lists. - list of list
-    // Each internal list represents a line from the plane and will store the pointers to the overlap lines
-
-    // List of Overlaps for lines that overlap with other lines from plane 1 and 2
-    std::vector< std::vector< vtkIdType > > plane1Overlaps(numberOfLinesInPlane1);
-    std::vector< std::vector< vtkIdType > > plane2Overlaps(numberOfLinesInPlane2);
-
-    // Loop through the lines in the first plane
-    for (int line1Index = 0; line1Index < numberOfLinesInPlane1; ++line1Index)
+    for (vtkIdType pairIndex = beginPairIndex; pairIndex < endPairIndex; ++pairIndex)
     {
-      vtkSmartPointer<vtkLine> line1 = vtkSmartPointer<vtkLine>::New();
-      line1->DeepCopy(inputContoursCopy->GetCell(firstLineOnPlane1Index + line1Index));
+      PlanePairTriangulation& planePair = planePairTriangulations[pairIndex];
+      planePair.FirstLineOnPlane1Index = planeStartLineIndices[pairIndex];
+      planePair.FirstLineOnPlane2Index = planeStartLineIndices[pairIndex + 1];
+      this->FindOverlappingLines(planePair.FirstLineOnPlane1Index, planePair.FirstLineOnPlane2Index, planeStartLineIndices[pairIndex + 2],
+        lineBounds, planePair.Plane1Overlaps, planePair.Plane2Overlaps);
+    }
+  });
 
-      // Loop through the lines in the second plane
-      for (int line2Index = 0; line2Index < numberOfLinesInPlane2; ++line2Index)
+  // Point locators are only needed for finding the closest branch, i.e. for the lines that overlap
+  // together with other lines with the same line on the adjacent plane
+  std::vector<char> lineNeedsPointLocator(numberOfLines, 0);
+  for (const PlanePairTriangulation& planePair : planePairTriangulations)
+  {
+    for (const std::vector<std::vector<vtkIdType> >* planeOverlaps : { &planePair.Plane1Overlaps, &planePair.Plane2Overlaps })
+    {
+      for (const std::vector<vtkIdType>& overlappingLineIds : *planeOverlaps)
       {
-        vtkSmartPointer<vtkLine> line2 = vtkSmartPointer<vtkLine>::New();
-        line2->DeepCopy(inputContoursCopy->GetCell(firstLineOnPlane2Index + line2Index));
-
-        // If the two lines overlap, then add them to the lists
-        if (this->DoLinesOverlap(line1, line2))
+        if (overlappingLineIds.size() > 1)
         {
-          // line from plane 1 overlaps with line from plane 2
-          plane1Overlaps[line1Index].push_back(firstLineOnPlane2Index + line2Index);
-          plane2Overlaps[line2Index].push_back(firstLineOnPlane1Index + line1Index);
+          for (vtkIdType lineIndex : overlappingLineIds)
+          {
+            lineNeedsPointLocator[lineIndex] = 1;
+          }
         }
       }
     }
-
-    // Loop through all of the lines in the first plane
-    for (int line1Index = firstLineOnPlane1Index; line1Index < firstLineOnPlane1Index + numberOfLinesInPlane1; ++line1Index)
+  }
+  std::vector<vtkSmartPointer<vtkPointLocator> > pointLocators(numberOfLines);
+  vtkSMPTools::For(0, numberOfLines, [&](vtkIdType beginLineIndex, vtkIdType endLineIndex)
+  {
+    for (vtkIdType lineIndex = beginLineIndex; lineIndex < endLineIndex; ++lineIndex)
     {
-      vtkSmartPointer<vtkLine> line1 = vtkSmartPointer<vtkLine>::New();
-      line1->DeepCopy(inputContoursCopy->GetCell(line1Index));
-
-      std::vector<vtkSmartPointer<vtkPointLocator> > overlap1PointLocators(plane1Overlaps[line1Index - firstLineOnPlane1Index].size());
-      std::vector<vtkSmartPointer<vtkIdList> > overlap1PointIds(plane1Overlaps[line1Index - firstLineOnPlane1Index].size());
-
-      // Loop through all of the lines in the second plane that overlap with the current line in the first plane
-      for (size_t overlapIndex = 0; overlapIndex < plane1Overlaps[line1Index - firstLineOnPlane1Index].size(); ++overlapIndex) // lines on plane 2 that overlap with line 1
+      if (!lineNeedsPointLocator[lineIndex])
       {
-        vtkIdType j = plane1Overlaps[line1Index - firstLineOnPlane1Index][overlapIndex];
-        overlap1PointLocators[overlapIndex] = pointLocators[j];
-        overlap1PointIds[overlapIndex] = linePointIdLists[j];
+        continue;
       }
+      vtkSmartPointer<vtkPoints> linePoints = vtkSmartPointer<vtkPoints>::New();
+      outputPoints->GetPoints(linePointIdLists[lineIndex], linePoints);
+      vtkSmartPointer<vtkPolyData> linePolyData = vtkSmartPointer<vtkPolyData>::New();
+      linePolyData->SetPoints(linePoints);
+      pointLocators[lineIndex] = vtkSmartPointer<vtkPointLocator>::New();
+      pointLocators[lineIndex]->SetDataSet(linePolyData);
+      pointLocators[lineIndex]->BuildLocator();
+    }
+  });
 
-      // Loop through all of the lines in the second plane that overlap with the current line in the first plane
-      for (size_t overlapIndex = 0; overlapIndex < plane1Overlaps[line1Index - firstLineOnPlane1Index].size(); ++overlapIndex) // lines on plane 2 that overlap with line 1
-      {
-        vtkIdType line2Index = plane1Overlaps[line1Index - firstLineOnPlane1Index][overlapIndex];
-
-        vtkSmartPointer<vtkLine> line2 = vtkSmartPointer<vtkLine>::New();
-        line2->DeepCopy(inputContoursCopy->GetCell(line2Index));
-
-        std::vector<vtkSmartPointer<vtkPointLocator> > overlap2PointLocators(plane2Overlaps[line2Index - firstLineOnPlane2Index].size());
-        std::vector<vtkSmartPointer<vtkIdList> > overlap2PointIds(plane2Overlaps[line2Index - firstLineOnPlane2Index].size());
-
-        for (size_t i = 0; i < plane2Overlaps[line2Index - firstLineOnPlane2Index].size(); ++i)
-        {
-          int j = plane2Overlaps[line2Index - firstLineOnPlane2Index][i];
-          overlap2PointLocators[i] = pointLocators[j];
-          overlap2PointIds[i] = linePointIdLists[j];
-        }
-
-        // Get the portion of line 1 that is close to line 2,
-        vtkSmartPointer<vtkLine> dividedLine1 = vtkSmartPointer<vtkLine>::New();
-        this->Branch(inputContoursCopy, line1, line2Index, plane1Overlaps[line1Index - firstLineOnPlane1Index], overlap1PointLocators, overlap1PointIds, dividedLine1);
-        vtkSmartPointer<vtkIdList> dividedPointsInLine1 = dividedLine1->GetPointIds();
-        int numberOfdividedPointsInLine1 = dividedLine1->GetNumberOfPoints();
-
-        // Get the portion of line 2 that is close to line 1.
-        vtkSmartPointer<vtkLine> dividedLine2 = vtkSmartPointer<vtkLine>::New();
-        this->Branch(inputContoursCopy, line2, line1Index, plane2Overlaps[line2Index - firstLineOnPlane2Index], overlap2PointLocators, overlap2PointIds, dividedLine2);
-        vtkSmartPointer<vtkIdList> dividedPointsInLine2 = dividedLine2->GetPointIds();
-        int numberOfdividedPointsInLine2 = dividedLine2->GetNumberOfPoints();
-
-        if (numberOfdividedPointsInLine1 > 1 && numberOfdividedPointsInLine2 > 1)
-        {
-          lineTriganulatedToAbove[line1Index] = true;
-          lineTriganulatedToBelow[line2Index] = true;
-          this->TriangulateBetweenContours(inputContoursCopy, dividedPointsInLine1, dividedPointsInLine2, outputPolygons);
-        }
-
-      }
+  // Triangulate between each pair of consecutive planes. The pairs are independent, so they are processed
+  // in parallel, each into its own cell array. The cell arrays are then appended in plane order, so the
+  // output does not depend on the number of threads.
+  vtkSMPTools::For(0, numberOfPlanePairs, 1, [&](vtkIdType beginPairIndex, vtkIdType endPairIndex)
+  {
+    for (vtkIdType pairIndex = beginPairIndex; pairIndex < endPairIndex; ++pairIndex)
+    {
+      this->TriangulatePlanePair(inputContoursCopy, pointLocators, linePointIdLists, planePairTriangulations[pairIndex]);
     }
+  });
 
-    // Advance the points
-    firstLineOnPlane1Index = firstLineOnPlane2Index;
-    numberOfLinesInPlane1 = numberOfLinesInPlane2;
+  for (const PlanePairTriangulation& planePairTriangulation : planePairTriangulations)
+  {
+    outputPolygons->Append(planePairTriangulation.Polygons);
+    for (vtkIdType lineIndex : planePairTriangulation.LinesTriangulatedToAbove)
+    {
+      lineTriganulatedToAbove[lineIndex] = true;
+    }
+    for (vtkIdType lineIndex : planePairTriangulation.LinesTriangulatedToBelow)
+    {
+      lineTriganulatedToBelow[lineIndex] = true;
+    }
   }
 
   // Triangulate all contours which are exposed.
@@ -343,6 +444,103 @@ bool vtkPlanarContourToClosedSurfaceConversionRule::Convert(vtkDataObject* sourc
   return true;
 }
 
+//----------------------------------------------------------------------------
+void vtkPlanarContourToClosedSurfaceConversionRule::FindOverlappingLines(
+  vtkIdType firstLineOnPlane1Index, vtkIdType firstLineOnPlane2Index, vtkIdType endLineOnPlane2Index,
+  const std::vector<std::array<double, 6> >& lineBounds,
+  std::vector<std::vector<vtkIdType> >& plane1Overlaps, std::vector<std::vector<vtkIdType> >& plane2Overlaps)
+{
+  int numberOfLinesInPlane1 = firstLineOnPlane2Index - firstLineOnPlane1Index;
+  int numberOfLinesInPlane2 = endLineOnPlane2Index - firstLineOnPlane2Index;
+
+  // initialize overlaps lists. - list of list
+  // Each internal list represents a line from the plane and will store the pointers to the overlap lines
+  plane1Overlaps.assign(numberOfLinesInPlane1, std::vector<vtkIdType>());
+  plane2Overlaps.assign(numberOfLinesInPlane2, std::vector<vtkIdType>());
+
+  // Only the lines of plane 2 whose grid cells are covered by the line of plane 1 are tested for overlap.
+  // The candidates are sorted, so the overlap lists are in line order, the same as when testing all pairs.
+  LineBoundsGrid plane2Grid;
+  plane2Grid.Build(lineBounds, firstLineOnPlane2Index, endLineOnPlane2Index);
+  std::vector<vtkIdType> candidateLineIds;
+
+  // Loop through the lines in the first plane
+  for (int line1Index = 0; line1Index < numberOfLinesInPlane1; ++line1Index)
+  {
+    const double* line1Bounds = lineBounds[firstLineOnPlane1Index + line1Index].data();
+    plane2Grid.FindCandidates(line1Bounds, candidateLineIds);
+
+    // Loop through the candidate lines in the second plane
+    for (vtkIdType line2Id : candidateLineIds)
+    {
+      // If the two lines overlap, then add them to the lists
+      if (this->DoLinesOverlap(line1Bounds, lineBounds[line2Id].data()))
+      {
+        // line from plane 1 overlaps with line from plane 2
+        plane1Overlaps[line1Index].push_back(line2Id);
+        plane2Overlaps[line2Id - firstLineOnPlane2Index].push_back(firstLineOnPlane1Index + line1Index);
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkPlanarContourToClosedSurfaceConversionRule::TriangulatePlanePair(vtkPolyData* inputROIPoints,
+  const std::vector<vtkSmartPointer<vtkPointLocator> >& pointLocators,
+  const std::vector<vtkSmartPointer<vtkIdList> >& linePointIdLists,
+  PlanePairTriangulation& planePair)
+{
+  planePair.Polygons = vtkSmartPointer<vtkCellArray>::New();
+  planePair.LinesTriangulatedToAbove.clear();
+  planePair.LinesTriangulatedToBelow.clear();
+
+  vtkIdType firstLineOnPlane1Index = planePair.FirstLineOnPlane1Index;
+  vtkIdType firstLineOnPlane2Index = planePair.FirstLineOnPlane2Index;
+  const std::vector<std::vector<vtkIdType> >& plane1Overlaps = planePair.Plane1Overlaps;
+  const std::vector<std::vector<vtkIdType> >& plane2Overlaps = planePair.Plane2Overlaps;
+
+  // Loop through all of the lines in the first plane
+  for (vtkIdType line1Index = firstLineOnPlane1Index; line1Index < firstLineOnPlane2Index; ++line1Index)
+  {
+    const std::vector<vtkIdType>& line1Overlaps = plane1Overlaps[line1Index - firstLineOnPlane1Index];
+    std::vector<vtkSmartPointer<vtkPointLocator> > overlap1PointLocators(line1Overlaps.size());
+    std::vector<vtkSmartPointer<vtkIdList> > overlap1PointIds(line1Overlaps.size());
+    for (size_t overlapIndex = 0; overlapIndex < line1Overlaps.size(); ++overlapIndex) // lines on plane 2 that overlap with line 1
+    {
+      overlap1PointLocators[overlapIndex] = pointLocators[line1Overlaps[overlapIndex]];
+      overlap1PointIds[overlapIndex] = linePointIdLists[line1Overlaps[overlapIndex]];
+    }
+
+    // Loop through all of the lines in the second plane that overlap with the current line in the first plane
+    for (vtkIdType line2Index : line1Overlaps)
+    {
+      const std::vector<vtkIdType>& line2Overlaps = plane2Overlaps[line2Index - firstLineOnPlane2Index];
+      std::vector<vtkSmartPointer<vtkPointLocator> > overlap2PointLocators(line2Overlaps.size());
+      std::vector<vtkSmartPointer<vtkIdList> > overlap2PointIds(line2Overlaps.size());
+      for (size_t overlapIndex = 0; overlapIndex < line2Overlaps.size(); ++overlapIndex)
+      {
+        overlap2PointLocators[overlapIndex] = pointLocators[line2Overlaps[overlapIndex]];
+        overlap2PointIds[overlapIndex] = linePointIdLists[line2Overlaps[overlapIndex]];
+      }
+
+      // Get the portion of line 1 that is close to line 2,
+      vtkSmartPointer<vtkIdList> dividedPointsInLine1 = vtkSmartPointer<vtkIdList>::New();
+      this->Branch(inputROIPoints, linePointIdLists[line1Index], line2Index, line1Overlaps, overlap1PointLocators, overlap1PointIds, dividedPointsInLine1);
+
+      // Get the portion of line 2 that is close to line 1.
+      vtkSmartPointer<vtkIdList> dividedPointsInLine2 = vtkSmartPointer<vtkIdList>::New();
+      this->Branch(inputROIPoints, linePointIdLists[line2Index], line1Index, line2Overlaps, overlap2PointLocators, overlap2PointIds, dividedPointsInLine2);
+
+      if (dividedPointsInLine1->GetNumberOfIds() > 1 && dividedPointsInLine2->GetNumberOfIds() > 1)
+      {
+        planePair.LinesTriangulatedToAbove.push_back(line1Index);
+        planePair.LinesTriangulatedToBelow.push_back(line2Index);
+        this->TriangulateBetweenContours(inputROIPoints, dividedPointsInLine1, dividedPointsInLine2, planePair.Polygons);
+      }
+    }
+  }
+}
+
 //----------------------------------------------------------------------------
 void vtkPlanarContourToClosedSurfaceConversionRule::TriangulateBetweenContours(vtkPolyData* inputROIPoints, vtkIdList* pointsInLine1, vtkIdList* pointsInLine2, vtkCellArray* outputPolygons)
 {
@@ -974,6 +1172,12 @@ bool vtkPlanarContourToClosedSurfaceConversionRule::DoLinesOverlap(vtkLine* line
   double bounds2[6];
   line2->GetBounds(bounds2);
 
+  return this->DoLinesOverlap(bounds1, bounds2);
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlanarContourToClosedSurfaceConversionRule::DoLinesOverlap(const double bounds1[6], const double bounds2[6])
+{
   return bounds1[0] < bounds2[1] &&
     bounds1[1] > bounds2[0] &&
     bounds1[2] < bounds2[3] &&
@@ -982,7 +1186,9 @@ bool vtkPlanarContourToClosedSurfaceConversionRule::DoLinesOverlap(vtkLine* line
 
 // TODO: It may be possible to speed up this function by only calling the branch function once. -- need to look into this
 //----------------------------------------------------------------------------
-void vtkPlanarContourToClosedSurfaceConversionRule::Branch(vtkPolyData* inputROIPoints, vtkLine* branchingLine, vtkIdType currentLineId, std::vector< vtkIdType > overlappingLineIds, std::vector<vtkSmartPointer<vtkPointLocator> > pointLocators, std::vector<vtkSmartPointer<vtkIdList> > lineIdLists, vtkLine* outputLine)
+void vtkPlanarContourToClosedSurfaceConversionRule::Branch(vtkPolyData* inputROIPoints, vtkIdList* branchingLinePointIds, vtkIdType currentLineId,
+  const std::vector< vtkIdType >& overlappingLineIds, const std::vector<vtkSmartPointer<vtkPointLocator> >& pointLocators,
+  const std::vector<vtkSmartPointer<vtkIdList> >& lineIdLists, vtkIdList* outputLinePointIds)
 {
   if (!inputROIPoints)
   {
@@ -990,18 +1196,17 @@ void vtkPlanarContourToClosedSurfaceConversionRule::Branch(vtkPolyData* inputROI
     return;
   }
 
-  if (!branchingLine)
+  if (!branchingLinePointIds || !outputLinePointIds)
   {
-    vtkErrorMacro("Branch: Invalid vtkLine");
+    vtkErrorMacro("Branch: Invalid vtkIdList");
     return;
   }
 
-  vtkSmartPointer<vtkIdList> outputLinePointIds = outputLine->GetPointIds();
   outputLinePointIds->Initialize();
 
   if (overlappingLineIds.size() == 1)
   {
-    outputLinePointIds->DeepCopy(branchingLine->GetPointIds());
+    outputLinePointIds->DeepCopy(branchingLinePointIds);
     return;
   }
 
@@ -1009,9 +1214,10 @@ void vtkPlanarContourToClosedSurfaceConversionRule::Branch(vtkPolyData* inputROI
   bool prev = false; // TODO: Clean up
 
   // Loop through all of the points in the current line
-  for (int currentPointIndex = 0; currentPointIndex < branchingLine->GetNumberOfPoints(); ++currentPointIndex)
+  vtkIdType numberOfBranchingLinePoints = branchingLinePointIds->GetNumberOfIds();
+  for (vtkIdType currentPointIndex = 0; currentPointIndex < numberOfBranchingLinePoints; ++currentPointIndex)
   {
-    vtkIdType currentPointId = branchingLine->GetPointId(currentPointIndex);
+    vtkIdType currentPointId = branchingLinePointIds->GetId(currentPointIndex);
 
     double currentPoint[3] = { 0,0,0 };
     inputROIPoints->GetPoint(currentPointId, currentPoint);
@@ -1032,11 +1238,11 @@ void vtkPlanarContourToClosedSurfaceConversionRule::Branch(vtkPolyData* inputROI
       prev = false;
     }
   }
-  int dividedNumberOfPoints = outputLine->GetNumberOfPoints();
+  vtkIdType dividedNumberOfPoints = outputLinePointIds->GetNumberOfIds();
   if (dividedNumberOfPoints > 1)
   {
     // Determine if the trunk was originally a closed contour.
-    bool lineIsClosed = (branchingLine->GetPointId(0) == branchingLine->GetPointId(branchingLine->GetNumberOfPoints() - 1));
+    bool lineIsClosed = (branchingLinePointIds->GetId(0) == branchingLinePointIds->GetId(numberOfBranchingLinePoints - 1));
 
     if (lineIsClosed && (outputLinePointIds->GetId(0) != outputLinePointIds->GetId(dividedNumberOfPoints - 1)))
     {
@@ -1047,7 +1253,9 @@ void vtkPlanarContourToClosedSurfaceConversionRule::Branch(vtkPolyData* inputROI
 }
 
 //----------------------------------------------------------------------------
-int vtkPlanarContourToClosedSurfaceConversionRule::GetClosestBranch(vtkPolyData* inputROIPoints, double* originalPoint, std::vector< vtkIdType > overlappingLineIds, std::vector<vtkSmartPointer<vtkPointLocator> > pointLocators, std::vector<vtkSmartPointer<vtkIdList> > lineIdLists)
+int vtkPlanarContourToClosedSurfaceConversionRule::GetClosestBranch(vtkPolyData* inputROIPoints, double* originalPoint,
+  const std::vector< vtkIdType >& overlappingLineIds, const std::vector<vtkSmartPointer<vtkPointLocator> >& pointLocators,
+  const std::vector<vtkSmartPointer<vtkIdList> >& lineIdLists)
 {
   if (!inputROIPoints)
   {
@@ -1066,6 +1274,20 @@ int vtkPlanarContourToClosedSurfaceConversionRule::GetClosestBranch(vtkPolyData*
   // Loop through all of the lines that overlap with the line the original point is on
   for (size_t currentOverlapIndex = 0; currentOverlapIndex < overlappingLineIds.size(); ++currentOverlapIndex)
   {
+    // The distance from the bounds of the line in the XY plane is a lower bound of the distance from its points.
+    // If it is not less than the current minimum, then the line cannot be closer, so the locator query can be skipped.
+    const double* lineBounds = pointLocators[currentOverlapIndex]->GetBounds();
+    double boundsDistanceSquared = 0.0;
+    for (int axis = 0; axis < 2; ++axis)
+    {
+      double axisDistance = std::max(std::max(lineBounds[2 * axis] - originalPoint[axis], originalPoint[axis] - lineBounds[2 * axis + 1]), 0.0);
+      boundsDistanceSquared += axisDistance * axisDistance;
+    }
+    if (boundsDistanceSquared >= minimumDistanceSquared)
+    {
+      continue;
+    }
+
     vtkIdType closestPointId = pointLocators[currentOverlapIndex]->FindClosestPoint(originalPoint);
     double currentPoint[3] = { 0,0,0 };
     inputROIPoints->GetPoint(lineIdLists[currentOverlapIndex]->GetId(closestPointId), currentPoint);
@@ -1082,7 +1304,8 @@ int vtkPlanarContourToClosedSurfaceConversionRule::GetClosestBranch(vtkPolyData*
 }
 
 //----------------------------------------------------------------------------
-void vtkPlanarContourToClosedSurfaceConversionRule::EndCapping(vtkPolyData* inputROIPoints, vtkCellArray* outputPolygons, std::vector< bool > lineTriganulatedToAbove, std::vector< bool > lineTriganulatedToBelow)
+void vtkPlanarContourToClosedSurfaceConversionRule::EndCapping(vtkPolyData* inputROIPoints, vtkCellArray* outputPolygons,
+  const std::vector< bool >& lineTriganulatedToAbove, const std::vector< bool >& lineTriganulatedToBelow)
 {
   if (!inputROIPoints)
   {
@@ -1164,15 +1387,15 @@ void vtkPlanarContourToClosedSurfaceConversionRule::EndCapping(vtkPolyData* inpu
         // Loop through all of the external lines that were created
         for (int currentLineId = 0; currentLineId < numberOfCells; ++currentLineId)
         {
-          vtkSmartPointer<vtkLine> dividedLine = vtkSmartPointer<vtkLine>::New();
-          this->Branch(inputROIPoints, currentLine, currentLineId, overlapLineIds, pointLocators, idLists, dividedLine);
+          vtkSmartPointer<vtkIdList> dividedLinePointIds = vtkSmartPointer<vtkIdList>::New();
+          this->Branch(inputROIPoints, currentLine->GetPointIds(), currentLineId, overlapLineIds, pointLocators, idLists, dividedLinePointIds);
           if (direction == CAPPING_ABOVE)
           {
-            this->TriangulateBetweenContours(inputROIPoints, dividedLine->GetPointIds(), idLists[currentLineId], outputPolygons);
+            this->TriangulateBetweenContours(inputROIPoints, dividedLinePointIds, idLists[currentLineId], outputPolygons);
           }
           else
           {
-            this->TriangulateBetweenContours(inputROIPoints, idLists[currentLineId], dividedLine->GetPointIds(), outputPolygons);
+            this->TriangulateBetweenContours(inputROIPoints, idLists[currentLineId], dividedLinePointIds, outputPolygons);
           }
         }
       } // end if (!lineTriangulated)
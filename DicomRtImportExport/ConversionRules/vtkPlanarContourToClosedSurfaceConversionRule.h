@@ -33,6 +33,10 @@
 // VTK includes
 #include "vtkPointLocator.h"
 
+// STD includes
+#include <array>
+#include <vector>
+
 class vtkPolyData;
 class vtkIdList;
 class vtkCellArray;
@@ -94,10 +98,54 @@ public:
   /// Human-readable name of the target representation
   const char* GetTargetRepresentationName() override { return vtkSegmentationConverter::GetSegmentationClosedSurfaceRepresentationName(); };
 
+protected:
+  /// Overlapping lines and result of the triangulation between the contours of two consecutive planes
+  struct PlanePairTriangulation
+  {
+    /// Index of the first line on the lower plane
+    vtkIdType FirstLineOnPlane1Index = 0;
+    /// Index of the first line on the upper plane (end of the lines of the lower plane)
+    vtkIdType FirstLineOnPlane2Index = 0;
+    /// For each line of the lower plane, the ids of the lines on the upper plane that overlap with it
+    std::vector<std::vector<vtkIdType> > Plane1Overlaps;
+    /// For each line of the upper plane, the ids of the lines on the lower plane that overlap with it
+    std::vector<std::vector<vtkIdType> > Plane2Overlaps;
+    /// Triangles connecting the contours of the two planes
+    vtkSmartPointer<vtkCellArray> Polygons;
+    /// Lines of the lower plane that were connected to the upper plane
+    std::vector<vtkIdType> LinesTriangulatedToAbove;
+    /// Lines of the upper plane that were connected to the lower plane
+    std::vector<vtkIdType> LinesTriangulatedToBelow;
+  };
+
 protected:
   vtkPlanarContourToClosedSurfaceConversionRule();
   ~vtkPlanarContourToClosedSurfaceConversionRule() override;
 
+  /// Find the lines of two consecutive planes that overlap in the XY plane.
+  /// A uniform grid is built on the bounding boxes of the lines of the upper plane, so that only the lines in the
+  /// grid cells covered by a line of the lower plane are tested, instead of all the pairs.
+  /// \param firstLineOnPlane1Index Index of the first line on the lower plane
+  /// \param firstLineOnPlane2Index Index of the first line on the upper plane (end of the lines of the lower plane)
+  /// \param endLineOnPlane2Index End of the lines of the upper plane
+  /// \param lineBounds Bounds of all the lines
+  /// \param plane1Overlaps Output overlapping lines for each line of the lower plane, in increasing order
+  /// \param plane2Overlaps Output overlapping lines for each line of the upper plane, in increasing order
+  void FindOverlappingLines(vtkIdType firstLineOnPlane1Index, vtkIdType firstLineOnPlane2Index, vtkIdType endLineOnPlane2Index,
+    const std::vector<std::array<double, 6> >& lineBounds,
+    std::vector<std::vector<vtkIdType> >& plane1Overlaps, std::vector<std::vector<vtkIdType> >& plane2Overlaps);
+
+  /// Triangulate between the overlapping contours of two consecutive planes.
+  /// Does not access the cells of the input poly data, so it can be called concurrently for different plane pairs.
+  /// \param inputROIPoints Polydata containing all of the points and contours
+  /// \param pointLocators Point locators for the lines that overlap with the same line on the adjacent plane
+  /// \param linePointIdLists Point ids of all the lines
+  /// \param planePair Plane pair with the overlapping lines found. The triangles and triangulated lines are stored in it.
+  void TriangulatePlanePair(vtkPolyData* inputROIPoints,
+    const std::vector<vtkSmartPointer<vtkPointLocator> >& pointLocators,
+    const std::vector<vtkSmartPointer<vtkIdList> >& linePointIdLists,
+    PlanePairTriangulation& planePair);
+
   /// Construct a surface triangulation between two lines using a dynamic programming algorithm.
   /// \param inputROIPoints Polydata containing all of the points and contours
   /// \param pointsInLine1 List of points that are contained in the line to be triangulated
@@ -154,16 +202,20 @@ protected:
   /// \param The first line
   /// \param The second line
   bool DoLinesOverlap(vtkLine* line1, vtkLine* line2);
+  /// Determine if two contours overlap in the XY axis based on their bounds.
+  bool DoLinesOverlap(const double bounds1[6], const double bounds2[6]);
 
   /// Create a branching pattern for overlapping contours.
   /// \param inputROIPoints Polydata containing all of the points and contours
-  /// \param branchingLine The orignal line that is being divided
+  /// \param branchingLinePointIds Point ids of the orignal line that is being divided
   /// \param currentLineId The ID of the current line in the input polydata that is being compared
   /// \param overlappingLineIds List of line IDs for lines that overlap with the current line
   /// \param pointLocators List of point locators for lines in the overlap list
   /// \param lineIdLists List of vtkIdLists for all of the lines in the overlap list
-  /// \param outputLine The output branched line
-  void Branch(vtkPolyData* inputROIPoints, vtkLine* branchingLine, vtkIdType currentLineId, std::vector< vtkIdType > overlappingLineIds, std::vector<vtkSmartPointer<vtkPointLocator> > pointLocators, std::vector<vtkSmartPointer<vtkIdList> > lineIdLists, vtkLine* outputLine);
+  /// \param outputLinePointIds Point ids of the output branched line
+  void Branch(vtkPolyData* inputROIPoints, vtkIdList* branchingLinePointIds, vtkIdType currentLineId,
+    const std::vector< vtkIdType >& overlappingLineIds, const std::vector<vtkSmartPointer<vtkPointLocator> >& pointLocators,
+    const std::vector<vtkSmartPointer<vtkIdList> >& lineIdLists, vtkIdList* outputLinePointIds);
 
   /// Find the branch closest from the point on the trunk
   /// \param inputROIPoints Polydata containing all of the points and contours
@@ -171,7 +223,9 @@ protected:
   /// \param overlappingLineIds List of line IDs for lines that overlap with the current line
   /// \param pointLocators List of point locators for lines in the overlap list
   /// \param lineIdLists List of vtkIdLists for all of the lines in the overlap list
-  int GetClosestBranch(vtkPolyData* inputROIPoints, double* originalPoint, std::vector< vtkIdType > overlappingLineIds, std::vector<vtkSmartPointer<vtkPointLocator> > pointLocators, std::vector<vtkSmartPointer<vtkIdList> > lineIdLists);
+  int GetClosestBranch(vtkPolyData* inputROIPoints, double* originalPoint,
+    const std::vector< vtkIdType >& overlappingLineIds, const std::vector<vtkSmartPointer<vtkPointLocator> >& pointLocators,
+    const std::vector<vtkSmartPointer<vtkIdList> >& lineIdLists);
 
   /// Seal the exterior contours of the mesh.
   /// \param inputROIPoints Polydata containing all of the points and contours
@@ -179,7 +233,8 @@ protected:
   /// \param outputPolygons
   /// \param lineTriganulatedToAbove
   /// \param lineTriganulatedToBelow
-  void EndCapping(vtkPolyData* inputROIPoints, vtkCellArray* outputPolygons, std::vector< bool > lineTriganulatedToAbove, std::vector< bool > lineTriganulatedToBelow);
+  void EndCapping(vtkPolyData* inputROIPoints, vtkCellArray* outputPolygons,
+    const std::vector< bool >& lineTriganulatedToAbove, const std::vector< bool >& lineTriganulatedToBelow);
 
   /// Calculate the spacing between the lines in the polydata
   /// WARNING: This function requires that the normal vector of all contours is aligned with the Z-axis.
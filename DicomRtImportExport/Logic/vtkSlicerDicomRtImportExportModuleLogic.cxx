@@ -115,12 +115,14 @@
 #include <vtkObjectFactory.h>
 #include <vtkPlane.h>
 #include <vtkPolyData.h>
+#include <vtkSMPTools.h>
 #include <vtkSmartPointer.h>
 #include <vtkStringArray.h>
 #include <vtkStripper.h>
 #include <vtkTransformPolyDataFilter.h>
 #include <vtkTable.h>
 #include <vtkDoubleArray.h>
+#include <vtksys/SystemTools.hxx>
 
 // ITK includes
 #include <itkImage.h>
@@ -132,6 +134,10 @@
 #include "vtkSlicerDICOMLoadable.h"
 #include "vtkSlicerDICOMExportable.h"
 
+// STD includes
+#include <algorithm>
+#include <map>
+
 //----------------------------------------------------------------------------
 vtkStandardNewMacro(vtkSlicerDicomRtImportExportModuleLogic);
 
@@ -150,20 +156,41 @@ public:
   vtkInternal(vtkSlicerDicomRtImportExportModuleLogic* external);
   ~vtkInternal() = default;
 
+  /// Result of examining a DICOM file for loading
+  struct ExaminedFile
+  {
+    /// File size and modification time at examination, used to validate the cached result
+    unsigned long FileSize{0};
+    long ModifiedTime{0};
+    /// True if the file contains a loadable RT object
+    bool Loadable{false};
+    OFString SOPClassUID;
+    /// Loadable name. For RT doses it does not contain the referenced plan label, which is
+    /// looked up in the DICOM database by \sa AddReferencedRtPlanLabelsToRtDoseNames
+    OFString Name;
+    std::vector<OFString> ReferencedSOPInstanceUIDs;
+  };
+
+  /// Examine a DICOM file for loading. Only the header tags needed for the examination are read,
+  /// the large sequences and the pixel data are not. Can be called concurrently for different files,
+  /// as it does not access the DICOM database or the MRML scene.
+  /// \param examinedFile Output examination result (file size and modification time are not changed)
+  static void ExamineFile(const std::string& fileName, ExaminedFile& examinedFile);
+
   /// Examine RT Dose dataset and assemble name and referenced SOP instances
-  void ExamineRtDoseDataset(DcmDataset* dataset, OFString &name, std::vector<OFString> &referencedSOPInstanceUIDs);
+  static void ExamineRtDoseDataset(DcmDataset* dataset, OFString &name, std::vector<OFString> &referencedSOPInstanceUIDs);
 
   /// Examine RT Plan dataset and assemble name and referenced SOP instances
-  void ExamineRtPlanDataset(DcmDataset* dataset, OFString &name, std::vector<OFString> &referencedSOPInstanceUIDs);
-
-  /// Examine RT Ion Plan dataset and assemble name and referenced SOP instances
-  void ExamineRtIonPlanDataset(DcmDataset* dataset, OFString &name, std::vector<OFString> &referencedSOPInstanceUIDs);
+  static void ExamineRtPlanDataset(DcmDataset* dataset, OFString &name, std::vector<OFString> &referencedSOPInstanceUIDs);
 
   /// Examine RT Structure Set dataset and assemble name and referenced SOP instances
-  void ExamineRtStructureSetDataset(DcmDataset* dataset, OFString &name, std::vector<OFString> &referencedSOPInstanceUIDs);
+  static void ExamineRtStructureSetDataset(DcmDataset* dataset, OFString &name, std::vector<OFString> &referencedSOPInstanceUIDs);
 
   /// Examine RT Image dataset and assemble name and referenced SOP instances
-  void ExamineRtImageDataset(DcmDataset* dataset, OFString &name, std::vector<OFString> &referencedSOPInstanceUIDs);
+  static void ExamineRtImageDataset(DcmDataset* dataset, OFString &name, std::vector<OFString> &referencedSOPInstanceUIDs);
+
+  /// Append the label of the referenced RT plan (looked up in the DICOM database) to the names of the examined RT doses
+  void AddReferencedRtPlanLabelsToRtDoseNames(std::vector<ExaminedFile>& examinedFiles);
 
   /// Load RT Dose and related objects into the MRML scene
   /// \return Success flag
@@ -231,8 +258,19 @@ public:
   /// \param roiReferencedSeriesUid Uid of the input series for which slice spacing is to be calculated.
   double CalculateSliceSpacing(vtkSlicerDicomRtReader* rtReader, const char* roiReferencedSeriesUid);
 
+  /// Generate closed surface representation from the planar contours for the given segments concurrently.
+  /// The conversions run on temporary segments, so that no segmentation events are invoked from the worker threads.
+  /// The resulting surfaces are added to the segments in the given order on the calling thread.
+  /// \param segmentation Segmentation containing the segments, providing the conversion parameters
+  /// \param segments Segments with planar contour representation, in ROI order
+  void GenerateClosedSurfacesInParallel(vtkSegmentation* segmentation, const std::vector<vtkSegment*>& segments);
+
 public:
   vtkSlicerDicomRtImportExportModuleLogic* External;
+
+  /// Examination results of the files examined so far, keyed on file path.
+  /// A result is reused while the size and modification time of the file are unchanged.
+  std::map<std::string, ExaminedFile> ExaminedFileCache;
 };
 
 //----------------------------------------------------------------------------
@@ -244,6 +282,93 @@ vtkSlicerDicomRtImportExportModuleLogic::vtkInternal::vtkInternal(vtkSlicerDicom
 {
 }
 
+//-----------------------------------------------------------------------------
+void vtkSlicerDicomRtImportExportModuleLogic::vtkInternal::ExamineFile(const std::string& fileName, ExaminedFile& examinedFile)
+{
+  examinedFile.Loadable = false;
+  examinedFile.SOPClassUID.clear();
+  examinedFile.Name.clear();
+  examinedFile.ReferencedSOPInstanceUIDs.clear();
+
+  // Read the file only until the SOP class UID, so that files that are not RT objects are skipped quickly
+  DcmFileFormat sopClassFileformat;
+  OFCondition result = sopClassFileformat.loadFileUntilTag(fileName.c_str(), EXS_Unknown, EGL_noChange,
+    DCM_MaxReadLength, ERM_autoDetect, DCM_SOPInstanceUID);
+  if (!result.good())
+  {
+    return; // Failed to parse this file, skip it
+  }
+  OFString sopClass;
+  if (!sopClassFileformat.getDataset()->findAndGetOFString(DCM_SOPClassUID, sopClass).good() || sopClass.empty())
+  {
+    return; // Failed to parse this file, skip it
+  }
+
+  // Read the header of the RT object until the tags needed for examination. The sequences following them
+  // (contours, beams) and the pixel data are not read, and long element values are not loaded into memory.
+  DcmTagKey stopParsingAtElement;
+  if (sopClass == UID_RTDoseStorage || sopClass == UID_RTImageStorage)
+  {
+    stopParsingAtElement = DCM_PixelData;
+  }
+  else if (sopClass == UID_RTPlanStorage || sopClass == UID_RTIonPlanStorage)
+  {
+    stopParsingAtElement = DCM_DoseReferenceSequence;
+  }
+  else if (sopClass == UID_RTStructureSetStorage)
+  {
+    stopParsingAtElement = DCM_StructureSetROISequence;
+  }
+  /* Not yet supported
+  else if (sopClass == UID_RTTreatmentSummaryRecordStorage)
+  else if (sopClass == UID_RTIonBeamsTreatmentRecordStorage)
+  */
+  else
+  {
+    return; // Not an RT file
+  }
+
+  DcmFileFormat fileformat;
+  result = fileformat.loadFileUntilTag(fileName.c_str(), EXS_Unknown, EGL_noChange,
+    DCM_MaxReadLength, ERM_autoDetect, stopParsingAtElement);
+  if (!result.good())
+  {
+    return; // Failed to parse this file, skip it
+  }
+  DcmDataset* dataset = fileformat.getDataset();
+
+  // DICOM parsing is successful, now assemble the loadable information
+  OFString name("");
+  OFString seriesNumber("");
+  dataset->findAndGetOFString(DCM_SeriesNumber, seriesNumber);
+  if (!seriesNumber.empty())
+  {
+    name += seriesNumber + ": ";
+  }
+
+  std::vector<OFString>& referencedSOPInstanceUIDs = examinedFile.ReferencedSOPInstanceUIDs;
+  if (sopClass == UID_RTDoseStorage)
+  {
+    ExamineRtDoseDataset(dataset, name, referencedSOPInstanceUIDs);
+  }
+  else if (sopClass == UID_RTPlanStorage || sopClass == UID_RTIonPlanStorage)
+  {
+    ExamineRtPlanDataset(dataset, name, referencedSOPInstanceUIDs);
+  }
+  else if (sopClass == UID_RTStructureSetStorage)
+  {
+    ExamineRtStructureSetDataset(dataset, name, referencedSOPInstanceUIDs);
+  }
+  else if (sopClass == UID_RTImageStorage)
+  {
+    ExamineRtImageDataset(dataset, name, referencedSOPInstanceUIDs);
+  }
+
+  examinedFile.Loadable = true;
+  examinedFile.SOPClassUID = sopClass;
+  examinedFile.Name = name;
+}
+
 //-----------------------------------------------------------------------------
 void vtkSlicerDicomRtImportExportModuleLogic::vtkInternal::ExamineRtDoseDataset(DcmDataset* dataset, OFString &name, std::vector<OFString> &referencedSOPInstanceUIDs)
 {
@@ -267,46 +392,54 @@ void vtkSlicerDicomRtImportExportModuleLogic::vtkInternal::ExamineRtDoseDataset(
     name += " [" + instanceNumber + "]";
   }
 
-  // Find RTPlan name for RTDose series
+  // Get referenced RTPlan (its name is added to the loadable name in AddReferencedRtPlanLabelsToRtDoseNames)
+  DcmItem* referencedRtPlanItem = nullptr;
   OFString referencedSOPInstanceUID("");
-  DRTDoseIOD rtDoseObject;
-  if (rtDoseObject.read(*dataset).good())
+  if ( dataset->findAndGetSequenceItem(DCM_ReferencedRTPlanSequence, referencedRtPlanItem, 0).good()
+    && referencedRtPlanItem->findAndGetOFString(DCM_ReferencedSOPInstanceUID, referencedSOPInstanceUID).good() )
   {
-    DRTReferencedRTPlanSequence &referencedRTPlanSequence = rtDoseObject.getReferencedRTPlanSequence();
-    if (referencedRTPlanSequence.gotoFirstItem().good())
+    referencedSOPInstanceUIDs.push_back(referencedSOPInstanceUID);
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vtkSlicerDicomRtImportExportModuleLogic::vtkInternal::AddReferencedRtPlanLabelsToRtDoseNames(std::vector<ExaminedFile>& examinedFiles)
+{
+  ctkDICOMDatabase* dicomDatabase = nullptr;
+  for (ExaminedFile& examinedFile : examinedFiles)
+  {
+    if (!examinedFile.Loadable || examinedFile.SOPClassUID != UID_RTDoseStorage || examinedFile.ReferencedSOPInstanceUIDs.empty())
     {
-      DRTReferencedRTPlanSequence::Item &referencedRTPlanSequenceItem = referencedRTPlanSequence.getCurrentItem();
-      if (referencedRTPlanSequenceItem.isValid())
-      {
-        if (referencedRTPlanSequenceItem.getReferencedSOPInstanceUID(referencedSOPInstanceUID).good())
-        {
-          referencedSOPInstanceUIDs.push_back(referencedSOPInstanceUID);
-        }
-      }
+      continue;
     }
-  }
 
-  // Create and open DICOM database to perform database operations for getting RTPlan name
-  QSettings settings;
-  QString databaseDirectory = settings.value("DatabaseDirectory").toString();
-  QString databaseFile = databaseDirectory + vtkSlicerDicomRtReader::DICOMREADER_DICOM_DATABASE_FILENAME.c_str();
-  ctkDICOMDatabase* dicomDatabase = new ctkDICOMDatabase();
-  dicomDatabase->openDatabase(databaseFile, vtkSlicerDicomRtReader::DICOMREADER_DICOM_CONNECTION_NAME.c_str());
+    // Create and open DICOM database to perform database operations for getting RTPlan name
+    if (!dicomDatabase)
+    {
+      QSettings settings;
+      QString databaseDirectory = settings.value("DatabaseDirectory").toString();
+      QString databaseFile = databaseDirectory + vtkSlicerDicomRtReader::DICOMREADER_DICOM_DATABASE_FILENAME.c_str();
+      dicomDatabase = new ctkDICOMDatabase();
+      dicomDatabase->openDatabase(databaseFile, vtkSlicerDicomRtReader::DICOMREADER_DICOM_CONNECTION_NAME.c_str());
+    }
 
-  // Get RTPlan name to show it with the dose
-  //TODO: Uncomment this line when figured out the reason for the crash, see https://github.com/SlicerRt/SlicerRT/issues/135
-  QString rtPlanLabelTag("300a,0002");
-  QString rtPlanFileName = dicomDatabase->fileForInstance(referencedSOPInstanceUID.c_str());
-  if (!rtPlanFileName.isEmpty())
-  {
-   name += OFString(": ") + OFString(dicomDatabase->fileValue(rtPlanFileName,rtPlanLabelTag).toUtf8().constData());
+    // Get RTPlan name to show it with the dose
+    QString rtPlanLabelTag("300a,0002");
+    QString rtPlanFileName = dicomDatabase->fileForInstance(examinedFile.ReferencedSOPInstanceUIDs[0].c_str());
+    if (!rtPlanFileName.isEmpty())
+    {
+      examinedFile.Name += OFString(": ") + OFString(dicomDatabase->fileValue(rtPlanFileName,rtPlanLabelTag).toUtf8().constData());
+    }
   }
 
   // Close and delete DICOM database
-  dicomDatabase->closeDatabase();
-  delete dicomDatabase;
-  QSqlDatabase::removeDatabase(vtkSlicerDicomRtReader::DICOMREADER_DICOM_CONNECTION_NAME.c_str());
-  QSqlDatabase::removeDatabase(QString(vtkSlicerDicomRtReader::DICOMREADER_DICOM_CONNECTION_NAME.c_str()) + "TagCache");
+  if (dicomDatabase)
+  {
+    dicomDatabase->closeDatabase();
+    delete dicomDatabase;
+    QSqlDatabase::removeDatabase(vtkSlicerDicomRtReader::DICOMREADER_DICOM_CONNECTION_NAME.c_str());
+    QSqlDatabase::removeDatabase(QString(vtkSlicerDicomRtReader::DICOMREADER_DICOM_CONNECTION_NAME.c_str()) + "TagCache");
+  }
 }
 
 //-----------------------------------------------------------------------------
@@ -362,98 +495,27 @@ void vtkSlicerDicomRtImportExportModuleLogic::vtkInternal::ExamineRtStructureSet
     name += ": " + structLabel;
   }
 
-  // Get referenced image instance UIDs
-  OFString referencedSOPInstanceUID("");
-  DRTStructureSetIOD rtStructureSetObject;
-  if (rtStructureSetObject.read(*dataset).good())
+  // Get referenced image instance UIDs from the contour image sequence of the referenced series.
+  // The contour image sequences in the ROI contour sequence are not used, as that sequence contains
+  // all the contour points, and is not read for examination.
+  DcmItem* referencedFrameOfReferenceItem = nullptr;
+  DcmItem* referencedStudyItem = nullptr;
+  DcmItem* referencedSeriesItem = nullptr;
+  DcmSequenceOfItems* contourImageSequence = nullptr;
+  if ( dataset->findAndGetSequenceItem(DCM_ReferencedFrameOfReferenceSequence, referencedFrameOfReferenceItem, 0).good()
+    && referencedFrameOfReferenceItem->findAndGetSequenceItem(DCM_RTReferencedStudySequence, referencedStudyItem, 0).good()
+    && referencedStudyItem->findAndGetSequenceItem(DCM_RTReferencedSeriesSequence, referencedSeriesItem, 0).good()
+    && referencedSeriesItem->findAndGetSequence(DCM_ContourImageSequence, contourImageSequence).good() )
   {
-    DRTROIContourSequence &rtROIContourSequenceObject = rtStructureSetObject.getROIContourSequence();
-    if (rtROIContourSequenceObject.gotoFirstItem().good())
-    {
-      do // For all ROIs
-      {
-        DRTROIContourSequence::Item &currentRoiObject = rtROIContourSequenceObject.getCurrentItem();
-        if (currentRoiObject.isValid())
-        {
-          DRTContourSequence &rtContourSequenceObject = currentRoiObject.getContourSequence();
-          if (rtContourSequenceObject.gotoFirstItem().good())
-          {
-            do // For all contours
-            {
-              DRTContourSequence::Item &contourItem = rtContourSequenceObject.getCurrentItem();
-              if (!contourItem.isValid())
-              {
-                DRTContourImageSequence &rtContourImageSequenceObject = contourItem.getContourImageSequence();
-                if (rtContourImageSequenceObject.gotoFirstItem().good())
-                {
-                  DRTContourImageSequence::Item &rtContourImageSequenceItem = rtContourImageSequenceObject.getCurrentItem();
-                  if (rtContourImageSequenceItem.isValid())
-                  {
-                    OFString referencedSOPInstanceUID("");
-                    if (rtContourImageSequenceItem.getReferencedSOPInstanceUID(referencedSOPInstanceUID).good())
-                    {
-                      referencedSOPInstanceUIDs.push_back(referencedSOPInstanceUID);
-                    }
-                  }
-                }
-              }
-            } // For all contours
-            while (rtContourSequenceObject.gotoNextItem().good());
-          }
-        }
-      } // For all ROIs
-      while (rtROIContourSequenceObject.gotoNextItem().good());
-    } // End ROIContourSequence
-
-    // If the above tags do not store the referenced instance UIDs, then look at the other possible place
-    if (referencedSOPInstanceUIDs.empty())
+    for (unsigned long itemIndex = 0; itemIndex < contourImageSequence->card(); ++itemIndex)
     {
-      DRTReferencedFrameOfReferenceSequence &rtReferencedFrameOfReferenceSequenceObject = rtStructureSetObject.getReferencedFrameOfReferenceSequence();
-      if (rtReferencedFrameOfReferenceSequenceObject.gotoFirstItem().good())
+      OFString referencedSOPInstanceUID("");
+      if (contourImageSequence->getItem(itemIndex)->findAndGetOFString(DCM_ReferencedSOPInstanceUID, referencedSOPInstanceUID).good())
       {
-        DRTReferencedFrameOfReferenceSequence::Item &currentReferencedFrameOfReferenceSequenceItem = rtReferencedFrameOfReferenceSequenceObject.getCurrentItem();
-        if (currentReferencedFrameOfReferenceSequenceItem.isValid())
-        {
-          DRTRTReferencedStudySequence &rtReferencedStudySequenceObject = currentReferencedFrameOfReferenceSequenceItem.getRTReferencedStudySequence();
-          if (rtReferencedStudySequenceObject.gotoFirstItem().good())
-          {
-            DRTRTReferencedStudySequence::Item &rtReferencedStudySequenceItem = rtReferencedStudySequenceObject.getCurrentItem();
-            if (rtReferencedStudySequenceItem.isValid())
-            {
-              DRTRTReferencedSeriesSequence &rtReferencedSeriesSequenceObject = rtReferencedStudySequenceItem.getRTReferencedSeriesSequence();
-              if (rtReferencedSeriesSequenceObject.gotoFirstItem().good())
-              {
-                if (rtReferencedSeriesSequenceObject.gotoFirstItem().good())
-                {
-                  DRTRTReferencedSeriesSequence::Item &rtReferencedSeriesSequenceItem = rtReferencedSeriesSequenceObject.getCurrentItem();
-                  if (rtReferencedSeriesSequenceItem.isValid())
-                  {
-                    DRTContourImageSequence &rtContourImageSequenceObject = rtReferencedSeriesSequenceItem.getContourImageSequence();
-                    if (rtContourImageSequenceObject.gotoFirstItem().good())
-                    {
-                      do
-                      {
-                        DRTContourImageSequence::Item &rtContourImageSequenceItem = rtContourImageSequenceObject.getCurrentItem();
-                        if (rtContourImageSequenceItem.isValid())
-                        {
-                          OFString referencedSOPInstanceUID("");
-                          if (rtContourImageSequenceItem.getReferencedSOPInstanceUID(referencedSOPInstanceUID).good())
-                          {
-                            referencedSOPInstanceUIDs.push_back(referencedSOPInstanceUID);
-                          }
-                        }
-                      } // For all contours
-                      while (rtContourImageSequenceObject.gotoNextItem().good());
-                    }
-                  }
-                }
-              }
-            }
-          }
-        }
+        referencedSOPInstanceUIDs.push_back(referencedSOPInstanceUID);
       }
-    } // End DRTReferencedFrameOfReferenceSequence
-  } // End finding referenced instance UIDs
+    }
+  }
 }
 
 //-----------------------------------------------------------------------------
@@ -474,19 +536,12 @@ void vtkSlicerDicomRtImportExportModuleLogic::vtkInternal::ExamineRtImageDataset
   }
 
   // Get referenced RTPlan
+  DcmItem* referencedRtPlanItem = nullptr;
   OFString referencedSOPInstanceUID("");
-  DRTImageIOD rtImageObject;
-  if (rtImageObject.read(*dataset).good())
+  if ( dataset->findAndGetSequenceItem(DCM_ReferencedRTPlanSequence, referencedRtPlanItem, 0).good()
+    && referencedRtPlanItem->findAndGetOFString(DCM_ReferencedSOPInstanceUID, referencedSOPInstanceUID).good() )
   {
-    DRTReferencedRTPlanSequenceInRTImageModule &rtReferencedRtPlanSequenceObject = rtImageObject.getReferencedRTPlanSequence();
-    if (rtReferencedRtPlanSequenceObject.gotoFirstItem().good())
-    {
-      DRTReferencedRTPlanSequenceInRTImageModule::Item &currentReferencedRtPlanSequenceObject = rtReferencedRtPlanSequenceObject.getCurrentItem();
-      if (currentReferencedRtPlanSequenceObject.getReferencedSOPInstanceUID(referencedSOPInstanceUID).good())
-      {
-        referencedSOPInstanceUIDs.push_back(referencedSOPInstanceUID);
-      }
-    }
+    referencedSOPInstanceUIDs.push_back(referencedSOPInstanceUID);
   }
 }
 
@@ -503,56 +558,25 @@ bool vtkSlicerDicomRtImportExportModuleLogic::vtkInternal::LoadRtDose(vtkSlicerD
   const char* fileName = loadable->GetFiles()->GetValue(0).c_str();
   const char* seriesName = loadable->GetName();
 
-  // Load Volume
-  vtkSmartPointer<vtkMRMLVolumeArchetypeStorageNode> volumeStorageNode = vtkSmartPointer<vtkMRMLVolumeArchetypeStorageNode>::New();
   vtkSmartPointer<vtkMRMLScalarVolumeNode> volumeNode = vtkSmartPointer<vtkMRMLScalarVolumeNode>::New();
-  volumeStorageNode->SetFileName(fileName);
-  volumeStorageNode->ResetFileNameList();
-  volumeStorageNode->SetSingleFile(1);
-
-  // Read volume from disk
-  if (!volumeStorageNode->ReadData(volumeNode))
-  {
-    vtkErrorWithObjectMacro(this->External, "LoadRtDose: Failed to load dose volume file '" << fileName << "' (series name '" << seriesName << "')");
-    return false;
-  }
-
-  volumeNode->SetScene(this->External->GetMRMLScene());
   std::string volumeNodeName = scene->GenerateUniqueName(seriesName);
   volumeNode->SetName(volumeNodeName.c_str());
 
-  // Set new spacing
-  double* initialSpacing = volumeNode->GetSpacing();
-  double* correctSpacing = rtReader->GetPixelSpacing();
-  volumeNode->SetSpacing(correctSpacing[0], correctSpacing[1], initialSpacing[2]);
-  volumeNode->SetAttribute(vtkSlicerRtCommon::DICOMRTIMPORT_DOSE_VOLUME_IDENTIFIER_ATTRIBUTE_NAME.c_str(), "1");
-  scene->AddNode(volumeNode);
-
-  // Apply dose grid scaling
   if (!rtReader->GetDoseGridScaling())
   {
     vtkErrorWithObjectMacro(this->External, "LoadRtDose: Empty dose unit value found for dose volume " << volumeNode->GetName());
   }
   double doseGridScaling = vtkVariant(rtReader->GetDoseGridScaling()).ToDouble();
 
-  vtkSmartPointer<vtkImageData> floatVolumeData = vtkSmartPointer<vtkImageData>::New();
-
-  vtkSmartPointer<vtkImageCast> imageCast = vtkSmartPointer<vtkImageCast>::New();
-  imageCast->SetInputData(volumeNode->GetImageData());
-  imageCast->SetOutputScalarTypeToFloat();
-  imageCast->Update();
-  floatVolumeData->DeepCopy(imageCast->GetOutput());
-
-  float value = 0.0;
-  float* floatPtr = (float*)floatVolumeData->GetScalarPointer();
-  for (long i=0; i<floatVolumeData->GetNumberOfPoints(); ++i)
+  if (!vtkSlicerDicomRtImportExportModuleLogic::LoadRtDoseVolume(rtReader, fileName, volumeNode))
   {
-    value = (*floatPtr) * doseGridScaling;
-    (*floatPtr) = value;
-    ++floatPtr;
+    vtkErrorWithObjectMacro(this->External, "LoadRtDose: Failed to load dose volume file '" << fileName << "' (series name '" << seriesName << "')");
+    return false;
   }
+  volumeNode->SetName(volumeNodeName.c_str());
 
-  volumeNode->SetAndObserveImageData(floatVolumeData);
+  volumeNode->SetAttribute(vtkSlicerRtCommon::DICOMRTIMPORT_DOSE_VOLUME_IDENTIFIER_ATTRIBUTE_NAME.c_str(), "1");
+  scene->AddNode(volumeNode);
 
   // Get default isodose color table and default dose color table
   vtkMRMLColorTableNode* defaultIsodoseColorTable = vtkSlicerIsodoseModuleLogic::GetDefaultIsodoseColorTable(scene);
@@ -1604,6 +1628,9 @@ bool vtkSlicerDicomRtImportExportModuleLogic::vtkInternal::LoadRtStructureSet(vt
   long maximumNumberOfPoints = -1;
   long totalNumberOfPoints = 0;
 
+  // Segments created from contour ROIs, in ROI order
+  std::vector<vtkSegment*> contourSegments;
+
   // Add ROIs
   int numberOfRois = rtReader->GetNumberOfRois();
   for (int internalROIIndex=0; internalROIIndex<numberOfRois; internalROIIndex++)
@@ -1744,6 +1771,7 @@ bool vtkSlicerDicomRtImportExportModuleLogic::vtkInternal::LoadRtStructureSet(vt
       segment->SetColor(roiColor[0], roiColor[1], roiColor[2]);
       segment->AddRepresentation(vtkSegmentationConverter::GetSegmentationPlanarContourRepresentationName(), roiPolyData);
       segmentationNode->GetSegmentation()->AddSegment(segment);
+      contourSegments.push_back(segment);
 
       // Add DICOM ROI number as tag to the segment
       std::stringstream roiNumberStream;
@@ -1760,6 +1788,12 @@ bool vtkSlicerDicomRtImportExportModuleLogic::vtkInternal::LoadRtStructureSet(vt
     vtkDebugWithObjectMacro(this->External, "LoadRtStructureSet: Maximum number of points in a segment = " << maximumNumberOfPoints << ", Total number of points in segmentation = " << totalNumberOfPoints);
     if (maximumNumberOfPoints < 800000 && totalNumberOfPoints < 3000000)
     {
+      // Generate the surfaces of all ROIs at once, so that the segmentation finds them already present
+      // when the preferred display representation is set, instead of converting the segments one by one
+      if (this->External->ParallelSurfaceGeneration)
+      {
+        this->GenerateClosedSurfacesInParallel(segmentationNode->GetSegmentation(), contourSegments);
+      }
       segmentationDisplayNode->SetPreferredDisplayRepresentationName3D(vtkSegmentationConverter::GetSegmentationClosedSurfaceRepresentationName());
       segmentationDisplayNode->SetPreferredDisplayRepresentationName2D(vtkSegmentationConverter::GetSegmentationClosedSurfaceRepresentationName());
       segmentationDisplayNode->CalculateAutoOpacitiesForSegments();
@@ -1780,6 +1814,72 @@ bool vtkSlicerDicomRtImportExportModuleLogic::vtkInternal::LoadRtStructureSet(vt
   return true;
 }
 
+//---------------------------------------------------------------------------
+void vtkSlicerDicomRtImportExportModuleLogic::vtkInternal::GenerateClosedSurfacesInParallel(vtkSegmentation* segmentation, const std::vector<vtkSegment*>& segments)
+{
+#if Slicer_VERSION_MAJOR >= 5 || (Slicer_VERSION_MAJOR >= 4 && Slicer_VERSION_MINOR >= 11)
+  if (!segmentation || segments.empty())
+  {
+    return;
+  }
+
+  // Conversion parameters are read on the main thread, the rule instances only use their own copy
+  std::string defaultSliceThickness = segmentation->GetConversionParameter(
+    vtkPlanarContourToClosedSurfaceConversionRule::GetDefaultSliceThicknessParameterName());
+  std::string endCapping = segmentation->GetConversionParameter(
+    vtkPlanarContourToClosedSurfaceConversionRule::GetEndCappingParameterName());
+
+  int numberOfSegments = static_cast<int>(segments.size());
+  std::vector<vtkSmartPointer<vtkSegment> > conversionSegments(numberOfSegments);
+  std::vector<vtkSmartPointer<vtkPlanarContourToClosedSurfaceConversionRule> > rules(numberOfSegments);
+  for (int segmentIndex = 0; segmentIndex < numberOfSegments; ++segmentIndex)
+  {
+    vtkSmartPointer<vtkSegment> conversionSegment = vtkSmartPointer<vtkSegment>::New();
+    conversionSegment->AddRepresentation(vtkSegmentationConverter::GetSegmentationPlanarContourRepresentationName(),
+      segments[segmentIndex]->GetRepresentation(vtkSegmentationConverter::GetSegmentationPlanarContourRepresentationName()));
+    conversionSegments[segmentIndex] = conversionSegment;
+
+    vtkSmartPointer<vtkPlanarContourToClosedSurfaceConversionRule> rule = vtkSmartPointer<vtkPlanarContourToClosedSurfaceConversionRule>::New();
+    if (!defaultSliceThickness.empty())
+    {
+      rule->SetConversionParameter(vtkPlanarContourToClosedSurfaceConversionRule::GetDefaultSliceThicknessParameterName(), defaultSliceThickness);
+    }
+    if (!endCapping.empty())
+    {
+      rule->SetConversionParameter(vtkPlanarContourToClosedSurfaceConversionRule::GetEndCappingParameterName(), endCapping);
+    }
+    rules[segmentIndex] = rule;
+  }
+
+  // Convert the ROIs concurrently. Each ROI uses its own rule instance and segment, and only reads its own contours.
+  std::vector<char> conversionSucceeded(numberOfSegments, 0);
+  vtkSMPTools::For(0, numberOfSegments, 1, [&](vtkIdType beginSegmentIndex, vtkIdType endSegmentIndex)
+  {
+    for (vtkIdType segmentIndex = beginSegmentIndex; segmentIndex < endSegmentIndex; ++segmentIndex)
+    {
+      conversionSucceeded[segmentIndex] = rules[segmentIndex]->Convert(conversionSegments[segmentIndex]) ? 1 : 0;
+    }
+  });
+
+  // Add the surfaces to the segments in ROI order. Segments whose conversion failed are left to the segmentation
+  // to convert, as if parallel surface generation was off.
+  for (int segmentIndex = 0; segmentIndex < numberOfSegments; ++segmentIndex)
+  {
+    vtkDataObject* closedSurface = conversionSegments[segmentIndex]->GetRepresentation(
+      vtkSegmentationConverter::GetSegmentationClosedSurfaceRepresentationName());
+    if (!conversionSucceeded[segmentIndex] || !closedSurface)
+    {
+      vtkWarningWithObjectMacro(this->External, "GenerateClosedSurfacesInParallel: Failed to generate closed surface for segment "
+        << (segments[segmentIndex]->GetName() ? segments[segmentIndex]->GetName() : "Unnamed"));
+      continue;
+    }
+    segments[segmentIndex]->AddRepresentation(vtkSegmentationConverter::GetSegmentationClosedSurfaceRepresentationName(), closedSurface);
+  }
+#else
+  vtkWarningWithObjectMacro(this->External, "GenerateClosedSurfacesInParallel: Not supported in this Slicer version, surfaces are generated by the segmentation");
+#endif
+}
+
 //---------------------------------------------------------------------------
 bool vtkSlicerDicomRtImportExportModuleLogic::vtkInternal::LoadRtImage(vtkSlicerDicomRtReader* rtReader, vtkSlicerDICOMLoadable* loadable)
 {
@@ -2414,6 +2514,7 @@ vtkSlicerDicomRtImportExportModuleLogic::vtkSlicerDicomRtImportExportModuleLogic
   this->Internal = new vtkInternal(this);
 
   this->BeamModelsInSeparateBranch = true;
+  this->ParallelSurfaceGeneration = true;
 }
 
 //----------------------------------------------------------------------------
@@ -2430,6 +2531,9 @@ vtkSlicerDicomRtImportExportModuleLogic::~vtkSlicerDicomRtImportExportModuleLogi
 void vtkSlicerDicomRtImportExportModuleLogic::PrintSelf(ostream& os, vtkIndent indent)
 {
   this->Superclass::PrintSelf(os, indent);
+
+  os << indent << "BeamModelsInSeparateBranch: " << (this->BeamModelsInSeparateBranch ? "true" : "false") << "\n";
+  os << indent << "ParallelSurfaceGeneration: " << (this->ParallelSurfaceGeneration ? "true" : "false") << "\n";
 }
 
 //---------------------------------------------------------------------------
@@ -2478,77 +2582,65 @@ void vtkSlicerDicomRtImportExportModuleLogic::ExamineForLoad(vtkStringArray* fil
   }
   loadables->RemoveAllItems();
 
-  for (int fileIndex=0; fileIndex<fileList->GetNumberOfValues(); ++fileIndex)
+  // Look up the files in the examination cache. Files that have not been examined yet, or that
+  // have changed since they were examined, are examined again.
+  int numberOfFiles = fileList->GetNumberOfValues();
+  std::vector<std::string> fileNames(numberOfFiles);
+  std::vector<vtkInternal::ExaminedFile> examinedFiles(numberOfFiles);
+  std::vector<int> fileIndicesToExamine;
+  for (int fileIndex=0; fileIndex<numberOfFiles; ++fileIndex)
   {
-    // Load file in DCMTK
-    DcmFileFormat fileformat;
-    vtkStdString fileName = fileList->GetValue(fileIndex);
-    OFCondition result = fileformat.loadFile(fileName.c_str(), EXS_Unknown);
-    if (!result.good())
-    {
-      continue; // Failed to parse this file, skip it
-    }
+    fileNames[fileIndex] = fileList->GetValue(fileIndex);
+    unsigned long fileSize = vtksys::SystemTools::FileLength(fileNames[fileIndex]);
+    long modifiedTime = vtksys::SystemTools::ModifiedTime(fileNames[fileIndex]);
 
-    // Check SOP Class UID for one of the supported RT objects
-    DcmDataset *dataset = fileformat.getDataset();
-    OFString sopClass;
-    if (!dataset->findAndGetOFString(DCM_SOPClassUID, sopClass).good() || sopClass.empty())
+    std::map<std::string, vtkInternal::ExaminedFile>::iterator cachedFileIt = this->Internal->ExaminedFileCache.find(fileNames[fileIndex]);
+    if ( cachedFileIt != this->Internal->ExaminedFileCache.end()
+      && cachedFileIt->second.FileSize == fileSize && cachedFileIt->second.ModifiedTime == modifiedTime )
     {
-      continue; // Failed to parse this file, skip it
+      examinedFiles[fileIndex] = cachedFileIt->second;
     }
-
-    // DICOM parsing is successful, now check if the object is loadable
-    OFString name("");
-    OFString seriesNumber("");
-    std::vector<OFString> referencedSOPInstanceUIDs;
-    dataset->findAndGetOFString(DCM_SeriesNumber, seriesNumber);
-    if (!seriesNumber.empty())
+    else
     {
-      name += seriesNumber + ": ";
+      examinedFiles[fileIndex].FileSize = fileSize;
+      examinedFiles[fileIndex].ModifiedTime = modifiedTime;
+      fileIndicesToExamine.push_back(fileIndex);
     }
+  }
 
-    // RTDose
-    if (sopClass == UID_RTDoseStorage)
-    {
-      this->Internal->ExamineRtDoseDataset(dataset, name, referencedSOPInstanceUIDs);
-    }
-    // RTPlan
-    else if (sopClass == UID_RTPlanStorage)
-    {
-      this->Internal->ExamineRtPlanDataset(dataset, name, referencedSOPInstanceUIDs);
-    }
-    // RTIonPlan
-    else if (sopClass == UID_RTIonPlanStorage)
-    {
-      this->Internal->ExamineRtPlanDataset(dataset, name, referencedSOPInstanceUIDs);
-    }
-    // RTStructureSet
-    else if (sopClass == UID_RTStructureSetStorage)
-    {
-      this->Internal->ExamineRtStructureSetDataset(dataset, name, referencedSOPInstanceUIDs);
-    }
-    // RTImage
-    else if (sopClass == UID_RTImageStorage)
+  // Examine the files concurrently. Each file is read into its own dataset, and only the header is read.
+  vtkSMPTools::For(0, static_cast<vtkIdType>(fileIndicesToExamine.size()), 1, [&](vtkIdType beginIndex, vtkIdType endIndex)
+  {
+    for (vtkIdType index = beginIndex; index < endIndex; ++index)
     {
-      this->Internal->ExamineRtImageDataset(dataset, name, referencedSOPInstanceUIDs);
+      int fileIndex = fileIndicesToExamine[index];
+      vtkInternal::ExamineFile(fileNames[fileIndex], examinedFiles[fileIndex]);
     }
-    /* Not yet supported
-    else if (sopClass == UID_RTTreatmentSummaryRecordStorage)
-    else if (sopClass == UID_RTIonBeamsTreatmentRecordStorage)
-    */
-    else
+  });
+  for (int fileIndex : fileIndicesToExamine)
+  {
+    this->Internal->ExaminedFileCache[fileNames[fileIndex]] = examinedFiles[fileIndex];
+  }
+
+  // The referenced plan labels are not cached, as the DICOM database may change between examinations
+  this->Internal->AddReferencedRtPlanLabelsToRtDoseNames(examinedFiles);
+
+  for (int fileIndex=0; fileIndex<numberOfFiles; ++fileIndex)
+  {
+    const vtkInternal::ExaminedFile& examinedFile = examinedFiles[fileIndex];
+    if (!examinedFile.Loadable)
     {
-      continue; // Not an RT file
+      continue;
     }
 
     // The file is a loadable RT object, create and set up loadable
     vtkNew<vtkSlicerDICOMLoadable> loadable;
-    loadable->SetName(name.c_str());
-    loadable->AddFile(fileName.c_str());
+    loadable->SetName(examinedFile.Name.c_str());
+    loadable->AddFile(fileNames[fileIndex].c_str());
     loadable->SetConfidence(1.0);
     loadable->SetSelected(true);
-    std::vector<OFString>::iterator uidIt;
-    for (uidIt = referencedSOPInstanceUIDs.begin(); uidIt != referencedSOPInstanceUIDs.end(); ++uidIt)
+    std::vector<OFString>::const_iterator uidIt;
+    for (uidIt = examinedFile.ReferencedSOPInstanceUIDs.begin(); uidIt != examinedFile.ReferencedSOPInstanceUIDs.end(); ++uidIt)
     {
       loadable->AddReferencedInstanceUID(uidIt->c_str());
     }
@@ -2868,69 +2960,110 @@ std::string vtkSlicerDicomRtImportExportModuleLogic::ExportDicomRTStudy(vtkColle
         return error;
       }
 
-      // Export each segment in segmentation
+      // Export the segments in chunks of about the number of threads. The labelmaps of a chunk are converted concurrently,
+      // then added to the writer before the next chunk is started, so that only the labelmaps of one chunk are in memory at a time
       std::vector< std::string > segmentIDs;
       segmentationNode->GetSegmentation()->GetSegmentIDs(segmentIDs);
-      for (std::vector< std::string >::const_iterator segmentIdIt = segmentIDs.begin(); segmentIdIt != segmentIDs.end(); ++segmentIdIt)
+      int numberOfSegments = static_cast<int>(segmentIDs.size());
+      int segmentChunkSize = std::max(1, vtkSMPTools::GetEstimatedNumberOfThreads());
+      for (int chunkStartIndex = 0; chunkStartIndex < numberOfSegments; chunkStartIndex += segmentChunkSize)
       {
-        std::string segmentID = *segmentIdIt;
-        vtkSegment* segment = segmentationNode->GetSegmentation()->GetSegment(*segmentIdIt);
+        int chunkEndIndex = std::min(chunkStartIndex + segmentChunkSize, numberOfSegments);
+
+        // Collect the labelmap of each segment in the chunk. This accesses the MRML nodes, so it is done on the main thread
+        std::vector<vtkSmartPointer<vtkOrientedImageData> > binaryLabelmapCopies(chunkEndIndex - chunkStartIndex);
+        for (int segmentIndex = chunkStartIndex; segmentIndex < chunkEndIndex; ++segmentIndex)
+        {
+          std::string segmentID = segmentIDs[segmentIndex];
 
-        // Get binary labelmap representation
+          // Get binary labelmap representation
 #if Slicer_VERSION_MAJOR >= 5 || (Slicer_VERSION_MAJOR >= 4 && Slicer_VERSION_MINOR >= 11)
-        vtkNew<vtkOrientedImageData> binaryLabelmap;
-        segmentationNode->GetBinaryLabelmapRepresentation(segmentID, binaryLabelmap);
+          vtkNew<vtkOrientedImageData> binaryLabelmap;
+          segmentationNode->GetBinaryLabelmapRepresentation(segmentID, binaryLabelmap);
 #else
-        vtkOrientedImageData* binaryLabelmap = vtkOrientedImageData::SafeDownCast(
-          segment->GetRepresentation(vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName()) );
+          vtkSegment* segment = segmentationNode->GetSegmentation()->GetSegment(segmentID);
+          vtkOrientedImageData* binaryLabelmap = vtkOrientedImageData::SafeDownCast(
+            segment->GetRepresentation(vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName()) );
 #endif
-        if (!binaryLabelmap)
-        {
-          error = vtkMRMLTr("vtkSlicerDicomRtImportExportModuleLogic", "Failed to get binary labelmap representation from segment ") + segmentID;
-          vtkErrorMacro("ExportDicomRTStudy: " + error);
-          return error;
-        }
-        // Temporarily copy labelmap image data as it will be probably resampled
-        vtkSmartPointer<vtkOrientedImageData> binaryLabelmapCopy = vtkSmartPointer<vtkOrientedImageData>::New();
-        binaryLabelmapCopy->DeepCopy(binaryLabelmap);
+          if (!binaryLabelmap)
+          {
+            error = vtkMRMLTr("vtkSlicerDicomRtImportExportModuleLogic", "Failed to get binary labelmap representation from segment ") + segmentID;
+            vtkErrorMacro("ExportDicomRTStudy: " + error);
+            return error;
+          }
+          // Temporarily copy labelmap image data as it will be probably resampled
+          vtkSmartPointer<vtkOrientedImageData> binaryLabelmapCopy = vtkSmartPointer<vtkOrientedImageData>::New();
+          binaryLabelmapCopy->DeepCopy(binaryLabelmap);
 
-        // Apply parent transformation nodes if necessary
-        if (segmentationNode->GetParentTransformNode())
+          // Apply parent transformation nodes if necessary
+          if (segmentationNode->GetParentTransformNode())
+          {
+            if (!vtkSlicerSegmentationsModuleLogic::ApplyParentTransformToOrientedImageData(segmentationNode, binaryLabelmapCopy))
+            {
+              std::string errorMessage(vtkMRMLTr("vtkSlicerDicomRtImportExportModuleLogic", "Failed to apply parent transformation to exported segment"));
+              vtkErrorMacro("ExportDicomRTStudy: " << errorMessage);
+              return errorMessage;
+            }
+          }
+          binaryLabelmapCopies[segmentIndex - chunkStartIndex] = binaryLabelmapCopy;
+        } // For each segment in chunk
+
+        // Resample the labelmaps to the anatomical image geometry and convert them to Plastimatch images concurrently.
+        // Each segment only works on its own labelmap copy, the anatomical image is only read.
+        std::vector<Plm_image::Pointer> plmStructures(chunkEndIndex - chunkStartIndex);
+        std::vector<char> resampleSucceeded(chunkEndIndex - chunkStartIndex, 1);
+        vtkSMPTools::For(0, chunkEndIndex - chunkStartIndex, 1, [&](vtkIdType beginChunkIndex, vtkIdType endChunkIndex)
         {
-          if (!vtkSlicerSegmentationsModuleLogic::ApplyParentTransformToOrientedImageData(segmentationNode, binaryLabelmapCopy))
+          for (vtkIdType chunkIndex = beginChunkIndex; chunkIndex < endChunkIndex; ++chunkIndex)
           {
-            std::string errorMessage(vtkMRMLTr("vtkSlicerDicomRtImportExportModuleLogic", "Failed to apply parent transformation to exported segment"));
-            vtkErrorMacro("ExportDicomRTStudy: " << errorMessage);
-            return errorMessage;
+            vtkOrientedImageData* binaryLabelmapCopy = binaryLabelmapCopies[chunkIndex];
+
+            // Make sure the labelmap dimensions match the reference dimensions
+            if ( !vtkOrientedImageDataResample::DoGeometriesMatch(imageOrientedImageData, binaryLabelmapCopy)
+              || !vtkOrientedImageDataResample::DoExtentsMatch(imageOrientedImageData, binaryLabelmapCopy) )
+            {
+              if (!vtkOrientedImageDataResample::ResampleOrientedImageToReferenceOrientedImage(binaryLabelmapCopy, imageOrientedImageData, binaryLabelmapCopy))
+              {
+                resampleSucceeded[chunkIndex] = 0;
+                binaryLabelmapCopies[chunkIndex] = nullptr;
+                continue;
+              }
+            }
+
+            // Convert mask to Plm image. The labelmap copy is not needed afterwards
+            plmStructures[chunkIndex] = PlmCommon::ConvertVtkOrientedImageDataToPlmImage(binaryLabelmapCopy);
+            binaryLabelmapCopies[chunkIndex] = nullptr;
           }
-        }
-        // Make sure the labelmap dimensions match the reference dimensions
-        if ( !vtkOrientedImageDataResample::DoGeometriesMatch(imageOrientedImageData, binaryLabelmapCopy)
-          || !vtkOrientedImageDataResample::DoExtentsMatch(imageOrientedImageData, binaryLabelmapCopy) )
+        });
+
+        // Add the structures to the writer in segment order, so that the written structure set is the same as with serial conversion.
+        // Errors are reported for the first failed segment, as the serial conversion would have stopped there.
+        for (int segmentIndex = chunkStartIndex; segmentIndex < chunkEndIndex; ++segmentIndex)
         {
-          if (!vtkOrientedImageDataResample::ResampleOrientedImageToReferenceOrientedImage(binaryLabelmapCopy, imageOrientedImageData, binaryLabelmapCopy))
+          std::string segmentID = segmentIDs[segmentIndex];
+          int chunkIndex = segmentIndex - chunkStartIndex;
+          if (!resampleSucceeded[chunkIndex])
           {
             error = vtkMRMLTr("vtkSlicerDicomRtImportExportModuleLogic", "Failed to resample segment ") + segmentID + vtkMRMLTr("vtkSlicerDicomRtImportExportModuleLogic", " to match anatomical image geometry");
             vtkErrorMacro("ExportDicomRTStudy: " + error);
             return error;
           }
-        }
-
-        // Convert mask to Plm image
-        Plm_image::Pointer plmStructure = PlmCommon::ConvertVtkOrientedImageDataToPlmImage(binaryLabelmapCopy);
-        if (!plmStructure)
-        {
-          error = vtkMRMLTr("vtkSlicerDicomRtImportExportModuleLogic", "Failed to convert segment labelmap ") + segmentID + vtkMRMLTr("vtkSlicerDicomRtImportExportModuleLogic", " to Plastimatch image");
-          vtkErrorMacro("ExportDicomRTStudy: " + error);
-          return error;
-        }
+          if (!plmStructures[chunkIndex])
+          {
+            error = vtkMRMLTr("vtkSlicerDicomRtImportExportModuleLogic", "Failed to convert segment labelmap ") + segmentID + vtkMRMLTr("vtkSlicerDicomRtImportExportModuleLogic", " to Plastimatch image");
+            vtkErrorMacro("ExportDicomRTStudy: " + error);
+            return error;
+          }
 
-        // Get segment properties
-        std::string segmentName = segment->GetName();
-        double* segmentColor = segment->GetColor();
+          // Get segment properties
+          vtkSegment* segment = segmentationNode->GetSegmentation()->GetSegment(segmentID);
+          std::string segmentName = segment->GetName();
+          double* segmentColor = segment->GetColor();
 
-        rtWriter->AddStructure(plmStructure->itk_uchar(), segmentName.c_str(), segmentColor);
-      } // For each segment
+          rtWriter->AddStructure(plmStructures[chunkIndex]->itk_uchar(), segmentName.c_str(), segmentColor);
+          plmStructures[chunkIndex] = nullptr;
+        } // For each segment in chunk
+      } // For each chunk of segments
     }
     // If master representation is poly data type, then export from closed surface
     else if (segmentation->IsMasterRepresentationPolyData())
@@ -2951,99 +3084,123 @@ std::string vtkSlicerDicomRtImportExportModuleLogic::ExportDicomRTStudy(vtkColle
       {
         segmentationNode->GetParentTransformNode()->GetTransformToWorld(nodeToWorldTransform);
       }
-      // Initialize poly data transformer
-      vtkSmartPointer<vtkTransformPolyDataFilter> transformPolyData = vtkSmartPointer<vtkTransformPolyDataFilter>::New();
-      transformPolyData->SetTransform(nodeToWorldTransform);
+      // Bring the transform up to date before it is shared by the worker threads
+      nodeToWorldTransform->Update();
 
-      // Initialize cutting plane with normal of the Z axis of the anatomical image
+      // Get the Z axis of the anatomical image, which is the normal of the cutting planes
       vtkSmartPointer<vtkMatrix4x4> imageToWorldMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
       imageOrientedImageData->GetImageToWorldMatrix(imageToWorldMatrix);
       double normal[3] = { imageToWorldMatrix->GetElement(0,2), imageToWorldMatrix->GetElement(1,2), imageToWorldMatrix->GetElement(2,2) };
-      vtkSmartPointer<vtkPlane> slicePlane = vtkSmartPointer<vtkPlane>::New();
-      slicePlane->SetNormal(normal);
+      int imageExtent[6] = {0,-1,0,-1,0,-1};
+      imageOrientedImageData->GetExtent(imageExtent);
 
-      // Export each segment in segmentation
+      // Collect the closed surface of each segment in segmentation
       std::vector< std::string > segmentIDs;
       segmentationNode->GetSegmentation()->GetSegmentIDs(segmentIDs);
-      for (std::vector< std::string >::const_iterator segmentIdIt = segmentIDs.begin(); segmentIdIt != segmentIDs.end(); ++segmentIdIt)
+      int numberOfSegments = static_cast<int>(segmentIDs.size());
+      std::vector<vtkPolyData*> closedSurfacePolyDatas(numberOfSegments, nullptr);
+      for (int segmentIndex = 0; segmentIndex < numberOfSegments; ++segmentIndex)
       {
-        std::string segmentID = *segmentIdIt;
-        vtkSegment* segment = segmentationNode->GetSegmentation()->GetSegment(*segmentIdIt);
-
-        // Get closed surface representation
-        vtkPolyData* closedSurfacePolyData = vtkPolyData::SafeDownCast(
+        vtkSegment* segment = segmentationNode->GetSegmentation()->GetSegment(segmentIDs[segmentIndex]);
+        closedSurfacePolyDatas[segmentIndex] = vtkPolyData::SafeDownCast(
           segment->GetRepresentation(vtkSegmentationConverter::GetSegmentationClosedSurfaceRepresentationName()) );
-        if (!closedSurfacePolyData)
+        if (!closedSurfacePolyDatas[segmentIndex])
         {
-          error = vtkMRMLTr("vtkSlicerDicomRtImportExportModuleLogic", "Failed to get closed surface representation from segment ") + segmentID;
+          error = vtkMRMLTr("vtkSlicerDicomRtImportExportModuleLogic", "Failed to get closed surface representation from segment ") + segmentIDs[segmentIndex];
           vtkErrorMacro("ExportDicomRTStudy: " + error);
           return error;
         }
+      }
 
-        // Initialize cutter pipeline for segment
-        transformPolyData->SetInputData(closedSurfacePolyData);
-        vtkSmartPointer<vtkCutter> cutter = vtkSmartPointer<vtkCutter>::New();
-        cutter->SetInputConnection(transformPolyData->GetOutputPort());
-        cutter->SetGenerateCutScalars(0);
-        vtkSmartPointer<vtkStripper> stripper = vtkSmartPointer<vtkStripper>::New();
-        stripper->SetInputConnection(cutter->GetOutputPort());
-
-        // Get segment bounding box
-        double bounds[6] = {0.0,0.0,0.0,0.0,0.0,0.0};
-        transformPolyData->Update();
-        transformPolyData->GetOutput()->GetBounds(bounds);
-
-        // Containers to be passed to the writer
-        std::vector<int> sliceNumbers;
-        std::vector<std::string> sliceUIDs;
-        std::vector<vtkPolyData*> sliceContours;
-
-        // Create planar contours from closed surface based on each of the anatomical image slices
-        int imageExtent[6] = {0,-1,0,-1,0,-1};
-        imageOrientedImageData->GetExtent(imageExtent);
-        for (int slice=imageExtent[4]; slice<imageExtent[5]; ++slice)
+      // Convert the segments in chunks of about the number of threads, so that only the slice contours of one chunk are in memory at a time
+      int segmentChunkSize = std::max(1, vtkSMPTools::GetEstimatedNumberOfThreads());
+      for (int chunkStartIndex = 0; chunkStartIndex < numberOfSegments; chunkStartIndex += segmentChunkSize)
+      {
+        int chunkEndIndex = std::min(chunkStartIndex + segmentChunkSize, numberOfSegments);
+
+        // Containers to be passed to the writer for each segment in the chunk
+        std::vector< std::vector<int> > segmentSliceNumbers(chunkEndIndex - chunkStartIndex);
+        std::vector< std::vector<std::string> > segmentSliceUIDs(chunkEndIndex - chunkStartIndex);
+        std::vector< std::vector<vtkSmartPointer<vtkPolyData> > > segmentSliceContours(chunkEndIndex - chunkStartIndex);
+
+        // Cut the closed surfaces into planar contours concurrently. Each segment has its own cutter pipeline,
+        // the surfaces, the transform and the anatomical image geometry are only read.
+        vtkSMPTools::For(0, chunkEndIndex - chunkStartIndex, 1, [&](vtkIdType beginChunkIndex, vtkIdType endChunkIndex)
         {
-          // Calculate slice origin
-          double origin[3] = { imageToWorldMatrix->GetElement(0,3) + slice*normal[0],
-                               imageToWorldMatrix->GetElement(1,3) + slice*normal[1],
-                               imageToWorldMatrix->GetElement(2,3) + slice*normal[2] };
-          slicePlane->SetOrigin(origin);
-          if (origin[2] < bounds[4] || origin[2] > bounds[5])
+          for (vtkIdType chunkIndex = beginChunkIndex; chunkIndex < endChunkIndex; ++chunkIndex)
           {
-            // No contours outside surface bounds
-            continue;
-          }
-
-          // Cut closed surface at slice
-          cutter->SetCutFunction(slicePlane);
+            // Initialize cutter pipeline for segment
+            vtkSmartPointer<vtkTransformPolyDataFilter> transformPolyData = vtkSmartPointer<vtkTransformPolyDataFilter>::New();
+            transformPolyData->SetTransform(nodeToWorldTransform);
+            transformPolyData->SetInputData(closedSurfacePolyDatas[chunkStartIndex + chunkIndex]);
+            vtkSmartPointer<vtkPlane> slicePlane = vtkSmartPointer<vtkPlane>::New();
+            slicePlane->SetNormal(normal);
+            vtkSmartPointer<vtkCutter> cutter = vtkSmartPointer<vtkCutter>::New();
+            cutter->SetInputConnection(transformPolyData->GetOutputPort());
+            cutter->SetGenerateCutScalars(0);
+            vtkSmartPointer<vtkStripper> stripper = vtkSmartPointer<vtkStripper>::New();
+            stripper->SetInputConnection(cutter->GetOutputPort());
+
+            // Get segment bounding box
+            double bounds[6] = {0.0,0.0,0.0,0.0,0.0,0.0};
+            transformPolyData->Update();
+            transformPolyData->GetOutput()->GetBounds(bounds);
+
+            // Create planar contours from closed surface based on each of the anatomical image slices
+            for (int slice=imageExtent[4]; slice<imageExtent[5]; ++slice)
+            {
+              // Calculate slice origin
+              double origin[3] = { imageToWorldMatrix->GetElement(0,3) + slice*normal[0],
+                                   imageToWorldMatrix->GetElement(1,3) + slice*normal[1],
+                                   imageToWorldMatrix->GetElement(2,3) + slice*normal[2] };
+              slicePlane->SetOrigin(origin);
+              if (origin[2] < bounds[4] || origin[2] > bounds[5])
+              {
+                // No contours outside surface bounds
+                continue;
+              }
 
-          // Get instance UID of corresponding slice
-          int sliceNumber = slice-imageExtent[0];
-          sliceNumbers.push_back(sliceNumber);
-          std::string sliceInstanceUID = (imageSliceUIDs.size() > static_cast<size_t>(sliceNumber) ? imageSliceUIDs[sliceNumber] : "");
-          sliceUIDs.push_back(sliceInstanceUID);
+              // Cut closed surface at slice
+              cutter->SetCutFunction(slicePlane);
+
+              // Get instance UID of corresponding slice
+              int sliceNumber = slice-imageExtent[0];
+              segmentSliceNumbers[chunkIndex].push_back(sliceNumber);
+              std::string sliceInstanceUID = (imageSliceUIDs.size() > static_cast<size_t>(sliceNumber) ? imageSliceUIDs[sliceNumber] : "");
+              segmentSliceUIDs[chunkIndex].push_back(sliceInstanceUID);
+
+              // Save slice contour
+              stripper->Update();
+              vtkSmartPointer<vtkPolyData> sliceContour = vtkSmartPointer<vtkPolyData>::New();
+              sliceContour->SetPoints(stripper->GetOutput()->GetPoints());
+              sliceContour->SetPolys(stripper->GetOutput()->GetLines());
+              segmentSliceContours[chunkIndex].push_back(sliceContour);
+            } // For each anatomical image slice
+          }
+        });
 
-          // Save slice contour
-          stripper->Update();
-          vtkPolyData* sliceContour = vtkPolyData::New();
-          sliceContour->SetPoints(stripper->GetOutput()->GetPoints());
-          sliceContour->SetPolys(stripper->GetOutput()->GetLines());
-          sliceContours.push_back(sliceContour);
-        } // For each anatomical image slice
+        // Add contours to writer in segment order before the next chunk is converted, so that the written structure set is the same as with serial conversion
+        for (int segmentIndex = chunkStartIndex; segmentIndex < chunkEndIndex; ++segmentIndex)
+        {
+          int chunkIndex = segmentIndex - chunkStartIndex;
 
-        // Get segment properties
-        std::string segmentName = segment->GetName();
-        double* segmentColor = segment->GetColor();
+          // Get segment properties
+          vtkSegment* segment = segmentationNode->GetSegmentation()->GetSegment(segmentIDs[segmentIndex]);
+          std::string segmentName = segment->GetName();
+          double* segmentColor = segment->GetColor();
 
-        // Add contours to writer
-        rtWriter->AddStructure(segmentName.c_str(), segmentColor, sliceNumbers, sliceUIDs, sliceContours);
+          std::vector<vtkPolyData*> sliceContours;
+          for (std::vector<vtkSmartPointer<vtkPolyData> >::iterator contourIt = segmentSliceContours[chunkIndex].begin();
+            contourIt != segmentSliceContours[chunkIndex].end(); ++contourIt)
+          {
+            sliceContours.push_back(*contourIt);
+          }
+          rtWriter->AddStructure(segmentName.c_str(), segmentColor, segmentSliceNumbers[chunkIndex], segmentSliceUIDs[chunkIndex], sliceContours);
 
-        // Clean up slice contours
-        for (std::vector<vtkPolyData*>::iterator contourIt=sliceContours.begin(); contourIt!=sliceContours.end(); ++contourIt)
-        {
-          (*contourIt)->Delete();
-        }
-      } // For each segment
+          // Release slice contours of the segment
+          segmentSliceContours[chunkIndex].clear();
+        } // For each segment in chunk
+      } // For each chunk of segments
     }
     else
     {
@@ -3095,6 +3252,61 @@ vtkMRMLScalarVolumeNode* vtkSlicerDicomRtImportExportModuleLogic::GetReferencedV
   return vtkMRMLScalarVolumeNode::SafeDownCast(shNode->GetItemDataNode(referencedSeriesShItemID));
 }
 
+//---------------------------------------------------------------------------
+bool vtkSlicerDicomRtImportExportModuleLogic::LoadRtDoseVolume(vtkSlicerDicomRtReader* rtReader, const char* fileName,
+  vtkMRMLScalarVolumeNode* volumeNode, bool useArchetypeStorageNode/*=false*/)
+{
+  if (!rtReader || !volumeNode)
+  {
+    vtkGenericWarningMacro("vtkSlicerDicomRtImportExportModuleLogic::LoadRtDoseVolume: Invalid input arguments");
+    return false;
+  }
+
+  if (rtReader->GetDoseImageData() && !useArchetypeStorageNode)
+  {
+    // The reader has read the dose volume directly from the pixel data, with the dose grid scaling applied
+    volumeNode->SetIJKToRASMatrix(rtReader->GetDoseIJKToRASMatrix());
+    volumeNode->SetAndObserveImageData(rtReader->GetDoseImageData());
+    return true;
+  }
+
+  // Read volume from disk
+  vtkSmartPointer<vtkMRMLVolumeArchetypeStorageNode> volumeStorageNode = vtkSmartPointer<vtkMRMLVolumeArchetypeStorageNode>::New();
+  volumeStorageNode->SetFileName(fileName);
+  volumeStorageNode->ResetFileNameList();
+  volumeStorageNode->SetSingleFile(1);
+  if (!volumeStorageNode->ReadData(volumeNode))
+  {
+    vtkErrorWithObjectMacro(volumeNode, "LoadRtDoseVolume: Failed to read dose volume file '" << (fileName ? fileName : "") << "'");
+    return false;
+  }
+
+  // Set new spacing
+  double* initialSpacing = volumeNode->GetSpacing();
+  double* correctSpacing = rtReader->GetPixelSpacing();
+  volumeNode->SetSpacing(correctSpacing[0], correctSpacing[1], initialSpacing[2]);
+
+  // Apply dose grid scaling
+  double doseGridScaling = vtkVariant(rtReader->GetDoseGridScaling()).ToDouble();
+  vtkSmartPointer<vtkImageCast> imageCast = vtkSmartPointer<vtkImageCast>::New();
+  imageCast->SetInputData(volumeNode->GetImageData());
+  imageCast->SetOutputScalarTypeToFloat();
+  imageCast->Update();
+  vtkImageData* floatVolumeData = imageCast->GetOutput();
+
+  float* floatPtr = (float*)floatVolumeData->GetScalarPointer();
+  vtkSMPTools::For(0, floatVolumeData->GetNumberOfPoints(), [&](vtkIdType beginIndex, vtkIdType endIndex)
+  {
+    for (vtkIdType i = beginIndex; i < endIndex; ++i)
+    {
+      floatPtr[i] = floatPtr[i] * doseGridScaling;
+    }
+  });
+
+  volumeNode->SetAndObserveImageData(floatVolumeData);
+  return true;
+}
+
 //---------------------------------------------------------------------------
 void vtkSlicerDicomRtImportExportModuleLogic::InsertSeriesInSubjectHierarchy(vtkSlicerDicomReaderBase* reader, vtkMRMLScene* scene)
 {
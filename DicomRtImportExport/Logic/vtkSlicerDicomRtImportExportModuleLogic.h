@@ -43,6 +43,7 @@ class vtkMRMLScene;
 class vtkMRMLSegmentationNode;
 class vtkSlicerDICOMLoadable;
 class vtkSlicerDicomReaderBase;
+class vtkSlicerDicomRtReader;
 class vtkStringArray;
 
 /// \ingroup SlicerRt_QtModules_DicomRtImport
@@ -74,11 +75,24 @@ public:
   /// Insert currently loaded series in the proper place in subject hierarchy
   static void InsertSeriesInSubjectHierarchy(vtkSlicerDicomReaderBase* reader, vtkMRMLScene* scene);
 
+  /// Set the dose volume (in dose units) of an RTDOSE file to a volume node. The dose volume read directly by the
+  /// RT reader is used if available, otherwise the file is read through the volume archetype storage node.
+  /// \param rtReader RT reader that has loaded the RTDOSE file
+  /// \param fileName Name of the RTDOSE file
+  /// \param volumeNode Scalar volume node to set the dose volume to
+  /// \param useArchetypeStorageNode Read the file through the archetype storage node even if the reader has read the dose volume
+  /// \return True if loading successful
+  static bool LoadRtDoseVolume(vtkSlicerDicomRtReader* rtReader, const char* fileName, vtkMRMLScalarVolumeNode* volumeNode, bool useArchetypeStorageNode=false);
+
 public:
   vtkSetMacro(BeamModelsInSeparateBranch, bool);
   vtkGetMacro(BeamModelsInSeparateBranch, bool);
   vtkBooleanMacro(BeamModelsInSeparateBranch, bool);
 
+  vtkSetMacro(ParallelSurfaceGeneration, bool);
+  vtkGetMacro(ParallelSurfaceGeneration, bool);
+  vtkBooleanMacro(ParallelSurfaceGeneration, bool);
+
 protected:
   void SetMRMLSceneInternal(vtkMRMLScene* newScene) override;
   void OnMRMLSceneEndClose() override;
@@ -101,6 +115,11 @@ private:
   /// Flag determining whether the generated beam models are arranged in a separate subject hierarchy
   /// branch, or each beam model is added under its corresponding isocenter fiducial
   bool BeamModelsInSeparateBranch;
+
+  /// Flag determining whether the closed surface representations of the structures in a loaded structure set
+  /// are generated concurrently (each ROI on a separate thread) and then added to the segments in ROI order.
+  /// If off, then the surfaces are generated one by one by the segmentation when the display representation is set.
+  bool ParallelSurfaceGeneration;
 };
 
 #endif
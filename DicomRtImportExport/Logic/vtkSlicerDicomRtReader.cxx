@@ -29,7 +29,10 @@
 
 // VTK includes
 #include <vtkCellArray.h>
+#include <vtkIdTypeArray.h>
+#include <vtkImageData.h>
 #include <vtkMath.h>
+#include <vtkMatrix4x4.h>
 #include <vtkObjectFactory.h>
 #include <vtkPoints.h>
 #include <vtkPolyData.h>
@@ -37,18 +40,25 @@
 #include <vtkTable.h>
 #include <vtkStringArray.h>
 #include <vtkDoubleArray.h>
+#include <vtkSMPTools.h>
 #include <vtkVariant.h>
 
 // STD includes
+#include <algorithm>
 #include <array>
+#include <cmath>
 #include <vector>
 #include <map>
+#include <unordered_map>
 
 // DCMTK includes
 #include <dcmtk/config/osconfig.h>    /* make sure OS specific configuration is included first */
 
 #include <dcmtk/ofstd/ofconapp.h>
 
+#include <dcmtk/dcmdata/dcfcache.h>
+#include <dcmtk/dcmdata/dcxfer.h>
+
 #include <dcmtk/dcmrt/drtdose.h>
 #include <dcmtk/dcmrt/drtimage.h>
 #include <dcmtk/dcmrt/drtplan.h>
@@ -64,6 +74,28 @@
 
 vtkStandardNewMacro(vtkSlicerDicomRtReader);
 
+namespace
+{
+  /// Maximum size of the raw pixel data read from the file at once when reading a dose volume
+  const size_t MAX_DOSE_PIXEL_DATA_CHUNK_SIZE = 64 * 1024 * 1024;
+
+  //----------------------------------------------------------------------------
+  /// Convert raw dose pixel values to doses (in dose units) in parallel
+  template<typename PixelType>
+  void ApplyDoseGridScaling(const void* pixels, float* doses, vtkIdType numberOfVoxels, double doseGridScaling)
+  {
+    const PixelType* pixelValues = static_cast<const PixelType*>(pixels);
+    vtkSMPTools::For(0, numberOfVoxels, [&](vtkIdType beginVoxelIndex, vtkIdType endVoxelIndex)
+    {
+      // Same rounding as casting the volume to float and then scaling it
+      for (vtkIdType voxelIndex = beginVoxelIndex; voxelIndex < endVoxelIndex; ++voxelIndex)
+      {
+        doses[voxelIndex] = static_cast<float>(static_cast<float>(pixelValues[voxelIndex]) * doseGridScaling);
+      }
+    });
+  }
+}
+
 //----------------------------------------------------------------------------
 class vtkSlicerDicomRtReader::vtkInternal
 {
@@ -161,6 +193,8 @@ public:
 
   /// List of loaded contour ROIs from structure set
   std::vector<RoiEntry> RoiSequenceVector;
+  /// Index of ROI entries in \sa RoiSequenceVector by ROI number
+  std::unordered_map<unsigned int, size_t> RoiIndexByNumber;
 
   //TODO: Use referenced beams to load beams in correct order
   class ReferencedBeamEntry
@@ -335,6 +369,8 @@ public:
 
   /// List of loaded beams from external beam plan
   std::vector<BeamEntry> BeamSequenceVector;
+  /// Index of beam entries in \sa BeamSequenceVector by beam number
+  std::unordered_map<unsigned int, size_t> BeamIndexByNumber;
 
   /// Structure storing a channel in an RT application setup (for brachytherapy plan)
   class ChannelEntry
@@ -357,6 +393,8 @@ public:
 
   /// List of loaded channels from brachytherapy plan
   std::vector<ChannelEntry> ChannelSequenceVector;
+  /// Index of channel entries in \sa ChannelSequenceVector by channel number
+  std::unordered_map<unsigned int, size_t> ChannelIndexByNumber;
 
   /// Structure storing an RT Dose Prescription, Dose reference
   class DoseReferenceEntry
@@ -392,6 +430,11 @@ public:
 public:
   /// Load RT Dose
   void LoadRTDose(DcmDataset* dataset);
+  /// Read dose volume from the pixel data of an RT Dose dataset into \sa DoseImageData.
+  /// The pixel data is read from the file in chunks of frames, and the dose grid scaling is applied
+  /// into the dose volume in parallel, so the whole raw pixel data is never held in memory.
+  /// \return Success flag. Fails if the pixel data is compressed or the grid is not uniform
+  bool LoadRTDoseVolume(DcmDataset* dataset, double doseGridScaling);
 
   /// Load RT Plan 
   void LoadRTPlan(DcmDataset* dataset);
@@ -438,8 +481,23 @@ public:
   /// Get contour image sequence object in the referenced frame of reference sequence for a structure set
   DRTContourImageSequence* GetReferencedFrameOfReferenceContourImageSequence(DRTStructureSetIOD* rtStructureSet);
 
+  /// Get slice SOP instance UIDs listed in the referenced frame of reference sequence of a structure set,
+  /// keyed by negative slice numbers. The sequence is only traversed for the first ROI that needs it,
+  /// subsequent ROIs of the same structure set get the cached map.
+  const std::map<int, std::string>& GetReferencedFrameOfReferenceSliceInstanceUIDMap(DRTStructureSetIOD* rtStructureSet);
+
 public:
   vtkSlicerDicomRtReader* External;
+
+  /// Dose volume in dose units - for RTDOSE (\sa LoadRTDoseVolume)
+  vtkSmartPointer<vtkImageData> DoseImageData;
+  /// IJK to RAS matrix of the dose volume
+  vtkSmartPointer<vtkMatrix4x4> DoseIJKToRASMatrix;
+
+  /// Cached result of \sa GetReferencedFrameOfReferenceSliceInstanceUIDMap
+  std::map<int, std::string> ReferencedFrameOfReferenceSliceInstanceUIDMap;
+  /// Structure set the cached slice instance UID map belongs to
+  DRTStructureSetIOD* ReferencedFrameOfReferenceSliceInstanceUIDMapStructureSet{nullptr};
 };
 
 //----------------------------------------------------------------------------
@@ -450,8 +508,11 @@ vtkSlicerDicomRtReader::vtkInternal::vtkInternal(vtkSlicerDicomRtReader* externa
   : External(external)
 {
   this->RoiSequenceVector.clear();
+  this->RoiIndexByNumber.clear();
   this->BeamSequenceVector.clear();
+  this->BeamIndexByNumber.clear();
   this->ChannelSequenceVector.clear();
+  this->ChannelIndexByNumber.clear();
   this->DoseReferenceSequenceVector.clear();
 }
 
@@ -459,8 +520,11 @@ vtkSlicerDicomRtReader::vtkInternal::vtkInternal(vtkSlicerDicomRtReader* externa
 vtkSlicerDicomRtReader::vtkInternal::~vtkInternal()
 {
   this->RoiSequenceVector.clear();
+  this->RoiIndexByNumber.clear();
   this->BeamSequenceVector.clear();
+  this->BeamIndexByNumber.clear();
   this->ChannelSequenceVector.clear();
+  this->ChannelIndexByNumber.clear();
   this->DoseReferenceSequenceVector.clear();
 }
 
@@ -637,12 +701,10 @@ vtkSlicerDicomRtReader::vtkInternal::ControlPointEntry::operator=(const ControlP
 //----------------------------------------------------------------------------
 vtkSlicerDicomRtReader::vtkInternal::BeamEntry* vtkSlicerDicomRtReader::vtkInternal::FindBeamByNumber(unsigned int beamNumber)
 {
-  for (unsigned int i=0; i<this->BeamSequenceVector.size(); i++)
+  std::unordered_map<unsigned int, size_t>::iterator indexIt = this->BeamIndexByNumber.find(beamNumber);
+  if (indexIt != this->BeamIndexByNumber.end())
   {
-    if (this->BeamSequenceVector[i].Number == beamNumber)
-    {
-      return &this->BeamSequenceVector[i];
-    }
+    return &this->BeamSequenceVector[indexIt->second];
   }
 
   // Not found
@@ -653,12 +715,10 @@ vtkSlicerDicomRtReader::vtkInternal::BeamEntry* vtkSlicerDicomRtReader::vtkInter
 //----------------------------------------------------------------------------
 vtkSlicerDicomRtReader::vtkInternal::RoiEntry* vtkSlicerDicomRtReader::vtkInternal::FindRoiByNumber(unsigned int roiNumber)
 {
-  for (unsigned int i=0; i<this->RoiSequenceVector.size(); i++)
+  std::unordered_map<unsigned int, size_t>::iterator indexIt = this->RoiIndexByNumber.find(roiNumber);
+  if (indexIt != this->RoiIndexByNumber.end())
   {
-    if (this->RoiSequenceVector[i].Number == roiNumber)
-    {
-      return &this->RoiSequenceVector[i];
-    }
+    return &this->RoiSequenceVector[indexIt->second];
   }
 
   // Not found
@@ -669,12 +729,10 @@ vtkSlicerDicomRtReader::vtkInternal::RoiEntry* vtkSlicerDicomRtReader::vtkIntern
 //----------------------------------------------------------------------------
 vtkSlicerDicomRtReader::vtkInternal::ChannelEntry* vtkSlicerDicomRtReader::vtkInternal::FindChannelByNumber(unsigned int channelNumber)
 {
-  for (unsigned int i=0; i<this->ChannelSequenceVector.size(); i++)
+  std::unordered_map<unsigned int, size_t>::iterator indexIt = this->ChannelIndexByNumber.find(channelNumber);
+  if (indexIt != this->ChannelIndexByNumber.end())
   {
-    if (this->ChannelSequenceVector[i].Number == channelNumber)
-    {
-      return &this->ChannelSequenceVector[i];
-    }
+    return &this->ChannelSequenceVector[indexIt->second];
   }
 
   // Not found
@@ -773,6 +831,44 @@ DRTContourImageSequence* vtkSlicerDicomRtReader::vtkInternal::GetReferencedFrame
   return &rtContourImageSequence;
 }
 
+//----------------------------------------------------------------------------
+const std::map<int, std::string>& vtkSlicerDicomRtReader::vtkInternal::GetReferencedFrameOfReferenceSliceInstanceUIDMap(DRTStructureSetIOD* rtStructureSet)
+{
+  if (this->ReferencedFrameOfReferenceSliceInstanceUIDMapStructureSet == rtStructureSet)
+  {
+    return this->ReferencedFrameOfReferenceSliceInstanceUIDMap;
+  }
+  this->ReferencedFrameOfReferenceSliceInstanceUIDMap.clear();
+  this->ReferencedFrameOfReferenceSliceInstanceUIDMapStructureSet = rtStructureSet;
+
+  DRTContourImageSequence* rtContourImageSequence = this->GetReferencedFrameOfReferenceContourImageSequence(rtStructureSet);
+  if (!rtContourImageSequence || !rtContourImageSequence->gotoFirstItem().good())
+  {
+    vtkErrorWithObjectMacro(this->External, "GetReferencedFrameOfReferenceSliceInstanceUIDMap: No items in contour image sequence object item in referenced frame of reference sequence");
+    return this->ReferencedFrameOfReferenceSliceInstanceUIDMap;
+  }
+
+  int currentSliceNumber = -1; // Use negative keys to indicate that the slice instances cannot be directly mapped to the ROI planar contours
+  do 
+  {
+    DRTContourImageSequence::Item &rtContourImageSequenceItem = rtContourImageSequence->getCurrentItem();
+    if (rtContourImageSequenceItem.isValid())
+    {
+      OFString referencedSOPInstanceUID("");
+      rtContourImageSequenceItem.getReferencedSOPInstanceUID(referencedSOPInstanceUID);
+      this->ReferencedFrameOfReferenceSliceInstanceUIDMap[currentSliceNumber] = referencedSOPInstanceUID.c_str();
+    }
+    else
+    {
+      vtkErrorWithObjectMacro(this->External, "GetReferencedFrameOfReferenceSliceInstanceUIDMap: Contour image sequence object item in referenced frame of reference sequence is invalid");
+    }
+    currentSliceNumber--;
+  }
+  while (rtContourImageSequence->gotoNextItem().good());
+
+  return this->ReferencedFrameOfReferenceSliceInstanceUIDMap;
+}
+
 //----------------------------------------------------------------------------
 void vtkSlicerDicomRtReader::vtkInternal::LoadRTDose(DcmDataset* dataset)
 {
@@ -822,6 +918,13 @@ void vtkSlicerDicomRtReader::vtkInternal::LoadRTDose(DcmDataset* dataset)
   this->External->SetPixelSpacing(pixelSpacingOFVector[1], pixelSpacingOFVector[0]);
   vtkDebugWithObjectMacro(this->External, "Pixel Spacing: (" << pixelSpacingOFVector[1] << ", " << pixelSpacingOFVector[0] << ")");
 
+  // Read the dose volume directly from the pixel data. If it is not possible, then the dose volume
+  // is read from the file as a scalar volume when loading it into the scene.
+  if (!this->LoadRTDoseVolume(dataset, vtkVariant(doseGridScaling.c_str()).ToDouble()))
+  {
+    vtkDebugWithObjectMacro(this->External, "LoadRTDose: Dose volume cannot be read directly from the pixel data");
+  }
+
   // Get referenced RTPlan instance UID
   DRTReferencedRTPlanSequence &referencedRTPlanSequence = rtDose.getReferencedRTPlanSequence();
   if (referencedRTPlanSequence.gotoFirstItem().good())
@@ -852,6 +955,187 @@ void vtkSlicerDicomRtReader::vtkInternal::LoadRTDose(DcmDataset* dataset)
   this->External->LoadRTDoseSuccessful = true;
 }
 
+//----------------------------------------------------------------------------
+bool vtkSlicerDicomRtReader::vtkInternal::LoadRTDoseVolume(DcmDataset* dataset, double doseGridScaling)
+{
+  this->DoseImageData = nullptr;
+  this->DoseIJKToRASMatrix = nullptr;
+
+  // Only native pixel data in the local byte order can be read directly from the file
+  DcmXfer transferSyntax(dataset->getOriginalXfer());
+  if (transferSyntax.isEncapsulated() || transferSyntax.getStreamCompression() != ESC_none || transferSyntax.getByteOrder() != gLocalByteOrder)
+  {
+    return false;
+  }
+
+  Uint16 rows = 0;
+  Uint16 columns = 0;
+  Uint16 bitsAllocated = 0;
+  Uint16 bitsStored = 0;
+  Uint16 pixelRepresentation = 0;
+  Uint16 samplesPerPixel = 1;
+  Sint32 numberOfFrames = 1;
+  if ( dataset->findAndGetUint16(DCM_Rows, rows).bad() || dataset->findAndGetUint16(DCM_Columns, columns).bad()
+    || dataset->findAndGetUint16(DCM_BitsAllocated, bitsAllocated).bad() || rows == 0 || columns == 0 )
+  {
+    return false;
+  }
+  dataset->findAndGetUint16(DCM_BitsStored, bitsStored);
+  dataset->findAndGetUint16(DCM_PixelRepresentation, pixelRepresentation);
+  dataset->findAndGetUint16(DCM_SamplesPerPixel, samplesPerPixel);
+  dataset->findAndGetSint32(DCM_NumberOfFrames, numberOfFrames);
+  if ((bitsAllocated != 16 && bitsAllocated != 32) || bitsStored != bitsAllocated || samplesPerPixel != 1 || numberOfFrames < 1)
+  {
+    return false;
+  }
+
+  // Geometry. Frame positions are given by the grid frame offset vector along the slice normal
+  double position[3] = { 0.0, 0.0, 0.0 };
+  double orientation[6] = { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+  for (unsigned long index = 0; index < 3; ++index)
+  {
+    if (dataset->findAndGetFloat64(DCM_ImagePositionPatient, position[index], index).bad())
+    {
+      return false;
+    }
+  }
+  for (unsigned long index = 0; index < 6; ++index)
+  {
+    if (dataset->findAndGetFloat64(DCM_ImageOrientationPatient, orientation[index], index).bad())
+    {
+      return false;
+    }
+  }
+  std::vector<double> gridFrameOffsets(numberOfFrames, 0.0);
+  if (numberOfFrames > 1)
+  {
+    for (Sint32 frameIndex = 0; frameIndex < numberOfFrames; ++frameIndex)
+    {
+      if (dataset->findAndGetFloat64(DCM_GridFrameOffsetVector, gridFrameOffsets[frameIndex], frameIndex).bad())
+      {
+        return false;
+      }
+    }
+  }
+  // If the first offset is not zero, then the offsets are the z coordinates of the frames (see C.8.8.3.2)
+  double firstFrameOffset = gridFrameOffsets[0];
+  if (firstFrameOffset != 0.0 && fabs(firstFrameOffset - position[2]) < 1e-3)
+  {
+    firstFrameOffset = 0.0;
+    for (double& gridFrameOffset : gridFrameOffsets)
+    {
+      gridFrameOffset -= position[2];
+    }
+  }
+  double sliceSpacing = 1.0;
+  if (numberOfFrames > 1)
+  {
+    sliceSpacing = gridFrameOffsets[1] - gridFrameOffsets[0];
+    for (Sint32 frameIndex = 1; frameIndex < numberOfFrames; ++frameIndex)
+    {
+      if (fabs(gridFrameOffsets[frameIndex] - gridFrameOffsets[frameIndex-1] - sliceSpacing) > 1e-3 * fabs(sliceSpacing))
+      {
+        return false; // Non-uniform frame spacing
+      }
+    }
+    if (sliceSpacing == 0.0)
+    {
+      return false;
+    }
+  }
+  else
+  {
+    Float64 sliceThickness = 0.0;
+    if (dataset->findAndGetFloat64(DCM_SliceThickness, sliceThickness).good() && sliceThickness > 0.0)
+    {
+      sliceSpacing = sliceThickness;
+    }
+  }
+
+  // Pixel data
+  DcmElement* pixelDataElement = nullptr;
+  if (dataset->findAndGetElement(DCM_PixelData, pixelDataElement).bad() || !pixelDataElement)
+  {
+    return false;
+  }
+  size_t bytesPerVoxel = bitsAllocated / 8;
+  size_t voxelsPerFrame = static_cast<size_t>(rows) * columns;
+  size_t frameSize = voxelsPerFrame * bytesPerVoxel;
+  if (static_cast<size_t>(pixelDataElement->getLength()) < frameSize * numberOfFrames)
+  {
+    vtkErrorWithObjectMacro(this->External, "LoadRTDoseVolume: Pixel data is shorter than the dose grid");
+    return false;
+  }
+
+  vtkSmartPointer<vtkImageData> doseImageData = vtkSmartPointer<vtkImageData>::New();
+  doseImageData->SetDimensions(columns, rows, numberOfFrames);
+  doseImageData->AllocateScalars(VTK_FLOAT, 1);
+  float* doses = static_cast<float*>(doseImageData->GetScalarPointer());
+
+  // Read the frames in chunks straight from the file, and scale them into the dose volume
+  Sint32 framesPerChunk = static_cast<Sint32>(std::max<size_t>(1, MAX_DOSE_PIXEL_DATA_CHUNK_SIZE / frameSize));
+  framesPerChunk = std::min(framesPerChunk, numberOfFrames);
+  std::vector<Uint32> pixelChunk((framesPerChunk * frameSize + sizeof(Uint32) - 1) / sizeof(Uint32));
+  DcmFileCache fileCache;
+  for (Sint32 firstFrameIndex = 0; firstFrameIndex < numberOfFrames; firstFrameIndex += framesPerChunk)
+  {
+    Sint32 chunkFrames = std::min(framesPerChunk, numberOfFrames - firstFrameIndex);
+    OFCondition result = pixelDataElement->getPartialValue(pixelChunk.data(),
+      static_cast<Uint32>(firstFrameIndex * frameSize), static_cast<Uint32>(chunkFrames * frameSize), &fileCache, gLocalByteOrder);
+    if (result.bad())
+    {
+      vtkErrorWithObjectMacro(this->External, "LoadRTDoseVolume: Failed to read pixel data: " << result.text());
+      return false;
+    }
+
+    float* chunkDoses = doses + firstFrameIndex * voxelsPerFrame;
+    vtkIdType chunkVoxels = static_cast<vtkIdType>(chunkFrames * voxelsPerFrame);
+    if (bitsAllocated == 16)
+    {
+      if (pixelRepresentation)
+      {
+        ApplyDoseGridScaling<Sint16>(pixelChunk.data(), chunkDoses, chunkVoxels, doseGridScaling);
+      }
+      else
+      {
+        ApplyDoseGridScaling<Uint16>(pixelChunk.data(), chunkDoses, chunkVoxels, doseGridScaling);
+      }
+    }
+    else
+    {
+      if (pixelRepresentation)
+      {
+        ApplyDoseGridScaling<Sint32>(pixelChunk.data(), chunkDoses, chunkVoxels, doseGridScaling);
+      }
+      else
+      {
+        ApplyDoseGridScaling<Uint32>(pixelChunk.data(), chunkDoses, chunkVoxels, doseGridScaling);
+      }
+    }
+  }
+
+  // IJK to LPS: columns along the row direction cosines, rows along the column direction cosines,
+  // and frames along the slice normal. Then LPS to RAS.
+  double* pixelSpacing = this->External->GetPixelSpacing();
+  double rowDirection[3] = { orientation[0], orientation[1], orientation[2] };
+  double columnDirection[3] = { orientation[3], orientation[4], orientation[5] };
+  double sliceNormal[3] = { 0.0, 0.0, 0.0 };
+  vtkMath::Cross(rowDirection, columnDirection, sliceNormal);
+  vtkSmartPointer<vtkMatrix4x4> ijkToRasMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  for (int row = 0; row < 3; ++row)
+  {
+    double lpsToRas = (row < 2 ? -1.0 : 1.0);
+    ijkToRasMatrix->SetElement(row, 0, lpsToRas * rowDirection[row] * pixelSpacing[0]);
+    ijkToRasMatrix->SetElement(row, 1, lpsToRas * columnDirection[row] * pixelSpacing[1]);
+    ijkToRasMatrix->SetElement(row, 2, lpsToRas * sliceNormal[row] * sliceSpacing);
+    ijkToRasMatrix->SetElement(row, 3, lpsToRas * (position[row] + firstFrameOffset * sliceNormal[row]));
+  }
+
+  this->DoseImageData = doseImageData;
+  this->DoseIJKToRASMatrix = ijkToRasMatrix;
+  return true;
+}
+
 //----------------------------------------------------------------------------
 void vtkSlicerDicomRtReader::vtkInternal::LoadRTPlan(DcmDataset* dataset)
 {
@@ -1300,6 +1584,7 @@ void vtkSlicerDicomRtReader::vtkInternal::LoadRTPlan(DcmDataset* dataset)
         vtkErrorWithObjectMacro( this->External, "LoadRTPlan: Number of control points expected ("
           << beamNumberOfControlPoints << ") and found (" << controlPointCount << ") do not match. Invalid points remain among control points");
       }
+      this->BeamIndexByNumber.emplace(beamEntry.Number, this->BeamSequenceVector.size());
       this->BeamSequenceVector.push_back(beamEntry);
     }
     while (rtPlanBeamSequence.gotoNextItem().good());
@@ -1406,6 +1691,7 @@ void vtkSlicerDicomRtReader::vtkInternal::LoadRTPlan(DcmDataset* dataset)
           << channelNumberOfControlPoints << ") and found (" << controlPointCount << ") do not match. Invalid points remain among control points");
       }
 
+      this->ChannelIndexByNumber.emplace(channelEntry.Number, this->ChannelSequenceVector.size());
       this->ChannelSequenceVector.push_back(channelEntry);
     }
     while (channelSequence.gotoNextItem().good());
@@ -2130,6 +2416,7 @@ void vtkSlicerDicomRtReader::vtkInternal::LoadRTIonPlan(DcmDataset* dataset)
         vtkErrorWithObjectMacro( this->External, "LoadRTIonPlan: Number of control points expected ("
           << beamNumberOfControlPoints << ") and found (" << controlPointCount << ") do not match. Invalid points remain among control points");
       }
+      this->BeamIndexByNumber.emplace(beamEntry.Number, this->BeamSequenceVector.size());
       this->BeamSequenceVector.push_back(beamEntry);
     }
     while (ionBeamSequence.gotoNextItem().good());
@@ -2198,6 +2485,7 @@ void vtkSlicerDicomRtReader::vtkInternal::LoadRTIonPlan(DcmDataset* dataset)
 void vtkSlicerDicomRtReader::vtkInternal::LoadRTStructureSet(DcmDataset* dataset)
 {
   this->External->LoadRTStructureSetSuccessful = false;
+  this->ReferencedFrameOfReferenceSliceInstanceUIDMapStructureSet = nullptr;
 
   DRTStructureSetIOD* rtStructureSet = new DRTStructureSetIOD();
   if (rtStructureSet->read(*dataset).bad())
@@ -2389,6 +2677,7 @@ void vtkSlicerDicomRtReader::vtkInternal::LoadContoursFromRoiSequence(DRTStructu
     roiEntry.Number=roiNumber;
 
     // Save to vector          
+    this->RoiIndexByNumber.emplace(roiEntry.Number, this->RoiSequenceVector.size());
     this->RoiSequenceVector.push_back(roiEntry);
   }
   while (rtStructureSetROISequence->gotoNextItem().good());
@@ -2426,12 +2715,40 @@ vtkSlicerDicomRtReader::vtkInternal::RoiEntry* vtkSlicerDicomRtReader::vtkIntern
     return roiEntry;
   }
 
-  // Create containers for contour poly data
+  // Count the contour points, so that the points and cells of the ROI can be allocated at once
+  vtkIdType numberOfRoiPoints = 0;
+  vtkIdType numberOfRoiContours = 0;
+  do
+  {
+    DRTContourSequence::Item &contourItem = rtContourSequence.getCurrentItem();
+    Sint32 numberOfPoints = 0;
+    if (contourItem.isValid() && contourItem.getNumberOfContourPoints(numberOfPoints).good() && numberOfPoints > 0)
+    {
+      numberOfRoiPoints += numberOfPoints;
+      ++numberOfRoiContours;
+    }
+  }
+  while (rtContourSequence.gotoNextItem().good());
+  rtContourSequence.gotoFirstItem();
+
+  // Create containers for contour poly data. The point coordinates and the cell connectivity are written
+  // directly into the arrays, and each contour is closed by repeating its first point.
   vtkSmartPointer<vtkPoints> currentRoiContourPoints = vtkSmartPointer<vtkPoints>::New();
-  vtkSmartPointer<vtkCellArray> currentRoiContourCells = vtkSmartPointer<vtkCellArray>::New();
+  currentRoiContourPoints->SetDataTypeToFloat();
+  currentRoiContourPoints->SetNumberOfPoints(numberOfRoiPoints);
+  float* pointCoordinates = static_cast<float*>(currentRoiContourPoints->GetVoidPointer(0));
+  vtkSmartPointer<vtkIdTypeArray> cellOffsets = vtkSmartPointer<vtkIdTypeArray>::New();
+  cellOffsets->SetNumberOfValues(numberOfRoiContours + 1);
+  vtkSmartPointer<vtkIdTypeArray> cellConnectivity = vtkSmartPointer<vtkIdTypeArray>::New();
+  cellConnectivity->SetNumberOfValues(numberOfRoiPoints + numberOfRoiContours);
+  vtkIdType* offsets = cellOffsets->GetPointer(0);
+  vtkIdType* connectivity = cellConnectivity->GetPointer(0);
   vtkIdType pointId = 0;
+  vtkIdType connectivityIndex = 0;
+  vtkIdType contourIndex = 0;
 
   // Read contour data, iterate over contour sequence
+  OFVector<vtkTypeFloat64> contourData_LPS;
   do
   {
     // Get contour
@@ -2442,17 +2759,16 @@ vtkSlicerDicomRtReader::vtkInternal::RoiEntry* vtkSlicerDicomRtReader::vtkIntern
     }
 
     // Get number of contour points
-    OFString numberOfPointsString("");
-    contourItem.getNumberOfContourPoints(numberOfPointsString);
-    std::stringstream ss;
-    ss << numberOfPointsString;
-    int numberOfPoints;
-    ss >> numberOfPoints;
+    Sint32 numberOfPoints = 0;
+    if (contourItem.getNumberOfContourPoints(numberOfPoints).bad() || numberOfPoints <= 0)
+    {
+      vtkErrorWithObjectMacro(this->External, "LoadContour: Contour sequence object item is invalid: no contour points");
+      continue;
+    }
 
     // Get contour point data
-    OFVector<vtkTypeFloat64> contourData_LPS;
     contourItem.getContourData(contourData_LPS);
-    if (contourData_LPS.size() != size_t(numberOfPoints * 3))
+    if (contourData_LPS.size() != size_t(numberOfPoints) * 3)
     {
       vtkErrorWithObjectMacro(this->External, "LoadContour: Contour sequence object item is invalid: "
         << " number of contour points is " << numberOfPoints << " therefore expected "
@@ -2460,17 +2776,24 @@ vtkSlicerDicomRtReader::vtkInternal::RoiEntry* vtkSlicerDicomRtReader::vtkIntern
       continue;
     }
 
-    unsigned int contourIndex = currentRoiContourCells->InsertNextCell(numberOfPoints+1);
-    for (int k=0; k<numberOfPoints; k++)
+    // Convert from DICOM LPS -> Slicer RAS
+    const vtkTypeFloat64* contourPoints_LPS = &contourData_LPS[0];
+    float* contourPoints_RAS = pointCoordinates + 3 * pointId;
+    for (Sint32 k=0; k<numberOfPoints; k++)
     {
-      // Convert from DICOM LPS -> Slicer RAS
-      currentRoiContourPoints->InsertPoint(pointId, -contourData_LPS[3*k], -contourData_LPS[3*k+1], contourData_LPS[3*k+2]);
-      currentRoiContourCells->InsertCellPoint(pointId);
-      pointId++;
+      contourPoints_RAS[3*k]   = static_cast<float>(-contourPoints_LPS[3*k]);
+      contourPoints_RAS[3*k+1] = static_cast<float>(-contourPoints_LPS[3*k+1]);
+      contourPoints_RAS[3*k+2] = static_cast<float>(contourPoints_LPS[3*k+2]);
     }
 
-    // Close the contour
-    currentRoiContourCells->InsertCellPoint(pointId-numberOfPoints);
+    // Add contour cell, closed by its first point
+    offsets[contourIndex] = connectivityIndex;
+    for (Sint32 k=0; k<numberOfPoints; k++)
+    {
+      connectivity[connectivityIndex++] = pointId + k;
+    }
+    connectivity[connectivityIndex++] = pointId;
+    pointId += numberOfPoints;
 
     // Add map to the referenced slice instance UID
     // This is not a mandatory field so no error logged if not found. The reason why
@@ -2483,7 +2806,7 @@ vtkSlicerDicomRtReader::vtkInternal::RoiEntry* vtkSlicerDicomRtReader::vtkIntern
       {
         OFString referencedSOPInstanceUID("");
         rtContourImageSequenceItem.getReferencedSOPInstanceUID(referencedSOPInstanceUID);
-        contourToSliceInstanceUIDMap[contourIndex] = referencedSOPInstanceUID.c_str();
+        contourToSliceInstanceUIDMap[static_cast<int>(contourIndex)] = referencedSOPInstanceUID.c_str();
         referencedSopInstanceUids.insert(referencedSOPInstanceUID.c_str());
 
         // Check if multiple SOP instance UIDs are referenced
@@ -2497,37 +2820,26 @@ vtkSlicerDicomRtReader::vtkInternal::RoiEntry* vtkSlicerDicomRtReader::vtkIntern
         vtkErrorWithObjectMacro(this->External, "LoadContour: Contour image sequence object item is invalid");
       }
     }
+
+    ++contourIndex;
   }
   while (rtContourSequence.gotoNextItem().good());
 
+  // Drop the space allocated for invalid contours, and set up the cells
+  currentRoiContourPoints->SetNumberOfPoints(pointId);
+  cellOffsets->SetValue(contourIndex, connectivityIndex);
+  cellOffsets->SetNumberOfValues(contourIndex + 1);
+  cellConnectivity->SetNumberOfValues(connectivityIndex);
+  vtkSmartPointer<vtkCellArray> currentRoiContourCells = vtkSmartPointer<vtkCellArray>::New();
+  currentRoiContourCells->SetData(cellOffsets, cellConnectivity);
+
   // Read slice reference UIDs from referenced frame of reference sequence if it was not included in the ROIContourSequence above
   if (contourToSliceInstanceUIDMap.empty())
   {
-    DRTContourImageSequence* rtContourImageSequence = this->GetReferencedFrameOfReferenceContourImageSequence(rtStructureSet);
-    if (rtContourImageSequence && rtContourImageSequence->gotoFirstItem().good())
+    contourToSliceInstanceUIDMap = this->GetReferencedFrameOfReferenceSliceInstanceUIDMap(rtStructureSet);
+    for (std::map<int, std::string>::iterator sliceIt = contourToSliceInstanceUIDMap.begin(); sliceIt != contourToSliceInstanceUIDMap.end(); ++sliceIt)
     {
-      int currentSliceNumber = -1; // Use negative keys to indicate that the slice instances cannot be directly mapped to the ROI planar contours
-      do 
-      {
-        DRTContourImageSequence::Item &rtContourImageSequenceItem = rtContourImageSequence->getCurrentItem();
-        if (rtContourImageSequenceItem.isValid())
-        {
-          OFString referencedSOPInstanceUID("");
-          rtContourImageSequenceItem.getReferencedSOPInstanceUID(referencedSOPInstanceUID);
-          contourToSliceInstanceUIDMap[currentSliceNumber] = referencedSOPInstanceUID.c_str();
-          referencedSopInstanceUids.insert(referencedSOPInstanceUID.c_str());
-        }
-        else
-        {
-          vtkErrorWithObjectMacro(this->External, "LoadContour: Contour image sequence object item in referenced frame of reference sequence is invalid");
-        }
-        currentSliceNumber--;
-      }
-      while (rtContourImageSequence->gotoNextItem().good());
-    }
-    else
-    {
-      vtkErrorWithObjectMacro(this->External, "LoadContour: No items in contour image sequence object item in referenced frame of reference sequence");
+      referencedSopInstanceUids.insert(sliceIt->second);
     }
   }
 
@@ -2880,8 +3192,11 @@ void vtkSlicerDicomRtReader::Update()
     // Load DICOM file or dataset
     DcmFileFormat fileformat;
 
+    // Values longer than the maximum read length are not loaded into memory with the dataset, but read
+    // from the file when accessed. This is only kept for the pixel data of RT dose, other objects are
+    // loaded completely once their SOP class is known.
     OFCondition result = EC_TagNotFound;
-    result = fileformat.loadFile(this->FileName, EXS_Unknown);
+    result = fileformat.loadFile(this->FileName, EXS_Unknown, EGL_noChange, DCM_MaxReadLength);
     if (result.good())
     {
       DcmDataset *dataset = fileformat.getDataset();
@@ -2891,6 +3206,11 @@ void vtkSlicerDicomRtReader::Update()
       OFString sopClass("");
       if (dataset->findAndGetOFString(DCM_SOPClassUID, sopClass).good() && !sopClass.empty())
       {
+        if (sopClass != UID_RTDoseStorage)
+        {
+          fileformat.loadAllDataIntoMemory();
+        }
+
         if (sopClass == UID_RTDoseStorage)
         {
           this->Internal->LoadRTDose(dataset);
@@ -3013,6 +3333,18 @@ int vtkSlicerDicomRtReader::GetNumberOfDoseReferences()
   return this->Internal->DoseReferenceSequenceVector.size();
 }
 
+//----------------------------------------------------------------------------
+vtkImageData* vtkSlicerDicomRtReader::GetDoseImageData()
+{
+  return this->Internal->DoseImageData;
+}
+
+//----------------------------------------------------------------------------
+vtkMatrix4x4* vtkSlicerDicomRtReader::GetDoseIJKToRASMatrix()
+{
+  return this->Internal->DoseIJKToRASMatrix;
+}
+
 //----------------------------------------------------------------------------
 vtkTable* vtkSlicerDicomRtReader::GetDoseReferenceTable()
 {
@@ -39,6 +39,8 @@
 #include <vector>
 #include <array>
 
+class vtkImageData;
+class vtkMatrix4x4;
 class vtkPolyData;
 class vtkTable;
 
@@ -262,6 +264,12 @@ public:
   /// Set dose grid scaling
   vtkSetStringMacro(DoseGridScaling);
 
+  /// Get dose volume read directly from the pixel data, with the dose grid scaling applied (i.e. in dose units).
+  /// Only available for uncompressed pixel data on a uniform grid, nullptr otherwise
+  vtkImageData* GetDoseImageData();
+  /// Get IJK to RAS matrix of the dose volume. Only valid if \sa GetDoseImageData is available
+  vtkMatrix4x4* GetDoseIJKToRASMatrix();
+
   /// Get RT Plan SOP instance UID referenced by RT Dose
   vtkGetStringMacro(RTDoseReferencedRTPlanSOPInstanceUID);
   /// Set RT Plan SOP instance UID referenced by RT Dose
@@ -0,0 +1,360 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Csaba Pinter, PerkLab, Queen's University
+  and was supported through the Applied Cancer Research Unit program of Cancer Care
+  Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
+
+==============================================================================*/
+
+// DicomRtImportExport includes
+#include "vtkPlanarContourToClosedSurfaceConversionRule.h"
+
+// SegmentationCore includes
+#include <vtkSegment.h>
+#include <vtkSegmentationConverter.h>
+
+// VTK includes
+#include <vtkCellArray.h>
+#include <vtkMath.h>
+#include <vtkMultiBlockDataSet.h>
+#include <vtkObjectFactory.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+#include <vtkTimerLog.h>
+#include <vtkXMLMultiBlockDataReader.h>
+
+// VTKSYS includes
+#include <vtksys/SystemTools.hxx>
+
+// STD includes
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+//-----------------------------------------------------------------------------
+/// Conversion rule exposing the overlap detection between planes
+class vtkPlanarContourToClosedSurfaceConversionRuleTester : public vtkPlanarContourToClosedSurfaceConversionRule
+{
+public:
+  static vtkPlanarContourToClosedSurfaceConversionRuleTester* New();
+  vtkTypeMacro(vtkPlanarContourToClosedSurfaceConversionRuleTester, vtkPlanarContourToClosedSurfaceConversionRule);
+
+  using vtkPlanarContourToClosedSurfaceConversionRule::FindOverlappingLines;
+  using vtkPlanarContourToClosedSurfaceConversionRule::DoLinesOverlap;
+};
+vtkStandardNewMacro(vtkPlanarContourToClosedSurfaceConversionRuleTester);
+
+namespace
+{
+  //-----------------------------------------------------------------------------
+  /// Convert planar contours to closed surface
+  /// \return Closed surface, nullptr on failure
+  vtkSmartPointer<vtkPolyData> ConvertToClosedSurface(vtkPolyData* planarContours)
+  {
+    vtkSmartPointer<vtkSegment> segment = vtkSmartPointer<vtkSegment>::New();
+    segment->AddRepresentation(vtkSegmentationConverter::GetSegmentationPlanarContourRepresentationName(), planarContours);
+
+    vtkSmartPointer<vtkPlanarContourToClosedSurfaceConversionRule> rule = vtkSmartPointer<vtkPlanarContourToClosedSurfaceConversionRule>::New();
+    if (!rule->Convert(segment))
+    {
+      return nullptr;
+    }
+    return vtkPolyData::SafeDownCast(segment->GetRepresentation(vtkSegmentationConverter::GetSegmentationClosedSurfaceRepresentationName()));
+  }
+
+  //-----------------------------------------------------------------------------
+  /// Determine whether two surfaces contain the same triangles in the same order
+  bool AreSurfacesIdentical(vtkPolyData* surface1, vtkPolyData* surface2)
+  {
+    if (surface1->GetNumberOfPoints() != surface2->GetNumberOfPoints()
+      || surface1->GetNumberOfPolys() != surface2->GetNumberOfPolys())
+    {
+      return false;
+    }
+    vtkCellArray* polys1 = surface1->GetPolys();
+    vtkCellArray* polys2 = surface2->GetPolys();
+    for (vtkIdType cellId = 0; cellId < polys1->GetNumberOfCells(); ++cellId)
+    {
+      vtkIdType numberOfPoints1 = 0;
+      const vtkIdType* pointIds1 = nullptr;
+      polys1->GetCellAtId(cellId, numberOfPoints1, pointIds1);
+      vtkIdType numberOfPoints2 = 0;
+      const vtkIdType* pointIds2 = nullptr;
+      polys2->GetCellAtId(cellId, numberOfPoints2, pointIds2);
+      if (numberOfPoints1 != numberOfPoints2 || !std::equal(pointIds1, pointIds1 + numberOfPoints1, pointIds2))
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  //-----------------------------------------------------------------------------
+  /// Create planar contours with a grid of circular islands on each plane. The islands are shifted slightly
+  /// on each plane so that each island overlaps with the corresponding island on the adjacent planes only.
+  vtkSmartPointer<vtkPolyData> CreateIslandContours(int numberOfIslandsPerAxis, int numberOfPlanes, int numberOfPointsPerIsland)
+  {
+    const double radius = 5.0;
+    const double islandSpacing = 3.0 * radius;
+    const double planeSpacing = 2.0;
+
+    vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+    vtkSmartPointer<vtkCellArray> lines = vtkSmartPointer<vtkCellArray>::New();
+    for (int planeIndex = 0; planeIndex < numberOfPlanes; ++planeIndex)
+    {
+      double shift = 0.1 * radius * (planeIndex % 2);
+      for (int y = 0; y < numberOfIslandsPerAxis; ++y)
+      {
+        for (int x = 0; x < numberOfIslandsPerAxis; ++x)
+        {
+          // Closed contour, the first point is repeated at the end
+          lines->InsertNextCell(numberOfPointsPerIsland + 1);
+          vtkIdType firstPointId = points->GetNumberOfPoints();
+          for (int pointIndex = 0; pointIndex < numberOfPointsPerIsland; ++pointIndex)
+          {
+            double angle = 2.0 * vtkMath::Pi() * pointIndex / numberOfPointsPerIsland;
+            lines->InsertCellPoint(points->InsertNextPoint(
+              x * islandSpacing + shift + radius * cos(angle), y * islandSpacing + shift + radius * sin(angle), planeIndex * planeSpacing));
+          }
+          lines->InsertCellPoint(firstPointId);
+        }
+      }
+    }
+
+    vtkSmartPointer<vtkPolyData> contours = vtkSmartPointer<vtkPolyData>::New();
+    contours->SetPoints(points);
+    contours->SetLines(lines);
+    return contours;
+  }
+
+  //-----------------------------------------------------------------------------
+  /// Compare overlap detection between two planes of many islands using the spatial index and testing all pairs,
+  /// and time the conversion of the islands
+  bool RunIslandBenchmark(int numberOfIslandsPerAxis, int numberOfIterations)
+  {
+    const int numberOfPlanes = 10;
+    const int numberOfPointsPerIsland = 32;
+    vtkSmartPointer<vtkPolyData> contours = CreateIslandContours(numberOfIslandsPerAxis, numberOfPlanes, numberOfPointsPerIsland);
+    vtkIdType numberOfLinesOnPlane = numberOfIslandsPerAxis * numberOfIslandsPerAxis;
+    vtkIdType numberOfLines = contours->GetNumberOfLines();
+
+    std::vector<std::array<double, 6> > lineBounds(numberOfLines);
+    for (vtkIdType lineIndex = 0; lineIndex < numberOfLines; ++lineIndex)
+    {
+      contours->GetCellBounds(lineIndex, lineBounds[lineIndex].data());
+    }
+
+    vtkSmartPointer<vtkPlanarContourToClosedSurfaceConversionRuleTester> rule = vtkSmartPointer<vtkPlanarContourToClosedSurfaceConversionRuleTester>::New();
+    vtkSmartPointer<vtkTimerLog> timer = vtkSmartPointer<vtkTimerLog>::New();
+
+    // Overlap detection between the first two planes using the spatial index
+    std::vector<std::vector<vtkIdType> > plane1Overlaps;
+    std::vector<std::vector<vtkIdType> > plane2Overlaps;
+    timer->StartTimer();
+    for (int iteration = 0; iteration < numberOfIterations; ++iteration)
+    {
+      rule->FindOverlappingLines(0, numberOfLinesOnPlane, 2 * numberOfLinesOnPlane, lineBounds, plane1Overlaps, plane2Overlaps);
+    }
+    timer->StopTimer();
+    double indexedTimeSec = timer->GetElapsedTime() / numberOfIterations;
+
+    // Overlap detection between the first two planes by testing all pairs
+    std::vector<std::vector<vtkIdType> > allPairsPlane1Overlaps;
+    std::vector<std::vector<vtkIdType> > allPairsPlane2Overlaps;
+    timer->StartTimer();
+    for (int iteration = 0; iteration < numberOfIterations; ++iteration)
+    {
+      allPairsPlane1Overlaps.assign(numberOfLinesOnPlane, std::vector<vtkIdType>());
+      allPairsPlane2Overlaps.assign(numberOfLinesOnPlane, std::vector<vtkIdType>());
+      for (vtkIdType line1Index = 0; line1Index < numberOfLinesOnPlane; ++line1Index)
+      {
+        for (vtkIdType line2Index = numberOfLinesOnPlane; line2Index < 2 * numberOfLinesOnPlane; ++line2Index)
+        {
+          if (rule->DoLinesOverlap(lineBounds[line1Index].data(), lineBounds[line2Index].data()))
+          {
+            allPairsPlane1Overlaps[line1Index].push_back(line2Index);
+            allPairsPlane2Overlaps[line2Index - numberOfLinesOnPlane].push_back(line1Index);
+          }
+        }
+      }
+    }
+    timer->StopTimer();
+    double allPairsTimeSec = timer->GetElapsedTime() / numberOfIterations;
+
+    if (plane1Overlaps != allPairsPlane1Overlaps || plane2Overlaps != allPairsPlane2Overlaps)
+    {
+      std::cerr << "Overlapping lines found using the spatial index differ from those found by testing all pairs!" << std::endl;
+      return false;
+    }
+    std::cout << numberOfLinesOnPlane << " islands per plane: overlap detection takes " << indexedTimeSec * 1000.0
+      << " ms using the spatial index, " << allPairsTimeSec * 1000.0 << " ms testing all pairs (speedup: "
+      << (indexedTimeSec > 0.0 ? allPairsTimeSec / indexedTimeSec : 0.0) << "x)" << std::endl;
+
+    // Conversion of all the planes
+    double conversionTimeSec = 0.0;
+    vtkIdType numberOfTriangles = 0;
+    for (int iteration = 0; iteration < numberOfIterations; ++iteration)
+    {
+      timer->StartTimer();
+      vtkSmartPointer<vtkPolyData> closedSurface = ConvertToClosedSurface(contours);
+      timer->StopTimer();
+      conversionTimeSec += timer->GetElapsedTime();
+      if (!closedSurface || closedSurface->GetNumberOfPolys() == 0)
+      {
+        std::cerr << "Conversion of islands failed!" << std::endl;
+        return false;
+      }
+      numberOfTriangles = closedSurface->GetNumberOfPolys();
+    }
+    std::cout << numberOfLines << " island contours converted to " << numberOfTriangles << " triangles in "
+      << conversionTimeSec / numberOfIterations * 1000.0 << " ms" << std::endl;
+
+    return true;
+  }
+}
+
+//-----------------------------------------------------------------------------
+int vtkPlanarContourToClosedSurfaceConversionRuleBenchmark(int argc, char* argv[])
+{
+  int argIndex = 1;
+
+  const char* dataDirectoryPath = nullptr;
+  if (argc > argIndex+1)
+  {
+    if (STRCASECMP(argv[argIndex], "-DataDirectoryPath") == 0)
+    {
+      dataDirectoryPath = argv[argIndex+1];
+      std::cout << "Data directory path: " << dataDirectoryPath << std::endl;
+      argIndex += 2;
+    }
+    else
+    {
+      dataDirectoryPath = "";
+    }
+  }
+  else
+  {
+    std::cerr << "Invalid arguments!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  int numberOfIterations = 1;
+  if (argc > argIndex+1)
+  {
+    if (STRCASECMP(argv[argIndex], "-NumberOfIterations") == 0)
+    {
+      numberOfIterations = std::max(atoi(argv[argIndex+1]), 1);
+      std::cout << "Number of iterations: " << numberOfIterations << std::endl;
+      argIndex += 2;
+    }
+  }
+
+  // Number of islands along each axis on the planes of the synthetic contours (no synthetic contours if 0)
+  int numberOfIslandsPerAxis = 0;
+  if (argc > argIndex+1)
+  {
+    if (STRCASECMP(argv[argIndex], "-NumberOfIslandsPerAxis") == 0)
+    {
+      numberOfIslandsPerAxis = std::max(atoi(argv[argIndex+1]), 0);
+      std::cout << "Number of islands per axis: " << numberOfIslandsPerAxis << std::endl;
+      argIndex += 2;
+    }
+  }
+
+  if (numberOfIslandsPerAxis > 0 && !RunIslandBenchmark(numberOfIslandsPerAxis, numberOfIterations))
+  {
+    return EXIT_FAILURE;
+  }
+
+  // The remaining arguments are the segmentation files (.seg.vtm) containing planar contours
+  if (argIndex >= argc && numberOfIslandsPerAxis == 0)
+  {
+    std::cerr << "No input segmentation files specified!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  double totalTimeSec = 0.0;
+  for (; argIndex < argc; ++argIndex)
+  {
+    std::string segmentationFile = std::string(dataDirectoryPath) + std::string(argv[argIndex]);
+    if (!vtksys::SystemTools::FileExists(segmentationFile.c_str()))
+    {
+      std::cerr << "Segmentation file '" << segmentationFile << "' does not exist!" << std::endl;
+      return EXIT_FAILURE;
+    }
+    vtkSmartPointer<vtkXMLMultiBlockDataReader> reader = vtkSmartPointer<vtkXMLMultiBlockDataReader>::New();
+    reader->SetFileName(segmentationFile.c_str());
+    reader->Update();
+    vtkMultiBlockDataSet* segments = vtkMultiBlockDataSet::SafeDownCast(reader->GetOutput());
+    if (!segments)
+    {
+      std::cerr << "Failed to read segmentation file '" << segmentationFile << "'!" << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    double fileTimeSec = 0.0;
+    vtkIdType numberOfContours = 0;
+    vtkIdType numberOfTriangles = 0;
+    for (unsigned int blockIndex = 0; blockIndex < segments->GetNumberOfBlocks(); ++blockIndex)
+    {
+      vtkPolyData* planarContours = vtkPolyData::SafeDownCast(segments->GetBlock(blockIndex));
+      if (!planarContours || planarContours->GetNumberOfLines() < 2)
+      {
+        continue;
+      }
+
+      vtkSmartPointer<vtkPolyData> firstClosedSurface;
+      vtkSmartPointer<vtkTimerLog> timer = vtkSmartPointer<vtkTimerLog>::New();
+      for (int iteration = 0; iteration < numberOfIterations; ++iteration)
+      {
+        timer->StartTimer();
+        vtkSmartPointer<vtkPolyData> closedSurface = ConvertToClosedSurface(planarContours);
+        timer->StopTimer();
+        fileTimeSec += timer->GetElapsedTime();
+
+        if (!closedSurface || closedSurface->GetNumberOfPolys() == 0)
+        {
+          std::cerr << "Conversion of segment " << blockIndex << " in '" << argv[argIndex] << "' failed!" << std::endl;
+          return EXIT_FAILURE;
+        }
+        // The triangulation of the plane pairs is merged in plane order, so the result must be the same every time
+        if (!firstClosedSurface)
+        {
+          firstClosedSurface = closedSurface;
+        }
+        else if (!AreSurfacesIdentical(firstClosedSurface, closedSurface))
+        {
+          std::cerr << "Conversion of segment " << blockIndex << " in '" << argv[argIndex] << "' is not deterministic!" << std::endl;
+          return EXIT_FAILURE;
+        }
+      }
+      numberOfContours += planarContours->GetNumberOfLines();
+      numberOfTriangles += firstClosedSurface->GetNumberOfPolys();
+    }
+
+    fileTimeSec /= numberOfIterations;
+    totalTimeSec += fileTimeSec;
+    std::cout << argv[argIndex] << ": " << numberOfContours << " contours converted to " << numberOfTriangles
+      << " triangles in " << fileTimeSec * 1000.0 << " ms" << std::endl;
+  }
+  std::cout << "Total conversion time: " << totalTimeSec * 1000.0 << " ms" << std::endl;
+
+  return EXIT_SUCCESS;
+}
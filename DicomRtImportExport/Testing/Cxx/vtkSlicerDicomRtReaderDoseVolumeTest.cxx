@@ -0,0 +1,248 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Csaba Pinter, PerkLab, Queen's University
+  and was supported through the Applied Cancer Research Unit program of Cancer Care
+  Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
+
+==============================================================================*/
+
+// DicomRtImportExport includes
+#include "vtkSlicerDicomRtImportExportModuleLogic.h"
+#include "vtkSlicerDicomRtReader.h"
+
+// MRML includes
+#include <vtkMRMLScalarVolumeNode.h>
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkMatrix4x4.h>
+#include <vtkSmartPointer.h>
+
+// VTKSYS includes
+#include <vtksys/SystemTools.hxx>
+
+// DCMTK includes
+#include <dcmtk/config/osconfig.h>
+#include <dcmtk/dcmdata/dcdeftag.h>
+#include <dcmtk/dcmdata/dcfilefo.h>
+#include <dcmtk/dcmdata/dcuid.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+  const int NUMBER_OF_COLUMNS = 8;
+  const int NUMBER_OF_ROWS = 6;
+  const int NUMBER_OF_FRAMES = 5;
+  const double SLICE_SPACING = 2.5;
+  const double FIRST_FRAME_POSITION_LPS[3] = { -50.0, -40.0, -20.0 };
+
+  //-----------------------------------------------------------------------------
+  /// Write a multi-frame RT dose on an axial grid. The grid frame offset vector contains the offsets
+  /// relative to the first frame, or the z coordinates of the frames if \a absoluteGridFrameOffsets is set.
+  bool WriteSyntheticDose(const std::string& fileName, bool absoluteGridFrameOffsets, const char* doseGridScaling)
+  {
+    char uid[100];
+    DcmFileFormat fileformat;
+    DcmDataset* dataset = fileformat.getDataset();
+    dataset->putAndInsertString(DCM_SOPClassUID, UID_RTDoseStorage);
+    dataset->putAndInsertString(DCM_SOPInstanceUID, dcmGenerateUniqueIdentifier(uid, SITE_INSTANCE_UID_ROOT));
+    dataset->putAndInsertString(DCM_StudyInstanceUID, dcmGenerateUniqueIdentifier(uid, SITE_STUDY_UID_ROOT));
+    dataset->putAndInsertString(DCM_SeriesInstanceUID, dcmGenerateUniqueIdentifier(uid, SITE_SERIES_UID_ROOT));
+    dataset->putAndInsertString(DCM_FrameOfReferenceUID, dcmGenerateUniqueIdentifier(uid, SITE_INSTANCE_UID_ROOT));
+    dataset->putAndInsertString(DCM_Modality, "RTDOSE");
+    dataset->putAndInsertString(DCM_PatientName, "Synthetic^Dose");
+    dataset->putAndInsertString(DCM_PatientID, "SyntheticDose");
+
+    // Image pixel
+    dataset->putAndInsertUint16(DCM_SamplesPerPixel, 1);
+    dataset->putAndInsertString(DCM_PhotometricInterpretation, "MONOCHROME2");
+    dataset->putAndInsertUint16(DCM_Rows, NUMBER_OF_ROWS);
+    dataset->putAndInsertUint16(DCM_Columns, NUMBER_OF_COLUMNS);
+    dataset->putAndInsertString(DCM_NumberOfFrames, std::to_string(NUMBER_OF_FRAMES).c_str());
+    dataset->putAndInsertTagKey(DCM_FrameIncrementPointer, DCM_GridFrameOffsetVector);
+    dataset->putAndInsertUint16(DCM_BitsAllocated, 16);
+    dataset->putAndInsertUint16(DCM_BitsStored, 16);
+    dataset->putAndInsertUint16(DCM_HighBit, 15);
+    dataset->putAndInsertUint16(DCM_PixelRepresentation, 0);
+
+    // Geometry. Row spacing and column spacing differ so that swapped axes are detected
+    std::ostringstream position;
+    position << FIRST_FRAME_POSITION_LPS[0] << "\\" << FIRST_FRAME_POSITION_LPS[1] << "\\" << FIRST_FRAME_POSITION_LPS[2];
+    dataset->putAndInsertString(DCM_ImagePositionPatient, position.str().c_str());
+    dataset->putAndInsertString(DCM_ImageOrientationPatient, "1\\0\\0\\0\\1\\0");
+    dataset->putAndInsertString(DCM_PixelSpacing, "2\\3");
+    dataset->putAndInsertString(DCM_SliceThickness, std::to_string(SLICE_SPACING).c_str());
+    std::ostringstream gridFrameOffsets;
+    for (int frameIndex = 0; frameIndex < NUMBER_OF_FRAMES; ++frameIndex)
+    {
+      double offset = frameIndex * SLICE_SPACING + (absoluteGridFrameOffsets ? FIRST_FRAME_POSITION_LPS[2] : 0.0);
+      gridFrameOffsets << (frameIndex > 0 ? "\\" : "") << offset;
+    }
+    dataset->putAndInsertString(DCM_GridFrameOffsetVector, gridFrameOffsets.str().c_str());
+
+    // RT dose
+    dataset->putAndInsertString(DCM_DoseUnits, "GY");
+    dataset->putAndInsertString(DCM_DoseType, "PHYSICAL");
+    dataset->putAndInsertString(DCM_DoseSummationType, "PLAN");
+    dataset->putAndInsertString(DCM_DoseGridScaling, doseGridScaling);
+
+    // Different value in each voxel
+    std::vector<Uint16> pixels(NUMBER_OF_COLUMNS * NUMBER_OF_ROWS * NUMBER_OF_FRAMES);
+    for (size_t voxelIndex = 0; voxelIndex < pixels.size(); ++voxelIndex)
+    {
+      pixels[voxelIndex] = static_cast<Uint16>(100 + 211 * voxelIndex);
+    }
+    dataset->putAndInsertUint16Array(DCM_PixelData, pixels.data(), static_cast<unsigned long>(pixels.size()));
+
+    return fileformat.saveFile(fileName.c_str(), EXS_LittleEndianExplicit).good();
+  }
+
+  //-----------------------------------------------------------------------------
+  /// Compare the dose volume read directly by the RT reader with the one read through the archetype storage node
+  bool CompareDoseVolumes(const std::string& fileName)
+  {
+    vtkSmartPointer<vtkSlicerDicomRtReader> reader = vtkSmartPointer<vtkSlicerDicomRtReader>::New();
+    reader->SetFileName(fileName.c_str());
+    reader->Update();
+    if (!reader->GetLoadRTDoseSuccessful())
+    {
+      std::cerr << "Failed to load synthetic dose " << fileName << std::endl;
+      return false;
+    }
+    if (!reader->GetDoseImageData())
+    {
+      std::cerr << "Dose volume was not read directly from the pixel data of " << fileName << std::endl;
+      return false;
+    }
+
+    vtkSmartPointer<vtkMRMLScalarVolumeNode> directVolumeNode = vtkSmartPointer<vtkMRMLScalarVolumeNode>::New();
+    vtkSmartPointer<vtkMRMLScalarVolumeNode> archetypeVolumeNode = vtkSmartPointer<vtkMRMLScalarVolumeNode>::New();
+    if ( !vtkSlicerDicomRtImportExportModuleLogic::LoadRtDoseVolume(reader, fileName.c_str(), directVolumeNode)
+      || !vtkSlicerDicomRtImportExportModuleLogic::LoadRtDoseVolume(reader, fileName.c_str(), archetypeVolumeNode, true) )
+    {
+      std::cerr << "Failed to load dose volume from " << fileName << std::endl;
+      return false;
+    }
+
+    // Geometry
+    vtkSmartPointer<vtkMatrix4x4> directIjkToRas = vtkSmartPointer<vtkMatrix4x4>::New();
+    vtkSmartPointer<vtkMatrix4x4> archetypeIjkToRas = vtkSmartPointer<vtkMatrix4x4>::New();
+    directVolumeNode->GetIJKToRASMatrix(directIjkToRas);
+    archetypeVolumeNode->GetIJKToRASMatrix(archetypeIjkToRas);
+    for (int row = 0; row < 4; ++row)
+    {
+      for (int column = 0; column < 4; ++column)
+      {
+        if (fabs(directIjkToRas->GetElement(row, column) - archetypeIjkToRas->GetElement(row, column)) > 1e-4)
+        {
+          std::cerr << "IJK to RAS matrix element (" << row << ", " << column << ") differs: " << directIjkToRas->GetElement(row, column)
+            << " (direct) instead of " << archetypeIjkToRas->GetElement(row, column) << " (archetype)" << std::endl;
+          return false;
+        }
+      }
+    }
+    if (fabs(directIjkToRas->GetElement(2, 2) - SLICE_SPACING) > 1e-4 || fabs(directIjkToRas->GetElement(2, 3) - FIRST_FRAME_POSITION_LPS[2]) > 1e-4)
+    {
+      std::cerr << "Invalid slice geometry: spacing " << directIjkToRas->GetElement(2, 2) << ", first slice position " << directIjkToRas->GetElement(2, 3) << std::endl;
+      return false;
+    }
+
+    // Voxel values
+    vtkImageData* directImageData = directVolumeNode->GetImageData();
+    vtkImageData* archetypeImageData = archetypeVolumeNode->GetImageData();
+    int directDimensions[3] = { 0, 0, 0 };
+    int archetypeDimensions[3] = { 0, 0, 0 };
+    directImageData->GetDimensions(directDimensions);
+    archetypeImageData->GetDimensions(archetypeDimensions);
+    if ( directDimensions[0] != NUMBER_OF_COLUMNS || directDimensions[1] != NUMBER_OF_ROWS || directDimensions[2] != NUMBER_OF_FRAMES
+      || !std::equal(directDimensions, directDimensions + 3, archetypeDimensions) )
+    {
+      std::cerr << "Dose volume dimensions differ: (" << directDimensions[0] << ", " << directDimensions[1] << ", " << directDimensions[2]
+        << ") (direct) instead of (" << archetypeDimensions[0] << ", " << archetypeDimensions[1] << ", " << archetypeDimensions[2] << ") (archetype)" << std::endl;
+      return false;
+    }
+    if (directImageData->GetScalarType() != VTK_FLOAT || archetypeImageData->GetScalarType() != VTK_FLOAT)
+    {
+      std::cerr << "Dose volumes are not float" << std::endl;
+      return false;
+    }
+    const float* directDoses = static_cast<const float*>(directImageData->GetScalarPointer());
+    const float* archetypeDoses = static_cast<const float*>(archetypeImageData->GetScalarPointer());
+    for (vtkIdType voxelIndex = 0; voxelIndex < directImageData->GetNumberOfPoints(); ++voxelIndex)
+    {
+      double directDose = directDoses[voxelIndex];
+      double archetypeDose = archetypeDoses[voxelIndex];
+      if (fabs(directDose - archetypeDose) > 1e-6 * std::max(1.0, fabs(archetypeDose)))
+      {
+        std::cerr << "Dose differs in voxel " << voxelIndex << ": " << directDose << " (direct) instead of "
+          << archetypeDose << " (archetype)" << std::endl;
+        return false;
+      }
+    }
+
+    return true;
+  }
+}
+
+//-----------------------------------------------------------------------------
+int vtkSlicerDicomRtReaderDoseVolumeTest(int argc, char* argv[])
+{
+  const char* temporaryDirectoryPath = nullptr;
+  for (int argIndex = 1; argIndex + 1 < argc; argIndex += 2)
+  {
+    if (STRCASECMP(argv[argIndex], "-TemporaryDirectory") == 0)
+    {
+      temporaryDirectoryPath = argv[argIndex+1];
+    }
+    else
+    {
+      std::cerr << "Invalid argument: " << argv[argIndex] << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+  if (!temporaryDirectoryPath)
+  {
+    std::cerr << "Missing -TemporaryDirectory argument!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Relative and absolute grid frame offsets, both with a dose grid scaling other than 1
+  for (int absoluteGridFrameOffsets = 0; absoluteGridFrameOffsets < 2; ++absoluteGridFrameOffsets)
+  {
+    std::string fileName = std::string(temporaryDirectoryPath) + "/SyntheticDose" + (absoluteGridFrameOffsets ? "Absolute" : "Relative") + ".dcm";
+    if (!WriteSyntheticDose(fileName, absoluteGridFrameOffsets, "0.00025"))
+    {
+      std::cerr << "Failed to write synthetic dose to " << fileName << std::endl;
+      return EXIT_FAILURE;
+    }
+    if (!CompareDoseVolumes(fileName))
+    {
+      std::cerr << "Dose volumes differ for " << (absoluteGridFrameOffsets ? "absolute" : "relative") << " grid frame offsets" << std::endl;
+      return EXIT_FAILURE;
+    }
+    std::cout << "Dose volume with " << (absoluteGridFrameOffsets ? "absolute" : "relative") << " grid frame offsets matches" << std::endl;
+    vtksys::SystemTools::RemoveFile(fileName);
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,252 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Csaba Pinter, PerkLab, Queen's University
+  and was supported through the Applied Cancer Research Unit program of Cancer Care
+  Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
+
+==============================================================================*/
+
+// DicomRtImportExport includes
+#include "vtkSlicerDicomRtReader.h"
+
+// VTK includes
+#include <vtkCellArray.h>
+#include <vtkMath.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+#include <vtkTimerLog.h>
+
+// VTKSYS includes
+#include <vtksys/SystemTools.hxx>
+
+// DCMTK includes
+#include <dcmtk/config/osconfig.h>
+#include <dcmtk/dcmdata/dcdeftag.h>
+#include <dcmtk/dcmdata/dcfilefo.h>
+#include <dcmtk/dcmdata/dcuid.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+namespace
+{
+  //-----------------------------------------------------------------------------
+  /// Contour point in DICOM LPS coordinates. Each ROI is a stack of circles with a different radius.
+  void GetContourPoint(int roiIndex, int contourIndex, int pointIndex, int numberOfPointsPerContour, double point_LPS[3])
+  {
+    double radius = 20.0 + 5.0 * roiIndex;
+    double angle = 2.0 * vtkMath::Pi() * pointIndex / numberOfPointsPerContour;
+    point_LPS[0] = 10.0 * roiIndex + radius * cos(angle);
+    point_LPS[1] = -15.0 + radius * sin(angle);
+    point_LPS[2] = -100.0 + 2.5 * contourIndex;
+  }
+
+  //-----------------------------------------------------------------------------
+  /// Write an RT structure set with the given number of ROIs, contours and points
+  bool WriteSyntheticStructureSet(const std::string& fileName, int numberOfRois, int numberOfContoursPerRoi, int numberOfPointsPerContour)
+  {
+    char uid[100];
+    DcmFileFormat fileformat;
+    DcmDataset* dataset = fileformat.getDataset();
+    dataset->putAndInsertString(DCM_SOPClassUID, UID_RTStructureSetStorage);
+    dataset->putAndInsertString(DCM_SOPInstanceUID, dcmGenerateUniqueIdentifier(uid, SITE_INSTANCE_UID_ROOT));
+    dataset->putAndInsertString(DCM_StudyInstanceUID, dcmGenerateUniqueIdentifier(uid, SITE_STUDY_UID_ROOT));
+    dataset->putAndInsertString(DCM_SeriesInstanceUID, dcmGenerateUniqueIdentifier(uid, SITE_SERIES_UID_ROOT));
+    dataset->putAndInsertString(DCM_Modality, "RTSTRUCT");
+    dataset->putAndInsertString(DCM_PatientName, "Synthetic^StructureSet");
+    dataset->putAndInsertString(DCM_PatientID, "SyntheticStructureSet");
+    dataset->putAndInsertString(DCM_StructureSetLabel, "Synthetic");
+    std::string frameOfReferenceUid = dcmGenerateUniqueIdentifier(uid, SITE_INSTANCE_UID_ROOT);
+    std::string imageSeriesInstanceUid = dcmGenerateUniqueIdentifier(uid, SITE_SERIES_UID_ROOT);
+    std::string imageSopInstanceUid = dcmGenerateUniqueIdentifier(uid, SITE_INSTANCE_UID_ROOT);
+
+    // Referenced frame of reference with a single referenced image
+    DcmItem* frameOfReferenceItem = nullptr;
+    DcmItem* studyItem = nullptr;
+    DcmItem* seriesItem = nullptr;
+    DcmItem* contourImageItem = nullptr;
+    dataset->findOrCreateSequenceItem(DCM_ReferencedFrameOfReferenceSequence, frameOfReferenceItem, 0);
+    frameOfReferenceItem->putAndInsertString(DCM_FrameOfReferenceUID, frameOfReferenceUid.c_str());
+    frameOfReferenceItem->findOrCreateSequenceItem(DCM_RTReferencedStudySequence, studyItem, 0);
+    studyItem->findOrCreateSequenceItem(DCM_RTReferencedSeriesSequence, seriesItem, 0);
+    seriesItem->putAndInsertString(DCM_SeriesInstanceUID, imageSeriesInstanceUid.c_str());
+    seriesItem->findOrCreateSequenceItem(DCM_ContourImageSequence, contourImageItem, 0);
+    contourImageItem->putAndInsertString(DCM_ReferencedSOPClassUID, UID_CTImageStorage);
+    contourImageItem->putAndInsertString(DCM_ReferencedSOPInstanceUID, imageSopInstanceUid.c_str());
+
+    for (int roiIndex = 0; roiIndex < numberOfRois; ++roiIndex)
+    {
+      std::string roiNumber = std::to_string(roiIndex + 1);
+
+      DcmItem* roiItem = nullptr;
+      dataset->findOrCreateSequenceItem(DCM_StructureSetROISequence, roiItem, -2);
+      roiItem->putAndInsertString(DCM_ROINumber, roiNumber.c_str());
+      roiItem->putAndInsertString(DCM_ReferencedFrameOfReferenceUID, frameOfReferenceUid.c_str());
+      roiItem->putAndInsertString(DCM_ROIName, ("ROI_" + roiNumber).c_str());
+      roiItem->putAndInsertString(DCM_ROIGenerationAlgorithm, "MANUAL");
+
+      DcmItem* observationItem = nullptr;
+      dataset->findOrCreateSequenceItem(DCM_RTROIObservationsSequence, observationItem, -2);
+      observationItem->putAndInsertString(DCM_ObservationNumber, roiNumber.c_str());
+      observationItem->putAndInsertString(DCM_ReferencedROINumber, roiNumber.c_str());
+      observationItem->putAndInsertString(DCM_RTROIInterpretedType, "ORGAN");
+
+      DcmItem* roiContourItem = nullptr;
+      dataset->findOrCreateSequenceItem(DCM_ROIContourSequence, roiContourItem, -2);
+      roiContourItem->putAndInsertString(DCM_ReferencedROINumber, roiNumber.c_str());
+      roiContourItem->putAndInsertString(DCM_ROIDisplayColor, "255\\128\\0");
+      for (int contourIndex = 0; contourIndex < numberOfContoursPerRoi; ++contourIndex)
+      {
+        std::ostringstream contourData;
+        contourData.setf(std::ios::fixed);
+        contourData.precision(3);
+        for (int pointIndex = 0; pointIndex < numberOfPointsPerContour; ++pointIndex)
+        {
+          double point_LPS[3] = { 0.0, 0.0, 0.0 };
+          GetContourPoint(roiIndex, contourIndex, pointIndex, numberOfPointsPerContour, point_LPS);
+          contourData << (pointIndex > 0 ? "\\" : "") << point_LPS[0] << "\\" << point_LPS[1] << "\\" << point_LPS[2];
+        }
+
+        DcmItem* contourItem = nullptr;
+        roiContourItem->findOrCreateSequenceItem(DCM_ContourSequence, contourItem, -2);
+        contourItem->putAndInsertString(DCM_ContourGeometricType, "CLOSED_PLANAR");
+        contourItem->putAndInsertString(DCM_NumberOfContourPoints, std::to_string(numberOfPointsPerContour).c_str());
+        contourItem->putAndInsertString(DCM_ContourData, contourData.str().c_str());
+      }
+    }
+
+    return fileformat.saveFile(fileName.c_str(), EXS_LittleEndianExplicit).good();
+  }
+}
+
+//-----------------------------------------------------------------------------
+int vtkSlicerDicomRtReaderStructureSetBenchmark(int argc, char* argv[])
+{
+  const char* temporaryDirectoryPath = nullptr;
+  int numberOfRois = 10;
+  int numberOfContoursPerRoi = 100;
+  int numberOfPointsPerContour = 1000;
+  int numberOfIterations = 3;
+  for (int argIndex = 1; argIndex + 1 < argc; argIndex += 2)
+  {
+    if (STRCASECMP(argv[argIndex], "-TemporaryDirectory") == 0)
+    {
+      temporaryDirectoryPath = argv[argIndex+1];
+    }
+    else if (STRCASECMP(argv[argIndex], "-NumberOfRois") == 0)
+    {
+      numberOfRois = std::max(atoi(argv[argIndex+1]), 1);
+    }
+    else if (STRCASECMP(argv[argIndex], "-NumberOfContoursPerRoi") == 0)
+    {
+      numberOfContoursPerRoi = std::max(atoi(argv[argIndex+1]), 1);
+    }
+    else if (STRCASECMP(argv[argIndex], "-NumberOfPointsPerContour") == 0)
+    {
+      numberOfPointsPerContour = std::max(atoi(argv[argIndex+1]), 1);
+    }
+    else if (STRCASECMP(argv[argIndex], "-NumberOfIterations") == 0)
+    {
+      numberOfIterations = std::max(atoi(argv[argIndex+1]), 1);
+    }
+    else
+    {
+      std::cerr << "Invalid argument: " << argv[argIndex] << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+  if (!temporaryDirectoryPath)
+  {
+    std::cerr << "Missing -TemporaryDirectory argument!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Write synthetic structure set
+  std::string fileName = std::string(temporaryDirectoryPath) + "/SyntheticStructureSet.dcm";
+  vtkSmartPointer<vtkTimerLog> timer = vtkSmartPointer<vtkTimerLog>::New();
+  timer->StartTimer();
+  if (!WriteSyntheticStructureSet(fileName, numberOfRois, numberOfContoursPerRoi, numberOfPointsPerContour))
+  {
+    std::cerr << "Failed to write synthetic structure set to " << fileName << std::endl;
+    return EXIT_FAILURE;
+  }
+  timer->StopTimer();
+  long long numberOfPoints = static_cast<long long>(numberOfRois) * numberOfContoursPerRoi * numberOfPointsPerContour;
+  std::cout << "Synthetic structure set with " << numberOfRois << " ROIs, " << numberOfRois * numberOfContoursPerRoi
+    << " contours and " << numberOfPoints << " points written in " << timer->GetElapsedTime() * 1000.0 << " ms" << std::endl;
+
+  // Load it repeatedly and check the contours
+  double bestTimeSec = 0.0;
+  for (int iteration = 0; iteration < numberOfIterations; ++iteration)
+  {
+    vtkSmartPointer<vtkSlicerDicomRtReader> reader = vtkSmartPointer<vtkSlicerDicomRtReader>::New();
+    reader->SetFileName(fileName.c_str());
+    timer->StartTimer();
+    reader->Update();
+    timer->StopTimer();
+    double timeSec = timer->GetElapsedTime();
+    bestTimeSec = (iteration == 0 ? timeSec : std::min(bestTimeSec, timeSec));
+
+    if (!reader->GetLoadRTStructureSetSuccessful() || reader->GetNumberOfRois() != numberOfRois)
+    {
+      std::cerr << "Failed to load synthetic structure set: " << reader->GetNumberOfRois() << " ROIs loaded instead of " << numberOfRois << std::endl;
+      return EXIT_FAILURE;
+    }
+    for (int roiIndex = 0; roiIndex < numberOfRois; ++roiIndex)
+    {
+      vtkPolyData* roiPolyData = reader->GetRoiPolyData(roiIndex);
+      if ( !roiPolyData || roiPolyData->GetNumberOfPoints() != numberOfContoursPerRoi * numberOfPointsPerContour
+        || roiPolyData->GetNumberOfLines() != numberOfContoursPerRoi )
+      {
+        std::cerr << "Invalid contours loaded for ROI " << roiIndex << std::endl;
+        return EXIT_FAILURE;
+      }
+
+      // Check the first point of the last contour (converted to RAS) and that the contour is closed
+      vtkIdType lastContourFirstPointId = (numberOfContoursPerRoi - 1) * numberOfPointsPerContour;
+      double expectedPoint_LPS[3] = { 0.0, 0.0, 0.0 };
+      GetContourPoint(roiIndex, numberOfContoursPerRoi - 1, 0, numberOfPointsPerContour, expectedPoint_LPS);
+      double expectedPoint_RAS[3] = { -expectedPoint_LPS[0], -expectedPoint_LPS[1], expectedPoint_LPS[2] };
+      double point_RAS[3] = { 0.0, 0.0, 0.0 };
+      roiPolyData->GetPoint(lastContourFirstPointId, point_RAS);
+      if (sqrt(vtkMath::Distance2BetweenPoints(point_RAS, expectedPoint_RAS)) > 1e-3)
+      {
+        std::cerr << "Invalid contour point loaded for ROI " << roiIndex << ": (" << point_RAS[0] << ", " << point_RAS[1] << ", " << point_RAS[2]
+          << ") instead of (" << expectedPoint_RAS[0] << ", " << expectedPoint_RAS[1] << ", " << expectedPoint_RAS[2] << ")" << std::endl;
+        return EXIT_FAILURE;
+      }
+      vtkIdType numberOfCellPoints = 0;
+      const vtkIdType* cellPointIds = nullptr;
+      roiPolyData->GetLines()->GetCellAtId(numberOfContoursPerRoi - 1, numberOfCellPoints, cellPointIds);
+      if ( numberOfCellPoints != numberOfPointsPerContour + 1 || cellPointIds[0] != lastContourFirstPointId
+        || cellPointIds[numberOfCellPoints - 1] != lastContourFirstPointId )
+      {
+        std::cerr << "Contour " << numberOfContoursPerRoi - 1 << " of ROI " << roiIndex << " is not closed" << std::endl;
+        return EXIT_FAILURE;
+      }
+    }
+  }
+  std::cout << "Structure set loaded in " << bestTimeSec * 1000.0 << " ms (best of " << numberOfIterations << "), "
+    << numberOfPoints / bestTimeSec * 1e-6 << " million points/s" << std::endl;
+
+  vtksys::SystemTools::RemoveFile(fileName);
+  return EXIT_SUCCESS;
+}
@@ -206,8 +206,9 @@ std::string vtkSlicerDoseComparisonModuleLogic::ComputeGammaDoseDifference(vtkMR
 
   double checkpointConvertStart = timer->GetUniversalTime();
   vtkMRMLScalarVolumeNode* referenceDoseVolumeNode = parameterNode->GetReferenceDoseVolumeNode();
-  Plm_image::Pointer referenceDose = PlmCommon::ConvertVolumeNodeToPlmImage(referenceDoseVolumeNode);
-  Plm_image::Pointer compareDose = PlmCommon::ConvertVolumeNodeToPlmImage(parameterNode->GetCompareDoseVolumeNode());
+  // Gamma computation does not modify its inputs, so the dose voxels are used without copying them
+  Plm_image::Pointer referenceDose = PlmCommon::ConvertVolumeNodeToPlmImage(referenceDoseVolumeNode, true, true);
+  Plm_image::Pointer compareDose = PlmCommon::ConvertVolumeNodeToPlmImage(parameterNode->GetCompareDoseVolumeNode(), true, true);
 
   Plm_image::Pointer maskVolume;
   vtkMRMLSegmentationNode* maskSegmentationNode = parameterNode->GetMaskSegmentationNode();
@@ -259,7 +260,7 @@ std::string vtkSlicerDoseComparisonModuleLogic::ComputeGammaDoseDifference(vtkMR
     }
 
     // Convert mask to Plm image
-    maskVolume = PlmCommon::ConvertVtkOrientedImageDataToPlmImage(maskSegmentLabelmap);
+    maskVolume = PlmCommon::ConvertVtkOrientedImageDataToPlmImage(maskSegmentLabelmap, true);
     if (!maskVolume)
     {
       std::string errorMessage = vtkMRMLTr("vtkSlicerDoseComparisonModuleLogic", "Failed to convert mask segment labelmap into Plm_image");
@@ -0,0 +1,229 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Csaba Pinter, PerkLab, Queen's University
+  and was supported through the Applied Cancer Research Unit program of Cancer Care
+  Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
+
+==============================================================================*/
+
+
+#include "vtkDoseValueDistribution.h"
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkImageStencilData.h>
+#include <vtkImageStencilIterator.h>
+#include <vtkObjectFactory.h>
+
+// STD includes
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+vtkStandardNewMacro(vtkDoseValueDistribution);
+
+namespace
+{
+
+//----------------------------------------------------------------------------
+/// Collect (value, weight) pairs of the image voxels inside the stencil
+template <class ImageScalarType, class FractionScalarType>
+void vtkDoseValueDistributionCollect2(vtkImageData* image, vtkImageStencilData* stencil,
+  vtkImageData* fractionalLabelmap, double minimumFractionalValue, double maximumFractionalValue,
+  std::vector<std::pair<double, double> >& samples)
+{
+  int extent[6] = { 0, -1, 0, -1, 0, -1 };
+  image->GetExtent(extent);
+  vtkImageStencilIterator<ImageScalarType> imageIter(image, stencil, extent);
+  vtkImageStencilIterator<FractionScalarType> fractionIter((fractionalLabelmap ? fractionalLabelmap : image), stencil, extent);
+  double fractionalRange = maximumFractionalValue - minimumFractionalValue;
+
+  while (!imageIter.IsAtEnd())
+  {
+    if (imageIter.IsInStencil())
+    {
+      ImageScalarType* imagePtr = imageIter.BeginSpan();
+      ImageScalarType* imageSpanEndPtr = imageIter.EndSpan();
+      FractionScalarType* fractionPtr = fractionIter.BeginSpan();
+      for (; imagePtr != imageSpanEndPtr; ++imagePtr, ++fractionPtr)
+      {
+        double weight = 1.0;
+        if (fractionalLabelmap)
+        {
+          weight = (static_cast<double>(*fractionPtr) - minimumFractionalValue) / fractionalRange;
+        }
+        samples.push_back(std::make_pair(static_cast<double>(*imagePtr), weight));
+      }
+    }
+    fractionIter.NextSpan();
+    imageIter.NextSpan();
+  }
+}
+
+//----------------------------------------------------------------------------
+template <class ImageScalarType>
+void vtkDoseValueDistributionCollect(vtkImageData* image, vtkImageStencilData* stencil,
+  vtkImageData* fractionalLabelmap, double minimumFractionalValue, double maximumFractionalValue,
+  std::vector<std::pair<double, double> >& samples)
+{
+  vtkImageData* fractionImage = (fractionalLabelmap ? fractionalLabelmap : image);
+  switch (fractionImage->GetScalarType())
+  {
+    vtkTemplateMacro( vtkDoseValueDistributionCollect2<ImageScalarType, VTK_TT>(
+      image, stencil, fractionalLabelmap, minimumFractionalValue, maximumFractionalValue, samples) );
+    default:
+      break;
+  }
+}
+
+}
+
+//----------------------------------------------------------------------------
+class vtkDoseValueDistribution::vtkInternal
+{
+public:
+  /// Distinct voxel values in ascending order
+  std::vector<double> Values;
+  /// Weight of the voxels with value greater than or equal to the value with the same index (non-increasing)
+  std::vector<double> WeightsAtOrAbove;
+};
+
+//----------------------------------------------------------------------------
+vtkDoseValueDistribution::vtkDoseValueDistribution()
+{
+  this->Internal = new vtkInternal();
+}
+
+//----------------------------------------------------------------------------
+vtkDoseValueDistribution::~vtkDoseValueDistribution()
+{
+  delete this->Internal;
+  this->Internal = nullptr;
+}
+
+//----------------------------------------------------------------------------
+void vtkDoseValueDistribution::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "NumberOfValues: " << this->GetNumberOfValues() << "\n";
+  os << indent << "TotalWeight: " << this->GetTotalWeight() << "\n";
+}
+
+//----------------------------------------------------------------------------
+void vtkDoseValueDistribution::Initialize()
+{
+  this->Internal->Values.clear();
+  this->Internal->WeightsAtOrAbove.clear();
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+bool vtkDoseValueDistribution::ComputeFromImage(vtkImageData* image, vtkImageStencilData* stencil,
+  vtkImageData* fractionalLabelmap/*=nullptr*/, double minimumFractionalValue/*=0.0*/, double maximumFractionalValue/*=1.0*/)
+{
+  this->Initialize();
+  if (!image || !image->GetScalarPointer() || image->GetNumberOfScalarComponents() != 1)
+  {
+    vtkErrorMacro("ComputeFromImage: Invalid input image");
+    return false;
+  }
+  if (fractionalLabelmap)
+  {
+    int imageExtent[6] = { 0, -1, 0, -1, 0, -1 };
+    int fractionalLabelmapExtent[6] = { 0, -1, 0, -1, 0, -1 };
+    image->GetExtent(imageExtent);
+    fractionalLabelmap->GetExtent(fractionalLabelmapExtent);
+    if ( !std::equal(imageExtent, imageExtent + 6, fractionalLabelmapExtent)
+      || fractionalLabelmap->GetNumberOfScalarComponents() != 1 || maximumFractionalValue <= minimumFractionalValue )
+    {
+      vtkErrorMacro("ComputeFromImage: Fractional labelmap needs to have the same extent as the image and a valid fractional range");
+      return false;
+    }
+  }
+
+  std::vector<std::pair<double, double> > samples;
+  switch (image->GetScalarType())
+  {
+    vtkTemplateMacro( vtkDoseValueDistributionCollect<VTK_TT>(
+      image, stencil, fractionalLabelmap, minimumFractionalValue, maximumFractionalValue, samples) );
+    default:
+      vtkErrorMacro("ComputeFromImage: Unknown image scalar type");
+      return false;
+  }
+
+  // Sort values and merge the weights of equal values
+  std::sort(samples.begin(), samples.end());
+  std::vector<double>& values = this->Internal->Values;
+  std::vector<double>& weights = this->Internal->WeightsAtOrAbove;
+  for (std::vector<std::pair<double, double> >::iterator sampleIt = samples.begin(); sampleIt != samples.end(); ++sampleIt)
+  {
+    if (values.empty() || values.back() != sampleIt->first)
+    {
+      values.push_back(sampleIt->first);
+      weights.push_back(0.0);
+    }
+    weights.back() += sampleIt->second;
+  }
+  std::vector<double>(values).swap(values);
+  std::vector<double>(weights).swap(weights);
+
+  // Accumulate weights from the highest value down
+  for (vtkIdType index = static_cast<vtkIdType>(weights.size()) - 2; index >= 0; --index)
+  {
+    weights[index] += weights[index + 1];
+  }
+
+  this->Modified();
+  return true;
+}
+
+//----------------------------------------------------------------------------
+vtkIdType vtkDoseValueDistribution::GetNumberOfValues()
+{
+  return static_cast<vtkIdType>(this->Internal->Values.size());
+}
+
+//----------------------------------------------------------------------------
+double vtkDoseValueDistribution::GetTotalWeight()
+{
+  return (this->Internal->WeightsAtOrAbove.empty() ? 0.0 : this->Internal->WeightsAtOrAbove.front());
+}
+
+//----------------------------------------------------------------------------
+double vtkDoseValueDistribution::GetWeightAtOrAboveValue(double value)
+{
+  const std::vector<double>& values = this->Internal->Values;
+  std::vector<double>::const_iterator valueIt = std::lower_bound(values.begin(), values.end(), value);
+  if (valueIt == values.end())
+  {
+    return 0.0;
+  }
+  return this->Internal->WeightsAtOrAbove[valueIt - values.begin()];
+}
+
+//----------------------------------------------------------------------------
+double vtkDoseValueDistribution::GetMinimumValueOfHighestWeight(double weight)
+{
+  // Find the first value where the weight at or above it is less than the requested weight.
+  // The value before it is the highest one with enough weight.
+  const std::vector<double>& weights = this->Internal->WeightsAtOrAbove;
+  std::vector<double>::const_iterator weightIt = std::partition_point(weights.begin(), weights.end(),
+    [weight](double weightAtOrAbove) { return weightAtOrAbove >= weight; });
+  if (weightIt == weights.begin())
+  {
+    return 0.0;
+  }
+  return this->Internal->Values[(weightIt - weights.begin()) - 1];
+}
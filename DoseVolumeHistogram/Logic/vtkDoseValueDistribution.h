@@ -0,0 +1,84 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Csaba Pinter, PerkLab, Queen's University
+  and was supported through the Applied Cancer Research Unit program of Cancer Care
+  Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
+
+==============================================================================*/
+
+
+#ifndef __vtkDoseValueDistribution_h
+#define __vtkDoseValueDistribution_h
+
+#include "vtkSlicerDoseVolumeHistogramModuleLogicExport.h"
+
+// VTK includes
+#include <vtkObject.h>
+
+class vtkImageData;
+class vtkImageStencilData;
+
+/// \ingroup SlicerRt_QtModules_DoseVolumeHistogram
+/// \brief Sorted distribution of the voxel doses of a structure, used for computing exact dose and volume metrics.
+///
+/// The voxel values inside the stencil are sorted once, voxels with equal value are merged, and the weight of
+/// the voxels having at least each value is stored. Then volume (V) and dose (D) metrics can be queried in
+/// logarithmic time without binning, so their precision does not depend on the step size of the DVH table.
+/// With a fractional labelmap each voxel is weighted by its fraction the same way as in vtkFractionalImageAccumulate.
+class VTK_SLICER_DOSEVOLUMEHISTOGRAM_LOGIC_EXPORT vtkDoseValueDistribution : public vtkObject
+{
+public:
+  static vtkDoseValueDistribution* New();
+  vtkTypeMacro(vtkDoseValueDistribution, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent) override;
+
+  /// Collect and sort the values of an image inside a stencil
+  /// \param image Image with a single scalar component (e.g. oversampled dose volume)
+  /// \param stencil Stencil of the structure
+  /// \param fractionalLabelmap Fractional labelmap of the structure with the same extent as the image (optional)
+  /// \param minimumFractionalValue Fractional labelmap value corresponding to zero weight
+  /// \param maximumFractionalValue Fractional labelmap value corresponding to full weight
+  /// \return Success flag
+  bool ComputeFromImage(vtkImageData* image, vtkImageStencilData* stencil,
+    vtkImageData* fractionalLabelmap=nullptr, double minimumFractionalValue=0.0, double maximumFractionalValue=1.0);
+
+  /// Remove all values
+  void Initialize();
+
+  /// Get number of distinct values
+  vtkIdType GetNumberOfValues();
+  /// Get total weight of the voxels (number of voxels, or sum of fractions with fractional labelmap)
+  double GetTotalWeight();
+
+  /// Get weight of the voxels with value greater than or equal to the given value (V metric)
+  double GetWeightAtOrAboveValue(double value);
+  /// Get the highest value for which the weight of the voxels with at least that value is not less than
+  /// the given weight (D metric). Returns 0 if the weight exceeds the total weight.
+  double GetMinimumValueOfHighestWeight(double weight);
+
+protected:
+  vtkDoseValueDistribution();
+  ~vtkDoseValueDistribution() override;
+
+private:
+  vtkDoseValueDistribution(const vtkDoseValueDistribution&) = delete;
+  void operator=(const vtkDoseValueDistribution&) = delete;
+
+private:
+  class vtkInternal;
+  vtkInternal* Internal;
+};
+
+#endif
@@ -0,0 +1,464 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Csaba Pinter, PerkLab, Queen's University
+  and was supported through the Applied Cancer Research Unit program of Cancer Care
+  Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
+
+==============================================================================*/
+
+#include "vtkIncrementalDoseVolumeHistogram.h"
+
+// SegmentationCore includes
+#include "vtkOrientedImageData.h"
+#include "vtkOrientedImageDataResample.h"
+
+// VTK includes
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkSmartPointer.h>
+
+// STD includes
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+vtkStandardNewMacro(vtkIncrementalDoseVolumeHistogram);
+
+namespace
+{
+
+/// Bin of the dose values in [0, start value)
+const int BELOW_START_VALUE_BIN = -1;
+/// Bin of the dose values that are not counted in the histogram (negative or invalid)
+const int NO_BIN = -2;
+
+//----------------------------------------------------------------------------
+/// Accumulated statistics and histogram of one segment
+struct IncrementalSegment
+{
+  vtkSmartPointer<vtkOrientedImageData> Labelmap;
+  int LabelValue{0};
+
+  vtkIdType VoxelCount{0};
+  double Sum{0.0};
+  double Min{0.0};
+  double Max{0.0};
+  double VoxelCountBelowStartValue{0.0};
+  std::vector<double> BinCounts;
+
+  void AddToBin(int bin, double count)
+  {
+    if (bin == BELOW_START_VALUE_BIN)
+    {
+      this->VoxelCountBelowStartValue += count;
+    }
+    else if (bin >= 0)
+    {
+      if (bin >= static_cast<int>(this->BinCounts.size()))
+      {
+        this->BinCounts.resize(bin + 1, 0.0);
+      }
+      this->BinCounts[bin] += count;
+    }
+  }
+};
+
+//----------------------------------------------------------------------------
+/// Get histogram bin of a dose value. Same binning as in vtkImageAccumulate (bin index is floor(position)),
+/// but comparing the position instead of the rounded index, so that invalid values are skipped without overflow.
+int GetHistogramBin(double value, double startValue, double stepSize)
+{
+  double binPosition = (value - startValue) / stepSize;
+  if (binPosition >= 0.0)
+  {
+    return (binPosition < VTK_INT_MAX ? static_cast<int>(binPosition) : NO_BIN);
+  }
+  double belowStartValuePosition = value / startValue;
+  if (belowStartValuePosition >= 0.0 && belowStartValuePosition < 1.0)
+  {
+    return BELOW_START_VALUE_BIN;
+  }
+  return NO_BIN;
+}
+
+//----------------------------------------------------------------------------
+/// Collect the voxels of a segment as (point ID in the accumulated dose volume, segment index) pairs
+template <class LabelScalarType>
+void vtkIncrementalDoseVolumeHistogramCollectVoxels(vtkOrientedImageData* labelmap, int labelValue, int segmentIndex,
+  const int geometryExtent[6], std::vector<std::pair<vtkIdType, int> >& memberships)
+{
+  int* labelmapExtent = labelmap->GetExtent();
+  int extent[6] = { 0, -1, 0, -1, 0, -1 };
+  for (int axis = 0; axis < 3; ++axis)
+  {
+    extent[2 * axis] = std::max(labelmapExtent[2 * axis], geometryExtent[2 * axis]);
+    extent[2 * axis + 1] = std::min(labelmapExtent[2 * axis + 1], geometryExtent[2 * axis + 1]);
+    if (extent[2 * axis] > extent[2 * axis + 1])
+    {
+      return;
+    }
+  }
+
+  vtkIdType dimensionX = geometryExtent[1] - geometryExtent[0] + 1;
+  vtkIdType dimensionY = geometryExtent[3] - geometryExtent[2] + 1;
+  for (int z = extent[4]; z <= extent[5]; ++z)
+  {
+    for (int y = extent[2]; y <= extent[3]; ++y)
+    {
+      LabelScalarType* labelRowPtr = static_cast<LabelScalarType*>(labelmap->GetScalarPointer(extent[0], y, z));
+      vtkIdType rowStartPointId = (extent[0] - geometryExtent[0])
+        + (y - geometryExtent[2]) * dimensionX + (z - geometryExtent[4]) * dimensionX * dimensionY;
+      for (int x = extent[0]; x <= extent[1]; ++x)
+      {
+        if (static_cast<vtkIdType>(labelRowPtr[x - extent[0]]) == labelValue)
+        {
+          memberships.push_back(std::make_pair(rowStartPointId + (x - extent[0]), segmentIndex));
+        }
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+/// Add weighted dose to the accumulated dose of the indexed voxels, and move the voxels whose bin changed
+template <class DoseScalarType>
+void vtkIncrementalDoseVolumeHistogramAddDose(DoseScalarType* dosePtr, double weight, double startValue, double stepSize,
+  const std::vector<vtkIdType>& voxelIds, const std::vector<vtkIdType>& membershipOffsets, const std::vector<int>& membershipSegments,
+  std::vector<double>& accumulatedDose, std::vector<IncrementalSegment>& segments, double& maximumDose)
+{
+  for (std::vector<IncrementalSegment>::iterator segmentIt = segments.begin(); segmentIt != segments.end(); ++segmentIt)
+  {
+    segmentIt->Min = VTK_DOUBLE_MAX;
+    segmentIt->Max = VTK_DOUBLE_MIN;
+  }
+  maximumDose = VTK_DOUBLE_MIN;
+
+  vtkIdType numberOfVoxels = static_cast<vtkIdType>(voxelIds.size());
+  for (vtkIdType voxelIndex = 0; voxelIndex < numberOfVoxels; ++voxelIndex)
+  {
+    double oldValue = accumulatedDose[voxelIndex];
+    double newValue = oldValue + weight * static_cast<double>(dosePtr[voxelIds[voxelIndex]]);
+    accumulatedDose[voxelIndex] = newValue;
+    if (newValue > maximumDose)
+    {
+      maximumDose = newValue;
+    }
+
+    int oldBin = GetHistogramBin(oldValue, startValue, stepSize);
+    int newBin = GetHistogramBin(newValue, startValue, stepSize);
+    for (vtkIdType membershipIndex = membershipOffsets[voxelIndex]; membershipIndex < membershipOffsets[voxelIndex + 1]; ++membershipIndex)
+    {
+      IncrementalSegment& segment = segments[membershipSegments[membershipIndex]];
+      segment.Sum += newValue - oldValue;
+      if (newValue < segment.Min)
+      {
+        segment.Min = newValue;
+      }
+      if (newValue > segment.Max)
+      {
+        segment.Max = newValue;
+      }
+      if (oldBin != newBin)
+      {
+        segment.AddToBin(oldBin, -1.0);
+        segment.AddToBin(newBin, 1.0);
+      }
+    }
+  }
+}
+
+}
+
+//----------------------------------------------------------------------------
+class vtkIncrementalDoseVolumeHistogram::vtkInternal
+{
+public:
+  vtkSmartPointer<vtkOrientedImageData> Geometry;
+  std::vector<IncrementalSegment> Segments;
+
+  /// Flag indicating whether the segment voxels have been indexed
+  bool IndexBuilt{false};
+  /// Point IDs of the voxels that are in at least one segment
+  std::vector<vtkIdType> VoxelIds;
+  /// Segments containing the indexed voxels: the segments of voxel i are in
+  /// MembershipSegments[ MembershipOffsets[i] .. MembershipOffsets[i+1]-1 ]
+  std::vector<vtkIdType> MembershipOffsets;
+  std::vector<int> MembershipSegments;
+  /// Accumulated dose of the indexed voxels
+  std::vector<double> AccumulatedDose;
+  double MaximumDose{0.0};
+};
+
+//----------------------------------------------------------------------------
+vtkIncrementalDoseVolumeHistogram::vtkIncrementalDoseVolumeHistogram()
+{
+  this->StartValue = 0.1;
+  this->StepSize = 0.2;
+  this->Internal = new vtkInternal();
+}
+
+//----------------------------------------------------------------------------
+vtkIncrementalDoseVolumeHistogram::~vtkIncrementalDoseVolumeHistogram()
+{
+  delete this->Internal;
+  this->Internal = nullptr;
+}
+
+//----------------------------------------------------------------------------
+void vtkIncrementalDoseVolumeHistogram::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "StartValue: " << this->StartValue << "\n";
+  os << indent << "StepSize: " << this->StepSize << "\n";
+  os << indent << "NumberOfSegments: " << this->Internal->Segments.size() << "\n";
+  os << indent << "NumberOfIndexedVoxels: " << this->Internal->VoxelIds.size() << "\n";
+}
+
+//----------------------------------------------------------------------------
+void vtkIncrementalDoseVolumeHistogram::Initialize(vtkOrientedImageData* geometry)
+{
+  delete this->Internal;
+  this->Internal = new vtkInternal();
+  this->Internal->Geometry = geometry;
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+int vtkIncrementalDoseVolumeHistogram::AddSegment(vtkOrientedImageData* labelmap, int labelValue)
+{
+  if (!this->Internal->Geometry)
+  {
+    vtkErrorMacro("AddSegment: Accumulated dose volume geometry is not initialized");
+    return -1;
+  }
+  if (this->Internal->IndexBuilt)
+  {
+    vtkErrorMacro("AddSegment: Segments cannot be added after a dose volume has been added");
+    return -1;
+  }
+  if (!labelmap || labelValue <= 0)
+  {
+    vtkErrorMacro("AddSegment: Invalid labelmap or label value");
+    return -1;
+  }
+  if (labelmap->GetScalarType() == VTK_FLOAT || labelmap->GetScalarType() == VTK_DOUBLE
+    || labelmap->GetNumberOfScalarComponents() != 1)
+  {
+    vtkErrorMacro("AddSegment: Labelmap needs to have a single integer scalar component");
+    return -1;
+  }
+  if (!vtkOrientedImageDataResample::DoGeometriesMatch(labelmap, this->Internal->Geometry))
+  {
+    vtkErrorMacro("AddSegment: Labelmap geometry does not match that of the accumulated dose volume");
+    return -1;
+  }
+
+  IncrementalSegment segment;
+  segment.Labelmap = labelmap;
+  segment.LabelValue = labelValue;
+  this->Internal->Segments.push_back(segment);
+  this->Modified();
+  return static_cast<int>(this->Internal->Segments.size()) - 1;
+}
+
+//----------------------------------------------------------------------------
+int vtkIncrementalDoseVolumeHistogram::GetNumberOfSegments()
+{
+  return static_cast<int>(this->Internal->Segments.size());
+}
+
+//----------------------------------------------------------------------------
+bool vtkIncrementalDoseVolumeHistogram::BuildIndex()
+{
+  if (this->StepSize <= 0.0)
+  {
+    vtkErrorMacro("BuildIndex: Invalid step size " << this->StepSize);
+    return false;
+  }
+
+  int geometryExtent[6] = { 0, -1, 0, -1, 0, -1 };
+  this->Internal->Geometry->GetExtent(geometryExtent);
+
+  // Collect segment voxels
+  std::vector<std::pair<vtkIdType, int> > memberships;
+  int numberOfSegments = static_cast<int>(this->Internal->Segments.size());
+  for (int segmentIndex = 0; segmentIndex < numberOfSegments; ++segmentIndex)
+  {
+    IncrementalSegment& segment = this->Internal->Segments[segmentIndex];
+    switch (segment.Labelmap->GetScalarType())
+    {
+      vtkTemplateMacro( vtkIncrementalDoseVolumeHistogramCollectVoxels<VTK_TT>(
+        segment.Labelmap, segment.LabelValue, segmentIndex, geometryExtent, memberships) );
+      default:
+        vtkErrorMacro("BuildIndex: Unknown labelmap scalar type");
+        return false;
+    }
+  }
+  std::sort(memberships.begin(), memberships.end());
+
+  // Build index so that each voxel is visited once regardless of the number of segments containing it
+  this->Internal->VoxelIds.clear();
+  this->Internal->MembershipOffsets.clear();
+  this->Internal->MembershipSegments.clear();
+  this->Internal->MembershipSegments.reserve(memberships.size());
+  for (std::vector<std::pair<vtkIdType, int> >::iterator membershipIt = memberships.begin(); membershipIt != memberships.end(); ++membershipIt)
+  {
+    if (this->Internal->VoxelIds.empty() || this->Internal->VoxelIds.back() != membershipIt->first)
+    {
+      this->Internal->VoxelIds.push_back(membershipIt->first);
+      this->Internal->MembershipOffsets.push_back(static_cast<vtkIdType>(this->Internal->MembershipSegments.size()));
+    }
+    this->Internal->MembershipSegments.push_back(membershipIt->second);
+  }
+  this->Internal->MembershipOffsets.push_back(static_cast<vtkIdType>(this->Internal->MembershipSegments.size()));
+  this->Internal->AccumulatedDose.assign(this->Internal->VoxelIds.size(), 0.0);
+  this->Internal->MaximumDose = 0.0;
+
+  // All voxels start with zero dose
+  int zeroDoseBin = GetHistogramBin(0.0, this->StartValue, this->StepSize);
+  for (std::vector<int>::iterator segmentIndexIt = this->Internal->MembershipSegments.begin();
+    segmentIndexIt != this->Internal->MembershipSegments.end(); ++segmentIndexIt)
+  {
+    IncrementalSegment& segment = this->Internal->Segments[*segmentIndexIt];
+    ++segment.VoxelCount;
+    segment.AddToBin(zeroDoseBin, 1.0);
+  }
+
+  this->Internal->IndexBuilt = true;
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkIncrementalDoseVolumeHistogram::AddWeightedDose(vtkOrientedImageData* doseVolume, double weight)
+{
+  if (!this->Internal->Geometry)
+  {
+    vtkErrorMacro("AddWeightedDose: Accumulated dose volume geometry is not initialized");
+    return false;
+  }
+  if (!doseVolume || !doseVolume->GetPointData() || !doseVolume->GetPointData()->GetScalars()
+    || doseVolume->GetNumberOfScalarComponents() != 1)
+  {
+    vtkErrorMacro("AddWeightedDose: Invalid dose volume");
+    return false;
+  }
+  if ( !vtkOrientedImageDataResample::DoGeometriesMatch(doseVolume, this->Internal->Geometry)
+    || !vtkOrientedImageDataResample::DoExtentsMatch(doseVolume, this->Internal->Geometry) )
+  {
+    vtkErrorMacro("AddWeightedDose: Dose volume geometry does not match that of the accumulated dose volume");
+    return false;
+  }
+  if (!this->Internal->IndexBuilt && !this->BuildIndex())
+  {
+    vtkErrorMacro("AddWeightedDose: Failed to index segment voxels");
+    return false;
+  }
+
+  switch (doseVolume->GetScalarType())
+  {
+    vtkTemplateMacro( vtkIncrementalDoseVolumeHistogramAddDose<VTK_TT>(
+      static_cast<VTK_TT*>(doseVolume->GetScalarPointer()), weight, this->StartValue, this->StepSize,
+      this->Internal->VoxelIds, this->Internal->MembershipOffsets, this->Internal->MembershipSegments,
+      this->Internal->AccumulatedDose, this->Internal->Segments, this->Internal->MaximumDose) );
+    default:
+      vtkErrorMacro("AddWeightedDose: Unknown dose volume scalar type");
+      return false;
+  }
+
+  this->Modified();
+  return true;
+}
+
+//----------------------------------------------------------------------------
+vtkIdType vtkIncrementalDoseVolumeHistogram::GetSegmentVoxelCount(int segmentIndex)
+{
+  if (segmentIndex < 0 || segmentIndex >= static_cast<int>(this->Internal->Segments.size()))
+  {
+    vtkErrorMacro("GetSegmentVoxelCount: Invalid segment index " << segmentIndex);
+    return 0;
+  }
+  return this->Internal->Segments[segmentIndex].VoxelCount;
+}
+
+//----------------------------------------------------------------------------
+double vtkIncrementalDoseVolumeHistogram::GetSegmentMean(int segmentIndex)
+{
+  if (segmentIndex < 0 || segmentIndex >= static_cast<int>(this->Internal->Segments.size()))
+  {
+    vtkErrorMacro("GetSegmentMean: Invalid segment index " << segmentIndex);
+    return 0.0;
+  }
+  const IncrementalSegment& segment = this->Internal->Segments[segmentIndex];
+  if (segment.VoxelCount == 0)
+  {
+    return 0.0;
+  }
+  return segment.Sum / static_cast<double>(segment.VoxelCount);
+}
+
+//----------------------------------------------------------------------------
+double vtkIncrementalDoseVolumeHistogram::GetSegmentMin(int segmentIndex)
+{
+  if (segmentIndex < 0 || segmentIndex >= static_cast<int>(this->Internal->Segments.size()))
+  {
+    vtkErrorMacro("GetSegmentMin: Invalid segment index " << segmentIndex);
+    return 0.0;
+  }
+  return this->Internal->Segments[segmentIndex].Min;
+}
+
+//----------------------------------------------------------------------------
+double vtkIncrementalDoseVolumeHistogram::GetSegmentMax(int segmentIndex)
+{
+  if (segmentIndex < 0 || segmentIndex >= static_cast<int>(this->Internal->Segments.size()))
+  {
+    vtkErrorMacro("GetSegmentMax: Invalid segment index " << segmentIndex);
+    return 0.0;
+  }
+  return this->Internal->Segments[segmentIndex].Max;
+}
+
+//----------------------------------------------------------------------------
+double vtkIncrementalDoseVolumeHistogram::GetSegmentVoxelCountBelowStartValue(int segmentIndex)
+{
+  if (segmentIndex < 0 || segmentIndex >= static_cast<int>(this->Internal->Segments.size()))
+  {
+    vtkErrorMacro("GetSegmentVoxelCountBelowStartValue: Invalid segment index " << segmentIndex);
+    return 0.0;
+  }
+  return this->Internal->Segments[segmentIndex].VoxelCountBelowStartValue;
+}
+
+//----------------------------------------------------------------------------
+double vtkIncrementalDoseVolumeHistogram::GetSegmentBinCount(int segmentIndex, int binIndex)
+{
+  if (segmentIndex < 0 || segmentIndex >= static_cast<int>(this->Internal->Segments.size()))
+  {
+    vtkErrorMacro("GetSegmentBinCount: Invalid segment index " << segmentIndex);
+    return 0.0;
+  }
+  const IncrementalSegment& segment = this->Internal->Segments[segmentIndex];
+  if (binIndex < 0 || binIndex >= static_cast<int>(segment.BinCounts.size()))
+  {
+    return 0.0;
+  }
+  return segment.BinCounts[binIndex];
+}
+
+//----------------------------------------------------------------------------
+double vtkIncrementalDoseVolumeHistogram::GetMaximumDose()
+{
+  return this->Internal->MaximumDose;
+}
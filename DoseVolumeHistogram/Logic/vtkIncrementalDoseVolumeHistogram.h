@@ -0,0 +1,108 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Csaba Pinter, PerkLab, Queen's University
+  and was supported through the Applied Cancer Research Unit program of Cancer Care
+  Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
+
+==============================================================================*/
+
+#ifndef __vtkIncrementalDoseVolumeHistogram_h
+#define __vtkIncrementalDoseVolumeHistogram_h
+
+#include "vtkSlicerDoseVolumeHistogramModuleLogicExport.h"
+
+// VTK includes
+#include <vtkObject.h>
+
+class vtkOrientedImageData;
+
+/// \ingroup SlicerRt_QtModules_DoseVolumeHistogram
+/// \brief Dose volume histograms of multiple segments that are updated as weighted dose volumes are accumulated.
+///
+/// The voxels of the segments are indexed once, when the first dose volume is added. After that only the
+/// accumulated dose of the indexed voxels is stored, and adding a weighted dose volume only visits these voxels,
+/// moving each voxel to its new histogram bin if the added dose changed its bin. This way adding a fraction
+/// costs a single pass over the segment voxels instead of a full DVH computation.
+///
+/// The accumulated dose starts from zero. The histogram bins are defined by the start value and step size
+/// the same way as in the DVH computation, and new bins are added when the accumulated dose exceeds the last one.
+class VTK_SLICER_DOSEVOLUMEHISTOGRAM_LOGIC_EXPORT vtkIncrementalDoseVolumeHistogram : public vtkObject
+{
+public:
+  static vtkIncrementalDoseVolumeHistogram* New();
+  vtkTypeMacro(vtkIncrementalDoseVolumeHistogram, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent) override;
+
+  /// Clear segments and accumulated dose, and set the geometry of the accumulated dose volume.
+  /// The added segment labelmaps need to be on the same lattice, and the added dose volumes need to have the same geometry.
+  void Initialize(vtkOrientedImageData* geometry);
+
+  /// Add segment. Needs to be called before adding the first dose volume.
+  /// \param labelmap Binary labelmap layer containing the segment. Must have integer scalar type.
+  /// \param labelValue Label value of the segment in the layer
+  /// \return Index of the added segment, -1 on failure
+  int AddSegment(vtkOrientedImageData* labelmap, int labelValue);
+  /// Get number of added segments
+  int GetNumberOfSegments();
+
+  /// Add weighted dose volume to the accumulated dose and update the histograms
+  /// \return Success flag
+  bool AddWeightedDose(vtkOrientedImageData* doseVolume, double weight);
+
+  /// Get number of voxels in segment
+  vtkIdType GetSegmentVoxelCount(int segmentIndex);
+  /// Get mean accumulated dose in segment
+  double GetSegmentMean(int segmentIndex);
+  /// Get minimum accumulated dose in segment
+  double GetSegmentMin(int segmentIndex);
+  /// Get maximum accumulated dose in segment
+  double GetSegmentMax(int segmentIndex);
+  /// Get number of voxels in segment with accumulated dose in [0, start value)
+  double GetSegmentVoxelCountBelowStartValue(int segmentIndex);
+  /// Get number of voxels in histogram bin of segment. Bin i contains the doses in [start + i*step, start + (i+1)*step)
+  double GetSegmentBinCount(int segmentIndex, int binIndex);
+  /// Get maximum accumulated dose in all segments
+  double GetMaximumDose();
+
+  /// Start value of the histogram bins. Cannot be changed after the first dose volume is added.
+  vtkGetMacro(StartValue, double);
+  vtkSetMacro(StartValue, double);
+
+  /// Step size of the histogram bins. Cannot be changed after the first dose volume is added.
+  vtkGetMacro(StepSize, double);
+  vtkSetMacro(StepSize, double);
+
+protected:
+  /// Index the voxels of the segments and initialize the histograms with zero dose
+  bool BuildIndex();
+
+protected:
+  double StartValue;
+  double StepSize;
+
+protected:
+  vtkIncrementalDoseVolumeHistogram();
+  ~vtkIncrementalDoseVolumeHistogram() override;
+
+private:
+  vtkIncrementalDoseVolumeHistogram(const vtkIncrementalDoseVolumeHistogram&) = delete;
+  void operator=(const vtkIncrementalDoseVolumeHistogram&) = delete;
+
+private:
+  class vtkInternal;
+  vtkInternal* Internal;
+};
+
+#endif
@@ -0,0 +1,423 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Csaba Pinter, PerkLab, Queen's University
+  and was supported through the Applied Cancer Research Unit program of Cancer Care
+  Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
+
+==============================================================================*/
+
+#include "vtkMultiSegmentImageAccumulate.h"
+
+// SegmentationCore includes
+#include "vtkOrientedImageData.h"
+#include "vtkOrientedImageDataResample.h"
+
+// VTK includes
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkSmartPointer.h>
+
+// STD includes
+#include <algorithm>
+#include <vector>
+
+vtkStandardNewMacro(vtkMultiSegmentImageAccumulate);
+
+namespace
+{
+
+//----------------------------------------------------------------------------
+/// Statistics and histogram of one segment
+struct SegmentAccumulator
+{
+  /// Index of the labelmap layer containing the segment
+  int LayerIndex{-1};
+  /// Label value of the segment in its layer
+  int LabelValue{0};
+
+  double BinOrigin{0.0};
+  double BinSpacing{1.0};
+  int NumberOfBins{0};
+
+  vtkIdType VoxelCount{0};
+  double Sum{0.0};
+  double Min{VTK_DOUBLE_MAX};
+  double Max{VTK_DOUBLE_MIN};
+  double VoxelCountBelowOrigin{0.0};
+  std::vector<double> BinCounts;
+
+  void Reset()
+  {
+    this->VoxelCount = 0;
+    this->Sum = 0.0;
+    this->Min = VTK_DOUBLE_MAX;
+    this->Max = VTK_DOUBLE_MIN;
+    this->VoxelCountBelowOrigin = 0.0;
+    this->BinCounts.assign(this->NumberOfBins, 0.0);
+  }
+
+  void AddValue(double value)
+  {
+    ++this->VoxelCount;
+    this->Sum += value;
+    if (value > this->Max)
+    {
+      this->Max = value;
+    }
+    if (value < this->Min)
+    {
+      this->Min = value;
+    }
+    if (this->NumberOfBins > 0)
+    {
+      // Bin index is floor(position). Comparing the position instead of the rounded index
+      // gives the same result for finite values, and skips invalid values without overflow.
+      double belowOriginPosition = value / this->BinOrigin;
+      if (belowOriginPosition >= 0.0 && belowOriginPosition < 1.0)
+      {
+        this->VoxelCountBelowOrigin += 1.0;
+      }
+      double binPosition = (value - this->BinOrigin) / this->BinSpacing;
+      if (binPosition >= 0.0 && binPosition < this->NumberOfBins)
+      {
+        this->BinCounts[static_cast<int>(binPosition)] += 1.0;
+      }
+    }
+  }
+};
+
+//----------------------------------------------------------------------------
+/// Labelmap layer that contains one or more segments
+struct LabelmapLayer
+{
+  vtkSmartPointer<vtkOrientedImageData> Labelmap;
+  /// Index of the accumulated segment for each label value (-1 if the label is not accumulated)
+  std::vector<int> SegmentIndexForLabel;
+};
+
+//----------------------------------------------------------------------------
+/// Add voxels of an image row to the segments of a labelmap layer row
+template <class InputScalarType, class LabelScalarType>
+void vtkMultiSegmentImageAccumulateRow(
+  InputScalarType* inputPtr, LabelScalarType* labelPtr, int numberOfVoxels,
+  const std::vector<int>& segmentIndexForLabel, std::vector<SegmentAccumulator>& segments)
+{
+  vtkIdType numberOfLabels = static_cast<vtkIdType>(segmentIndexForLabel.size());
+  for (int voxelIndex = 0; voxelIndex < numberOfVoxels; ++voxelIndex)
+  {
+    vtkIdType label = static_cast<vtkIdType>(labelPtr[voxelIndex]);
+    if (label <= 0 || label >= numberOfLabels)
+    {
+      continue;
+    }
+    int segmentIndex = segmentIndexForLabel[label];
+    if (segmentIndex < 0)
+    {
+      continue;
+    }
+    segments[segmentIndex].AddValue(static_cast<double>(inputPtr[voxelIndex]));
+  }
+}
+
+//----------------------------------------------------------------------------
+/// Traverse the input image once and add each voxel to all the segments containing it
+template <class InputScalarType>
+void vtkMultiSegmentImageAccumulateExecute(vtkOrientedImageData* inputImage,
+  std::vector<LabelmapLayer>& layers, std::vector<SegmentAccumulator>& segments)
+{
+  int inputExtent[6] = { 0, -1, 0, -1, 0, -1 };
+  inputImage->GetExtent(inputExtent);
+
+  for (int z = inputExtent[4]; z <= inputExtent[5]; ++z)
+  {
+    for (int y = inputExtent[2]; y <= inputExtent[3]; ++y)
+    {
+      InputScalarType* inputRowPtr = static_cast<InputScalarType*>(inputImage->GetScalarPointer(inputExtent[0], y, z));
+
+      // The input row is processed for each layer while it is in the cache
+      for (std::vector<LabelmapLayer>::iterator layerIt = layers.begin(); layerIt != layers.end(); ++layerIt)
+      {
+        int* layerExtent = layerIt->Labelmap->GetExtent();
+        if (y < layerExtent[2] || y > layerExtent[3] || z < layerExtent[4] || z > layerExtent[5])
+        {
+          continue;
+        }
+        int firstX = std::max(inputExtent[0], layerExtent[0]);
+        int lastX = std::min(inputExtent[1], layerExtent[1]);
+        if (firstX > lastX)
+        {
+          continue;
+        }
+
+        void* labelRowPtr = layerIt->Labelmap->GetScalarPointer(firstX, y, z);
+        switch (layerIt->Labelmap->GetScalarType())
+        {
+          vtkTemplateMacro( vtkMultiSegmentImageAccumulateRow(
+            inputRowPtr + (firstX - inputExtent[0]), static_cast<VTK_TT*>(labelRowPtr), lastX - firstX + 1,
+            layerIt->SegmentIndexForLabel, segments) );
+          default:
+            break;
+        }
+      }
+    }
+  }
+}
+
+}
+
+//----------------------------------------------------------------------------
+class vtkMultiSegmentImageAccumulate::vtkInternal
+{
+public:
+  vtkSmartPointer<vtkOrientedImageData> InputImage;
+  std::vector<LabelmapLayer> Layers;
+  std::vector<SegmentAccumulator> Segments;
+};
+
+//----------------------------------------------------------------------------
+vtkMultiSegmentImageAccumulate::vtkMultiSegmentImageAccumulate()
+{
+  this->Internal = new vtkInternal();
+}
+
+//----------------------------------------------------------------------------
+vtkMultiSegmentImageAccumulate::~vtkMultiSegmentImageAccumulate()
+{
+  delete this->Internal;
+  this->Internal = nullptr;
+}
+
+//----------------------------------------------------------------------------
+void vtkMultiSegmentImageAccumulate::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "NumberOfLayers: " << this->Internal->Layers.size() << "\n";
+  os << indent << "NumberOfSegments: " << this->Internal->Segments.size() << "\n";
+}
+
+//----------------------------------------------------------------------------
+void vtkMultiSegmentImageAccumulate::SetInputImage(vtkOrientedImageData* image)
+{
+  if (this->Internal->InputImage == image)
+  {
+    return;
+  }
+  this->Internal->InputImage = image;
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+vtkOrientedImageData* vtkMultiSegmentImageAccumulate::GetInputImage()
+{
+  return this->Internal->InputImage;
+}
+
+//----------------------------------------------------------------------------
+int vtkMultiSegmentImageAccumulate::AddSegment(vtkOrientedImageData* labelmap, int labelValue)
+{
+  if (!labelmap || labelValue <= 0)
+  {
+    vtkErrorMacro("AddSegment: Invalid labelmap or label value");
+    return -1;
+  }
+  if (labelmap->GetScalarType() == VTK_FLOAT || labelmap->GetScalarType() == VTK_DOUBLE
+    || labelmap->GetNumberOfScalarComponents() != 1)
+  {
+    vtkErrorMacro("AddSegment: Labelmap needs to have a single integer scalar component");
+    return -1;
+  }
+
+  // Find layer or add new one
+  int layerIndex = 0;
+  for (; layerIndex < static_cast<int>(this->Internal->Layers.size()); ++layerIndex)
+  {
+    if (this->Internal->Layers[layerIndex].Labelmap == labelmap)
+    {
+      break;
+    }
+  }
+  if (layerIndex == static_cast<int>(this->Internal->Layers.size()))
+  {
+    LabelmapLayer layer;
+    layer.Labelmap = labelmap;
+    this->Internal->Layers.push_back(layer);
+  }
+
+  LabelmapLayer& layer = this->Internal->Layers[layerIndex];
+  if (labelValue >= static_cast<int>(layer.SegmentIndexForLabel.size()))
+  {
+    layer.SegmentIndexForLabel.resize(labelValue + 1, -1);
+  }
+  if (layer.SegmentIndexForLabel[labelValue] >= 0)
+  {
+    vtkErrorMacro("AddSegment: Segment with label value " << labelValue << " has already been added from this labelmap");
+    return -1;
+  }
+
+  SegmentAccumulator segment;
+  segment.LayerIndex = layerIndex;
+  segment.LabelValue = labelValue;
+  int segmentIndex = static_cast<int>(this->Internal->Segments.size());
+  this->Internal->Segments.push_back(segment);
+  layer.SegmentIndexForLabel[labelValue] = segmentIndex;
+
+  this->Modified();
+  return segmentIndex;
+}
+
+//----------------------------------------------------------------------------
+void vtkMultiSegmentImageAccumulate::RemoveAllSegments()
+{
+  this->Internal->Layers.clear();
+  this->Internal->Segments.clear();
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+int vtkMultiSegmentImageAccumulate::GetNumberOfSegments()
+{
+  return static_cast<int>(this->Internal->Segments.size());
+}
+
+//----------------------------------------------------------------------------
+void vtkMultiSegmentImageAccumulate::SetSegmentBins(int segmentIndex, double origin, double spacing, int numberOfBins)
+{
+  if (segmentIndex < 0 || segmentIndex >= static_cast<int>(this->Internal->Segments.size()))
+  {
+    vtkErrorMacro("SetSegmentBins: Invalid segment index " << segmentIndex);
+    return;
+  }
+  SegmentAccumulator& segment = this->Internal->Segments[segmentIndex];
+  segment.BinOrigin = origin;
+  segment.BinSpacing = spacing;
+  segment.NumberOfBins = std::max(numberOfBins, 0);
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+bool vtkMultiSegmentImageAccumulate::Update()
+{
+  vtkOrientedImageData* inputImage = this->Internal->InputImage;
+  if (!inputImage || !inputImage->GetPointData() || !inputImage->GetPointData()->GetScalars())
+  {
+    vtkErrorMacro("Update: Invalid input image");
+    return false;
+  }
+  if (inputImage->GetNumberOfScalarComponents() != 1)
+  {
+    vtkErrorMacro("Update: Input image needs to have a single scalar component");
+    return false;
+  }
+  for (std::vector<LabelmapLayer>::iterator layerIt = this->Internal->Layers.begin(); layerIt != this->Internal->Layers.end(); ++layerIt)
+  {
+    if (!vtkOrientedImageDataResample::DoGeometriesMatch(inputImage, layerIt->Labelmap))
+    {
+      vtkErrorMacro("Update: Labelmap layer geometry does not match that of the input image");
+      return false;
+    }
+  }
+
+  for (std::vector<SegmentAccumulator>::iterator segmentIt = this->Internal->Segments.begin(); segmentIt != this->Internal->Segments.end(); ++segmentIt)
+  {
+    segmentIt->Reset();
+  }
+
+  switch (inputImage->GetScalarType())
+  {
+    vtkTemplateMacro( vtkMultiSegmentImageAccumulateExecute<VTK_TT>(
+      inputImage, this->Internal->Layers, this->Internal->Segments) );
+    default:
+      vtkErrorMacro("Update: Unknown scalar type");
+      return false;
+  }
+
+  return true;
+}
+
+//----------------------------------------------------------------------------
+vtkIdType vtkMultiSegmentImageAccumulate::GetSegmentVoxelCount(int segmentIndex)
+{
+  if (segmentIndex < 0 || segmentIndex >= static_cast<int>(this->Internal->Segments.size()))
+  {
+    vtkErrorMacro("GetSegmentVoxelCount: Invalid segment index " << segmentIndex);
+    return 0;
+  }
+  return this->Internal->Segments[segmentIndex].VoxelCount;
+}
+
+//----------------------------------------------------------------------------
+double vtkMultiSegmentImageAccumulate::GetSegmentMean(int segmentIndex)
+{
+  if (segmentIndex < 0 || segmentIndex >= static_cast<int>(this->Internal->Segments.size()))
+  {
+    vtkErrorMacro("GetSegmentMean: Invalid segment index " << segmentIndex);
+    return 0.0;
+  }
+  const SegmentAccumulator& segment = this->Internal->Segments[segmentIndex];
+  if (segment.VoxelCount == 0)
+  {
+    return 0.0;
+  }
+  return segment.Sum / static_cast<double>(segment.VoxelCount);
+}
+
+//----------------------------------------------------------------------------
+double vtkMultiSegmentImageAccumulate::GetSegmentMin(int segmentIndex)
+{
+  if (segmentIndex < 0 || segmentIndex >= static_cast<int>(this->Internal->Segments.size()))
+  {
+    vtkErrorMacro("GetSegmentMin: Invalid segment index " << segmentIndex);
+    return 0.0;
+  }
+  return this->Internal->Segments[segmentIndex].Min;
+}
+
+//----------------------------------------------------------------------------
+double vtkMultiSegmentImageAccumulate::GetSegmentMax(int segmentIndex)
+{
+  if (segmentIndex < 0 || segmentIndex >= static_cast<int>(this->Internal->Segments.size()))
+  {
+    vtkErrorMacro("GetSegmentMax: Invalid segment index " << segmentIndex);
+    return 0.0;
+  }
+  return this->Internal->Segments[segmentIndex].Max;
+}
+
+//----------------------------------------------------------------------------
+double vtkMultiSegmentImageAccumulate::GetSegmentVoxelCountBelowOrigin(int segmentIndex)
+{
+  if (segmentIndex < 0 || segmentIndex >= static_cast<int>(this->Internal->Segments.size()))
+  {
+    vtkErrorMacro("GetSegmentVoxelCountBelowOrigin: Invalid segment index " << segmentIndex);
+    return 0.0;
+  }
+  return this->Internal->Segments[segmentIndex].VoxelCountBelowOrigin;
+}
+
+//----------------------------------------------------------------------------
+double vtkMultiSegmentImageAccumulate::GetSegmentBinCount(int segmentIndex, int binIndex)
+{
+  if (segmentIndex < 0 || segmentIndex >= static_cast<int>(this->Internal->Segments.size()))
+  {
+    vtkErrorMacro("GetSegmentBinCount: Invalid segment index " << segmentIndex);
+    return 0.0;
+  }
+  const SegmentAccumulator& segment = this->Internal->Segments[segmentIndex];
+  if (binIndex < 0 || binIndex >= static_cast<int>(segment.BinCounts.size()))
+  {
+    return 0.0;
+  }
+  return segment.BinCounts[binIndex];
+}
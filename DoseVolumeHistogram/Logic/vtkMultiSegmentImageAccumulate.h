@@ -0,0 +1,102 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Csaba Pinter, PerkLab, Queen's University
+  and was supported through the Applied Cancer Research Unit program of Cancer Care
+  Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
+
+==============================================================================*/
+
+#ifndef __vtkMultiSegmentImageAccumulate_h
+#define __vtkMultiSegmentImageAccumulate_h
+
+#include "vtkSlicerDoseVolumeHistogramModuleLogicExport.h"
+
+// VTK includes
+#include <vtkObject.h>
+
+class vtkOrientedImageData;
+
+/// \ingroup SlicerRt_QtModules_DoseVolumeHistogram
+/// \brief Accumulate statistics and histograms of an image for multiple segments in a single pass.
+///
+/// Segments are specified by a binary labelmap layer and a label value. Segments in the same (shared)
+/// layer cannot overlap, but segments in different layers can, so each voxel of the input image is added
+/// to the accumulators of all the segments that contain it. This way the input image is read only once
+/// regardless of the number of segments, as opposed to running vtkImageAccumulate with a stencil for
+/// each segment.
+///
+/// The labelmap layers need to be on the same lattice as the input image (origin, spacing, directions),
+/// but their extents may differ. The statistics and the histogram bins are computed the same way as in
+/// vtkImageAccumulate, and the voxels of each segment are visited in the same order, so the results are
+/// identical to those of a stenciled vtkImageAccumulate.
+class VTK_SLICER_DOSEVOLUMEHISTOGRAM_LOGIC_EXPORT vtkMultiSegmentImageAccumulate : public vtkObject
+{
+public:
+  static vtkMultiSegmentImageAccumulate* New();
+  vtkTypeMacro(vtkMultiSegmentImageAccumulate, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent) override;
+
+  /// Set image whose voxel values are accumulated. Must have one scalar component.
+  void SetInputImage(vtkOrientedImageData* image);
+  /// Get image whose voxel values are accumulated
+  vtkOrientedImageData* GetInputImage();
+
+  /// Add segment to accumulate
+  /// \param labelmap Binary labelmap layer containing the segment. Must have integer scalar type.
+  ///   Multiple segments can be added with the same layer.
+  /// \param labelValue Label value of the segment in the layer
+  /// \return Index of the added segment, -1 on failure
+  int AddSegment(vtkOrientedImageData* labelmap, int labelValue);
+  /// Remove all segments and labelmap layers
+  void RemoveAllSegments();
+  /// Get number of added segments
+  int GetNumberOfSegments();
+
+  /// Set histogram bins of a segment. A value v falls in bin floor((v-origin)/spacing) as in vtkImageAccumulate.
+  /// If not set, only the statistics are computed for the segment.
+  void SetSegmentBins(int segmentIndex, double origin, double spacing, int numberOfBins);
+
+  /// Compute statistics, and histograms for the segments that have bins set
+  /// \return Success flag
+  bool Update();
+
+  /// Get number of voxels in segment
+  vtkIdType GetSegmentVoxelCount(int segmentIndex);
+  /// Get mean value in segment
+  double GetSegmentMean(int segmentIndex);
+  /// Get minimum value in segment
+  double GetSegmentMin(int segmentIndex);
+  /// Get maximum value in segment
+  double GetSegmentMax(int segmentIndex);
+  /// Get number of voxels in segment with value in [0, origin), where origin is that of the histogram
+  /// (same as vtkImageAccumulate bin 0 with component origin 0 and spacing equal to the histogram origin)
+  double GetSegmentVoxelCountBelowOrigin(int segmentIndex);
+  /// Get number of voxels in histogram bin of segment
+  double GetSegmentBinCount(int segmentIndex, int binIndex);
+
+protected:
+  vtkMultiSegmentImageAccumulate();
+  ~vtkMultiSegmentImageAccumulate() override;
+
+private:
+  vtkMultiSegmentImageAccumulate(const vtkMultiSegmentImageAccumulate&) = delete;
+  void operator=(const vtkMultiSegmentImageAccumulate&) = delete;
+
+private:
+  class vtkInternal;
+  vtkInternal* Internal;
+};
+
+#endif
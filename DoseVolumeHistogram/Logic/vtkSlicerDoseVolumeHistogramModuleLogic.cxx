@@ -21,6 +21,9 @@
 // DoseVolumeHistogram includes
 #include "vtkMRMLDoseVolumeHistogramNode.h"
 #include "vtkSlicerDoseVolumeHistogramModuleLogic.h"
+#include "vtkMultiSegmentImageAccumulate.h"
+#include "vtkIncrementalDoseVolumeHistogram.h"
+#include "vtkDoseValueDistribution.h"
 
 // SlicerRT includes
 #include "vtkSlicerRtCommon.h"
@@ -49,6 +52,7 @@
 #include <vtkMRMLTableNode.h>
 #include <vtkMRMLScalarVolumeNode.h>
 #include <vtkMRMLScene.h>
+#include <vtkMRMLTransformNode.h>
 #include <vtkEventBroker.h>
 
 // VTK includes
@@ -64,9 +68,11 @@
 #include <vtkImageStencilData.h>
 #include <vtkImageToImageStencil.h>
 #include <vtkMath.h>
+#include <vtkMatrix4x4.h>
 #include <vtkNew.h>
 #include <vtkObjectFactory.h>
 #include <vtkPiecewiseFunction.h>
+#include <vtkSMPTools.h>
 #include <vtkStringArray.h>
 #include <vtkTable.h>
 #include <vtkTimerLog.h>
@@ -77,6 +83,7 @@
 
 // STD includes
 #include <iostream>
+#include <map>
 #include <set>
 
 // Slicer includes
@@ -131,6 +138,9 @@ vtkSlicerDoseVolumeHistogramModuleLogic::vtkSlicerDoseVolumeHistogramModuleLogic
   this->UseLinearInterpolationForDoseVolume = true;
 
   this->LogSpeedMeasurements = false;
+  this->UseComputationCache = true;
+  this->DoseVolumeCacheUsed = false;
+  this->NumberOfCachedSegmentDvhsUsed = 0;
 }
 
 //----------------------------------------------------------------------------
@@ -169,9 +179,100 @@ void vtkSlicerDoseVolumeHistogramModuleLogic::OnMRMLSceneEndClose()
     return;
   }
 
+  this->ClearComputationCache();
+  this->IncrementalDvh = IncrementalDvhState();
+  this->DoseDistributions.clear();
+
   this->Modified();
 }
 
+//---------------------------------------------------------------------------
+void vtkSlicerDoseVolumeHistogramModuleLogic::ClearComputationCache()
+{
+  this->DoseVolumeCache = DoseVolumeCacheEntry();
+  this->SegmentDvhCache.clear();
+}
+
+//---------------------------------------------------------------------------
+std::string vtkSlicerDoseVolumeHistogramModuleLogic::GetParentTransformCacheKey(vtkMRMLTransformableNode* node)
+{
+  std::stringstream keyStream;
+  vtkMRMLTransformNode* transformNode = (node ? node->GetParentTransformNode() : nullptr);
+  for (; transformNode; transformNode = transformNode->GetParentTransformNode())
+  {
+    keyStream << transformNode->GetID() << ":" << transformNode->GetMTime();
+    if (transformNode->GetTransformToParent())
+    {
+      keyStream << ":" << transformNode->GetTransformToParent()->GetMTime();
+    }
+    keyStream << ";";
+  }
+  return keyStream.str();
+}
+
+//---------------------------------------------------------------------------
+std::string vtkSlicerDoseVolumeHistogramModuleLogic::GetDoseVolumeCacheKey(vtkMRMLDoseVolumeHistogramNode* parameterNode)
+{
+  vtkMRMLScalarVolumeNode* doseVolumeNode = (parameterNode ? parameterNode->GetDoseVolumeNode() : nullptr);
+  if (!doseVolumeNode || !doseVolumeNode->GetImageData())
+  {
+    return "";
+  }
+
+  // The MTime of the volume node itself is not used, because it also changes when node references are added,
+  // such as the DVH tables referenced from the dose volume after each computation
+  std::stringstream keyStream;
+  keyStream << doseVolumeNode->GetID() << "|" << doseVolumeNode->GetImageData()->GetMTime() << "|";
+  vtkNew<vtkMatrix4x4> doseIjkToRasMatrix;
+  doseVolumeNode->GetIJKToRASMatrix(doseIjkToRasMatrix);
+  keyStream.precision(17);
+  for (int row = 0; row < 3; ++row)
+  {
+    for (int column = 0; column < 4; ++column)
+    {
+      keyStream << doseIjkToRasMatrix->GetElement(row, column) << ",";
+    }
+  }
+  keyStream << "|" << GetParentTransformCacheKey(doseVolumeNode)
+    << "|" << (parameterNode->GetAutomaticOversampling() ? "A" : "F") << this->DefaultDoseVolumeOversamplingFactor;
+  return keyStream.str();
+}
+
+//---------------------------------------------------------------------------
+std::string vtkSlicerDoseVolumeHistogramModuleLogic::GetSegmentDvhCacheKey(
+  vtkMRMLDoseVolumeHistogramNode* parameterNode, const std::string& segmentID, const std::string& doseVolumeCacheKey)
+{
+  vtkMRMLSegmentationNode* segmentationNode = (parameterNode ? parameterNode->GetSegmentationNode() : nullptr);
+  vtkSegment* segment = (segmentationNode ? segmentationNode->GetSegmentation()->GetSegment(segmentID) : nullptr);
+  if (!segment || doseVolumeCacheKey.empty())
+  {
+    return "";
+  }
+
+  // Changes of any representation of the segment invalidate the DVH
+  vtkMTimeType segmentMTime = segment->GetMTime();
+  std::vector<std::string> representationNames;
+  segment->GetContainedRepresentationNames(representationNames);
+  for (std::vector<std::string>::iterator nameIt = representationNames.begin(); nameIt != representationNames.end(); ++nameIt)
+  {
+    vtkDataObject* representation = segment->GetRepresentation(*nameIt);
+    if (representation && representation->GetMTime() > segmentMTime)
+    {
+      segmentMTime = representation->GetMTime();
+    }
+  }
+
+  std::stringstream keyStream;
+  keyStream << doseVolumeCacheKey
+    << "|" << segmentationNode->GetID() << "|" << GetParentTransformCacheKey(segmentationNode)
+    << "|" << segmentID << "|" << segmentMTime << "|" << segment->GetLabelValue()
+    << "|" << parameterNode->GetUseFractionalLabelmap() << parameterNode->GetDoseSurfaceHistogram() << parameterNode->GetUseInsideDoseSurface()
+    << parameterNode->GetExactMetrics()
+    << "|" << this->StartValue << "|" << this->StepSize << "|" << this->NumberOfSamplesForNonDoseVolumes
+    << "|" << this->UseLinearInterpolationForDoseVolume;
+  return keyStream.str();
+}
+
 //---------------------------------------------------------------------------
 std::string vtkSlicerDoseVolumeHistogramModuleLogic::ComputeDvh(vtkMRMLDoseVolumeHistogramNode* parameterNode)
 {
@@ -196,12 +297,6 @@ std::string vtkSlicerDoseVolumeHistogramModuleLogic::ComputeDvh(vtkMRMLDoseVolum
   this->SetDisableModifiedEvent(1);
   int disabledNodeModify = parameterNode->StartModify();
 
-  // Get maximum dose from dose volume for number of DVH bins
-  vtkNew<vtkImageAccumulate> doseStat;
-  doseStat->SetInputData(doseVolumeNode->GetImageData());
-  doseStat->Update();
-  double maxDose = doseStat->GetMax()[0];
-
   // Get selected segmentation
   vtkSegmentation* selectedSegmentation = segmentationNode->GetSegmentation();
 
@@ -213,17 +308,135 @@ std::string vtkSlicerDoseVolumeHistogramModuleLogic::ComputeDvh(vtkMRMLDoseVolum
     selectedSegmentation->GetSegmentIDs(segmentIDs);
   }
 
-  // Create oriented image data from dose volume
-  vtkSmartPointer<vtkOrientedImageData> doseImageData = vtkSmartPointer<vtkOrientedImageData>::Take(
-    vtkSlicerSegmentationsModuleLogic::CreateOrientedImageDataFromVolumeNode(doseVolumeNode) );
-  if (!doseImageData.GetPointer())
+  // Get dose volume data. Reuse it from the previous computation if the dose volume has not changed
+  double maxDose = 0.0;
+  vtkSmartPointer<vtkOrientedImageData> doseImageData;
+  vtkSmartPointer<vtkOrientedImageData> fixedOversampledDoseVolume;
+  std::string doseVolumeCacheKey = this->GetDoseVolumeCacheKey(parameterNode);
+  this->DoseVolumeCacheUsed = false;
+  this->NumberOfCachedSegmentDvhsUsed = 0;
+  if (this->UseComputationCache && !doseVolumeCacheKey.empty() && this->DoseVolumeCache.Key == doseVolumeCacheKey)
   {
-    std::string errorMessage = vtkMRMLTr("vtkSlicerDoseVolumeHistogramModuleLogic", "Failed to get image data from dose volume");
-    vtkErrorMacro("ComputeDvh: " << errorMessage);
-    return errorMessage;
+    this->DoseVolumeCacheUsed = true;
+    maxDose = this->DoseVolumeCache.MaxDose;
+    doseImageData = this->DoseVolumeCache.DoseImageData;
+    fixedOversampledDoseVolume = this->DoseVolumeCache.FixedOversampledDoseVolume;
+  }
+  else
+  {
+    // Get maximum dose from dose volume for number of DVH bins
+    vtkNew<vtkImageAccumulate> doseStat;
+    doseStat->SetInputData(doseVolumeNode->GetImageData());
+    doseStat->Update();
+    maxDose = doseStat->GetMax()[0];
+
+    // Create oriented image data from dose volume
+    doseImageData = vtkSmartPointer<vtkOrientedImageData>::Take(
+      vtkSlicerSegmentationsModuleLogic::CreateOrientedImageDataFromVolumeNode(doseVolumeNode) );
+    if (!doseImageData.GetPointer())
+    {
+      std::string errorMessage = vtkMRMLTr("vtkSlicerDoseVolumeHistogramModuleLogic", "Failed to get image data from dose volume");
+      vtkErrorMacro("ComputeDvh: " << errorMessage);
+      return errorMessage;
+    }
+
+    // Use the same resampled dose volume if oversampling is fixed
+    if (!parameterNode->GetAutomaticOversampling())
+    {
+      // Get geometry of oversampled dose volume
+      fixedOversampledDoseVolume = vtkSmartPointer<vtkOrientedImageData>::New();
+      fixedOversampledDoseVolume->ShallowCopy(doseImageData);
+      vtkCalculateOversamplingFactor::ApplyOversamplingOnImageGeometry(fixedOversampledDoseVolume, this->DefaultDoseVolumeOversamplingFactor);
+
+      // Resample dose volume using linear interpolation
+      if ( !vtkOrientedImageDataResample::ResampleOrientedImageToReferenceOrientedImage(
+        doseImageData, fixedOversampledDoseVolume, fixedOversampledDoseVolume, true ) )
+      {
+        std::string errorMessage = vtkMRMLTr("vtkSlicerDoseVolumeHistogramModuleLogic", "Failed to resample dose volume");
+        vtkErrorMacro("ComputeDvh: " << errorMessage);
+        return errorMessage;
+      }
+    }
+
+    if (this->UseComputationCache)
+    {
+      this->DoseVolumeCache.Key = doseVolumeCacheKey;
+      this->DoseVolumeCache.MaxDose = maxDose;
+      this->DoseVolumeCache.DoseImageData = doseImageData;
+      this->DoseVolumeCache.FixedOversampledDoseVolume = fixedOversampledDoseVolume;
+    }
   }
 
-  // Temporarily duplicate selected segments to contain binary labelmap of a different geometry (tied to dose volume)
+  // Reuse DVHs of the segments that have not changed since the previous computation
+  std::map<std::string, SegmentDvhResult> cachedSegmentResults;
+  std::map<std::string, std::string> segmentCacheKeys;
+  std::vector<std::string> segmentIDsToCompute;
+  std::string segmentCacheEntryPrefix = std::string(segmentationNode->GetID()) + "|";
+  for (std::vector<std::string>::iterator segmentIt = segmentIDs.begin(); segmentIt != segmentIDs.end(); ++segmentIt)
+  {
+    std::string segmentCacheKey = this->GetSegmentDvhCacheKey(parameterNode, *segmentIt, doseVolumeCacheKey);
+    segmentCacheKeys[*segmentIt] = segmentCacheKey;
+    std::map<std::string, SegmentDvhCacheEntry>::iterator cacheIt = this->SegmentDvhCache.find(segmentCacheEntryPrefix + (*segmentIt));
+    if (this->UseComputationCache && !segmentCacheKey.empty()
+      && cacheIt != this->SegmentDvhCache.end() && cacheIt->second.Key == segmentCacheKey)
+    {
+      cachedSegmentResults[*segmentIt] = cacheIt->second.Result;
+      cachedSegmentResults[*segmentIt].ComputationTime = 0.0;
+      this->NumberOfCachedSegmentDvhsUsed++;
+      if (parameterNode->GetAutomaticOversampling())
+      {
+        parameterNode->AddAutomaticOversamplingFactor(*segmentIt, cacheIt->second.AutomaticOversamplingFactor);
+      }
+    }
+    else
+    {
+      segmentIDsToCompute.push_back(*segmentIt);
+    }
+  }
+  // Store computed DVH in the cache
+  auto cacheSegmentDvh = [&](const SegmentDvhResult& result)
+  {
+    if (!this->UseComputationCache || segmentCacheKeys[result.SegmentID].empty())
+    {
+      return;
+    }
+    SegmentDvhCacheEntry& cacheEntry = this->SegmentDvhCache[segmentCacheEntryPrefix + result.SegmentID];
+    cacheEntry.Key = segmentCacheKeys[result.SegmentID];
+    cacheEntry.Result = result;
+    cacheEntry.AutomaticOversamplingFactor = (parameterNode->GetAutomaticOversampling()
+      ? parameterNode->GetAutomaticOversamplingFactorForSegment(result.SegmentID) : 0.0);
+  };
+  // Write computed and cached DVHs into the tables in the order of the selected segments.
+  // The computed results are in the order of the segments to compute.
+  auto commitComputedAndCachedSegmentDvhs = [&](
+    const std::vector<SegmentDvhResult>& computedResults, const std::vector<std::string>& computedErrorMessages)
+  {
+    std::vector<SegmentDvhResult> results;
+    std::vector<std::string> errorMessages;
+    size_t computedIndex = 0;
+    for (std::vector<std::string>::iterator segmentIt = segmentIDs.begin(); segmentIt != segmentIDs.end(); ++segmentIt)
+    {
+      std::map<std::string, SegmentDvhResult>::iterator cachedResultIt = cachedSegmentResults.find(*segmentIt);
+      if (cachedResultIt != cachedSegmentResults.end())
+      {
+        results.push_back(cachedResultIt->second);
+        errorMessages.push_back("");
+      }
+      else if (computedIndex < computedResults.size())
+      {
+        results.push_back(computedResults[computedIndex]);
+        errorMessages.push_back(computedErrorMessages[computedIndex]);
+        if (errorMessages.back().empty())
+        {
+          cacheSegmentDvh(results.back());
+        }
+        ++computedIndex;
+      }
+    }
+    return this->CommitSegmentDvhs(parameterNode, results, errorMessages);
+  };
+
+  // Temporarily duplicate selected segments that need to be computed to contain binary labelmap of a different geometry (tied to dose volume)
   vtkSmartPointer<vtkSegmentation> segmentationCopy = vtkSmartPointer<vtkSegmentation>::New();
 #if Slicer_VERSION_MAJOR >= 5 && Slicer_VERSION_MINOR >= 3
   segmentationCopy->SetSourceRepresentationName(selectedSegmentation->GetSourceRepresentationName());
@@ -231,7 +444,7 @@ std::string vtkSlicerDoseVolumeHistogramModuleLogic::ComputeDvh(vtkMRMLDoseVolum
   segmentationCopy->SetMasterRepresentationName(selectedSegmentation->GetMasterRepresentationName());
 #endif
   segmentationCopy->CopyConversionParameters(selectedSegmentation);
-  for (std::vector<std::string>::iterator segmentIt = segmentIDs.begin(); segmentIt != segmentIDs.end(); ++segmentIt)
+  for (std::vector<std::string>::iterator segmentIt = segmentIDsToCompute.begin(); segmentIt != segmentIDsToCompute.end(); ++segmentIt)
   {
     segmentationCopy->CopySegmentFromSegmentation(selectedSegmentation, (*segmentIt));
   }
@@ -244,10 +457,16 @@ std::string vtkSlicerDoseVolumeHistogramModuleLogic::ComputeDvh(vtkMRMLDoseVolum
   fixedOversamplingValueStream << this->DefaultDoseVolumeOversamplingFactor;
   segmentationCopy->SetConversionParameter( vtkClosedSurfaceToBinaryLabelmapConversionRule::GetOversamplingFactorParameterName(),
     parameterNode->GetAutomaticOversampling() ? "A" : fixedOversamplingValueStream.str().c_str() );
+  // Single pass computation requires all segments to be binary labelmaps in the same oversampled dose geometry
+  bool singlePassComputation = false;
 #if Slicer_VERSION_MAJOR >= 5 || (Slicer_VERSION_MAJOR >= 4 && Slicer_VERSION_MINOR >= 11)
+  singlePassComputation = parameterNode->GetSinglePassComputation() && !parameterNode->GetUseFractionalLabelmap()
+    && !parameterNode->GetAutomaticOversampling() && !parameterNode->GetDoseSurfaceHistogram() && !parameterNode->GetExactMetrics();
   // We don't want to try to merge the labelmaps since if they have different oversampling factors, they would conflict.
-  // Could perhaps leave the labelmaps merged if there is a performance increase, but for now merging will be disabled for DVH calculation.
-  segmentationCopy->SetConversionParameter(vtkClosedSurfaceToBinaryLabelmapConversionRule::GetCollapseLabelmapsParameterName(), "0");
+  // With fixed oversampling (required for single pass computation) there is no conflict, and merging the labelmaps
+  // into shared layers reduces the number of layers that need to be traversed.
+  segmentationCopy->SetConversionParameter(vtkClosedSurfaceToBinaryLabelmapConversionRule::GetCollapseLabelmapsParameterName(),
+    singlePassComputation ? "1" : "0");
 #endif
 
   char* representationName = 0;
@@ -262,7 +481,7 @@ std::string vtkSlicerDoseVolumeHistogramModuleLogic::ComputeDvh(vtkMRMLDoseVolum
   }
 
   bool resamplingRequired = false;
-  if ( !segmentationCopy->CreateRepresentation(representationName, true) )
+  if ( !segmentIDsToCompute.empty() && !segmentationCopy->CreateRepresentation(representationName, true) )
   {
     // If conversion failed and there is no binary labelmap in the segmentation, then cannot calculate DVH
     if (!segmentationCopy->ContainsRepresentation(representationName) )
@@ -310,140 +529,171 @@ std::string vtkSlicerDoseVolumeHistogramModuleLogic::ComputeDvh(vtkMRMLDoseVolum
     }
   }
 
-  // Use the same resampled dose volume if oversampling is fixed
-  vtkSmartPointer<vtkOrientedImageData> fixedOversampledDoseVolume;
-  if (!parameterNode->GetAutomaticOversampling())
-  {
-    // Get geometry of oversampled dose volume
-    fixedOversampledDoseVolume = vtkSmartPointer<vtkOrientedImageData>::New();
-    fixedOversampledDoseVolume->ShallowCopy(doseImageData);
-    vtkCalculateOversamplingFactor::ApplyOversamplingOnImageGeometry(fixedOversampledDoseVolume, this->DefaultDoseVolumeOversamplingFactor);
+  bool isDoseVolume = vtkSlicerRtCommon::IsDoseVolumeNode(doseVolumeNode);
 
-    // Resample dose volume using linear interpolation
-    if ( !vtkOrientedImageDataResample::ResampleOrientedImageToReferenceOrientedImage(
-      doseImageData, fixedOversampledDoseVolume, fixedOversampledDoseVolume, true ) )
+  //
+  // Compute DVH for each selected segment
+  //
+  // The segment labelmaps are collected on the main thread, as applying the parent transform accesses the scene.
+  // The DVH computation itself does not access MRML, so in parallel mode it is performed for all segments
+  // concurrently, and the results are then written to the tables on the main thread in the order of the segments.
+  // In single pass mode the DVHs of all segments are computed from one traversal of the oversampled dose volume.
+  if (singlePassComputation)
+  {
+    std::vector<SegmentDvhResult> segmentResults;
+    std::vector<std::string> segmentErrorMessages;
+    std::string errorMessage = this->ComputeSegmentDvhsSinglePass(parameterNode, segmentationCopy, segmentIDsToCompute,
+      fixedOversampledDoseVolume, isDoseVolume, maxDose, segmentResults, segmentErrorMessages);
+    if (errorMessage.empty())
+    {
+      errorMessage = commitComputedAndCachedSegmentDvhs(segmentResults, segmentErrorMessages);
+    }
+    if (!errorMessage.empty())
     {
-      std::string errorMessage = vtkMRMLTr("vtkSlicerDoseVolumeHistogramModuleLogic", "Failed to resample dose volume");
       vtkErrorMacro("ComputeDvh: " << errorMessage);
       return errorMessage;
     }
   }
-
-  //
-  // Compute DVH for each selected segment
-  //
-  int counter = 1; // Start at one so that progress can reach 100%
-  int numberOfSelectedSegments = segmentationCopy->GetNumberOfSegments();
-  for (std::vector< std::string >::const_iterator segmentIdIt = segmentIDs.begin(); segmentIdIt != segmentIDs.end(); ++segmentIdIt, ++counter)
+  else
   {
-    std::string segmentID = *segmentIdIt;
-    vtkSegment* segment = segmentationCopy->GetSegment(*segmentIdIt);
+    bool parallelComputation = parameterNode->GetParallelComputation();
+    std::vector<SegmentDvhInput> segmentInputs;
+    int counter = 1; // Start at one so that progress can reach 100%
+    int numberOfSelectedSegments = static_cast<int>(segmentIDs.size());
+    for (std::vector< std::string >::const_iterator segmentIdIt = segmentIDs.begin(); segmentIdIt != segmentIDs.end(); ++segmentIdIt)
+    {
+      std::string segmentID = *segmentIdIt;
+
+      // Use DVH from the previous computation if the segment has not changed
+      std::map<std::string, SegmentDvhResult>::iterator cachedResultIt = cachedSegmentResults.find(segmentID);
+      if (cachedResultIt != cachedSegmentResults.end())
+      {
+        if (parallelComputation)
+        {
+          continue; // Committed together with the computed segments
+        }
+        std::string errorMessage = this->CommitSegmentDvh(parameterNode, cachedResultIt->second);
+        if (!errorMessage.empty())
+        {
+          vtkErrorMacro("ComputeDvh: " << errorMessage);
+          return errorMessage;
+        }
 
-    // Get segment labelmap
+        // Update progress bar
+        double progress = (double)(counter++) / (double)numberOfSelectedSegments;
+        this->InvokeEvent(vtkSlicerRtCommon::ProgressUpdated, (void*)&progress);
+        continue;
+      }
+
+      vtkSegment* segment = segmentationCopy->GetSegment(*segmentIdIt);
+
+      // Get segment labelmap
 #if Slicer_VERSION_MAJOR >= 5 || (Slicer_VERSION_MAJOR >= 4 && Slicer_VERSION_MINOR >= 11)
-    vtkSmartPointer<vtkOrientedImageData> segmentLabelmap = vtkOrientedImageData::SafeDownCast( segment->GetRepresentation(
-      representationName ) );
-    if (representationName == vtkSegmentationConverter::GetBinaryLabelmapRepresentationName())
-    {
-      vtkSmartPointer<vtkOrientedImageData> mergedLabelmap = segmentLabelmap;
-      vtkNew<vtkImageThreshold> threshold;
-      threshold->SetInputData(mergedLabelmap);
-      threshold->ThresholdBetween(segment->GetLabelValue(), segment->GetLabelValue());
-      threshold->SetInValue(1);
-      threshold->SetOutValue(0);
-      threshold->SetOutputScalarTypeToUnsignedChar();
-      threshold->Update();
-      segmentLabelmap = vtkSmartPointer<vtkOrientedImageData>::New();
-      segmentLabelmap->ShallowCopy(threshold->GetOutput());
-      segmentLabelmap->CopyDirections(mergedLabelmap);
-    }
+      vtkSmartPointer<vtkOrientedImageData> segmentLabelmap = vtkOrientedImageData::SafeDownCast( segment->GetRepresentation(
+        representationName ) );
+      if (representationName == vtkSegmentationConverter::GetBinaryLabelmapRepresentationName())
+      {
+        vtkSmartPointer<vtkOrientedImageData> mergedLabelmap = segmentLabelmap;
+        vtkNew<vtkImageThreshold> threshold;
+        threshold->SetInputData(mergedLabelmap);
+        threshold->ThresholdBetween(segment->GetLabelValue(), segment->GetLabelValue());
+        threshold->SetInValue(1);
+        threshold->SetOutValue(0);
+        threshold->SetOutputScalarTypeToUnsignedChar();
+        threshold->Update();
+        segmentLabelmap = vtkSmartPointer<vtkOrientedImageData>::New();
+        segmentLabelmap->ShallowCopy(threshold->GetOutput());
+        segmentLabelmap->CopyDirections(mergedLabelmap);
+      }
 #else
-    vtkOrientedImageData* segmentLabelmap = vtkOrientedImageData::SafeDownCast( segment->GetRepresentation(
-      representationName ) );
+      vtkOrientedImageData* segmentLabelmap = vtkOrientedImageData::SafeDownCast( segment->GetRepresentation(
+        representationName ) );
 #endif
 
-    if (!segmentLabelmap)
-    {
-      std::string errorMessage = vtkMRMLTr("vtkSlicerDoseVolumeHistogramModuleLogic", "Failed to get labelmap for segments");
-      vtkErrorMacro("ComputeDvh: " << errorMessage);
-      return errorMessage;
-    }
-
-    double minimumValue = 0.0;
-    vtkDoubleArray* scalarRange = vtkDoubleArray::SafeDownCast(
-      segmentLabelmap->GetFieldData()->GetAbstractArray(vtkSegmentationConverter::GetScalarRangeFieldName()));
-    if (scalarRange && scalarRange->GetNumberOfValues() == 2)
-    {
-      minimumValue = scalarRange->GetValue(0);
-    }
-
-    // Apply parent transformation nodes if necessary
-    if (segmentationNode->GetParentTransformNode())
-    {
-      double backgroundValue[4] = {minimumValue, minimumValue, minimumValue, 0.0};
-      if (!vtkSlicerSegmentationsModuleLogic::ApplyParentTransformToOrientedImageData(segmentationNode, segmentLabelmap, useFractionalLabelmap, backgroundValue))
+      if (!segmentLabelmap)
       {
-        std::string errorMessage = vtkMRMLTr("vtkSlicerDoseVolumeHistogramModuleLogic", "Failed to apply parent transformation to segment");
+        std::string errorMessage = vtkMRMLTr("vtkSlicerDoseVolumeHistogramModuleLogic", "Failed to get labelmap for segments");
         vtkErrorMacro("ComputeDvh: " << errorMessage);
         return errorMessage;
       }
-      resamplingRequired = true;
-    }
-    // Resample labelmap if necessary (if it was master, and could not be re-converted using the oversampled geometry, or if there was a parent transform)
-    if (resamplingRequired)
-    {
-      // Resample segmentation labelmap volume
-      if ( !vtkOrientedImageDataResample::ResampleOrientedImageToReferenceOrientedImage(
-        segmentLabelmap, fixedOversampledDoseVolume, segmentLabelmap, useFractionalLabelmap, false, nullptr, minimumValue ) )
+
+      double minimumValue = 0.0;
+      vtkDoubleArray* scalarRange = vtkDoubleArray::SafeDownCast(
+        segmentLabelmap->GetFieldData()->GetAbstractArray(vtkSegmentationConverter::GetScalarRangeFieldName()));
+      if (scalarRange && scalarRange->GetNumberOfValues() == 2)
       {
-        std::string errorMessage = vtkMRMLTr("vtkSlicerDoseVolumeHistogramModuleLogic", "Failed to resample segment binary labelmap");
-        vtkErrorMacro("ComputeDvh: " << errorMessage);
-        return errorMessage;
+        minimumValue = scalarRange->GetValue(0);
       }
-    }
 
-    // Get oversampled dose volume
-    vtkSmartPointer<vtkOrientedImageData> oversampledDoseVolume;
-    // Use the same resampled dose volume if oversampling is fixed
-    if (!parameterNode->GetAutomaticOversampling())
-    {
-      oversampledDoseVolume = fixedOversampledDoseVolume;
-    }
-    // Resample dose volume to match automatically oversampled segment labelmap geometry
-    else
-    {
-      oversampledDoseVolume = vtkSmartPointer<vtkOrientedImageData>::New();
-      if ( !vtkOrientedImageDataResample::ResampleOrientedImageToReferenceOrientedImage(
-        doseImageData, segmentLabelmap, oversampledDoseVolume, this->UseLinearInterpolationForDoseVolume ) )
+      // Apply parent transformation nodes if necessary
+      if (segmentationNode->GetParentTransformNode())
+      {
+        double backgroundValue[4] = {minimumValue, minimumValue, minimumValue, 0.0};
+        if (!vtkSlicerSegmentationsModuleLogic::ApplyParentTransformToOrientedImageData(segmentationNode, segmentLabelmap, useFractionalLabelmap, backgroundValue))
+        {
+          std::string errorMessage = vtkMRMLTr("vtkSlicerDoseVolumeHistogramModuleLogic", "Failed to apply parent transformation to segment");
+          vtkErrorMacro("ComputeDvh: " << errorMessage);
+          return errorMessage;
+        }
+        resamplingRequired = true;
+      }
+
+      SegmentDvhInput segmentInput;
+      segmentInput.SegmentID = segmentID;
+      segmentInput.Labelmap = segmentLabelmap;
+      segmentInput.MinimumValue = minimumValue;
+      segmentInput.ResamplingRequired = resamplingRequired;
+      if (parallelComputation)
+      {
+        segmentInputs.push_back(segmentInput);
+        continue;
+      }
+
+      // Calculate DVH for current segment
+      SegmentDvhResult segmentResult;
+      std::string errorMessage = this->ComputeSegmentDvh(parameterNode, segmentInput,
+        doseImageData, fixedOversampledDoseVolume, isDoseVolume, maxDose, segmentResult);
+      if (errorMessage.empty())
+      {
+        cacheSegmentDvh(segmentResult);
+        errorMessage = this->CommitSegmentDvh(parameterNode, segmentResult);
+      }
+      if (!errorMessage.empty())
       {
-        std::string errorMessage = vtkMRMLTr("vtkSlicerDoseVolumeHistogramModuleLogic", "Failed to resample dose volume");
         vtkErrorMacro("ComputeDvh: " << errorMessage);
         return errorMessage;
       }
-    }
 
-    // Make sure the segment labelmap is the same dimension as the dose volume
-    vtkSmartPointer<vtkImageConstantPad> padder = vtkSmartPointer<vtkImageConstantPad>::New();
-    padder->SetInputData(segmentLabelmap);
-    padder->SetConstant(minimumValue);
-    int extent[6] = {0,-1,0,-1,0,-1};
-    oversampledDoseVolume->GetExtent(extent);
-    padder->SetOutputWholeExtent(extent);
-    padder->Update();
-    segmentLabelmap->vtkImageData::DeepCopy(padder->GetOutput());
+      // Update progress bar
+      double progress = (double)(counter++) / (double)numberOfSelectedSegments;
+      this->InvokeEvent(vtkSlicerRtCommon::ProgressUpdated, (void*)&progress);
+    } // For each segment
 
-    // Calculate DVH for current segment
-    std::string errorMessage = this->ComputeDvh(parameterNode, segmentLabelmap, oversampledDoseVolume, segmentID, maxDose);
-    if (!errorMessage.empty())
+    if (parallelComputation)
     {
-      vtkErrorMacro("ComputeDvh: " << errorMessage);
-      return errorMessage;
-    }
+      // Compute DVH for all segments concurrently
+      std::vector<SegmentDvhResult> segmentResults(segmentInputs.size());
+      std::vector<std::string> segmentErrorMessages(segmentInputs.size());
+      auto computeSegmentDvhs = [&](vtkIdType beginIndex, vtkIdType endIndex)
+      {
+        for (vtkIdType segmentIndex = beginIndex; segmentIndex < endIndex; ++segmentIndex)
+        {
+          segmentErrorMessages[segmentIndex] = this->ComputeSegmentDvh(parameterNode, segmentInputs[segmentIndex],
+            doseImageData, fixedOversampledDoseVolume, isDoseVolume, maxDose, segmentResults[segmentIndex]);
+        }
+      };
+      // Use grain size of one, as the computation time varies greatly between segments
+      vtkSMPTools::For(0, static_cast<vtkIdType>(segmentInputs.size()), 1, computeSegmentDvhs);
 
-    // Update progress bar
-    double progress = (double)counter / (double)numberOfSelectedSegments;
-    this->InvokeEvent(vtkSlicerRtCommon::ProgressUpdated, (void*)&progress);
-  } // For each segment
+      // Write results into the tables in the order of the segments (same order as in serial computation)
+      std::string errorMessage = commitComputedAndCachedSegmentDvhs(segmentResults, segmentErrorMessages);
+      if (!errorMessage.empty())
+      {
+        vtkErrorMacro("ComputeDvh: " << errorMessage);
+        return errorMessage;
+      }
+    }
+  }
 
   // Fire only one modified event when the computation is done
   this->SetDisableModifiedEvent(0);
@@ -459,49 +709,84 @@ std::string vtkSlicerDoseVolumeHistogramModuleLogic::ComputeDvh(vtkMRMLDoseVolum
 }
 
 //---------------------------------------------------------------------------
-std::string vtkSlicerDoseVolumeHistogramModuleLogic::ComputeDvh(vtkMRMLDoseVolumeHistogramNode* parameterNode, vtkOrientedImageData* segmentLabelmap, vtkOrientedImageData* oversampledDoseVolume, std::string segmentID, double maxDoseGy)
+std::string vtkSlicerDoseVolumeHistogramModuleLogic::ComputeSegmentDvh(
+  vtkMRMLDoseVolumeHistogramNode* parameterNode, const SegmentDvhInput& segmentInput,
+  vtkOrientedImageData* doseVolume, vtkOrientedImageData* fixedOversampledDoseVolume,
+  bool isDoseVolume, double maxDoseGy, SegmentDvhResult& result)
 {
-  if (!this->GetMRMLScene() || !parameterNode)
+  // Note: This function may be called from worker threads, so errors are only reported through the return value
+  if (!parameterNode)
   {
-    std::string errorMessage = vtkMRMLTr("vtkSlicerDoseVolumeHistogramModuleLogic", "Invalid MRML scene or parameter set node");
-    vtkErrorMacro("ComputeDvh: " << errorMessage);
-    return errorMessage;
+    return vtkMRMLTr("vtkSlicerDoseVolumeHistogramModuleLogic", "Invalid parameter set node");
   }
-  if (!segmentLabelmap)
+  if (!segmentInput.Labelmap)
   {
-    std::string errorMessage = vtkMRMLTr("vtkSlicerDoseVolumeHistogramModuleLogic", "Invalid segment labelmap");
-    vtkErrorMacro("ComputeDvh: " << errorMessage);
-    return errorMessage;
+    return vtkMRMLTr("vtkSlicerDoseVolumeHistogramModuleLogic", "Invalid segment labelmap");
   }
-  if (!oversampledDoseVolume)
-  {
-    std::string errorMessage = vtkMRMLTr("vtkSlicerDoseVolumeHistogramModuleLogic", "Invalid oversampled dose volume");
-    vtkErrorMacro("ComputeDvh: " << errorMessage);
-    return errorMessage;
-  }
-  vtkMRMLSegmentationNode* segmentationNode = parameterNode->GetSegmentationNode();
-  vtkMRMLScalarVolumeNode* doseVolumeNode = parameterNode->GetDoseVolumeNode();
-  if ( !segmentationNode || !doseVolumeNode )
+  if (!doseVolume)
   {
-    std::string errorMessage = vtkMRMLTr("vtkSlicerDoseVolumeHistogramModuleLogic", "Both segmentation node and dose volume node need to be set");
-    vtkErrorMacro("ComputeDvh: " << errorMessage);
-    return errorMessage;
+    return vtkMRMLTr("vtkSlicerDoseVolumeHistogramModuleLogic", "Invalid dose volume");
   }
-  std::string segmentName = parameterNode->GetSegmentationNode()->GetSegmentation()->GetSegment(segmentID)->GetName();
-  bool isDoseVolume = vtkSlicerRtCommon::IsDoseVolumeNode(doseVolumeNode);
 
   vtkSmartPointer<vtkTimerLog> timer = vtkSmartPointer<vtkTimerLog>::New();
   double checkpointStart = timer->GetUniversalTime();
-  UNUSED_VARIABLE(checkpointStart); // Although it is used later, a warning is logged so needs to be suppressed
+
+  result.SegmentID = segmentInput.SegmentID;
+  bool useFractionalLabelmap = parameterNode->GetUseFractionalLabelmap();
+  double minimumValue = segmentInput.MinimumValue;
+
+  // Work on shallow copies of the input images, so that the inputs are not modified, and so that
+  // pipelines executed concurrently for different segments do not share any data objects
+  vtkSmartPointer<vtkOrientedImageData> segmentLabelmap = vtkSmartPointer<vtkOrientedImageData>::New();
+  segmentLabelmap->ShallowCopy(segmentInput.Labelmap);
+  vtkSmartPointer<vtkOrientedImageData> oversampledDoseVolume;
+  if (fixedOversampledDoseVolume)
+  {
+    // Use the same resampled dose volume if oversampling is fixed
+    oversampledDoseVolume = vtkSmartPointer<vtkOrientedImageData>::New();
+    oversampledDoseVolume->ShallowCopy(fixedOversampledDoseVolume);
+  }
+
+  // Resample labelmap if necessary (if it was master, and could not be re-converted using the oversampled geometry, or if there was a parent transform)
+  if (segmentInput.ResamplingRequired)
+  {
+    // Resample segmentation labelmap volume
+    if ( !vtkOrientedImageDataResample::ResampleOrientedImageToReferenceOrientedImage(
+      segmentLabelmap, oversampledDoseVolume, segmentLabelmap, useFractionalLabelmap, false, nullptr, minimumValue ) )
+    {
+      return vtkMRMLTr("vtkSlicerDoseVolumeHistogramModuleLogic", "Failed to resample segment binary labelmap");
+    }
+  }
+
+  // Resample dose volume to match automatically oversampled segment labelmap geometry
+  if (!oversampledDoseVolume)
+  {
+    vtkSmartPointer<vtkOrientedImageData> doseVolumeCopy = vtkSmartPointer<vtkOrientedImageData>::New();
+    doseVolumeCopy->ShallowCopy(doseVolume);
+    oversampledDoseVolume = vtkSmartPointer<vtkOrientedImageData>::New();
+    if ( !vtkOrientedImageDataResample::ResampleOrientedImageToReferenceOrientedImage(
+      doseVolumeCopy, segmentLabelmap, oversampledDoseVolume, this->UseLinearInterpolationForDoseVolume ) )
+    {
+      return vtkMRMLTr("vtkSlicerDoseVolumeHistogramModuleLogic", "Failed to resample dose volume");
+    }
+  }
+
+  // Make sure the segment labelmap is the same dimension as the dose volume
+  vtkSmartPointer<vtkImageConstantPad> padder = vtkSmartPointer<vtkImageConstantPad>::New();
+  padder->SetInputData(segmentLabelmap);
+  padder->SetConstant(minimumValue);
+  int extent[6] = {0,-1,0,-1,0,-1};
+  oversampledDoseVolume->GetExtent(extent);
+  padder->SetOutputWholeExtent(extent);
+  padder->Update();
+  segmentLabelmap->vtkImageData::DeepCopy(padder->GetOutput());
 
   // If the user has enabled the flag to calculate the dose surface histogram, then extract the surface from the labelmap
   if (parameterNode->GetDoseSurfaceHistogram())
   {
-    if (parameterNode->GetUseFractionalLabelmap())
+    if (useFractionalLabelmap)
     {
-      std::string errorMessage = vtkMRMLTr("vtkSlicerDoseVolumeHistogramModuleLogic", "Dose surface histogram is not currently supported for fractional labelmaps");
-      vtkErrorMacro("ComputeDvh: " << errorMessage);
-      return errorMessage;
+      return vtkMRMLTr("vtkSlicerDoseVolumeHistogramModuleLogic", "Dose surface histogram is not currently supported for fractional labelmaps");
     }
 
     double dilateValue = 0.0;
@@ -545,9 +830,8 @@ std::string vtkSlicerDoseVolumeHistogramModuleLogic::ComputeDvh(vtkMRMLDoseVolum
   // So, we have to choose >=epsilon (epsilon is a very small positive number).
   // How small the number is has a significance when the segmentLabelmap is a floating-point image,
   // which is a rare scenario, but may still happen.
-  double minimumValue = 0.0;
   double maximumValue = 1.0;
-  segmentLabelmap->GetFieldData();
+  minimumValue = 0.0;
   vtkDoubleArray* scalarRange = vtkDoubleArray::SafeDownCast(
     segmentLabelmap->GetFieldData()->GetAbstractArray( vtkSegmentationConverter::GetScalarRangeFieldName() )
     );
@@ -557,7 +841,6 @@ std::string vtkSlicerDoseVolumeHistogramModuleLogic::ComputeDvh(vtkMRMLDoseVolum
     maximumValue = scalarRange->GetValue(1);
   }
 
-  bool useFractionalLabelmap = parameterNode->GetUseFractionalLabelmap();
   if (useFractionalLabelmap)
   {
     stencil->ThresholdByUpper(minimumValue + 1e-10);
@@ -575,9 +858,7 @@ std::string vtkSlicerDoseVolumeHistogramModuleLogic::ComputeDvh(vtkMRMLDoseVolum
   structureStencil->GetExtent(stencilExtent);
   if (stencilExtent[1]-stencilExtent[0] <= 0 || stencilExtent[3]-stencilExtent[2] <= 0 || stencilExtent[5]-stencilExtent[4] <= 0)
   {
-    std::string errorMessage = vtkMRMLTr("vtkSlicerDoseVolumeHistogramModuleLogic", "Invalid stenciled dose volume");
-    vtkErrorMacro("ComputeDvh: " << errorMessage);
-    return errorMessage;
+    return vtkMRMLTr("vtkSlicerDoseVolumeHistogramModuleLogic", "Invalid stenciled dose volume");
   }
 
   // Compute statistics
@@ -601,11 +882,170 @@ std::string vtkSlicerDoseVolumeHistogramModuleLogic::ComputeDvh(vtkMRMLDoseVolum
   // Report error if there are no voxels in the stenciled dose volume (no non-zero voxels in the resampled labelmap)
   if (structureStat->GetVoxelCount() < 1)
   {
-    std::string errorMessage = vtkMRMLTr("vtkSlicerDoseVolumeHistogramModuleLogic", "Dose volume and the structure do not overlap"); // User-friendly error to help troubleshooting
-    vtkErrorMacro("ComputeDvh: " << errorMessage);
+    return vtkMRMLTr("vtkSlicerDoseVolumeHistogramModuleLogic", "Dose volume and the structure do not overlap"); // User-friendly error to help troubleshooting
+  }
+
+  // Get spacing and voxel volume
+  double* segmentLabelmapSpacing = segmentLabelmap->GetSpacing();
+  double cubicMMPerVoxel = segmentLabelmapSpacing[0] * segmentLabelmapSpacing[1] * segmentLabelmapSpacing[2];
+  double ccPerCubicMM = 0.001;
+
+  // Volume (cc), mean, min and max dose
+  double totalVoxels = 0;
+  if (useFractionalLabelmap)
+  {
+    totalVoxels = vtkFractionalImageAccumulate::SafeDownCast(structureStat)->GetFractionalVoxelCount();
+  }
+  else
+  {
+    totalVoxels = structureStat->GetVoxelCount();
+  }
+  result.VolumeCc = totalVoxels * cubicMMPerVoxel * ccPerCubicMM;
+  result.MeanDose = structureStat->GetMean()[0];
+  result.MinDose = structureStat->GetMin()[0];
+  result.MaxDose = structureStat->GetMax()[0];
+
+  // Create DVH plot values
+  int numSamples = 0;
+  double startValue = 0.0;
+  double stepSize = 0.0;
+  std::string errorMessage = this->CalculateDvhBins(isDoseVolume, maxDoseGy,
+    structureStat->GetMin()[0], structureStat->GetMax()[0], startValue, stepSize, numSamples);
+  if (!errorMessage.empty())
+  {
     return errorMessage;
   }
 
+  // Get the number of voxels with smaller dose than at the start value
+  structureStat->SetComponentExtent(0,1,0,0,0,0);
+  structureStat->SetComponentOrigin(0,0,0);
+  structureStat->SetComponentSpacing(startValue,1,1);
+  structureStat->Update();
+  double voxelBelowDose = structureStat->GetOutput()->GetScalarComponentAsDouble(0,0,0,0);
+
+  structureStat->SetComponentExtent(0,numSamples-1,0,0,0,0);
+  structureStat->SetComponentOrigin(startValue,0,0);
+  structureStat->SetComponentSpacing(stepSize,1,1);
+  structureStat->Update();
+
+  std::vector<double> binCounts(numSamples, 0.0);
+  vtkImageData* statArray = structureStat->GetOutput();
+  for (int sampleIndex=0; sampleIndex<numSamples; ++sampleIndex)
+  {
+    binCounts[sampleIndex] = statArray->GetScalarComponentAsDouble(sampleIndex,0,0,0);
+  }
+
+  this->CalculateDvhValues(isDoseVolume, useFractionalLabelmap, startValue, stepSize, voxelBelowDose, binCounts, totalVoxels, result);
+
+  // Keep sorted voxel doses for exact metrics
+  if (parameterNode->GetExactMetrics())
+  {
+    result.DoseDistribution = vtkSmartPointer<vtkDoseValueDistribution>::New();
+    if ( !result.DoseDistribution->ComputeFromImage(oversampledDoseVolume, structureStencil,
+      (useFractionalLabelmap ? segmentLabelmap.GetPointer() : nullptr), minimumValue, maximumValue) )
+    {
+      return vtkMRMLTr("vtkSlicerDoseVolumeHistogramModuleLogic", "Failed to sort voxel doses for exact metrics");
+    }
+  }
+
+  result.ComputationTime = timer->GetUniversalTime() - checkpointStart;
+  return ""; // No error
+}
+
+//---------------------------------------------------------------------------
+std::string vtkSlicerDoseVolumeHistogramModuleLogic::CalculateDvhBins(bool isDoseVolume, double maxDoseGy, double rangeMin, double rangeMax,
+  double& startValue, double& stepSize, int& numberOfSamples)
+{
+  if (isDoseVolume)
+  {
+    if (rangeMin<0)
+    {
+      return vtkMRMLTr("vtkSlicerDoseVolumeHistogramModuleLogic", "The dose volume contains negative dose values");
+    }
+
+    startValue = this->StartValue;
+    stepSize = this->StepSize;
+    numberOfSamples = (int)ceil( (maxDoseGy-startValue)/stepSize ) + 1;
+  }
+  else
+  {
+    startValue = rangeMin;
+    numberOfSamples = this->NumberOfSamplesForNonDoseVolumes;
+    stepSize = (rangeMax - rangeMin) / (double)(numberOfSamples-1);
+  }
+  return ""; // No error
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerDoseVolumeHistogramModuleLogic::CalculateDvhValues(bool isDoseVolume, bool clampVolumes, double startValue, double stepSize,
+  double voxelsBelowStartValue, const std::vector<double>& binCounts, double totalVoxels, SegmentDvhResult& result)
+{
+  // We put a fixed point at (0.0, 100%), but only if there are only positive values in the histogram
+  // Negative values can occur when the user requests histogram for an image, such as s CT volume (in
+  // this case Intensity Volume Histogram is computed), or the startValue became negative for the dose
+  // volume because the range minimum was smaller than the original start value.
+  bool insertPointAtOrigin = true;
+  if (startValue < 0.0)
+  {
+    insertPointAtOrigin = false;
+  }
+
+  int numSamples = static_cast<int>(binCounts.size());
+  result.DoseValues.clear();
+  result.VolumePercentValues.clear();
+  result.DoseValues.reserve(numSamples + 1);
+  result.VolumePercentValues.reserve(numSamples + 1);
+
+  if (insertPointAtOrigin)
+  {
+    // Add first fixed point at (0.0, 100%)
+    result.DoseValues.push_back(0.0);
+    result.VolumePercentValues.push_back(100.0);
+  }
+
+  double voxelBelowDose = voxelsBelowStartValue;
+  for (int sampleIndex=0; sampleIndex<numSamples; ++sampleIndex)
+  {
+    result.DoseValues.push_back(startValue + sampleIndex * stepSize);
+    if (clampVolumes)
+    {
+      result.VolumePercentValues.push_back(std::max(0.0, (1.0-(double)voxelBelowDose/(double)totalVoxels)*100.0));
+    }
+    else
+    {
+      result.VolumePercentValues.push_back((1.0-(double)voxelBelowDose/(double)totalVoxels)*100.0);
+    }
+    voxelBelowDose += binCounts[sampleIndex];
+  }
+
+  // Set the start of the first bin to 0 if the volume contains dose and the start value was negative
+  if (isDoseVolume && !insertPointAtOrigin && !result.DoseValues.empty())
+  {
+    result.DoseValues[0] = 0.0;
+  }
+}
+
+//---------------------------------------------------------------------------
+std::string vtkSlicerDoseVolumeHistogramModuleLogic::CommitSegmentDvh(vtkMRMLDoseVolumeHistogramNode* parameterNode, const SegmentDvhResult& result)
+{
+  if (!this->GetMRMLScene() || !parameterNode)
+  {
+    std::string errorMessage = vtkMRMLTr("vtkSlicerDoseVolumeHistogramModuleLogic", "Invalid MRML scene or parameter set node");
+    vtkErrorMacro("CommitSegmentDvh: " << errorMessage);
+    return errorMessage;
+  }
+  vtkMRMLSegmentationNode* segmentationNode = parameterNode->GetSegmentationNode();
+  vtkMRMLScalarVolumeNode* doseVolumeNode = parameterNode->GetDoseVolumeNode();
+  if ( !segmentationNode || !doseVolumeNode )
+  {
+    std::string errorMessage = vtkMRMLTr("vtkSlicerDoseVolumeHistogramModuleLogic", "Both segmentation node and dose volume node need to be set");
+    vtkErrorMacro("CommitSegmentDvh: " << errorMessage);
+    return errorMessage;
+  }
+  std::string segmentID = result.SegmentID;
+  std::string segmentName = segmentationNode->GetSegmentation()->GetSegment(segmentID)->GetName();
+  bool isDoseVolume = vtkSlicerRtCommon::IsDoseVolumeNode(doseVolumeNode);
+
   // Get metrics table for the parameter node; Create one if missing
   vtkMRMLTableNode* metricsTableNode = parameterNode->GetMetricsTableNode();
   vtkTable* metricsTable = metricsTableNode->GetTable();
@@ -642,215 +1082,555 @@ std::string vtkSlicerDoseVolumeHistogramModuleLogic::ComputeDvh(vtkMRMLDoseVolum
     tableNode->Delete(); // Release ownership to scene only
     metricsTable->InsertNextBlankRow();
 
-    // Dose surface histogram attributes
-    if (parameterNode->GetDoseSurfaceHistogram())
+    // Dose surface histogram attributes
+    if (parameterNode->GetDoseSurfaceHistogram())
+    {
+      tableNode->SetAttribute(DVH_SURFACE_ATTRIBUTE_NAME.c_str(), "1");
+      tableNode->SetAttribute(DVH_SURFACE_INSIDE_ATTRIBUTE_NAME.c_str(), parameterNode->GetUseInsideDoseSurface() ? "1" : "0");
+    }
+
+    // Set node references
+    metricsTableNode->SetNodeReferenceID(structureDvhNodeRef.c_str(), tableNode->GetID());
+    tableNode->SetNodeReferenceID(vtkMRMLDoseVolumeHistogramNode::DOSE_VOLUME_REFERENCE_ROLE, doseVolumeNode->GetID());
+    tableNode->SetNodeReferenceID(vtkMRMLDoseVolumeHistogramNode::SEGMENTATION_REFERENCE_ROLE, segmentationNode->GetID());
+    tableNode->SetNodeReferenceID(vtkMRMLDoseVolumeHistogramNode::DVH_METRICS_TABLE_REFERENCE_ROLE, metricsTableNode->GetID());
+  }
+  else if (tableNode->GetAttribute(DVH_TABLE_ROW_ATTRIBUTE_NAME.c_str()))
+  {
+    tableRow = vtkVariant(tableNode->GetAttribute(DVH_TABLE_ROW_ATTRIBUTE_NAME.c_str())).ToInt();
+  }
+  else
+  {
+    std::string errorMessage = vtkMRMLTr("vtkSlicerDoseVolumeHistogramModuleLogic", "Failed to find metrics table row for structure ") + segmentName;
+    vtkErrorMacro("CommitSegmentDvh: " << errorMessage);
+    return errorMessage;
+  }
+
+  // Set table node attributes:
+  // Structure name and segment color for visualization in the chart view
+  tableNode->SetAttribute(DVH_SEGMENT_ID_ATTRIBUTE_NAME.c_str(), segmentID.c_str());
+  // Oversampling factor
+  std::ostringstream oversamplingAttrValueStream;
+  oversamplingAttrValueStream << (parameterNode->GetAutomaticOversampling() ? (-1.0) : this->DefaultDoseVolumeOversamplingFactor);
+  tableNode->SetAttribute(DVH_DOSE_VOLUME_OVERSAMPLING_FACTOR_ATTRIBUTE_NAME.c_str(), oversamplingAttrValueStream.str().c_str());
+
+  // Set default column values
+
+  // Structure name
+  metricsTable->SetValue(tableRow, vtkMRMLDoseVolumeHistogramNode::MetricColumnStructure, vtkVariant(segmentName));
+  // Volume name
+  metricsTable->SetValue(tableRow, vtkMRMLDoseVolumeHistogramNode::MetricColumnDoseVolume, vtkVariant(doseVolumeNode->GetName()));
+  // Volume (cc) - save as attribute too (the DVH contains percentages that often need to be converted to volume)
+  metricsTable->SetValue(tableRow, vtkMRMLDoseVolumeHistogramNode::MetricColumnVolumeCc, vtkVariant(result.VolumeCc));
+  std::ostringstream attributeNameStream;
+  std::ostringstream attributeValueStream;
+  attributeNameStream << vtkMRMLDoseVolumeHistogramNode::DVH_ATTRIBUTE_PREFIX << vtkSlicerDoseVolumeHistogramModuleLogic::DVH_METRIC_TOTAL_VOLUME_CC;
+  attributeValueStream << result.VolumeCc;
+  tableNode->SetAttribute(attributeNameStream.str().c_str(), attributeValueStream.str().c_str());
+  // Mean dose
+  metricsTable->SetValue(tableRow, vtkMRMLDoseVolumeHistogramNode::MetricColumnMeanDose, vtkVariant(result.MeanDose));
+  // Min dose
+  metricsTable->SetValue(tableRow, vtkMRMLDoseVolumeHistogramNode::MetricColumnMinDose, vtkVariant(result.MinDose));
+  // Max dose
+  metricsTable->SetValue(tableRow, vtkMRMLDoseVolumeHistogramNode::MetricColumnMaxDose, vtkVariant(result.MaxDose));
+
+  // Allocate table
+  vtkTable* table = tableNode->GetTable();
+  int numberOfRows = static_cast<int>(result.DoseValues.size());
+  vtkNew<vtkDoubleArray> columnDose;
+  // no tr (column name is used as a lookup key in SetXColumnName/SetYColumnName below;
+  // it must stay stable regardless of UI language)
+  columnDose->SetName(isDoseVolume ? /*no tr*/ "Dose" : /*no tr*/ "Intensity");
+  columnDose->SetNumberOfTuples(numberOfRows);
+  table->AddColumn(columnDose);
+  vtkNew<vtkDoubleArray> columnVolume;
+  columnVolume->SetName(/*no tr*/ "Volume");
+  columnVolume->SetNumberOfTuples(numberOfRows);
+  table->AddColumn(columnVolume);
+  table->SetNumberOfRows(numberOfRows);
+
+  for (int rowIndex=0; rowIndex<numberOfRows; ++rowIndex)
+  {
+    table->SetValue(rowIndex, 0, result.DoseValues[rowIndex]);
+    table->SetValue(rowIndex, 1, result.VolumePercentValues[rowIndex]);
+    table->SetValue(rowIndex, 2, 0);
+  }
+
+  // Setup DVH subject hierarchy items
+  vtkMRMLSubjectHierarchyNode* shNode = vtkMRMLSubjectHierarchyNode::GetSubjectHierarchyNode(this->GetMRMLScene());
+  if (!shNode)
+  {
+    std::string errorMessage = vtkMRMLTr("vtkSlicerDoseVolumeHistogramModuleLogic", "Failed to access subject hierarchy node");
+    vtkErrorMacro("CommitSegmentDvh: " << errorMessage);
+    return errorMessage;
+  }
+  vtkIdType doseShItemID = shNode->GetItemByDataNode(doseVolumeNode);
+
+  // Add metrics table and chart to under the study of the dose in subject hierarchy
+  vtkIdType studyItemID = shNode->GetItemAncestorAtLevel(doseShItemID, vtkMRMLSubjectHierarchyConstants::GetDICOMLevelStudy());
+  if (studyItemID != vtkMRMLSubjectHierarchyNode::INVALID_ITEM_ID)
+  {
+    vtkIdType metricsShItemID = shNode->CreateItem(studyItemID, metricsTableNode);
+    shNode->CreateItem(metricsShItemID, tableNode);
+
+    vtkMRMLPlotChartNode* chartNode = parameterNode->GetChartNode();
+    shNode->CreateItem(studyItemID, chartNode);
+  }
+
+  // Store sorted voxel doses for exact metrics
+  if (result.DoseDistribution)
+  {
+    this->DoseDistributions[tableNode->GetID()] = result.DoseDistribution;
+  }
+  else
+  {
+    this->DoseDistributions.erase(tableNode->GetID());
+  }
+
+  // Add connection attribute to input segmentation and dose volume nodes
+  segmentationNode->AddNodeReferenceID(DVH_CREATED_DVH_NODE_REFERENCE_ROLE.c_str(), tableNode->GetID());
+  doseVolumeNode->AddNodeReferenceID(DVH_CREATED_DVH_NODE_REFERENCE_ROLE.c_str(), tableNode->GetID());
+
+  // Log measured time
+  if (this->LogSpeedMeasurements)
+  {
+    vtkDebugMacro("CommitSegmentDvh: DVH computation time for structure '" << segmentID << "': " << result.ComputationTime << " s");
+  }
+
+  return ""; // No error
+}
+
+//---------------------------------------------------------------------------
+std::string vtkSlicerDoseVolumeHistogramModuleLogic::CommitSegmentDvhs(vtkMRMLDoseVolumeHistogramNode* parameterNode,
+  const std::vector<SegmentDvhResult>& results, const std::vector<std::string>& errorMessages)
+{
+  int numberOfSegments = static_cast<int>(results.size());
+  for (int segmentIndex = 0; segmentIndex < numberOfSegments; ++segmentIndex)
+  {
+    std::string errorMessage = (segmentIndex < static_cast<int>(errorMessages.size()) ? errorMessages[segmentIndex] : std::string());
+    if (errorMessage.empty())
+    {
+      errorMessage = this->CommitSegmentDvh(parameterNode, results[segmentIndex]);
+    }
+    if (!errorMessage.empty())
+    {
+      return errorMessage;
+    }
+
+    // Update progress bar
+    double progress = (double)(segmentIndex + 1) / (double)numberOfSegments;
+    this->InvokeEvent(vtkSlicerRtCommon::ProgressUpdated, (void*)&progress);
+  }
+
+  return "";
+}
+
+//---------------------------------------------------------------------------
+std::string vtkSlicerDoseVolumeHistogramModuleLogic::ComputeSegmentDvhsSinglePass(
+  vtkMRMLDoseVolumeHistogramNode* parameterNode, vtkSegmentation* segmentation, const std::vector<std::string>& segmentIDs,
+  vtkOrientedImageData* oversampledDoseVolume, bool isDoseVolume, double maxDoseGy,
+  std::vector<SegmentDvhResult>& results, std::vector<std::string>& errorMessages)
+{
+  if (!parameterNode || !segmentation || !oversampledDoseVolume)
+  {
+    return vtkMRMLTr("vtkSlicerDoseVolumeHistogramModuleLogic", "Invalid input for single pass DVH computation");
+  }
+
+  vtkSmartPointer<vtkTimerLog> timer = vtkSmartPointer<vtkTimerLog>::New();
+  double checkpointStart = timer->GetUniversalTime();
+
+  // The stencils of the individual segments would have the extent of the oversampled dose volume
+  int doseExtent[6] = {0,-1,0,-1,0,-1};
+  oversampledDoseVolume->GetExtent(doseExtent);
+  if (doseExtent[1]-doseExtent[0] <= 0 || doseExtent[3]-doseExtent[2] <= 0 || doseExtent[5]-doseExtent[4] <= 0)
+  {
+    return vtkMRMLTr("vtkSlicerDoseVolumeHistogramModuleLogic", "Invalid stenciled dose volume");
+  }
+
+  // Add segments. Transform and resample each shared labelmap layer only once
+  std::vector<vtkSmartPointer<vtkOrientedImageData> > segmentLayers;
+  std::string errorMessage = this->GetSegmentLabelmapLayersInGeometry(
+    parameterNode->GetSegmentationNode(), segmentation, segmentIDs, oversampledDoseVolume, segmentLayers);
+  if (!errorMessage.empty())
+  {
+    return errorMessage;
+  }
+  vtkNew<vtkMultiSegmentImageAccumulate> segmentStat;
+  segmentStat->SetInputImage(oversampledDoseVolume);
+  for (size_t segmentIndex = 0; segmentIndex < segmentIDs.size(); ++segmentIndex)
+  {
+    vtkSegment* segment = segmentation->GetSegment(segmentIDs[segmentIndex]);
+    if (segmentStat->AddSegment(segmentLayers[segmentIndex], segment->GetLabelValue()) < 0)
+    {
+      return vtkMRMLTr("vtkSlicerDoseVolumeHistogramModuleLogic", "Failed to add segment to DVH computation");
+    }
+  }
+
+  int numberOfSegments = segmentStat->GetNumberOfSegments();
+  results.assign(numberOfSegments, SegmentDvhResult());
+  errorMessages.assign(numberOfSegments, std::string());
+  std::vector<double> startValues(numberOfSegments, 0.0);
+  std::vector<double> stepSizes(numberOfSegments, 0.0);
+  std::vector<int> numbersOfSamples(numberOfSegments, 0);
+
+  // The DVH bins of dose volumes do not depend on the segment, so the histograms can be computed in the same
+  // pass as the statistics. For other volumes the bins depend on the value range, so a second pass is needed.
+  if (isDoseVolume)
+  {
+    double startValue = 0.0;
+    double stepSize = 0.0;
+    int numSamples = 0;
+    this->CalculateDvhBins(isDoseVolume, maxDoseGy, 0.0, maxDoseGy, startValue, stepSize, numSamples);
+    for (int segmentIndex = 0; segmentIndex < numberOfSegments; ++segmentIndex)
+    {
+      segmentStat->SetSegmentBins(segmentIndex, startValue, stepSize, numSamples);
+    }
+  }
+  if (!segmentStat->Update())
+  {
+    return vtkMRMLTr("vtkSlicerDoseVolumeHistogramModuleLogic", "Failed to compute segment statistics");
+  }
+
+  double* doseSpacing = oversampledDoseVolume->GetSpacing();
+  double cubicMMPerVoxel = doseSpacing[0] * doseSpacing[1] * doseSpacing[2];
+  double ccPerCubicMM = 0.001;
+  for (int segmentIndex = 0; segmentIndex < numberOfSegments; ++segmentIndex)
+  {
+    SegmentDvhResult& result = results[segmentIndex];
+    result.SegmentID = segmentIDs[segmentIndex];
+
+    // Report error if there are no voxels in the stenciled dose volume (no non-zero voxels in the resampled labelmap)
+    if (segmentStat->GetSegmentVoxelCount(segmentIndex) < 1)
+    {
+      errorMessages[segmentIndex] = vtkMRMLTr("vtkSlicerDoseVolumeHistogramModuleLogic", "Dose volume and the structure do not overlap");
+      continue;
+    }
+
+    result.VolumeCc = segmentStat->GetSegmentVoxelCount(segmentIndex) * cubicMMPerVoxel * ccPerCubicMM;
+    result.MeanDose = segmentStat->GetSegmentMean(segmentIndex);
+    result.MinDose = segmentStat->GetSegmentMin(segmentIndex);
+    result.MaxDose = segmentStat->GetSegmentMax(segmentIndex);
+
+    errorMessages[segmentIndex] = this->CalculateDvhBins(isDoseVolume, maxDoseGy, result.MinDose, result.MaxDose,
+      startValues[segmentIndex], stepSizes[segmentIndex], numbersOfSamples[segmentIndex]);
+    if (!isDoseVolume && errorMessages[segmentIndex].empty())
+    {
+      segmentStat->SetSegmentBins(segmentIndex, startValues[segmentIndex], stepSizes[segmentIndex], numbersOfSamples[segmentIndex]);
+    }
+  }
+  if (!isDoseVolume && !segmentStat->Update())
+  {
+    return vtkMRMLTr("vtkSlicerDoseVolumeHistogramModuleLogic", "Failed to compute segment statistics");
+  }
+
+  // Create DVH plot values
+  for (int segmentIndex = 0; segmentIndex < numberOfSegments; ++segmentIndex)
+  {
+    if (!errorMessages[segmentIndex].empty())
     {
-      tableNode->SetAttribute(DVH_SURFACE_ATTRIBUTE_NAME.c_str(), "1");
-      tableNode->SetAttribute(DVH_SURFACE_INSIDE_ATTRIBUTE_NAME.c_str(), parameterNode->GetUseInsideDoseSurface() ? "1" : "0");
+      continue;
+    }
+    std::vector<double> binCounts(numbersOfSamples[segmentIndex], 0.0);
+    for (int sampleIndex=0; sampleIndex<numbersOfSamples[segmentIndex]; ++sampleIndex)
+    {
+      binCounts[sampleIndex] = segmentStat->GetSegmentBinCount(segmentIndex, sampleIndex);
     }
+    this->CalculateDvhValues(isDoseVolume, false, startValues[segmentIndex], stepSizes[segmentIndex],
+      segmentStat->GetSegmentVoxelCountBelowOrigin(segmentIndex), binCounts,
+      (double)segmentStat->GetSegmentVoxelCount(segmentIndex), results[segmentIndex]);
+  }
 
-    // Set node references
-    metricsTableNode->SetNodeReferenceID(structureDvhNodeRef.c_str(), tableNode->GetID());
-    tableNode->SetNodeReferenceID(vtkMRMLDoseVolumeHistogramNode::DOSE_VOLUME_REFERENCE_ROLE, doseVolumeNode->GetID());
-    tableNode->SetNodeReferenceID(vtkMRMLDoseVolumeHistogramNode::SEGMENTATION_REFERENCE_ROLE, segmentationNode->GetID());
-    tableNode->SetNodeReferenceID(vtkMRMLDoseVolumeHistogramNode::DVH_METRICS_TABLE_REFERENCE_ROLE, metricsTableNode->GetID());
+  // The segments are computed together, so the computation time is distributed evenly among them
+  double computationTime = timer->GetUniversalTime() - checkpointStart;
+  for (int segmentIndex = 0; segmentIndex < numberOfSegments; ++segmentIndex)
+  {
+    results[segmentIndex].ComputationTime = computationTime / numberOfSegments;
   }
-  else if (tableNode->GetAttribute(DVH_TABLE_ROW_ATTRIBUTE_NAME.c_str()))
+
+  return "";
+}
+
+//---------------------------------------------------------------------------
+std::string vtkSlicerDoseVolumeHistogramModuleLogic::StartIncrementalDvh(vtkMRMLDoseVolumeHistogramNode* parameterNode)
+{
+  this->IncrementalDvh = IncrementalDvhState();
+  if (!this->GetMRMLScene() || !parameterNode)
   {
-    tableRow = vtkVariant(tableNode->GetAttribute(DVH_TABLE_ROW_ATTRIBUTE_NAME.c_str())).ToInt();
+    std::string errorMessage = vtkMRMLTr("vtkSlicerDoseVolumeHistogramModuleLogic", "Invalid MRML scene or parameter set node");
+    vtkErrorMacro("StartIncrementalDvh: " << errorMessage);
+    return errorMessage;
   }
-  else
+  vtkMRMLSegmentationNode* segmentationNode = parameterNode->GetSegmentationNode();
+  vtkMRMLScalarVolumeNode* doseVolumeNode = parameterNode->GetDoseVolumeNode();
+  if ( !segmentationNode || !doseVolumeNode )
   {
-    std::string errorMessage = vtkMRMLTr("vtkSlicerDoseVolumeHistogramModuleLogic", "Failed to find metrics table row for structure ") + segmentName;
-    vtkErrorMacro("ComputeDvh: " << errorMessage);
+    std::string errorMessage = vtkMRMLTr("vtkSlicerDoseVolumeHistogramModuleLogic", "Both segmentation node and dose volume node need to be set");
+    vtkErrorMacro("StartIncrementalDvh: " << errorMessage);
+    return errorMessage;
+  }
+  if ( parameterNode->GetAutomaticOversampling() || parameterNode->GetUseFractionalLabelmap()
+    || parameterNode->GetDoseSurfaceHistogram() )
+  {
+    std::string errorMessage = vtkMRMLTr("vtkSlicerDoseVolumeHistogramModuleLogic",
+      "Incremental DVH computation requires fixed oversampling and binary labelmaps, and does not support dose surface histograms");
+    vtkErrorMacro("StartIncrementalDvh: " << errorMessage);
     return errorMessage;
   }
 
-  // Set table node attributes:
-  // Structure name and segment color for visualization in the chart view
-  tableNode->SetAttribute(DVH_SEGMENT_ID_ATTRIBUTE_NAME.c_str(), segmentID.c_str());
-  // Oversampling factor
-  std::ostringstream oversamplingAttrValueStream;
-  oversamplingAttrValueStream << (parameterNode->GetAutomaticOversampling() ? (-1.0) : this->DefaultDoseVolumeOversamplingFactor);
-  tableNode->SetAttribute(DVH_DOSE_VOLUME_OVERSAMPLING_FACTOR_ATTRIBUTE_NAME.c_str(), oversamplingAttrValueStream.str().c_str());
+  vtkSmartPointer<vtkTimerLog> timer = vtkSmartPointer<vtkTimerLog>::New();
+  double checkpointStart = timer->GetUniversalTime();
 
-  // Get spacing and voxel volume
-  double* segmentLabelmapSpacing = segmentLabelmap->GetSpacing();
-  double cubicMMPerVoxel = segmentLabelmapSpacing[0] * segmentLabelmapSpacing[1] * segmentLabelmapSpacing[2];
-  double ccPerCubicMM = 0.001;
+  // The accumulated dose is stored in the oversampled geometry of the selected dose volume
+  vtkSmartPointer<vtkOrientedImageData> doseImageData = vtkSmartPointer<vtkOrientedImageData>::Take(
+    vtkSlicerSegmentationsModuleLogic::CreateOrientedImageDataFromVolumeNode(doseVolumeNode) );
+  if (!doseImageData.GetPointer())
+  {
+    std::string errorMessage = vtkMRMLTr("vtkSlicerDoseVolumeHistogramModuleLogic", "Failed to get image data from dose volume");
+    vtkErrorMacro("StartIncrementalDvh: " << errorMessage);
+    return errorMessage;
+  }
+  vtkSmartPointer<vtkOrientedImageData> geometry = vtkSmartPointer<vtkOrientedImageData>::New();
+  geometry->ShallowCopy(doseImageData);
+  vtkCalculateOversamplingFactor::ApplyOversamplingOnImageGeometry(geometry, this->DefaultDoseVolumeOversamplingFactor);
 
-  // Set default column values
+  // If segment IDs list is empty then include all segments
+  vtkSegmentation* selectedSegmentation = segmentationNode->GetSegmentation();
+  std::vector<std::string> segmentIDs;
+  parameterNode->GetSelectedSegmentIDs(segmentIDs);
+  if (segmentIDs.empty())
+  {
+    selectedSegmentation->GetSegmentIDs(segmentIDs);
+  }
 
-  // Structure name
-  metricsTable->SetValue(tableRow, vtkMRMLDoseVolumeHistogramNode::MetricColumnStructure, vtkVariant(segmentName));
-  // Volume name
-  metricsTable->SetValue(tableRow, vtkMRMLDoseVolumeHistogramNode::MetricColumnDoseVolume, vtkVariant(doseVolumeNode->GetName()));
-  // Volume (cc) - save as attribute too (the DVH contains percentages that often need to be converted to volume)
-  double volumeCc = 0;
-  if (useFractionalLabelmap)
+  // Temporarily duplicate selected segments to contain binary labelmap in the oversampled dose geometry
+  vtkSmartPointer<vtkSegmentation> segmentationCopy = vtkSmartPointer<vtkSegmentation>::New();
+#if Slicer_VERSION_MAJOR >= 5 && Slicer_VERSION_MINOR >= 3
+  segmentationCopy->SetSourceRepresentationName(selectedSegmentation->GetSourceRepresentationName());
+#else
+  segmentationCopy->SetMasterRepresentationName(selectedSegmentation->GetMasterRepresentationName());
+#endif
+  segmentationCopy->CopyConversionParameters(selectedSegmentation);
+  for (std::vector<std::string>::iterator segmentIt = segmentIDs.begin(); segmentIt != segmentIDs.end(); ++segmentIt)
   {
-    volumeCc = vtkFractionalImageAccumulate::SafeDownCast(structureStat)->GetFractionalVoxelCount() * cubicMMPerVoxel * ccPerCubicMM;
+    segmentationCopy->CopySegmentFromSegmentation(selectedSegmentation, (*segmentIt));
   }
-  else
+  segmentationCopy->SetConversionParameter( vtkSegmentationConverter::GetReferenceImageGeometryParameterName(),
+    vtkSegmentationConverter::SerializeImageGeometry(doseImageData) );
+  std::stringstream fixedOversamplingValueStream;
+  fixedOversamplingValueStream << this->DefaultDoseVolumeOversamplingFactor;
+  segmentationCopy->SetConversionParameter( vtkClosedSurfaceToBinaryLabelmapConversionRule::GetOversamplingFactorParameterName(),
+    fixedOversamplingValueStream.str() );
+#if Slicer_VERSION_MAJOR >= 5 || (Slicer_VERSION_MAJOR >= 4 && Slicer_VERSION_MINOR >= 11)
+  segmentationCopy->SetConversionParameter(vtkClosedSurfaceToBinaryLabelmapConversionRule::GetCollapseLabelmapsParameterName(), "1");
+#endif
+  if ( !segmentationCopy->CreateRepresentation(vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName(), true)
+    && !segmentationCopy->ContainsRepresentation(vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName()) )
   {
-    volumeCc = structureStat->GetVoxelCount() * cubicMMPerVoxel * ccPerCubicMM;
+    std::string errorMessage = vtkMRMLTr("vtkSlicerDoseVolumeHistogramModuleLogic", "Unable to acquire binary labelmap from segmentation");
+    vtkErrorMacro("StartIncrementalDvh: " << errorMessage);
+    return errorMessage;
   }
-  metricsTable->SetValue(tableRow, vtkMRMLDoseVolumeHistogramNode::MetricColumnVolumeCc, vtkVariant(volumeCc));
-  std::ostringstream attributeNameStream;
-  std::ostringstream attributeValueStream;
-  attributeNameStream << vtkMRMLDoseVolumeHistogramNode::DVH_ATTRIBUTE_PREFIX << vtkSlicerDoseVolumeHistogramModuleLogic::DVH_METRIC_TOTAL_VOLUME_CC;
-  attributeValueStream << volumeCc;
-  tableNode->SetAttribute(attributeNameStream.str().c_str(), attributeValueStream.str().c_str());
-  // Mean dose
-  metricsTable->SetValue(tableRow, vtkMRMLDoseVolumeHistogramNode::MetricColumnMeanDose, vtkVariant(structureStat->GetMean()[0]));
-  // Min dose
-  metricsTable->SetValue(tableRow, vtkMRMLDoseVolumeHistogramNode::MetricColumnMinDose, vtkVariant(structureStat->GetMin()[0]));
-  // Max dose
-  metricsTable->SetValue(tableRow, vtkMRMLDoseVolumeHistogramNode::MetricColumnMaxDose, vtkVariant(structureStat->GetMax()[0]));
 
-  // Create DVH plot values
-  int numSamples = 0;
-  double startValue = 0.0;
-  double stepSize = 0.0;
-  double rangeMin = structureStat->GetMin()[0];
-  double rangeMax = structureStat->GetMax()[0];
-  if (isDoseVolume)
+  // Add segments to the histogram
+  std::vector<vtkSmartPointer<vtkOrientedImageData> > segmentLayers;
+  std::string errorMessage = this->GetSegmentLabelmapLayersInGeometry(
+    segmentationNode, segmentationCopy, segmentIDs, geometry, segmentLayers);
+  if (!errorMessage.empty())
   {
-    if (rangeMin<0)
+    vtkErrorMacro("StartIncrementalDvh: " << errorMessage);
+    return errorMessage;
+  }
+  vtkSmartPointer<vtkIncrementalDoseVolumeHistogram> histogram = vtkSmartPointer<vtkIncrementalDoseVolumeHistogram>::New();
+  histogram->Initialize(geometry);
+  histogram->SetStartValue(this->StartValue);
+  histogram->SetStepSize(this->StepSize);
+  for (size_t segmentIndex = 0; segmentIndex < segmentIDs.size(); ++segmentIndex)
+  {
+    vtkSegment* segment = segmentationCopy->GetSegment(segmentIDs[segmentIndex]);
+    if (histogram->AddSegment(segmentLayers[segmentIndex], segment->GetLabelValue()) < 0)
     {
-      std::string errorMessage = vtkMRMLTr("vtkSlicerDoseVolumeHistogramModuleLogic", "The dose volume contains negative dose values");
-      vtkErrorMacro("ComputeDvh: " << errorMessage);
+      errorMessage = vtkMRMLTr("vtkSlicerDoseVolumeHistogramModuleLogic", "Failed to add segment to DVH computation");
+      vtkErrorMacro("StartIncrementalDvh: " << errorMessage);
       return errorMessage;
     }
-
-    startValue = this->StartValue;
-    stepSize = this->StepSize;
-    numSamples = (int)ceil( (maxDoseGy-startValue)/stepSize ) + 1;
-  }
-  else
-  {
-    startValue = rangeMin;
-    numSamples = this->NumberOfSamplesForNonDoseVolumes;
-    stepSize = (rangeMax - rangeMin) / (double)(numSamples-1);
   }
 
-  // Get the number of voxels with smaller dose than at the start value
-  structureStat->SetComponentExtent(0,1,0,0,0,0);
-  structureStat->SetComponentOrigin(0,0,0);
-  structureStat->SetComponentSpacing(startValue,1,1);
-  structureStat->Update();
-  double voxelBelowDose = structureStat->GetOutput()->GetScalarComponentAsDouble(0,0,0,0);
+  this->IncrementalDvh.ParameterNode = parameterNode;
+  this->IncrementalDvh.SegmentIDs = segmentIDs;
+  this->IncrementalDvh.Geometry = geometry;
+  this->IncrementalDvh.Histogram = histogram;
 
-  // We put a fixed point at (0.0, 100%), but only if there are only positive values in the histogram
-  // Negative values can occur when the user requests histogram for an image, such as s CT volume (in
-  // this case Intensity Volume Histogram is computed), or the startValue became negative for the dose
-  // volume because the range minimum was smaller than the original start value.
-  bool insertPointAtOrigin = true;
-  if (startValue < 0.0)
+  if (this->LogSpeedMeasurements)
   {
-    insertPointAtOrigin = false;
+    vtkDebugMacro("StartIncrementalDvh: Preparation time: " << timer->GetUniversalTime() - checkpointStart << " s");
   }
+  return "";
+}
 
-  structureStat->SetComponentExtent(0,numSamples-1,0,0,0,0);
-  structureStat->SetComponentOrigin(startValue,0,0);
-  structureStat->SetComponentSpacing(stepSize,1,1);
-  structureStat->Update();
-
-  // Allocate table
-  vtkTable* table = tableNode->GetTable();
-  int numberOfRows = numSamples + (insertPointAtOrigin?1:0);
-  vtkNew<vtkDoubleArray> columnDose;
-  // no tr (column name is used as a lookup key in SetXColumnName/SetYColumnName below;
-  // it must stay stable regardless of UI language)
-  columnDose->SetName(isDoseVolume ? /*no tr*/ "Dose" : /*no tr*/ "Intensity");
-  columnDose->SetNumberOfTuples(numberOfRows);
-  table->AddColumn(columnDose);
-  vtkNew<vtkDoubleArray> columnVolume;
-  columnVolume->SetName(/*no tr*/ "Volume");
-  columnVolume->SetNumberOfTuples(numberOfRows);
-  table->AddColumn(columnVolume);
-  table->SetNumberOfRows(numberOfRows);
-
-  int rowIndex = 0;
-
-  if (insertPointAtOrigin)
+//---------------------------------------------------------------------------
+std::string vtkSlicerDoseVolumeHistogramModuleLogic::AddDoseToIncrementalDvh(
+  vtkMRMLDoseVolumeHistogramNode* parameterNode, vtkMRMLScalarVolumeNode* doseVolumeNode, double weight)
+{
+  if (!parameterNode || !this->IncrementalDvh.Histogram || this->IncrementalDvh.ParameterNode != parameterNode)
   {
-    // Add first fixed point at (0.0, 100%)
-    table->SetValue(rowIndex, 0, 0.0);
-    table->SetValue(rowIndex, 1, 100.0);
-    table->SetValue(rowIndex, 2, 0);
-    ++rowIndex;
+    std::string errorMessage = vtkMRMLTr("vtkSlicerDoseVolumeHistogramModuleLogic", "Incremental DVH computation has not been started for the parameter set node");
+    vtkErrorMacro("AddDoseToIncrementalDvh: " << errorMessage);
+    return errorMessage;
+  }
+  if (!doseVolumeNode || !doseVolumeNode->GetImageData())
+  {
+    std::string errorMessage = vtkMRMLTr("vtkSlicerDoseVolumeHistogramModuleLogic", "Invalid dose volume to add");
+    vtkErrorMacro("AddDoseToIncrementalDvh: " << errorMessage);
+    return errorMessage;
   }
 
-  vtkImageData* statArray = structureStat->GetOutput();
-  double totalVoxels = 0;
-  if (useFractionalLabelmap)
+  vtkSmartPointer<vtkTimerLog> timer = vtkSmartPointer<vtkTimerLog>::New();
+  double checkpointStart = timer->GetUniversalTime();
+
+  // Resample dose volume to the oversampled geometry using linear interpolation (same as in ComputeDvh).
+  // As interpolation is linear in the dose values, adding the resampled dose volumes is the same as
+  // resampling the accumulated dose volume.
+  vtkSmartPointer<vtkOrientedImageData> doseImageData = vtkSmartPointer<vtkOrientedImageData>::Take(
+    vtkSlicerSegmentationsModuleLogic::CreateOrientedImageDataFromVolumeNode(doseVolumeNode) );
+  vtkSmartPointer<vtkOrientedImageData> resampledDoseImageData = vtkSmartPointer<vtkOrientedImageData>::New();
+  if ( !doseImageData.GetPointer()
+    || !vtkOrientedImageDataResample::ResampleOrientedImageToReferenceOrientedImage(
+      doseImageData, this->IncrementalDvh.Geometry, resampledDoseImageData, true ) )
   {
-    totalVoxels = vtkFractionalImageAccumulate::SafeDownCast(structureStat)->GetFractionalVoxelCount();
+    std::string errorMessage = vtkMRMLTr("vtkSlicerDoseVolumeHistogramModuleLogic", "Failed to resample dose volume");
+    vtkErrorMacro("AddDoseToIncrementalDvh: " << errorMessage);
+    return errorMessage;
   }
-  else
+
+  vtkIncrementalDoseVolumeHistogram* histogram = this->IncrementalDvh.Histogram;
+  if (!histogram->AddWeightedDose(resampledDoseImageData, weight))
   {
-    totalVoxels = structureStat->GetVoxelCount();
+    std::string errorMessage = vtkMRMLTr("vtkSlicerDoseVolumeHistogramModuleLogic", "Failed to add dose volume to the accumulated dose");
+    vtkErrorMacro("AddDoseToIncrementalDvh: " << errorMessage);
+    return errorMessage;
   }
 
-  for (int sampleIndex=0; sampleIndex<numSamples; ++sampleIndex)
+  // Create DVH plot values from the updated histograms
+  int numberOfSegments = histogram->GetNumberOfSegments();
+  std::vector<SegmentDvhResult> results(numberOfSegments);
+  std::vector<std::string> errorMessages(numberOfSegments);
+  double* doseSpacing = this->IncrementalDvh.Geometry->GetSpacing();
+  double cubicMMPerVoxel = doseSpacing[0] * doseSpacing[1] * doseSpacing[2];
+  double ccPerCubicMM = 0.001;
+  for (int segmentIndex = 0; segmentIndex < numberOfSegments; ++segmentIndex)
   {
-    double voxelsInBin = statArray->GetScalarComponentAsDouble(sampleIndex,0,0,0);
-    table->SetValue(rowIndex, 0, startValue + sampleIndex * stepSize);
-    if (useFractionalLabelmap)
+    SegmentDvhResult& result = results[segmentIndex];
+    result.SegmentID = this->IncrementalDvh.SegmentIDs[segmentIndex];
+    if (histogram->GetSegmentVoxelCount(segmentIndex) < 1)
     {
-      table->SetValue(rowIndex, 1, std::max(0.0, (1.0-(double)voxelBelowDose/(double)totalVoxels)*100.0));
+      errorMessages[segmentIndex] = vtkMRMLTr("vtkSlicerDoseVolumeHistogramModuleLogic", "Dose volume and the structure do not overlap");
+      continue;
     }
-    else
+
+    result.VolumeCc = histogram->GetSegmentVoxelCount(segmentIndex) * cubicMMPerVoxel * ccPerCubicMM;
+    result.MeanDose = histogram->GetSegmentMean(segmentIndex);
+    result.MinDose = histogram->GetSegmentMin(segmentIndex);
+    result.MaxDose = histogram->GetSegmentMax(segmentIndex);
+
+    double startValue = 0.0;
+    double stepSize = 0.0;
+    int numSamples = 0;
+    errorMessages[segmentIndex] = this->CalculateDvhBins(true, histogram->GetMaximumDose(), result.MinDose, result.MaxDose,
+      startValue, stepSize, numSamples);
+    if (!errorMessages[segmentIndex].empty())
     {
-      table->SetValue(rowIndex, 1, (1.0-(double)voxelBelowDose/(double)totalVoxels)*100.0);
+      continue;
     }
-    table->SetValue(rowIndex, 2, 0);
-    ++rowIndex;
-    voxelBelowDose += voxelsInBin;
+    std::vector<double> binCounts(numSamples, 0.0);
+    for (int sampleIndex=0; sampleIndex<numSamples; ++sampleIndex)
+    {
+      binCounts[sampleIndex] = histogram->GetSegmentBinCount(segmentIndex, sampleIndex);
+    }
+    this->CalculateDvhValues(true, false, startValue, stepSize, histogram->GetSegmentVoxelCountBelowStartValue(segmentIndex),
+      binCounts, (double)histogram->GetSegmentVoxelCount(segmentIndex), result);
   }
 
-  // Set the start of the first bin to 0 if the volume contains dose and the start value was negative
-  if (isDoseVolume && !insertPointAtOrigin)
+  // The segments are updated together, so the computation time is distributed evenly among them
+  double computationTime = timer->GetUniversalTime() - checkpointStart;
+  for (int segmentIndex = 0; segmentIndex < numberOfSegments; ++segmentIndex)
   {
-    table->SetValue(0, 0, 0.0);
+    results[segmentIndex].ComputationTime = computationTime / numberOfSegments;
   }
 
-  // Setup DVH subject hierarchy items
-  vtkMRMLSubjectHierarchyNode* shNode = vtkMRMLSubjectHierarchyNode::GetSubjectHierarchyNode(this->GetMRMLScene());
-  if (!shNode)
+  // Write DVHs into the tables, firing only one modified event when done
+  int disabledNodeModify = parameterNode->StartModify();
+  std::string errorMessage = this->CommitSegmentDvhs(parameterNode, results, errorMessages);
+  parameterNode->EndModify(disabledNodeModify);
+  if (!errorMessage.empty())
   {
-    std::string errorMessage = vtkMRMLTr("vtkSlicerDoseVolumeHistogramModuleLogic", "Failed to access subject hierarchy node");
-    vtkErrorMacro("ComputeDvh: " << errorMessage);
+    vtkErrorMacro("AddDoseToIncrementalDvh: " << errorMessage);
     return errorMessage;
   }
-  vtkIdType doseShItemID = shNode->GetItemByDataNode(doseVolumeNode);
-
-  // Add metrics table and chart to under the study of the dose in subject hierarchy
-  vtkIdType studyItemID = shNode->GetItemAncestorAtLevel(doseShItemID, vtkMRMLSubjectHierarchyConstants::GetDICOMLevelStudy());
-  if (studyItemID != vtkMRMLSubjectHierarchyNode::INVALID_ITEM_ID)
+  // Trigger update of table
+  if (parameterNode->GetMetricsTableNode())
   {
-    vtkIdType metricsShItemID = shNode->CreateItem(studyItemID, metricsTableNode);
-    shNode->CreateItem(metricsShItemID, tableNode);
-
-    vtkMRMLPlotChartNode* chartNode = parameterNode->GetChartNode();
-    shNode->CreateItem(studyItemID, chartNode);
+    parameterNode->GetMetricsTableNode()->Modified();
   }
 
-  // Add connection attribute to input segmentation and dose volume nodes
-  segmentationNode->AddNodeReferenceID(DVH_CREATED_DVH_NODE_REFERENCE_ROLE.c_str(), tableNode->GetID());
-  doseVolumeNode->AddNodeReferenceID(DVH_CREATED_DVH_NODE_REFERENCE_ROLE.c_str(), tableNode->GetID());
+  return "";
+}
 
-  // Log measured time
-  double checkpointEnd = timer->GetUniversalTime();
-  UNUSED_VARIABLE(checkpointEnd); // Although it is used just below, a warning is logged so needs to be suppressed
-  if (this->LogSpeedMeasurements)
+//---------------------------------------------------------------------------
+std::string vtkSlicerDoseVolumeHistogramModuleLogic::GetSegmentLabelmapLayersInGeometry(
+  vtkMRMLSegmentationNode* segmentationNode, vtkSegmentation* segmentation,
+  const std::vector<std::string>& segmentIDs, vtkOrientedImageData* geometry,
+  std::vector<vtkSmartPointer<vtkOrientedImageData> >& layers)
+{
+  layers.clear();
+  if (!segmentation || !geometry)
   {
-    vtkDebugMacro("ComputeDvh: DVH computation time for structure '" << segmentID << "': " << checkpointEnd-checkpointStart << " s");
+    return vtkMRMLTr("vtkSlicerDoseVolumeHistogramModuleLogic", "Invalid segmentation or geometry");
   }
 
-  return ""; // No error
-} // end ComputeDvh
+  std::map<vtkOrientedImageData*, vtkSmartPointer<vtkOrientedImageData> > preparedLayers;
+  for (std::vector<std::string>::const_iterator segmentIdIt = segmentIDs.begin(); segmentIdIt != segmentIDs.end(); ++segmentIdIt)
+  {
+    vtkSegment* segment = segmentation->GetSegment(*segmentIdIt);
+    vtkOrientedImageData* segmentLayer = (segment ? vtkOrientedImageData::SafeDownCast(
+      segment->GetRepresentation(vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName()) ) : nullptr);
+    if (!segmentLayer)
+    {
+      return vtkMRMLTr("vtkSlicerDoseVolumeHistogramModuleLogic", "Failed to get labelmap for segments");
+    }
+
+    std::map<vtkOrientedImageData*, vtkSmartPointer<vtkOrientedImageData> >::iterator layerIt = preparedLayers.find(segmentLayer);
+    if (layerIt == preparedLayers.end())
+    {
+      vtkSmartPointer<vtkOrientedImageData> layer = vtkSmartPointer<vtkOrientedImageData>::New();
+      layer->ShallowCopy(segmentLayer);
+
+      // Apply parent transformation nodes if necessary
+      if (segmentationNode && segmentationNode->GetParentTransformNode())
+      {
+        double backgroundValue[4] = {0.0, 0.0, 0.0, 0.0};
+        if (!vtkSlicerSegmentationsModuleLogic::ApplyParentTransformToOrientedImageData(segmentationNode, layer, false, backgroundValue))
+        {
+          return vtkMRMLTr("vtkSlicerDoseVolumeHistogramModuleLogic", "Failed to apply parent transformation to segment");
+        }
+      }
+
+      // Resample layer to the given lattice (nearest neighbor, so that label values are preserved)
+      if (!vtkOrientedImageDataResample::DoGeometriesMatch(layer, geometry))
+      {
+        if ( !vtkOrientedImageDataResample::ResampleOrientedImageToReferenceOrientedImage(
+          layer, geometry, layer, false ) )
+        {
+          return vtkMRMLTr("vtkSlicerDoseVolumeHistogramModuleLogic", "Failed to resample segment binary labelmap");
+        }
+      }
+
+      layerIt = preparedLayers.insert(std::make_pair(segmentLayer, layer)).first;
+    }
+    layers.push_back(layerIt->second);
+  }
+
+  return "";
+}
 
 //---------------------------------------------------------------------------
 vtkMRMLPlotViewNode* vtkSlicerDoseVolumeHistogramModuleLogic::GetPlotViewNode()
@@ -1295,7 +2075,27 @@ bool vtkSlicerDoseVolumeHistogramModuleLogic::ComputeVMetrics(vtkMRMLDoseVolumeH
       continue;
     }
 
-    // Compute volume for all V's
+    // Compute volume for all V's exactly from the sorted voxel doses if available
+    vtkDoseValueDistribution* doseDistribution = this->GetDoseDistributionForDvh(dvhTableNode);
+    if (doseDistribution && doseDistribution->GetTotalWeight() > 0.0)
+    {
+      int tableColumn = numberOfColumnsBefore;
+      for (std::vector<double>::iterator it = doseValues.begin(); it != doseValues.end(); ++it)
+      {
+        double volumePercent = doseDistribution->GetWeightAtOrAboveValue(*it) / doseDistribution->GetTotalWeight() * 100.0;
+        if (parameterNode->GetShowVMetricsCc())
+        {
+          metricsTable->SetValue( tableRow, tableColumn++, vtkVariant(volumePercent*structureVolume/100.0) );
+        }
+        if (parameterNode->GetShowVMetricsPercent())
+        {
+          metricsTable->SetValue( tableRow, tableColumn++, vtkVariant(volumePercent) );
+        }
+      }
+      continue;
+    }
+
+    // Compute volume for all V's by interpolating the DVH table
     vtkTable* table = dvhTableNode->GetTable();
     vtkNew<vtkPiecewiseFunction> interpolator;
     interpolator->ClampingOn();
@@ -1489,16 +2289,22 @@ bool vtkSlicerDoseVolumeHistogramModuleLogic::ComputeDMetrics(vtkMRMLDoseVolumeH
       continue;
     }
 
-    // Calculate metrics and set table entries
+    // Calculate metrics and set table entries.
+    // Use the sorted voxel doses if available (the weights are converted from cc to the voxel weights)
+    vtkDoseValueDistribution* doseDistribution = this->GetDoseDistributionForDvh(dvhTableNode);
     int tableColumn = numberOfColumnsBefore;
     for (std::vector<double>::iterator ccIt=volumeValuesCc.begin(); ccIt!=volumeValuesCc.end(); ++ccIt)
     {
-      double d = ComputeDMetric(dvhTableNode, (*ccIt), structureVolume, false);
+      double d = (doseDistribution
+        ? doseDistribution->GetMinimumValueOfHighestWeight((*ccIt) / structureVolume * doseDistribution->GetTotalWeight())
+        : ComputeDMetric(dvhTableNode, (*ccIt), structureVolume, false) );
       metricsTable->SetValue(tableRow, tableColumn++, vtkVariant(d));
     }
     for (std::vector<double>::iterator percentIt=volumeValuesPercent.begin(); percentIt!=volumeValuesPercent.end(); ++percentIt)
     {
-      double d = ComputeDMetric(dvhTableNode, (*percentIt), structureVolume, true);
+      double d = (doseDistribution
+        ? doseDistribution->GetMinimumValueOfHighestWeight((*percentIt) / 100.0 * doseDistribution->GetTotalWeight())
+        : ComputeDMetric(dvhTableNode, (*percentIt), structureVolume, true) );
       metricsTable->SetValue(tableRow, tableColumn++, vtkVariant(d));
     }
   } // For all DVHs
@@ -1566,6 +2372,18 @@ double vtkSlicerDoseVolumeHistogramModuleLogic::ComputeDMetric(vtkMRMLTableNode*
   return doseForVolume;
 }
 
+//---------------------------------------------------------------------------
+vtkDoseValueDistribution* vtkSlicerDoseVolumeHistogramModuleLogic::GetDoseDistributionForDvh(vtkMRMLTableNode* dvhTableNode)
+{
+  if (!dvhTableNode || !dvhTableNode->GetID())
+  {
+    return nullptr;
+  }
+  std::map<std::string, vtkSmartPointer<vtkDoseValueDistribution> >::iterator distributionIt =
+    this->DoseDistributions.find(dvhTableNode->GetID());
+  return (distributionIt != this->DoseDistributions.end() ? distributionIt->second.GetPointer() : nullptr);
+}
+
 //---------------------------------------------------------------------------
 bool vtkSlicerDoseVolumeHistogramModuleLogic::ExportDvhToCsv(vtkMRMLDoseVolumeHistogramNode* parameterNode, const char* fileName, bool comma/*=true*/)
 {
@@ -32,7 +32,18 @@
 
 #include "vtkSlicerDoseVolumeHistogramModuleLogicExport.h"
 
+// VTK includes
+#include <vtkSmartPointer.h>
+#include <vtkWeakPointer.h>
+
+// STD includes
+#include <map>
+#include <vector>
+
+class vtkDoseValueDistribution;
+class vtkIncrementalDoseVolumeHistogram;
 class vtkOrientedImageData;
+class vtkSegmentation;
 class vtkCallbackCommand;
 
 class vtkMRMLDoseVolumeHistogramNode;
@@ -40,7 +51,9 @@ class vtkMRMLPlotChartNode;
 class vtkMRMLPlotSeriesNode;
 class vtkMRMLPlotViewNode;
 class vtkMRMLScalarVolumeNode;
+class vtkMRMLSegmentationNode;
 class vtkMRMLTableNode;
+class vtkMRMLTransformableNode;
 
 /// \ingroup SlicerRt_QtModules_DoseVolumeHistogram
 /// \brief The DoseVolumeHistogram module computes dose volume histogram (DVH) and metrics from a dose map and segmentation.
@@ -82,12 +95,37 @@ public:
 
 public:
   /// Compute DVH based on parameter node selections (dose volume, segmentation, segment IDs)
+  /// If \sa UseComputationCache is enabled, then the oversampled dose volume and the DVHs of the segments
+  /// that have not changed since the last computation are reused.
   std::string ComputeDvh(vtkMRMLDoseVolumeHistogramNode* parameterNode);
 
-  /// Compute V metrics for existing DVHs using the given dose values and add them in the metrics table
+  /// Release the cached dose volume and DVHs used by \sa ComputeDvh
+  void ClearComputationCache();
+
+  /// Start incremental DVH computation for accumulating dose (e.g. fractions of a treatment) on the selected segments.
+  /// The voxels of the segments are indexed in the oversampled geometry of the selected dose volume, and the accumulated
+  /// dose starts from zero. The dose volumes are then added using \sa AddDoseToIncrementalDvh.
+  /// Requires fixed oversampling and binary labelmaps, and does not support dose surface histograms.
+  /// \return Error message, empty string if no error
+  std::string StartIncrementalDvh(vtkMRMLDoseVolumeHistogramNode* parameterNode);
+
+  /// Add weighted dose volume to the accumulated dose of the incremental DVH computation, and update the DVH
+  /// and metrics tables with the DVHs of the accumulated dose. Only the voxels of the segments are updated, so
+  /// this is much faster than computing the DVHs of the accumulated dose volume.
+  /// \param parameterNode Parameter node the incremental computation was started with by \sa StartIncrementalDvh
+  /// \param doseVolumeNode Dose volume to add. It is resampled to the geometry of the incremental computation
+  /// \param weight Weight of the added dose volume
+  /// \return Error message, empty string if no error
+  std::string AddDoseToIncrementalDvh(vtkMRMLDoseVolumeHistogramNode* parameterNode, vtkMRMLScalarVolumeNode* doseVolumeNode, double weight);
+
+  /// Compute V metrics for existing DVHs using the given dose values and add them in the metrics table.
+  /// The metrics are computed from the sorted voxel doses for the DVHs computed with exact metrics enabled
+  /// in the parameter node, and interpolated from the DVH table otherwise.
   bool ComputeVMetrics(vtkMRMLDoseVolumeHistogramNode* parameterNode);
 
-  /// Compute D metrics for existing DVHs using the given dose values and add them in the metrics table
+  /// Compute D metrics for existing DVHs using the given dose values and add them in the metrics table.
+  /// The metrics are computed from the sorted voxel doses for the DVHs computed with exact metrics enabled
+  /// in the parameter node, and interpolated from the DVH table otherwise.
   bool ComputeDMetrics(vtkMRMLDoseVolumeHistogramNode* parameterNode);
 
   /// Add dose volume histogram of a structure (ROI) to the selected plot given its table node
@@ -142,19 +180,128 @@ public:
   vtkSetMacro(LogSpeedMeasurements, bool);
   vtkBooleanMacro(LogSpeedMeasurements, bool);
 
+  vtkGetMacro(UseComputationCache, bool);
+  vtkSetMacro(UseComputationCache, bool);
+  vtkBooleanMacro(UseComputationCache, bool);
+
+  /// Get whether the last \sa ComputeDvh call reused the cached dose volume
+  vtkGetMacro(DoseVolumeCacheUsed, bool);
+  /// Get number of segment DVHs the last \sa ComputeDvh call took from the cache instead of computing them
+  vtkGetMacro(NumberOfCachedSegmentDvhsUsed, int);
+
 protected:
+  /// Input of the DVH computation of one segment, collected on the main thread by \sa ComputeDvh
+  struct SegmentDvhInput
+  {
+    /// ID of the segment the DVH is calculated on
+    std::string SegmentID;
+    /// Labelmap of the segment. Binary labelmaps are already thresholded to contain only the segment
+    vtkSmartPointer<vtkOrientedImageData> Labelmap;
+    /// Background value of the labelmap
+    double MinimumValue{0.0};
+    /// Flag indicating that the labelmap needs to be resampled to the oversampled dose volume geometry
+    bool ResamplingRequired{false};
+  };
+
+  /// Result of the DVH computation of one segment.
+  /// It does not reference any MRML node, so that it can be computed on a worker thread. It is written
+  /// to the DVH and metrics tables by \sa CommitSegmentDvh
+  struct SegmentDvhResult
+  {
+    /// ID of the segment the DVH is calculated on
+    std::string SegmentID;
+    /// Volume of the structure in cc
+    double VolumeCc{0.0};
+    double MeanDose{0.0};
+    double MinDose{0.0};
+    double MaxDose{0.0};
+    /// Dose (or intensity) values of the DVH table rows
+    std::vector<double> DoseValues;
+    /// Volume percentages of the DVH table rows
+    std::vector<double> VolumePercentValues;
+    /// Time spent computing the DVH (s)
+    double ComputationTime{0.0};
+    /// Sorted voxel doses for exact metrics (only if enabled in the parameter node)
+    vtkSmartPointer<vtkDoseValueDistribution> DoseDistribution;
+  };
+
   /// Compute DVH for the given structure segment with the stenciled dose volume
-  /// (the labelmap representation of a segment but with dose values instead of the labels)
-  /// \param parameterNode Dose volume histogram parameter set node
-  /// \param segmentLabelmap Binary representation of the labelmap representation of the segment the DVH is calculated on
-  /// \param oversampledDoseVolume Dose volume resampled to match the geometry of the segment labelmap (to allow stenciling)
-  /// \param segmentID ID of segment the DVH is calculated on
+  /// (the labelmap representation of a segment but with dose values instead of the labels).
+  /// Does not access the MRML scene, so it can be called concurrently for different segments.
+  /// \param parameterNode Dose volume histogram parameter set node (only its computation options are read)
+  /// \param segmentInput Labelmap and resampling options of the segment the DVH is calculated on
+  /// \param doseVolume Dose volume in its original geometry (used with automatic oversampling)
+  /// \param fixedOversampledDoseVolume Dose volume resampled with the fixed oversampling factor (nullptr if automatic)
+  /// \param isDoseVolume Flag indicating whether the volume contains dose (determines the DVH bins)
   /// \param maxDoseGy Maximum dose determining the number of DVH bins (passed as argument so that it is only calculated once in \sa ComputeDvh() )
+  /// \param result Output DVH and statistics of the segment
+  /// \return Error message, empty string if no error
+  std::string ComputeSegmentDvh(
+    vtkMRMLDoseVolumeHistogramNode* parameterNode, const SegmentDvhInput& segmentInput,
+    vtkOrientedImageData* doseVolume, vtkOrientedImageData* fixedOversampledDoseVolume,
+    bool isDoseVolume, double maxDoseGy, SegmentDvhResult& result );
+
+  /// Write DVH of a segment computed by \sa ComputeSegmentDvh into its DVH table node and the metrics table.
+  /// Creates the DVH table node if it does not exist yet. Must be called on the main thread.
   /// \return Error message, empty string if no error
-  std::string ComputeDvh(
-    vtkMRMLDoseVolumeHistogramNode* parameterNode,
-    vtkOrientedImageData* segmentLabelmap, vtkOrientedImageData* oversampledDoseVolume,
-    std::string segmentID, double maxDoseGy );
+  std::string CommitSegmentDvh(vtkMRMLDoseVolumeHistogramNode* parameterNode, const SegmentDvhResult& result);
+
+  /// Write DVHs of multiple segments into the tables in the order of the segments, and update progress.
+  /// The first error (either from the computation or from writing the results) aborts the operation.
+  /// \param results Computed DVHs of the segments
+  /// \param errorMessages Errors of the computation of the segments (same size as results, empty string if no error)
+  /// \return Error message, empty string if no error
+  std::string CommitSegmentDvhs(vtkMRMLDoseVolumeHistogramNode* parameterNode,
+    const std::vector<SegmentDvhResult>& results, const std::vector<std::string>& errorMessages);
+
+  /// Compute DVH for multiple binary labelmap segments with one traversal of the oversampled dose volume
+  /// using \sa vtkMultiSegmentImageAccumulate. Segments sharing a labelmap layer are transformed and resampled
+  /// only once. The results are identical to those of \sa ComputeSegmentDvh.
+  /// \param segmentation Segmentation containing the binary labelmap representation of the segments in the oversampled dose geometry
+  /// \param segmentIDs IDs of the segments to compute the DVH for
+  /// \param oversampledDoseVolume Dose volume resampled with the fixed oversampling factor
+  /// \param results Output DVH and statistics of the segments (in the order of the segment IDs)
+  /// \param errorMessages Output errors of the segments (empty string if no error)
+  /// \return Error message of the whole computation, empty string if no error
+  std::string ComputeSegmentDvhsSinglePass(
+    vtkMRMLDoseVolumeHistogramNode* parameterNode, vtkSegmentation* segmentation, const std::vector<std::string>& segmentIDs,
+    vtkOrientedImageData* oversampledDoseVolume, bool isDoseVolume, double maxDoseGy,
+    std::vector<SegmentDvhResult>& results, std::vector<std::string>& errorMessages );
+
+  /// Get binary labelmap layers of segments transformed and resampled to the given geometry.
+  /// Segments sharing a labelmap layer get the same prepared layer, so that each layer is transformed and resampled only once.
+  /// \param segmentationNode Segmentation node whose parent transforms are applied on the layers
+  /// \param segmentation Segmentation containing the binary labelmap representation of the segments
+  /// \param layers Output labelmap layers of the segments (in the order of the segment IDs)
+  /// \return Error message, empty string if no error
+  std::string GetSegmentLabelmapLayersInGeometry(vtkMRMLSegmentationNode* segmentationNode, vtkSegmentation* segmentation,
+    const std::vector<std::string>& segmentIDs, vtkOrientedImageData* geometry,
+    std::vector<vtkSmartPointer<vtkOrientedImageData> >& layers);
+
+  /// Determine DVH bins from the value range of a segment
+  /// \return Error message, empty string if no error
+  std::string CalculateDvhBins(bool isDoseVolume, double maxDoseGy, double rangeMin, double rangeMax,
+    double& startValue, double& stepSize, int& numberOfSamples);
+
+  /// Fill DVH table values of a segment from its histogram
+  /// \param clampVolumes Flag determining whether volume percentages are clamped at zero (needed for fractional labelmaps)
+  /// \param voxelsBelowStartValue Number of voxels with value between zero and the start value
+  /// \param binCounts Number of voxels in the histogram bins starting at the start value
+  /// \param totalVoxels Number of voxels in the segment
+  void CalculateDvhValues(bool isDoseVolume, bool clampVolumes, double startValue, double stepSize,
+    double voxelsBelowStartValue, const std::vector<double>& binCounts, double totalVoxels, SegmentDvhResult& result);
+
+  /// Assemble key identifying the oversampled dose volume: changes if the dose volume, its transform,
+  /// or the oversampling options change
+  std::string GetDoseVolumeCacheKey(vtkMRMLDoseVolumeHistogramNode* parameterNode);
+
+  /// Assemble key identifying the DVH of a segment: changes if the dose volume cache key, the segment
+  /// (any of its representations), the segmentation transform, or the DVH computation options change
+  std::string GetSegmentDvhCacheKey(vtkMRMLDoseVolumeHistogramNode* parameterNode, const std::string& segmentID,
+    const std::string& doseVolumeCacheKey);
+
+  /// Assemble key identifying the parent transforms of a transformable node
+  static std::string GetParentTransformCacheKey(vtkMRMLTransformableNode* node);
 
   /// Return the plot view node object from the layout
   vtkMRMLPlotViewNode* GetPlotViewNode();
@@ -174,6 +321,10 @@ protected:
   /// Calculate one D metric. Called from \sa ComputeDMetrics
   double ComputeDMetric(vtkMRMLTableNode* tableNode, double volume, double structureVolume, bool isPercent);
 
+  /// Get sorted voxel doses of a DVH for exact metrics
+  /// \return Dose distribution if the DVH was computed with exact metrics, nullptr otherwise
+  vtkDoseValueDistribution* GetDoseDistributionForDvh(vtkMRMLTableNode* dvhTableNode);
+
   /// Callback function observing the visibility column of the metrics table
   static void OnVisibilityChanged(vtkObject* caller, unsigned long eid, void* clientData, void* callData);
 
@@ -213,6 +364,55 @@ protected:
 
   /// Flag telling whether the speed measurements are logged on standard output
   bool LogSpeedMeasurements;
+
+  /// Flag determining whether the oversampled dose volume and the DVHs of unchanged segments are reused
+  /// in subsequent DVH computations. True by default
+  bool UseComputationCache;
+
+  /// Flag telling whether the last DVH computation reused the cached dose volume
+  bool DoseVolumeCacheUsed;
+  /// Number of segment DVHs reused from the cache in the last DVH computation
+  int NumberOfCachedSegmentDvhsUsed;
+
+  /// Dose volume data reused between DVH computations on the same dose volume
+  struct DoseVolumeCacheEntry
+  {
+    /// Key the data was computed for (see \sa GetDoseVolumeCacheKey)
+    std::string Key;
+    double MaxDose{0.0};
+    vtkSmartPointer<vtkOrientedImageData> DoseImageData;
+    /// Dose volume resampled with the fixed oversampling factor (nullptr if automatic)
+    vtkSmartPointer<vtkOrientedImageData> FixedOversampledDoseVolume;
+  };
+  DoseVolumeCacheEntry DoseVolumeCache;
+
+  /// DVH of a segment reused if the segment and the computation inputs have not changed
+  struct SegmentDvhCacheEntry
+  {
+    /// Key the DVH was computed for (see \sa GetSegmentDvhCacheKey)
+    std::string Key;
+    SegmentDvhResult Result;
+    /// Automatic oversampling factor of the segment (only used with automatic oversampling)
+    double AutomaticOversamplingFactor{0.0};
+  };
+  /// Cached DVHs by segmentation node ID and segment ID
+  std::map<std::string, SegmentDvhCacheEntry> SegmentDvhCache;
+
+  /// State of the incremental DVH computation (see \sa StartIncrementalDvh)
+  struct IncrementalDvhState
+  {
+    /// Parameter node the incremental computation was started with
+    vtkWeakPointer<vtkMRMLDoseVolumeHistogramNode> ParameterNode;
+    /// IDs of the segments in the order they were added to the histogram
+    std::vector<std::string> SegmentIDs;
+    /// Oversampled dose geometry the added dose volumes are resampled to
+    vtkSmartPointer<vtkOrientedImageData> Geometry;
+    vtkSmartPointer<vtkIncrementalDoseVolumeHistogram> Histogram;
+  };
+  IncrementalDvhState IncrementalDvh;
+
+  /// Sorted voxel doses of the DVHs computed with exact metrics, by DVH table node ID
+  std::map<std::string, vtkSmartPointer<vtkDoseValueDistribution> > DoseDistributions;
 };
 
 #endif
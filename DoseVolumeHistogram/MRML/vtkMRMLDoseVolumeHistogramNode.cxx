@@ -66,6 +66,9 @@ vtkMRMLDoseVolumeHistogramNode::vtkMRMLDoseVolumeHistogramNode()
   this->UseFractionalLabelmap = false;
   this->DoseSurfaceHistogram = 0;
   this->UseInsideDoseSurface = true;
+  this->ParallelComputation = false;
+  this->SinglePassComputation = false;
+  this->ExactMetrics = false;
 
   this->HideFromEditors = false;
 }
@@ -105,6 +108,9 @@ void vtkMRMLDoseVolumeHistogramNode::WriteXML(ostream& of, int nIndent)
 
   of << " ShowDoseVolumesOnly=\"" << (this->ShowDoseVolumesOnly ? "true" : "false") << "\"";
   of << " AutomaticOversampling=\"" << (this->AutomaticOversampling ? "true" : "false") << "\"";
+  of << " ParallelComputation=\"" << (this->ParallelComputation ? "true" : "false") << "\"";
+  of << " SinglePassComputation=\"" << (this->SinglePassComputation ? "true" : "false") << "\"";
+  of << " ExactMetrics=\"" << (this->ExactMetrics ? "true" : "false") << "\"";
 }
 
 //----------------------------------------------------------------------------
@@ -175,6 +181,18 @@ void vtkMRMLDoseVolumeHistogramNode::ReadXMLAttributes(const char** atts)
       {
       this->AutomaticOversampling = (strcmp(attValue,"true") ? false : true);
       }
+    else if (!strcmp(attName, "ParallelComputation")) 
+      {
+      this->ParallelComputation = (strcmp(attValue,"true") ? false : true);
+      }
+    else if (!strcmp(attName, "SinglePassComputation")) 
+      {
+      this->SinglePassComputation = (strcmp(attValue,"true") ? false : true);
+      }
+    else if (!strcmp(attName, "ExactMetrics")) 
+      {
+      this->ExactMetrics = (strcmp(attValue,"true") ? false : true);
+      }
     }
 }
 
@@ -200,6 +218,9 @@ void vtkMRMLDoseVolumeHistogramNode::Copy(vtkMRMLNode *anode)
   this->ShowDMetrics = node->ShowDMetrics;
   this->ShowDoseVolumesOnly = node->ShowDoseVolumesOnly;
   this->AutomaticOversampling = node->AutomaticOversampling;
+  this->ParallelComputation = node->ParallelComputation;
+  this->SinglePassComputation = node->SinglePassComputation;
+  this->ExactMetrics = node->ExactMetrics;
 
   this->DisableModifiedEventOff();
   this->InvokePendingModifiedEvent();
@@ -228,6 +249,9 @@ void vtkMRMLDoseVolumeHistogramNode::PrintSelf(ostream& os, vtkIndent indent)
   os << indent << "ShowDMetrics:   " << (this->ShowDMetrics ? "true" : "false") << "\n";
   os << indent << "ShowDoseVolumesOnly:   " << (this->ShowDoseVolumesOnly ? "true" : "false") << "\n";
   os << indent << "AutomaticOversampling:   " << (this->AutomaticOversampling ? "true" : "false") << "\n";
+  os << indent << "ParallelComputation:   " << (this->ParallelComputation ? "true" : "false") << "\n";
+  os << indent << "SinglePassComputation:   " << (this->SinglePassComputation ? "true" : "false") << "\n";
+  os << indent << "ExactMetrics:   " << (this->ExactMetrics ? "true" : "false") << "\n";
 }
 
 //----------------------------------------------------------------------------
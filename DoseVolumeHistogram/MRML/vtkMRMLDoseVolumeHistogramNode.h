@@ -217,6 +217,27 @@ public:
   /// Get if the surface histogram should be calculated using internal/external voxels
   vtkBooleanMacro(UseInsideDoseSurface, bool);
 
+  /// Get parallel computation flag
+  vtkGetMacro(ParallelComputation, bool);
+  /// Set parallel computation flag
+  vtkSetMacro(ParallelComputation, bool);
+  /// Set parallel computation flag
+  vtkBooleanMacro(ParallelComputation, bool);
+
+  /// Get single pass computation flag
+  vtkGetMacro(SinglePassComputation, bool);
+  /// Set single pass computation flag
+  vtkSetMacro(SinglePassComputation, bool);
+  /// Set single pass computation flag
+  vtkBooleanMacro(SinglePassComputation, bool);
+
+  /// Get exact metrics flag
+  vtkGetMacro(ExactMetrics, bool);
+  /// Set exact metrics flag
+  vtkSetMacro(ExactMetrics, bool);
+  /// Set exact metrics flag
+  vtkBooleanMacro(ExactMetrics, bool);
+
 protected:
   /// Set and observe DVH metrics table node
   /// Metrics table node is unique and mandatory for each DVH node, so it is created within the node.
@@ -278,6 +299,24 @@ protected:
 
   /// Whether to calculate the dose volume histogram from voxels inside/outside the structure
   bool UseInsideDoseSurface;
+
+  /// Flag determining whether the DVHs of the selected segments are computed concurrently.
+  /// The results are identical to the serial computation, but the labelmaps of all selected
+  /// segments are kept in memory at the same time. False by default
+  bool ParallelComputation;
+
+  /// Flag determining whether the DVHs of all selected segments are computed in one traversal of the
+  /// oversampled dose volume, instead of stenciling the dose volume for each segment separately.
+  /// Only used for binary labelmaps with fixed oversampling and without dose surface histogram,
+  /// otherwise the segments are computed one by one. The results are identical in both cases.
+  /// Takes precedence over \sa ParallelComputation. False by default
+  bool SinglePassComputation;
+
+  /// Flag determining whether the sorted voxel doses of the structures are kept when computing the DVHs,
+  /// so that the D and V metrics are computed exactly instead of interpolating the DVH table.
+  /// This makes the metrics independent of the DVH step size at the cost of memory. Single pass
+  /// computation is not used if enabled. False by default
+  bool ExactMetrics;
 };
 
 #endif
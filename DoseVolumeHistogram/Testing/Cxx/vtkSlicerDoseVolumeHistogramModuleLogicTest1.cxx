@@ -72,6 +72,8 @@ int CompareCsvDvhTables(std::string dvhMetricsCsvFileName, std::string baselineC
 
 int CompareCsvDvhMetrics(std::string dvhMetricsCsvFileName, std::string baselineDvhMetricCsvFileName, double metricDifferenceThreshold);
 
+bool AreDvhTablesIdentical(vtkTable* dvhTable, vtkTable* baselineDvhTable);
+
 //-----------------------------------------------------------------------------
 int vtkSlicerDoseVolumeHistogramModuleLogicTest1( int argc, char * argv[] )
 {
@@ -341,6 +343,61 @@ int vtkSlicerDoseVolumeHistogramModuleLogicTest1( int argc, char * argv[] )
     std::cerr << "Invalid arguments" << std::endl;
     return EXIT_FAILURE;
   }
+  // ParallelComputation (optional)
+  bool parallelComputation = false;
+  if (argc > argIndex + 1)
+  {
+    if (STRCASECMP(argv[argIndex], "-ParallelComputation") == 0)
+    {
+      parallelComputation = (vtkVariant(argv[argIndex + 1]).ToInt() > 0 ? true : false);
+      std::cout << "Parallel computation: " << (parallelComputation ? "true" : "false") << std::endl;
+      argIndex += 2;
+    }
+  }
+  // SinglePassComputation (optional)
+  bool singlePassComputation = false;
+  if (argc > argIndex + 1)
+  {
+    if (STRCASECMP(argv[argIndex], "-SinglePassComputation") == 0)
+    {
+      singlePassComputation = (vtkVariant(argv[argIndex + 1]).ToInt() > 0 ? true : false);
+      std::cout << "Single pass computation: " << (singlePassComputation ? "true" : "false") << std::endl;
+      argIndex += 2;
+    }
+  }
+  // RepeatComputation (optional): number of times the DVH is computed again using the computation cache
+  int repeatComputation = 0;
+  if (argc > argIndex + 1)
+  {
+    if (STRCASECMP(argv[argIndex], "-RepeatComputation") == 0)
+    {
+      repeatComputation = vtkVariant(argv[argIndex + 1]).ToInt();
+      std::cout << "Repeat computation: " << repeatComputation << std::endl;
+      argIndex += 2;
+    }
+  }
+  // IncrementalComputation (optional): number of equal fractions the dose volume is added in using incremental DVH computation
+  int incrementalComputation = 0;
+  if (argc > argIndex + 1)
+  {
+    if (STRCASECMP(argv[argIndex], "-IncrementalComputation") == 0)
+    {
+      incrementalComputation = vtkVariant(argv[argIndex + 1]).ToInt();
+      std::cout << "Incremental computation: " << incrementalComputation << std::endl;
+      argIndex += 2;
+    }
+  }
+  // ExactMetrics (optional)
+  bool exactMetrics = false;
+  if (argc > argIndex + 1)
+  {
+    if (STRCASECMP(argv[argIndex], "-ExactMetrics") == 0)
+    {
+      exactMetrics = (vtkVariant(argv[argIndex + 1]).ToInt() > 0 ? true : false);
+      std::cout << "Exact metrics: " << (exactMetrics ? "true" : "false") << std::endl;
+      argIndex += 2;
+    }
+  }
 
   // Constraint the criteria to be greater than zero
   if (volumeDifferenceCriterion == 0.0)
@@ -431,6 +488,9 @@ int vtkSlicerDoseVolumeHistogramModuleLogicTest1( int argc, char * argv[] )
   paramNode->SetAutomaticOversampling(automaticOversamplingCalculation);
   paramNode->SetDoseSurfaceHistogram(doseSurfaceHistogram);
   paramNode->SetUseInsideDoseSurface(useInsideSurface);
+  paramNode->SetParallelComputation(parallelComputation);
+  paramNode->SetSinglePassComputation(singlePassComputation);
+  paramNode->SetExactMetrics(exactMetrics);
 
   // Setup chart node
   vtkMRMLPlotChartNode* chartNode = paramNode->GetChartNode();
@@ -454,7 +514,22 @@ int vtkSlicerDoseVolumeHistogramModuleLogicTest1( int argc, char * argv[] )
   UNUSED_VARIABLE(checkpointStart); // Although it is used later, a warning is logged so needs to be suppressed
 
   // Compute DVH
-  std::string errorMessage = dvhLogic->ComputeDvh(paramNode);
+  std::string errorMessage;
+  if (incrementalComputation > 0)
+  {
+    // Accumulate the dose volume in equal fractions, updating the DVHs after each fraction
+    errorMessage = dvhLogic->StartIncrementalDvh(paramNode);
+    for (int fractionIndex = 0; fractionIndex < incrementalComputation && errorMessage.empty(); ++fractionIndex)
+    {
+      double fractionCheckpointStart = timer->GetUniversalTime();
+      errorMessage = dvhLogic->AddDoseToIncrementalDvh(paramNode, doseScalarVolumeNode, 1.0 / incrementalComputation);
+      std::cout << "Incremental DVH update time: " << timer->GetUniversalTime()-fractionCheckpointStart << " s" << std::endl;
+    }
+  }
+  else
+  {
+    errorMessage = dvhLogic->ComputeDvh(paramNode);
+  }
   if (!errorMessage.empty())
   {
     std::cerr << errorMessage << std::endl;
@@ -477,6 +552,66 @@ int vtkSlicerDoseVolumeHistogramModuleLogicTest1( int argc, char * argv[] )
   UNUSED_VARIABLE(checkpointEnd); // Although it is used just below, a warning is logged so needs to be suppressed
   std::cout << "DVH computation time (including rasterization): " << checkpointEnd-checkpointStart << " s" << std::endl;
 
+  // Compute DVH again with unchanged inputs (the cached dose volume and DVHs are used)
+  std::vector<vtkSmartPointer<vtkTable> > firstDvhTables;
+  if (repeatComputation > 0)
+  {
+    std::vector<vtkMRMLTableNode*> firstDvhNodes;
+    paramNode->GetDvhTableNodes(firstDvhNodes);
+    for (std::vector<vtkMRMLTableNode*>::iterator dvhIt = firstDvhNodes.begin(); dvhIt != firstDvhNodes.end(); ++dvhIt)
+    {
+      vtkSmartPointer<vtkTable> firstDvhTable = vtkSmartPointer<vtkTable>::New();
+      firstDvhTable->DeepCopy((*dvhIt)->GetTable());
+      firstDvhTables.push_back(firstDvhTable);
+    }
+  }
+  for (int repeatIndex = 0; repeatIndex < repeatComputation; ++repeatIndex)
+  {
+    double repeatCheckpointStart = timer->GetUniversalTime();
+    errorMessage = dvhLogic->ComputeDvh(paramNode);
+    if (!errorMessage.empty())
+    {
+      std::cerr << errorMessage << std::endl;
+      return EXIT_FAILURE;
+    }
+    std::cout << "Repeated DVH computation time: " << timer->GetUniversalTime()-repeatCheckpointStart << " s" << std::endl;
+
+    // Inputs are unchanged since the previous computation, so everything has to come from the cache.
+    // After incremental computation the first full computation fills the cache, so only the later ones are checked.
+    if (incrementalComputation == 0 || repeatIndex > 0)
+    {
+      if (!dvhLogic->GetDoseVolumeCacheUsed())
+      {
+        std::cerr << "ERROR: Cached dose volume was not used in repeated DVH computation" << std::endl;
+        return EXIT_FAILURE;
+      }
+      if (dvhLogic->GetNumberOfCachedSegmentDvhsUsed() != static_cast<int>(firstDvhTables.size()))
+      {
+        std::cerr << "ERROR: Number of cached segment DVHs used in repeated DVH computation is "
+          << dvhLogic->GetNumberOfCachedSegmentDvhsUsed() << " instead of " << firstDvhTables.size() << std::endl;
+        return EXIT_FAILURE;
+      }
+    }
+
+    // Repeated computation has to give the same DVH tables
+    std::vector<vtkMRMLTableNode*> repeatedDvhNodes;
+    paramNode->GetDvhTableNodes(repeatedDvhNodes);
+    if (repeatedDvhNodes.size() != firstDvhTables.size())
+    {
+      std::cerr << "ERROR: Number of DVH tables changed in repeated DVH computation: "
+        << repeatedDvhNodes.size() << " instead of " << firstDvhTables.size() << std::endl;
+      return EXIT_FAILURE;
+    }
+    for (size_t dvhIndex = 0; dvhIndex < repeatedDvhNodes.size(); ++dvhIndex)
+    {
+      if (!AreDvhTablesIdentical(repeatedDvhNodes[dvhIndex]->GetTable(), firstDvhTables[dvhIndex]))
+      {
+        std::cerr << "ERROR: DVH table " << repeatedDvhNodes[dvhIndex]->GetName() << " differs after repeated DVH computation" << std::endl;
+        return EXIT_FAILURE;
+      }
+    }
+  }
+
   std::vector<vtkMRMLTableNode*> dvhNodes;
   paramNode->GetDvhTableNodes(dvhNodes);
 
@@ -793,3 +928,28 @@ int CompareCsvDvhMetrics(std::string dvhMetricsCsvFileName, std::string baseline
 
   return 0;
 }
+
+//-----------------------------------------------------------------------------
+bool AreDvhTablesIdentical(vtkTable* dvhTable, vtkTable* baselineDvhTable)
+{
+  if (!dvhTable || !baselineDvhTable)
+  {
+    return false;
+  }
+  if ( dvhTable->GetNumberOfColumns() != baselineDvhTable->GetNumberOfColumns()
+    || dvhTable->GetNumberOfRows() != baselineDvhTable->GetNumberOfRows() )
+  {
+    return false;
+  }
+  for (vtkIdType columnIndex = 0; columnIndex < dvhTable->GetNumberOfColumns(); ++columnIndex)
+  {
+    for (vtkIdType rowIndex = 0; rowIndex < dvhTable->GetNumberOfRows(); ++rowIndex)
+    {
+      if (dvhTable->GetValue(rowIndex, columnIndex) != baselineDvhTable->GetValue(rowIndex, columnIndex))
+      {
+        return false;
+      }
+    }
+  }
+  return true;
+}
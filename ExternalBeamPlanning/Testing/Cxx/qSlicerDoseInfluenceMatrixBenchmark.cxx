@@ -0,0 +1,147 @@
+#include "../../Widgets/qSlicerDoseInfluenceMatrix.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// Micro-benchmark of the dose influence matrix products D*w and D^T*g on a synthetic matrix.
+// Usage: qSlicerDoseInfluenceMatrixBenchmark [-NumberOfVoxels N] [-NumberOfBixels N]
+//          [-NonZerosPerVoxel N] [-NumberOfRepetitions N]
+
+using MatrixType = qSlicerDoseInfluenceMatrix::MatrixType;
+
+namespace
+{
+//-----------------------------------------------------------------------------
+/// Each bixel deposits dose in a contiguous run of voxels starting at a random voxel,
+/// similarly to a pencil beam crossing the dose grid.
+MatrixType CreateInfluenceMatrix(int numberOfVoxels, int numberOfBixels, int nonZerosPerVoxel)
+{
+  int nonZerosPerBixel = std::max(1, static_cast<int>(
+    static_cast<long long>(numberOfVoxels) * nonZerosPerVoxel / numberOfBixels));
+  nonZerosPerBixel = std::min(nonZerosPerBixel, numberOfVoxels);
+
+  std::mt19937 generator(42);
+  std::uniform_int_distribution<int> startDistribution(0, numberOfVoxels - nonZerosPerBixel);
+  std::uniform_real_distribution<double> valueDistribution(0.0, 1.0);
+
+  MatrixType matrix(numberOfVoxels, numberOfBixels);
+  matrix.reserve(static_cast<long long>(nonZerosPerBixel) * numberOfBixels);
+  for (int col = 0; col < numberOfBixels; ++col)
+  {
+    matrix.startVec(col);
+    int start = startDistribution(generator);
+    for (int row = start; row < start + nonZerosPerBixel; ++row)
+      matrix.insertBack(row, col) = valueDistribution(generator);
+  }
+  matrix.finalize();
+  return matrix;
+}
+
+//-----------------------------------------------------------------------------
+/// Run the product repeatedly and return the best time in seconds
+double TimeProduct(const std::function<void()>& product, int numberOfRepetitions)
+{
+  double bestTime = 0.0;
+  for (int i = 0; i < numberOfRepetitions; ++i)
+  {
+    auto start = std::chrono::steady_clock::now();
+    product();
+    double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (i == 0 || time < bestTime)
+      bestTime = time;
+  }
+  return bestTime;
+}
+
+//-----------------------------------------------------------------------------
+void ReportProduct(const char* name, double time, long long nonZeros)
+{
+  // One multiplication and one addition per non-zero
+  double gflops = 2.0 * static_cast<double>(nonZeros) / time * 1e-9;
+  std::cout << "  " << name << ": " << time * 1e3 << " ms, " << gflops << " GFLOP/s" << std::endl;
+}
+
+//-----------------------------------------------------------------------------
+double RelativeError(const Eigen::VectorXd& result, const Eigen::VectorXd& reference)
+{
+  double norm = reference.norm();
+  return norm > 0.0 ? (result - reference).norm() / norm : (result - reference).norm();
+}
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+  int numberOfVoxels = 1000000;
+  int numberOfBixels = 5000;
+  int nonZerosPerVoxel = 10;
+  int numberOfRepetitions = 10;
+  for (int i = 1; i + 1 < argc; i += 2)
+  {
+    if (!strcmp(argv[i], "-NumberOfVoxels"))
+      numberOfVoxels = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "-NumberOfBixels"))
+      numberOfBixels = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "-NonZerosPerVoxel"))
+      nonZerosPerVoxel = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "-NumberOfRepetitions"))
+      numberOfRepetitions = atoi(argv[i + 1]);
+    else
+    {
+      std::cerr << "Invalid argument: " << argv[i] << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+  if (numberOfVoxels < 1 || numberOfBixels < 1 || nonZerosPerVoxel < 1 || numberOfRepetitions < 1)
+  {
+    std::cerr << "Invalid matrix size or number of repetitions" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  MatrixType matrix = CreateInfluenceMatrix(numberOfVoxels, numberOfBixels, nonZerosPerVoxel);
+  long long nonZeros = matrix.nonZeros();
+  std::cout << "Influence matrix: " << numberOfVoxels << " voxels x " << numberOfBixels << " bixels, "
+    << nonZeros << " non-zeros" << std::endl;
+
+  Eigen::VectorXd w = Eigen::VectorXd::Random(numberOfBixels).cwiseAbs();
+  Eigen::VectorXd g = Eigen::VectorXd::Random(numberOfVoxels);
+
+  // Reference: single-threaded Eigen products on the column-major matrix
+  Eigen::VectorXd doseReference;
+  Eigen::VectorXd gradientReference;
+  std::cout << "Eigen (column-major, single-threaded):" << std::endl;
+  ReportProduct("D*w", TimeProduct([&]() { doseReference = matrix * w; }, numberOfRepetitions), nonZeros);
+  ReportProduct("D^T*g", TimeProduct([&]() { gradientReference = matrix.transpose() * g; }, numberOfRepetitions), nonZeros);
+
+  bool success = true;
+  for (bool singlePrecision : { false, true })
+  {
+    qSlicerDoseInfluenceMatrix influenceMatrix(matrix, singlePrecision);
+    std::cout << "qSlicerDoseInfluenceMatrix (" << (singlePrecision ? "float" : "double") << " values, "
+      << influenceMatrix.memorySize() / (1024.0 * 1024.0) << " MiB):" << std::endl;
+
+    Eigen::VectorXd dose;
+    Eigen::VectorXd gradient;
+    ReportProduct("D*w", TimeProduct([&]() { influenceMatrix.multiply(w, dose); }, numberOfRepetitions), nonZeros);
+    ReportProduct("D^T*g", TimeProduct([&]() { influenceMatrix.multiplyTransposed(g, gradient); }, numberOfRepetitions), nonZeros);
+
+    // Summation order differs from Eigen's, and float values are rounded
+    double tolerance = singlePrecision ? 1e-5 : 1e-12;
+    double doseError = RelativeError(dose, doseReference);
+    double gradientError = RelativeError(gradient, gradientReference);
+    if (doseError > tolerance || gradientError > tolerance)
+    {
+      std::cerr << "Product mismatch: relative error of D*w " << doseError << ", D^T*g " << gradientError
+        << " (tolerance " << tolerance << ")" << std::endl;
+      success = false;
+    }
+  }
+
+  return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
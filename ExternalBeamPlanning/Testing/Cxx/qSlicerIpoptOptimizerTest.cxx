@@ -1,9 +1,119 @@
 #include "../../Widgets/qSlicerIpoptOptimizer.h"
+#include "../../Widgets/qSlicerMinMaxDoseConstraint.h"
 
 #include <QCoreApplication>
 #include <QDebug>
 #include <iostream>
 #include <cmath>
+#include <random>
+#include <set>
+
+// Compare the sparse constraint Jacobian of plan optimization with the dense Jacobian of the constraints
+// multiplied by the influence matrix, for one structure with a log-sum-exp min/max dose constraint (mode 0)
+// and one with voxel-wise bounds (mode 1).
+static bool testSparseConstraintJacobian()
+{
+    using SparseJacobianType = qSlicerAbstractConstraint::SparseJacobianType;
+    const int numBixels = 15;
+    const int numVoxels[2] = {20, 12};
+
+    std::mt19937 generator(42);
+    std::uniform_real_distribution<double> value(0.1, 1.0);
+    std::bernoulli_distribution isNonZero(0.3);
+
+    // Random non-negative influence matrices of the structure voxels
+    std::vector<SparseJacobianType> structureMatrices;
+    for (int nv : numVoxels) {
+        std::vector<Eigen::Triplet<double>> triplets;
+        for (int v = 0; v < nv; ++v)
+            for (int b = 0; b < numBixels; ++b)
+                if (isNonZero(generator))
+                    triplets.emplace_back(v, b, value(generator));
+        SparseJacobianType matrix(nv, numBixels);
+        matrix.setFromTriplets(triplets.begin(), triplets.end());
+        structureMatrices.push_back(matrix);
+    }
+
+    qSlicerMinMaxDoseConstraint logSumExpConstraint;
+    QMap<QString, QVariant> parameters;
+    parameters["minDose"] = 0.5;
+    parameters["maxDose"] = 3.0;
+    parameters["mode"] = 0;
+    logSumExpConstraint.setConstraintParameters(parameters);
+    qSlicerMinMaxDoseConstraint voxelWiseConstraint;
+    parameters["mode"] = 1;
+    voxelWiseConstraint.setConstraintParameters(parameters);
+    std::vector<qSlicerAbstractConstraint*> constraints = {&logSumExpConstraint, &voxelWiseConstraint};
+
+    Eigen::VectorXd w(numBixels);
+    for (int b = 0; b < numBixels; ++b)
+        w[b] = value(generator);
+    std::vector<Eigen::VectorXd> doses;
+    for (const SparseJacobianType& matrix : structureMatrices)
+        doses.push_back(matrix * w);
+
+    // Dense reference: the Jacobians of the structures stacked on each other
+    std::vector<Eigen::MatrixXd> denseJacobians;
+    int numRows = 0;
+    for (size_t i = 0; i < constraints.size(); ++i) {
+        denseJacobians.push_back(constraints[i]->computeDoseConstraintJacobian(doses[i]) * Eigen::MatrixXd(structureMatrices[i]));
+        numRows += static_cast<int>(denseJacobians.back().rows());
+    }
+    Eigen::MatrixXd reference(numRows, numBixels);
+    int row = 0;
+    for (const Eigen::MatrixXd& jacobian : denseJacobians) {
+        reference.middleRows(row, jacobian.rows()) = jacobian;
+        row += static_cast<int>(jacobian.rows());
+    }
+    if (numRows != 2 + numVoxels[1]) {
+        std::cout << "✗ Unexpected number of constraints: " << numRows << std::endl;
+        return false;
+    }
+
+    qSlicerIpoptOptimizer::JacobianSparsityType sparsity =
+        qSlicerIpoptOptimizer::computeConstraintJacobianSparsity(constraints, structureMatrices);
+    qSlicerIpoptOptimizer::Array values =
+        qSlicerIpoptOptimizer::computeConstraintJacobianValues(constraints, structureMatrices, doses, sparsity);
+
+    // One value per declared entry, which is what IPOPT receives in eval_jac_g
+    if (values.size() != sparsity.size()) {
+        std::cout << "✗ Jacobian has " << values.size() << " values for " << sparsity.size() << " pattern entries" << std::endl;
+        return false;
+    }
+
+    // Entries are within the Jacobian, unique and in row-major order
+    std::set<std::pair<int,int>> entries;
+    for (size_t k = 0; k < sparsity.size(); ++k) {
+        const std::pair<int,int>& entry = sparsity[k];
+        if (entry.first < 0 || entry.first >= numRows || entry.second < 0 || entry.second >= numBixels
+            || (k > 0 && !(sparsity[k - 1] < entry))) {
+            std::cout << "✗ Invalid pattern entry (" << entry.first << ", " << entry.second << ")" << std::endl;
+            return false;
+        }
+        entries.insert(entry);
+    }
+
+    const double tolerance = 1e-10;
+    double maxError = 0.0;
+    for (size_t k = 0; k < sparsity.size(); ++k)
+        maxError = std::max(maxError, std::abs(values[k] - reference(sparsity[k].first, sparsity[k].second)));
+    if (maxError > tolerance) {
+        std::cout << "✗ Sparse Jacobian differs from the dense reference (error: " << maxError << ")" << std::endl;
+        return false;
+    }
+
+    // No non-zero of the dense Jacobian is outside the declared sparsity
+    for (int r = 0; r < numRows; ++r)
+        for (int c = 0; c < numBixels; ++c)
+            if (reference(r, c) != 0.0 && entries.count(std::make_pair(r, c)) == 0) {
+                std::cout << "✗ Non-zero (" << r << ", " << c << ") is not in the sparsity pattern" << std::endl;
+                return false;
+            }
+
+    std::cout << "✓ Sparse constraint Jacobian matches the dense reference (" << sparsity.size()
+              << " of " << numRows * numBixels << " entries, error: " << maxError << ")" << std::endl;
+    return true;
+}
 
 int main(int argc, char* argv[])
 {
@@ -110,6 +220,37 @@ int main(int argc, char* argv[])
         std::cout << "✗ Rosenbrock optimization failed with status: " << result_rb.status << std::endl;
         return 1;
     }
+
+    // Test 3: Sparse constraint Jacobian
+    std::cout << "\n=== Test 3: Sparse Constraint Jacobian ===" << std::endl;
+
+    if (!testSparseConstraintJacobian()) {
+        return 1;
+    }
+
+    // Test 4: Constrained problem, eval_jac_g fails if the values do not match the declared sparsity
+    std::cout << "\n=== Test 4: Dose Constraint ===" << std::endl;
+
+    qSlicerIpoptOptimizer constrainedOptimizer;
+    constrainedOptimizer.setMaxIterations(500);
+    // Two voxels of a target, each irradiated by one of two bixels, and a second bixel limited by an organ at risk
+    constrainedOptimizer.addStructureTerm({1.0, 1.0}, {0, 1}, {0, 1}, 2, 2, "SquaredDeviation", 2.0, 1.0);
+    constrainedOptimizer.addStructureConstraint({1.0}, {0}, {1}, 1, 2, "MaxDose", 1.0, 0.01);
+
+    auto result_con = constrainedOptimizer.solveProblem({1.0, 1.0});
+
+    if (result_con.success) {
+        std::cout << "✓ Constrained optimization succeeded!" << std::endl;
+        std::cout << "  Solution: [" << result_con.solution[0] << ", " << result_con.solution[1] << "]" << std::endl;
+        if (result_con.solution[1] > 1.0 + 1e-3 || std::abs(result_con.solution[0] - 2.0) > 1e-3) {
+            std::cout << "✗ Constrained solution is wrong" << std::endl;
+            return 1;
+        }
+    } else {
+        std::cout << "✗ Constrained optimization failed with status: " << result_con.status << std::endl;
+        return 1;
+    }
+
     // For a more advanced interactive test with proton patients, please check out https://github.com/SebastiaanBreedveld/TROTS/tree/master/SlicerRT_import
 
     std::cout << "\n✓ All tests passed successfully!" << std::endl;
@@ -25,3 +25,13 @@ void qSlicerAbstractConstraint::setConstraintParameters(QMap<QString, QVariant>
 {
   constraintParameters = parameters;
 }
+
+qSlicerAbstractConstraint::SparseJacobianType qSlicerAbstractConstraint::computeDoseConstraintJacobianPattern(int numVoxels)
+{
+  return Eigen::MatrixXd::Ones(numConstraints(numVoxels), numVoxels).sparseView();
+}
+
+qSlicerAbstractConstraint::SparseJacobianType qSlicerAbstractConstraint::computeDoseConstraintJacobianSparse(const DoseType& dose)
+{
+  return computeDoseConstraintJacobian(dose).sparseView();
+}
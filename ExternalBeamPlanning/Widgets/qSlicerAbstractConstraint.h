@@ -9,6 +9,7 @@
 #include <QString>
 
 #include <itkeigen/Eigen/Dense>
+#include <itkeigen/Eigen/Sparse>
 
 /// \ingroup SlicerRt_QtModules_ExternalBeamPlanning
 /// \brief Abstract base class for dose constraint functions used in plan optimization.
@@ -25,6 +26,7 @@ class Q_SLICER_MODULE_EXTERNALBEAMPLANNING_WIDGETS_EXPORT qSlicerAbstractConstra
 
 public:
   using DoseType = Eigen::VectorXd;
+  using SparseJacobianType = Eigen::SparseMatrix<double, Eigen::RowMajor>;
 
   typedef QObject Superclass;
   explicit qSlicerAbstractConstraint(QObject* parent = nullptr);
@@ -45,6 +47,15 @@ public:
   /// Jacobian: matrix of shape (numConstraints, numVoxels).
   Q_INVOKABLE virtual Eigen::MatrixXd computeDoseConstraintJacobian(const DoseType& dose) = 0;
 
+  /// Sparsity pattern of the Jacobian: matrix of shape (numConstraints, numVoxels) with a non-zero
+  /// entry where a constraint may depend on the dose of a voxel. The pattern must not depend on the dose.
+  /// Dense by default; constraints that depend on a few voxels each (e.g. voxel-wise bounds) override it.
+  virtual SparseJacobianType computeDoseConstraintJacobianPattern(int numVoxels);
+
+  /// Jacobian as a sparse matrix with non-zeros only within computeDoseConstraintJacobianPattern.
+  /// The dense Jacobian is converted by default.
+  virtual SparseJacobianType computeDoseConstraintJacobianSparse(const DoseType& dose);
+
   /// Upper bounds for each constraint equation.
   Q_INVOKABLE virtual DoseType upperBounds(int numVoxels) = 0;
 
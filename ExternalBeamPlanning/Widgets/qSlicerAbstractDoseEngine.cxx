@@ -178,7 +178,13 @@ void qSlicerAbstractDoseEngine::registerBeamParametersTabWidget(qMRMLBeamParamet
 }
 
 //----------------------------------------------------------------------------
-QString qSlicerAbstractDoseEngine::calculateDose(vtkMRMLRTBeamNode* beamNode)
+bool qSlicerAbstractDoseEngine::isThreadSafe() const
+{
+  return this->m_IsThreadSafe;
+}
+
+//----------------------------------------------------------------------------
+QString qSlicerAbstractDoseEngine::prepareDoseCalculation(vtkMRMLRTBeamNode* beamNode)
 {
   if (!beamNode)
   {
@@ -230,6 +236,18 @@ QString qSlicerAbstractDoseEngine::calculateDose(vtkMRMLRTBeamNode* beamNode)
   // Remove past intermediate results for beam before calculating dose again
   this->removeIntermediateResults(beamNode);
 
+  return QString();
+}
+
+//----------------------------------------------------------------------------
+QString qSlicerAbstractDoseEngine::calculateDose(vtkMRMLRTBeamNode* beamNode)
+{
+  QString errorMessage = this->prepareDoseCalculation(beamNode);
+  if (!errorMessage.isEmpty())
+  {
+    return errorMessage;
+  }
+
   // Create output dose volume for beam
   vtkSmartPointer<vtkMRMLScalarVolumeNode> resultDoseVolumeNode = vtkSmartPointer<vtkMRMLScalarVolumeNode>::New();
   beamNode->GetScene()->AddNode(resultDoseVolumeNode);
@@ -238,7 +256,7 @@ QString qSlicerAbstractDoseEngine::calculateDose(vtkMRMLRTBeamNode* beamNode)
   resultDoseVolumeNode->SetName(resultDoseNodeName.c_str());
 
   // Calculate dose
-  QString errorMessage = this->calculateDoseUsingEngine(beamNode, resultDoseVolumeNode);
+  errorMessage = this->calculateDoseUsingEngine(beamNode, resultDoseVolumeNode);
   if (errorMessage.isEmpty())
   {
     // Add result dose volume to beam
@@ -258,59 +276,15 @@ QString qSlicerAbstractDoseEngine::calculateDoseInfluenceMatrix(vtkMRMLRTBeamNod
     return errorMessage;
   }
 
-  if (!beamNode)
+  QString errorMessage = this->prepareDoseCalculation(beamNode);
+  if (!errorMessage.isEmpty())
   {
-    QString errorMessage(tr("Invalid beam node"));
-    qCritical() << Q_FUNC_INFO << ": " << errorMessage;
-    return errorMessage;
-  }
-  vtkMRMLRTPlanNode* parentPlanNode = beamNode->GetParentPlanNode();
-  if (!parentPlanNode)
-  {
-    QString errorMessage = tr("Unable to access parent node for beam %1").arg(beamNode->GetName());
-    qCritical() << Q_FUNC_INFO << ": " << errorMessage;
     return errorMessage;
   }
 
-  // Add RT plan to the same branch where the reference volume is
-  vtkMRMLScalarVolumeNode* referenceVolumeNode = parentPlanNode->GetReferenceVolumeNode();
-  if (!referenceVolumeNode)
-  {
-    QString errorMessage(tr("Unable to access reference volume"));
-    qCritical() << Q_FUNC_INFO << ": " << errorMessage;
-    return errorMessage;
-  }
-  vtkMRMLSubjectHierarchyNode* shNode = vtkMRMLSubjectHierarchyNode::GetSubjectHierarchyNode(beamNode->GetScene());
-  if (!shNode)
-  {
-    QString errorMessage(tr("Failed to access subject hierarchy node"));
-    qCritical() << Q_FUNC_INFO << ": " << errorMessage;
-    return errorMessage;
-  }
-  vtkIdType referenceVolumeShItemID = shNode->GetItemByDataNode(referenceVolumeNode);
-  if (referenceVolumeShItemID)
-  {
-    vtkIdType planShItemID = parentPlanNode->GetPlanSubjectHierarchyItemID();
-    if (planShItemID)
-    {
-      shNode->SetItemParent(planShItemID, shNode->GetItemParent(referenceVolumeShItemID));
-      }
-    else
-    {
-      qCritical() << Q_FUNC_INFO << ": Failed to access RT plan subject hierarchy item, although it should always be available";
-    }
-  }
-  else
-  {
-    qCritical() << Q_FUNC_INFO << ": Failed to access reference volume subject hierarchy item";
-  }
-    
-  // Remove past intermediate results for beam before calculating dose again
-  this->removeIntermediateResults(beamNode);
-
   // Calculate dose
-  QString errorMessage = this->calculateDoseInfluenceMatrixUsingEngine(beamNode);
-  
+  errorMessage = this->calculateDoseInfluenceMatrixUsingEngine(beamNode);
+
   return errorMessage;
 }
 
@@ -49,6 +49,7 @@ class Q_SLICER_MODULE_EXTERNALBEAMPLANNING_WIDGETS_EXPORT qSlicerAbstractDoseEng
   Q_PROPERTY(bool isInverse READ isInverse WRITE setIsInverse)
   Q_PROPERTY(bool canDoIonPlan READ canDoIonPlan WRITE setCanDoIonPlan)
   Q_PROPERTY(bool supportsBodySegment READ supportsBodySegment WRITE setSupportsBodySegment)
+  Q_PROPERTY(bool isThreadSafe READ isThreadSafe)
 
 public:
   /// Maximum Gray value for visualization window/level of the newly created per-beam dose volumes
@@ -86,6 +87,10 @@ public:
   /// Set body segment support
   virtual void setSupportsBodySegment(bool supportsBodySegment);
 
+  /// Thread safety of the calculation. If true, then the dose engine logic calls \sa calculateDoseUsingEngine
+  /// and \sa calculateDoseInfluenceMatrixUsingEngine for multiple beams concurrently on worker threads
+  bool isThreadSafe()const;
+
 // Dose calculation related functions
 public:
   /// Perform dose calculation for a single beam
@@ -116,6 +121,10 @@ protected:
   /// \param beamNode Beam for which the dose is calculated. Each beam has a parent plan from which the
   ///   plan-specific parameters are got
   /// \param resultDoseVolumeNode Output volume node for the result dose. It is created by \sa CalculateDose
+  ///
+  /// Thread-safe engines (\sa isThreadSafe) may be called on a worker thread. In that case the result dose
+  /// volume node is added to the scene only after the calculation, and the engine must not modify the scene
+  /// or any node other than the beam and the result dose volume node.
   virtual QString calculateDoseUsingEngine(
     vtkMRMLRTBeamNode* beamNode,
     vtkMRMLScalarVolumeNode* resultDoseVolumeNode ) = 0;
@@ -127,9 +136,18 @@ protected:
   /// \param beamNode Beam for which the dose is calculated. Each beam has a parent plan from which the
   ///   plan-specific parameters are got
   /// \param resultDoseVolumeNode Output volume node for the result dose. It is created by \sa CalculateDose
+  ///
+  /// Thread-safe engines (\sa isThreadSafe) may be called on a worker thread, and must not modify the scene
+  /// or any node other than the beam.
   virtual QString calculateDoseInfluenceMatrixUsingEngine(
       vtkMRMLRTBeamNode* beamNode);
 
+  /// Perform the actions generic to any dose engine before calculating the dose or dose influence matrix
+  /// for a beam: put the plan next to the reference volume in subject hierarchy, and remove the intermediate
+  /// results of the previous calculation. Must be called on the main thread.
+  /// \return Error message. Empty string on success
+  QString prepareDoseCalculation(vtkMRMLRTBeamNode* beamNode);
+
   /// Define engine-specific beam parameters.
   /// This is the method that needs to be implemented in each engine.
   virtual void defineBeamParameters() = 0;
@@ -301,6 +319,10 @@ protected:
   /// Is false by default, but can be set in the dose engine constructor
   bool m_SupportsBodySegment = false;
 
+  /// Can the dose engine calculate multiple beams concurrently? (see \sa calculateDoseUsingEngine)
+  /// Is false by default, but can be set in the dose engine constructor. Not available for scripted engines.
+  bool m_IsThreadSafe = false;
+
   /// List of registered tab widgets. Static so that it is common to all engines.
   static QSet<qMRMLBeamParametersTabWidget*> m_BeamParametersTabWidgets;
 
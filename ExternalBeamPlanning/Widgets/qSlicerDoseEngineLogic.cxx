@@ -53,6 +53,13 @@
 // Qt includes
 #include <QDebug>
 
+// STD includes
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
 //-----------------------------------------------------------------------------
 /// \ingroup Slicer_QtModules_SubjectHierarchy
 class qSlicerDoseEngineLogicPrivate
@@ -64,6 +71,10 @@ public:
   qSlicerDoseEngineLogicPrivate(qSlicerDoseEngineLogic& object);
   ~qSlicerDoseEngineLogicPrivate();
   void loadApplicationSettings();
+
+public:
+  /// Flag determining whether the beams are calculated concurrently with thread-safe dose engines
+  bool ParallelBeamCalculationEnabled{true};
 };
 
 //-----------------------------------------------------------------------------
@@ -91,12 +102,27 @@ void qSlicerDoseEngineLogicPrivate::loadApplicationSettings()
 //----------------------------------------------------------------------------
 qSlicerDoseEngineLogic::qSlicerDoseEngineLogic(QObject* parent)
   : QObject(parent)
+  , d_ptr(new qSlicerDoseEngineLogicPrivate(*this))
 {
 }
 
 //----------------------------------------------------------------------------
 qSlicerDoseEngineLogic::~qSlicerDoseEngineLogic() = default;
 
+//-----------------------------------------------------------------------------
+void qSlicerDoseEngineLogic::setParallelBeamCalculationEnabled(bool enabled)
+{
+  Q_D(qSlicerDoseEngineLogic);
+  d->ParallelBeamCalculationEnabled = enabled;
+}
+
+//-----------------------------------------------------------------------------
+bool qSlicerDoseEngineLogic::parallelBeamCalculationEnabled()const
+{
+  Q_D(const qSlicerDoseEngineLogic);
+  return d->ParallelBeamCalculationEnabled;
+}
+
 //-----------------------------------------------------------------------------
 void qSlicerDoseEngineLogic::setMRMLScene(vtkMRMLScene* scene)
 {
@@ -186,6 +212,8 @@ void qSlicerDoseEngineLogic::applyDoseEngineInPlan(vtkObject* nodeObject)
 //---------------------------------------------------------------------------
 QString qSlicerDoseEngineLogic::calculateDose(vtkMRMLRTPlanNode* planNode)
 {
+  Q_D(qSlicerDoseEngineLogic);
+
   QString errorMessage("");
   if (!planNode || !planNode->GetScene())
   {
@@ -211,28 +239,41 @@ QString qSlicerDoseEngineLogic::calculateDose(vtkMRMLRTPlanNode* planNode)
   int currentBeamIndex = 0;
   double progress = 0.0;
 
-  for (std::vector<vtkMRMLRTBeamNode*>::iterator beamIt = beams.begin(); beamIt != beams.end(); ++beamIt, ++currentBeamIndex)
+  if (selectedEngine->isThreadSafe() && d->ParallelBeamCalculationEnabled && numberOfBeams > 1)
   {
-    vtkMRMLRTBeamNode* beamNode = (*beamIt);
-    if (beamNode)
+    // Calculate the beams concurrently (progress is reported as the beams finish)
+    errorMessage = this->calculateBeamsInParallel(selectedEngine, beams, false);
+    if (!errorMessage.isEmpty())
     {
-      progress = (double)currentBeamIndex / (numberOfBeams+1);
-      emit progressUpdated(progress);
-
-      // Calculate dose for current beam
-      errorMessage = selectedEngine->calculateDose(beamNode);
-      if (!errorMessage.isEmpty())
+      qCritical() << Q_FUNC_INFO << ": " << errorMessage;
+      return errorMessage;
+    }
+  }
+  else
+  {
+    for (std::vector<vtkMRMLRTBeamNode*>::iterator beamIt = beams.begin(); beamIt != beams.end(); ++beamIt, ++currentBeamIndex)
+    {
+      vtkMRMLRTBeamNode* beamNode = (*beamIt);
+      if (beamNode)
       {
+        progress = (double)currentBeamIndex / (numberOfBeams+1);
+        emit progressUpdated(progress);
+
+        // Calculate dose for current beam
+        errorMessage = selectedEngine->calculateDose(beamNode);
+        if (!errorMessage.isEmpty())
+        {
+          qCritical() << Q_FUNC_INFO << ": " << errorMessage;
+          return errorMessage;
+        }
+      }
+      else
+      {
+        errorMessage = tr("Invalid beam");
         qCritical() << Q_FUNC_INFO << ": " << errorMessage;
         return errorMessage;
       }
     }
-    else
-    {
-      errorMessage = tr("Invalid beam");
-      qCritical() << Q_FUNC_INFO << ": " << errorMessage;
-      return errorMessage;
-    }
   }
 
   progress = (double)numberOfBeams / (numberOfBeams+1);
@@ -255,6 +296,8 @@ QString qSlicerDoseEngineLogic::calculateDose(vtkMRMLRTPlanNode* planNode)
 //---------------------------------------------------------------------------
 QString qSlicerDoseEngineLogic::calculateDoseInfluenceMatrix(vtkMRMLRTPlanNode* planNode)
 {
+  Q_D(qSlicerDoseEngineLogic);
+
   QString errorMessage("");
   if (!planNode || !planNode->GetScene())
   {
@@ -280,34 +323,160 @@ QString qSlicerDoseEngineLogic::calculateDoseInfluenceMatrix(vtkMRMLRTPlanNode*
   int currentBeamIndex = 0;
   double progress = 0.0;
 
-  for (std::vector<vtkMRMLRTBeamNode*>::iterator beamIt = beams.begin(); beamIt != beams.end(); ++beamIt, ++currentBeamIndex)
+  if (selectedEngine->isThreadSafe() && d->ParallelBeamCalculationEnabled && numberOfBeams > 1)
   {
-    vtkMRMLRTBeamNode* beamNode = (*beamIt);
-    if (beamNode)
+    // Calculate the beams concurrently (progress is reported as the beams finish)
+    errorMessage = this->calculateBeamsInParallel(selectedEngine, beams, true);
+    if (!errorMessage.isEmpty())
     {
-      progress = (double)currentBeamIndex / (numberOfBeams + 1);
-      emit progressUpdated(progress);
-
-      // Calculate dose for current beam
-      errorMessage = selectedEngine->calculateDoseInfluenceMatrix(beamNode);
-      if (!errorMessage.isEmpty())
+      qCritical() << Q_FUNC_INFO << ": " << errorMessage;
+      return errorMessage;
+    }
+  }
+  else
+  {
+    for (std::vector<vtkMRMLRTBeamNode*>::iterator beamIt = beams.begin(); beamIt != beams.end(); ++beamIt, ++currentBeamIndex)
+    {
+      vtkMRMLRTBeamNode* beamNode = (*beamIt);
+      if (beamNode)
+      {
+        progress = (double)currentBeamIndex / (numberOfBeams + 1);
+        emit progressUpdated(progress);
+
+        // Calculate dose for current beam
+        errorMessage = selectedEngine->calculateDoseInfluenceMatrix(beamNode);
+        if (!errorMessage.isEmpty())
+        {
+          qCritical() << Q_FUNC_INFO << ": " << errorMessage;
+          return errorMessage;
+        }
+      }
+      else
       {
+        errorMessage = tr("Invalid beam");
         qCritical() << Q_FUNC_INFO << ": " << errorMessage;
         return errorMessage;
       }
     }
-    else
+  }
+
+  progress = (double)numberOfBeams / (numberOfBeams + 1);
+  emit progressUpdated(progress);
+
+  return QString();
+}
+
+//---------------------------------------------------------------------------
+QString qSlicerDoseEngineLogic::calculateBeamsInParallel(
+  qSlicerAbstractDoseEngine* engine, std::vector<vtkMRMLRTBeamNode*>& beams, bool doseInfluenceMatrix)
+{
+  if (!engine)
+  {
+    QString errorMessage(tr("Invalid dose engine"));
+    qCritical() << Q_FUNC_INFO << ": " << errorMessage;
+    return errorMessage;
+  }
+  if (doseInfluenceMatrix && !engine->isInverse())
+  {
+    QString errorMessage(tr("Dose engine lacks functionality for calculating a dose influence matrix for inverse planning"));
+    qCritical() << Q_FUNC_INFO << ": " << errorMessage;
+    return errorMessage;
+  }
+  int numberOfBeams = beams.size();
+
+  // Prepare the beams and create the result dose volumes on the main thread. The result dose volumes
+  // are added to the scene only after the calculation, because the scene must not be modified by the workers
+  std::vector<vtkSmartPointer<vtkMRMLScalarVolumeNode> > resultDoseVolumeNodes(numberOfBeams);
+  for (int beamIndex = 0; beamIndex < numberOfBeams; ++beamIndex)
+  {
+    vtkMRMLRTBeamNode* beamNode = beams[beamIndex];
+    if (!beamNode)
     {
-      errorMessage = tr("Invalid beam");
+      QString errorMessage(tr("Invalid beam"));
       qCritical() << Q_FUNC_INFO << ": " << errorMessage;
       return errorMessage;
     }
+    QString errorMessage = engine->prepareDoseCalculation(beamNode);
+    if (!errorMessage.isEmpty())
+    {
+      return errorMessage;
+    }
+    if (!doseInfluenceMatrix)
+    {
+      resultDoseVolumeNodes[beamIndex] = vtkSmartPointer<vtkMRMLScalarVolumeNode>::New();
+      // Give default name for result node (engine can give it a more meaningful name)
+      std::string resultDoseNodeName = std::string(beamNode->GetName()) + "_Dose";
+      resultDoseVolumeNodes[beamIndex]->SetName(resultDoseNodeName.c_str());
+    }
   }
 
-  progress = (double)numberOfBeams / (numberOfBeams + 1);
-  emit progressUpdated(progress);
+  // Calculate the beams on worker threads. Each worker takes the next beam that has not been started yet
+  std::vector<QString> errorMessages(numberOfBeams);
+  std::atomic<int> nextBeamIndex(0);
+  int numberOfFinishedBeams = 0;
+  std::mutex finishedMutex;
+  std::condition_variable beamFinished;
+  auto calculateBeams = [&]()
+  {
+    for (int beamIndex = nextBeamIndex++; beamIndex < numberOfBeams; beamIndex = nextBeamIndex++)
+    {
+      QString errorMessage = doseInfluenceMatrix
+        ? engine->calculateDoseInfluenceMatrixUsingEngine(beams[beamIndex])
+        : engine->calculateDoseUsingEngine(beams[beamIndex], resultDoseVolumeNodes[beamIndex]);
+      {
+        std::lock_guard<std::mutex> lock(finishedMutex);
+        errorMessages[beamIndex] = errorMessage;
+        ++numberOfFinishedBeams;
+      }
+      beamFinished.notify_one();
+    }
+  };
 
-  return QString();
+  int numberOfThreads = std::min<int>(numberOfBeams, std::max<unsigned int>(1, std::thread::hardware_concurrency()));
+  std::vector<std::thread> threads;
+  for (int threadIndex = 0; threadIndex < numberOfThreads; ++threadIndex)
+  {
+    threads.emplace_back(calculateBeams);
+  }
+
+  // Report the aggregated progress on the main thread as the beams finish
+  emit progressUpdated(0.0);
+  int numberOfReportedBeams = 0;
+  while (numberOfReportedBeams < numberOfBeams)
+  {
+    {
+      std::unique_lock<std::mutex> lock(finishedMutex);
+      beamFinished.wait(lock, [&]() { return numberOfFinishedBeams > numberOfReportedBeams; });
+      numberOfReportedBeams = numberOfFinishedBeams;
+    }
+    emit progressUpdated((double)numberOfReportedBeams / (numberOfBeams+1));
+  }
+  for (std::thread& thread : threads)
+  {
+    thread.join();
+  }
+
+  // Add the results to the scene in the order of the beams
+  QString firstErrorMessage;
+  for (int beamIndex = 0; beamIndex < numberOfBeams; ++beamIndex)
+  {
+    if (!errorMessages[beamIndex].isEmpty())
+    {
+      qCritical() << Q_FUNC_INFO << ": Failed to calculate beam " << beams[beamIndex]->GetName() << ": " << errorMessages[beamIndex];
+      if (firstErrorMessage.isEmpty())
+      {
+        firstErrorMessage = errorMessages[beamIndex];
+      }
+      continue;
+    }
+    if (!doseInfluenceMatrix)
+    {
+      beams[beamIndex]->GetScene()->AddNode(resultDoseVolumeNodes[beamIndex]);
+      engine->addResultDose(resultDoseVolumeNodes[beamIndex], beams[beamIndex]);
+    }
+  }
+
+  return firstErrorMessage;
 }
 
 //---------------------------------------------------------------------------
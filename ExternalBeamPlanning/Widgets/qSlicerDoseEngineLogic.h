@@ -34,9 +34,13 @@
 // Qt includes
 #include <QObject>
 
+// STD includes
+#include <vector>
+
 class vtkMRMLScene;
 class vtkMRMLRTPlanNode;
 class vtkMRMLRTBeamNode;
+class qSlicerAbstractDoseEngine;
 class qSlicerDoseEngineLogicPrivate;
 
 /// \ingroup SlicerRt_QtModules_ExternalBeamPlanning
@@ -59,12 +63,21 @@ public:
   /// Set the current MRML scene to the widget
   Q_INVOKABLE virtual void setMRMLScene(vtkMRMLScene* scene);
 
-  /// Calculate dose for a plan
+  /// Calculate dose for a plan.
+  /// The beams are calculated concurrently if the dose engine is thread-safe (\sa qSlicerAbstractDoseEngine::isThreadSafe)
+  /// and parallel beam calculation is enabled
   Q_INVOKABLE QString calculateDose(vtkMRMLRTPlanNode* planNode);
 
-  /// Calculate dose influence matrix for a plan
+  /// Calculate dose influence matrix for a plan.
+  /// The beams are calculated concurrently if the dose engine is thread-safe and parallel beam calculation is enabled
   Q_INVOKABLE QString calculateDoseInfluenceMatrix(vtkMRMLRTPlanNode* planNode);
 
+  /// Enable calculating the beams of a plan concurrently on worker threads with thread-safe dose engines.
+  /// Enabled by default
+  Q_INVOKABLE void setParallelBeamCalculationEnabled(bool enabled);
+  /// Get whether the beams of a plan are calculated concurrently with thread-safe dose engines
+  Q_INVOKABLE bool parallelBeamCalculationEnabled()const;
+
   /// Accumulate per-beam dose volumes for each beam under given plan. The accumulated
   /// total dose is
   Q_INVOKABLE QString createAccumulatedDose(vtkMRMLRTPlanNode* planNode);
@@ -96,7 +109,15 @@ protected slots:
   void onSceneImportEnded(vtkObject* sceneObject);
 
 protected:
-  QScopedPointer<qSlicerDoseEngineLogic> d_ptr;
+  /// Calculate dose or dose influence matrix for the given beams concurrently on worker threads.
+  /// The beams are prepared and the result dose volumes are added to the scene on the calling (main) thread,
+  /// in the order of the beams, so that the scene is not modified by the worker threads.
+  /// \param doseInfluenceMatrix Calculate dose influence matrices if true, dose volumes otherwise
+  /// \return Error message of the first failed beam. Empty string on success
+  QString calculateBeamsInParallel(qSlicerAbstractDoseEngine* engine, std::vector<vtkMRMLRTBeamNode*>& beams, bool doseInfluenceMatrix);
+
+protected:
+  QScopedPointer<qSlicerDoseEngineLogicPrivate> d_ptr;
 
 private:
   Q_DECLARE_PRIVATE(qSlicerDoseEngineLogic);
@@ -0,0 +1,129 @@
+#include "qSlicerDoseInfluenceMatrix.h"
+
+// VTK includes
+#include <vtkSMPTools.h>
+
+namespace
+{
+//-----------------------------------------------------------------------------
+/// y[i] = sum_k values[k] * x[indices[k]] for k in [starts[i], starts[i+1])
+template <typename ValueType>
+void MultiplyCompressed(const std::vector<int>& starts, const std::vector<int>& indices,
+  const std::vector<ValueType>& values, const double* x, double* y, int n)
+{
+  const int* startsPtr = starts.data();
+  const int* indicesPtr = indices.data();
+  const ValueType* valuesPtr = values.data();
+  vtkSMPTools::For(0, n, [=](vtkIdType begin, vtkIdType end)
+  {
+    for (vtkIdType i = begin; i < end; ++i)
+    {
+      double sum = 0.0;
+      for (int k = startsPtr[i]; k < startsPtr[i + 1]; ++k)
+        sum += static_cast<double>(valuesPtr[k]) * x[indicesPtr[k]];
+      y[i] = sum;
+    }
+  });
+}
+}
+
+//-----------------------------------------------------------------------------
+qSlicerDoseInfluenceMatrix::qSlicerDoseInfluenceMatrix() = default;
+
+//-----------------------------------------------------------------------------
+qSlicerDoseInfluenceMatrix::qSlicerDoseInfluenceMatrix(const MatrixType& matrix, bool singlePrecision)
+{
+  this->setMatrix(matrix, singlePrecision);
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerDoseInfluenceMatrix::setMatrix(const MatrixType& matrix, bool singlePrecision)
+{
+  m_Rows = static_cast<int>(matrix.rows());
+  m_Cols = static_cast<int>(matrix.cols());
+  m_SinglePrecision = singlePrecision;
+  const int nnz = static_cast<int>(matrix.nonZeros());
+
+  std::vector<double>().swap(m_RowValues);
+  std::vector<float>().swap(m_RowValuesFloat);
+  std::vector<double>().swap(m_ColumnValues);
+  std::vector<float>().swap(m_ColumnValuesFloat);
+  if (singlePrecision)
+  {
+    m_RowValuesFloat.resize(nnz);
+    m_ColumnValuesFloat.resize(nnz);
+  }
+  else
+  {
+    m_RowValues.resize(nnz);
+    m_ColumnValues.resize(nnz);
+  }
+
+  // Column layout: copy of the input (which may be uncompressed, so it is read by the iterators)
+  m_ColumnStarts.assign(m_Cols + 1, 0);
+  m_RowIndices.resize(nnz);
+  std::vector<int> rowCounts(m_Rows + 1, 0);
+  int k = 0;
+  for (int col = 0; col < m_Cols; ++col)
+  {
+    m_ColumnStarts[col] = k;
+    for (MatrixType::InnerIterator it(matrix, col); it; ++it, ++k)
+    {
+      m_RowIndices[k] = static_cast<int>(it.row());
+      if (singlePrecision)
+        m_ColumnValuesFloat[k] = static_cast<float>(it.value());
+      else
+        m_ColumnValues[k] = it.value();
+      ++rowCounts[it.row() + 1];
+    }
+  }
+  m_ColumnStarts[m_Cols] = k;
+
+  // Row layout: counting transpose of the column layout. Columns are visited in increasing order,
+  // so the column indices within each row are sorted.
+  m_RowStarts.assign(m_Rows + 1, 0);
+  for (int row = 0; row < m_Rows; ++row)
+    m_RowStarts[row + 1] = m_RowStarts[row] + rowCounts[row + 1];
+  std::vector<int> cursor(m_RowStarts.begin(), m_RowStarts.end() - 1);
+  m_ColumnIndices.resize(nnz);
+  for (int col = 0; col < m_Cols; ++col)
+  {
+    for (int j = m_ColumnStarts[col]; j < m_ColumnStarts[col + 1]; ++j)
+    {
+      int dest = cursor[m_RowIndices[j]]++;
+      m_ColumnIndices[dest] = col;
+      if (singlePrecision)
+        m_RowValuesFloat[dest] = m_ColumnValuesFloat[j];
+      else
+        m_RowValues[dest] = m_ColumnValues[j];
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+size_t qSlicerDoseInfluenceMatrix::memorySize() const
+{
+  return (m_RowStarts.size() + m_ColumnIndices.size() + m_ColumnStarts.size() + m_RowIndices.size()) * sizeof(int)
+    + (m_RowValues.size() + m_ColumnValues.size()) * sizeof(double)
+    + (m_RowValuesFloat.size() + m_ColumnValuesFloat.size()) * sizeof(float);
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerDoseInfluenceMatrix::multiply(const Eigen::VectorXd& w, Eigen::VectorXd& dose) const
+{
+  dose.resize(m_Rows);
+  if (m_SinglePrecision)
+    MultiplyCompressed(m_RowStarts, m_ColumnIndices, m_RowValuesFloat, w.data(), dose.data(), m_Rows);
+  else
+    MultiplyCompressed(m_RowStarts, m_ColumnIndices, m_RowValues, w.data(), dose.data(), m_Rows);
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerDoseInfluenceMatrix::multiplyTransposed(const Eigen::VectorXd& g, Eigen::VectorXd& result) const
+{
+  result.resize(m_Cols);
+  if (m_SinglePrecision)
+    MultiplyCompressed(m_ColumnStarts, m_RowIndices, m_ColumnValuesFloat, g.data(), result.data(), m_Cols);
+  else
+    MultiplyCompressed(m_ColumnStarts, m_RowIndices, m_ColumnValues, g.data(), result.data(), m_Cols);
+}
@@ -0,0 +1,65 @@
+#ifndef __qSlicerDoseInfluenceMatrix_h
+#define __qSlicerDoseInfluenceMatrix_h
+
+#include "qSlicerExternalBeamPlanningModuleWidgetsExport.h"
+
+#include <itkeigen/Eigen/Dense>
+#include <itkeigen/Eigen/Sparse>
+
+#include <vector>
+
+/// \ingroup SlicerRt_QtModules_ExternalBeamPlanning
+/// \brief Multi-threaded products with a dose influence matrix D (rows = voxels, cols = bixels).
+///
+/// The optimizer computes the dose D*w and the gradient D^T*g in every iteration. Both products are
+/// parallelized over their output elements, so each of them needs its own layout of D: the rows
+/// (CSR) for D*w and the columns (CSC) for D^T*g. Each output element is summed by one thread in a
+/// fixed order, so the results do not depend on the number of threads.
+///
+/// The values can be stored in single precision to halve the memory traffic of the products, which
+/// are limited by memory bandwidth. The products are accumulated in double precision in both modes.
+class Q_SLICER_MODULE_EXTERNALBEAMPLANNING_WIDGETS_EXPORT qSlicerDoseInfluenceMatrix
+{
+public:
+  /// Same layout as vtkMRMLRTBeamNode::DoseInfluenceMatrixType
+  using MatrixType = Eigen::SparseMatrix<double, Eigen::ColMajor, int>;
+
+  qSlicerDoseInfluenceMatrix();
+  explicit qSlicerDoseInfluenceMatrix(const MatrixType& matrix, bool singlePrecision = false);
+
+  /// Build the row and column layouts from a column-major influence matrix.
+  /// The input matrix is not referenced afterwards.
+  void setMatrix(const MatrixType& matrix, bool singlePrecision = false);
+
+  int rows() const { return m_Rows; }
+  int cols() const { return m_Cols; }
+  int nonZeros() const { return static_cast<int>(m_ColumnIndices.size()); }
+  bool isSinglePrecision() const { return m_SinglePrecision; }
+
+  /// Memory used by the two layouts in bytes
+  size_t memorySize() const;
+
+  /// dose = D * w. \param w must have cols() elements.
+  void multiply(const Eigen::VectorXd& w, Eigen::VectorXd& dose) const;
+  /// result = D^T * g. \param g must have rows() elements.
+  void multiplyTransposed(const Eigen::VectorXd& g, Eigen::VectorXd& result) const;
+
+protected:
+  int m_Rows{0};
+  int m_Cols{0};
+  bool m_SinglePrecision{false};
+
+  /// Row layout (CSR), used for D * w
+  std::vector<int> m_RowStarts;
+  std::vector<int> m_ColumnIndices;
+  std::vector<double> m_RowValues;
+  std::vector<float> m_RowValuesFloat;
+
+  /// Column layout (CSC), used for D^T * g
+  std::vector<int> m_ColumnStarts;
+  std::vector<int> m_RowIndices;
+  std::vector<double> m_ColumnValues;
+  std::vector<float> m_ColumnValuesFloat;
+};
+
+#endif
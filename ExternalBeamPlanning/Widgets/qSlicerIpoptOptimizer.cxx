@@ -14,6 +14,7 @@
 #include "qSlicerMinMaxDVHConstraint.h"
 #include "qSlicerMinMaxEUDConstraint.h"
 #include "qSlicerMinMaxMeanDoseConstraint.h"
+#include "qSlicerDoseInfluenceMatrix.h"
 
 // Beams includes
 #include "vtkMRMLRTBeamNode.h"
@@ -45,6 +46,8 @@
 #include <QDebug>
 
 // STL includes
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <regex>
 #include <cassert>
@@ -113,6 +116,46 @@ public:
   // Empty → fall back to dense m×n pattern.
   std::vector<std::pair<int,int>> jacSparsityPattern;
   int numJacNonzeros = 0;
+
+  /// Doses of the structures at the most recent iterate. IPOPT evaluates the objective, gradient,
+  /// constraints and constraint Jacobian at the same iterate, so the doses (the sparse D·w products)
+  /// are computed once per iterate and shared by the callbacks instead of being recomputed in each.
+  class DoseCache
+  {
+  public:
+    /// Computes the doses of all structures from the weights
+    using DoseFunction = std::function<void(const Eigen::VectorXd&, std::vector<Eigen::VectorXd>&)>;
+
+    explicit DoseCache(DoseFunction function) : doseFunction(std::move(function)) {}
+
+    /// Get the doses at iterate w. They are only computed if w differs from the cached iterate.
+    const std::vector<Eigen::VectorXd>& getDoses(const qSlicerIpoptOptimizer::Array& w)
+    {
+      ++numRequests;
+      if (!valid || w != iterate)
+      {
+        iterate = w;
+        doseFunction(Eigen::Map<const Eigen::VectorXd>(w.data(), w.size()), doses);
+        valid = true;
+        ++numComputations;
+      }
+      return doses;
+    }
+
+    int getNumberOfRequests() const { return numRequests; }
+    int getNumberOfComputations() const { return numComputations; }
+
+  private:
+    DoseFunction doseFunction;
+    qSlicerIpoptOptimizer::Array iterate;
+    std::vector<Eigen::VectorXd> doses;
+    bool valid = false;
+    int numRequests = 0;
+    int numComputations = 0;
+  };
+  // Dose cache shared by the callbacks wired from the structure terms or the plan objectives.
+  // Null if the callbacks were set directly.
+  std::shared_ptr<DoseCache> doseCache;
 };
 
 //-----------------------------------------------------------------------------
@@ -131,6 +174,12 @@ private:
   double  bestInfPr = std::numeric_limits<double>::max();
   Array   lastEvalX;  // x seen in the most recent eval_f call
 
+  // Iteration timing, measured between consecutive intermediate callbacks
+  std::chrono::steady_clock::time_point lastIterationTime;
+  double totalIterationTimeSec = 0.0;
+  double maxIterationTimeSec = 0.0;
+  int    numTimedIterations = 0;
+
 public:
   IpoptProblem(qSlicerIpoptOptimizerPrivate* dPtr, const Array& initialPoint)
     : d(dPtr), x0(initialPoint), n(static_cast<int>(initialPoint.size()))
@@ -203,6 +252,16 @@ public:
       bestInfPr = inf_pr;
       bestX     = lastEvalX;
     }
+
+    // The first callback is made for the starting point, the iterations are timed from there
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (iter > 0) {
+      double iterationTimeSec = std::chrono::duration<double>(now - lastIterationTime).count();
+      totalIterationTimeSec += iterationTimeSec;
+      maxIterationTimeSec = std::max(maxIterationTimeSec, iterationTimeSec);
+      ++numTimedIterations;
+    }
+    lastIterationTime = now;
     return true;
   }
 
@@ -255,8 +314,9 @@ public:
       if (!d->constraintJacobianFunction) return false;
       Array xvec(x, x + n);
       Array jac = d->constraintJacobianFunction(xvec);
-      for (Index k2 = 0; k2 < nele_jac; k2++)
-        values[k2] = (k2 < static_cast<Index>(jac.size())) ? jac[k2] : 0.0;
+      // Values must correspond one-to-one to the declared sparsity pattern
+      if (static_cast<Index>(jac.size()) != nele_jac) return false;
+      std::copy(jac.begin(), jac.end(), values);
     }
     return true;
   }
@@ -275,6 +335,16 @@ public:
     d->lastResult.final_objective_value = obj_value;
     d->lastResult.status = static_cast<ApplicationReturnStatus>(status);
     d->lastResult.success = (status == SUCCESS || status == STOP_AT_ACCEPTABLE_POINT);
+
+    if (numTimedIterations > 0) {
+      qDebug() << "IPOPT iterations:" << numTimedIterations
+               << "- mean iteration time:" << 1000.0 * totalIterationTimeSec / numTimedIterations << "ms"
+               << "- max iteration time:" << 1000.0 * maxIterationTimeSec << "ms";
+    }
+    if (d->doseCache) {
+      qDebug() << "IPOPT dose evaluations:" << d->doseCache->getNumberOfComputations()
+               << "for" << d->doseCache->getNumberOfRequests() << "callback evaluations";
+    }
   }
 };
 
@@ -446,6 +516,7 @@ void qSlicerIpoptOptimizer::clearStructureTerms()
   d->numConstraints             = 0;
   d->jacSparsityPattern.clear();
   d->numJacNonzeros             = 0;
+  d->doseCache                  = nullptr;
 }
 
 //-----------------------------------------------------------------------------
@@ -472,19 +543,38 @@ qSlicerIpoptOptimizer::Result qSlicerIpoptOptimizer::solveProblem(const Array& x
 {
   Q_D(qSlicerIpoptOptimizer);
 
-  // Auto-wire objective/gradient from structure terms when no explicit function is set
-  if (!d->structureTerms.empty())
+  // Auto-wire objective/gradient from structure terms when no explicit function is set.
+  // The doses of the structure terms are followed by those of the constraint terms in the dose cache.
+  auto sharedTerms = std::make_shared<std::vector<qSlicerIpoptOptimizerPrivate::StructureTerm>>(
+    d->structureTerms);
+  auto sharedCon = std::make_shared<std::vector<qSlicerIpoptOptimizerPrivate::ConstraintTerm>>(
+    d->constraintTerms);
+  if (!sharedTerms->empty() || !sharedCon->empty())
   {
-    auto sharedTerms = std::make_shared<std::vector<qSlicerIpoptOptimizerPrivate::StructureTerm>>(
-      d->structureTerms);
+    d->doseCache = std::make_shared<qSlicerIpoptOptimizerPrivate::DoseCache>(
+      [sharedTerms, sharedCon](const Eigen::VectorXd& wv, std::vector<Eigen::VectorXd>& doses)
+    {
+      doses.resize(sharedTerms->size() + sharedCon->size());
+      size_t k = 0;
+      for (const auto& t : *sharedTerms)
+        doses[k++] = t.D * wv;
+      for (const auto& t : *sharedCon)
+        doses[k++] = t.D * wv;
+    });
+  }
+  std::shared_ptr<qSlicerIpoptOptimizerPrivate::DoseCache> doseCache = d->doseCache;
+  const size_t conDoseOffset = sharedTerms->size();
 
-    d->objectiveFunction = [sharedTerms](const Array& w) -> double
+  if (!sharedTerms->empty())
+  {
+    d->objectiveFunction = [sharedTerms, doseCache](const Array& w) -> double
     {
-      Eigen::VectorXd wv = Eigen::Map<const Eigen::VectorXd>(w.data(), w.size());
+      const std::vector<Eigen::VectorXd>& doses = doseCache->getDoses(w);
       double total = 0.0;
-      for (const auto& t : *sharedTerms)
+      for (size_t ti = 0; ti < sharedTerms->size(); ++ti)
       {
-        Eigen::VectorXd dose = t.D * wv;
+        const auto& t = (*sharedTerms)[ti];
+        const Eigen::VectorXd& dose = doses[ti];
         double f = 0.0;
         if (t.objectiveType == "SquaredOverdosing") {
           for (int i = 0; i < dose.size(); ++i) {
@@ -514,14 +604,15 @@ qSlicerIpoptOptimizer::Result qSlicerIpoptOptimizer::solveProblem(const Array& x
       return total;
     };
 
-    d->gradientFunction = [sharedTerms](const Array& w) -> Array
+    d->gradientFunction = [sharedTerms, doseCache](const Array& w) -> Array
     {
       int n = static_cast<int>(w.size());
-      Eigen::VectorXd wv = Eigen::Map<const Eigen::VectorXd>(w.data(), n);
+      const std::vector<Eigen::VectorXd>& doses = doseCache->getDoses(w);
       Eigen::VectorXd grad = Eigen::VectorXd::Zero(n);
-      for (const auto& t : *sharedTerms)
+      for (size_t ti = 0; ti < sharedTerms->size(); ++ti)
       {
-        Eigen::VectorXd dose = t.D * wv;
+        const auto& t = (*sharedTerms)[ti];
+        const Eigen::VectorXd& dose = doses[ti];
         Eigen::VectorXd gDose = Eigen::VectorXd::Zero(dose.size());
         if (t.objectiveType == "SquaredOverdosing") {
           for (int i = 0; i < dose.size(); ++i) {
@@ -553,11 +644,8 @@ qSlicerIpoptOptimizer::Result qSlicerIpoptOptimizer::solveProblem(const Array& x
   }
 
   // Auto-wire constraints from constraintTerms when present
-  if (!d->constraintTerms.empty())
+  if (!sharedCon->empty())
   {
-    auto sharedCon = std::make_shared<std::vector<qSlicerIpoptOptimizerPrivate::ConstraintTerm>>(
-      d->constraintTerms);
-
     int numCon = static_cast<int>(d->constraintTerms.size());
     d->numConstraints = numCon;
 
@@ -577,15 +665,16 @@ qSlicerIpoptOptimizer::Result qSlicerIpoptOptimizer::solveProblem(const Array& x
 
     // g_i(w) = logsumexp( D_i·w, T)          for MaxDose  → constrained ≤ bound
     // g_i(w) = −logsumexp(−D_i·w, T)         for MinDose  → constrained ≥ bound
-    d->constraintFunction = [sharedCon](const qSlicerIpoptOptimizer::Array& w)
+    d->constraintFunction = [sharedCon, doseCache, conDoseOffset](const qSlicerIpoptOptimizer::Array& w)
       -> qSlicerIpoptOptimizer::Array
     {
-      Eigen::VectorXd wv = Eigen::Map<const Eigen::VectorXd>(w.data(), w.size());
+      const std::vector<Eigen::VectorXd>& doses = doseCache->getDoses(w);
       qSlicerIpoptOptimizer::Array g;
       g.reserve(sharedCon->size());
-      for (const auto& t : *sharedCon)
+      for (size_t ci = 0; ci < sharedCon->size(); ++ci)
       {
-        Eigen::VectorXd dose = t.D * wv;
+        const auto& t = (*sharedCon)[ci];
+        Eigen::VectorXd dose = doses[conDoseOffset + ci];
         if (t.constraintType == "MinDose") dose = -dose;
         // numerically stable logsumexp
         double dmax = dose.maxCoeff();
@@ -613,10 +702,10 @@ qSlicerIpoptOptimizer::Result qSlicerIpoptOptimizer::solveProblem(const Array& x
 
     // Sparse Jacobian: for each (ci, j) in pattern, value = D_ci.col(j) · softmax(±dose_ci)
     auto sharedPat = std::make_shared<std::vector<std::pair<int,int>>>(d->jacSparsityPattern);
-    d->constraintJacobianFunction = [sharedCon, sharedPat](const qSlicerIpoptOptimizer::Array& w)
+    d->constraintJacobianFunction = [sharedCon, sharedPat, doseCache, conDoseOffset](const qSlicerIpoptOptimizer::Array& w)
       -> qSlicerIpoptOptimizer::Array
     {
-      Eigen::VectorXd wv = Eigen::Map<const Eigen::VectorXd>(w.data(), w.size());
+      const std::vector<Eigen::VectorXd>& doses = doseCache->getDoses(w);
       qSlicerIpoptOptimizer::Array vals(sharedPat->size());
       int curCi = -1;
       Eigen::VectorXd softw;
@@ -627,7 +716,7 @@ qSlicerIpoptOptimizer::Result qSlicerIpoptOptimizer::solveProblem(const Array& x
         if (ci != curCi)
         {
           const auto& t = (*sharedCon)[ci];
-          Eigen::VectorXd dose = t.D * wv;
+          Eigen::VectorXd dose = doses[conDoseOffset + ci];
           if (t.constraintType == "MinDose") dose = -dose;
           double dmax = dose.maxCoeff();
           Eigen::VectorXd expv(dose.size());
@@ -792,6 +881,7 @@ void qSlicerIpoptOptimizer::setOption(const QString& key, const QVariant& value)
   else if (key == "print_user_options")         d->options.print_user_options = value.toString();
   else if (key == "print_options_documentation") d->options.print_options_documentation = value.toString();
   else if (key == "print_timing_statistics")    d->options.print_timing_statistics = value.toString();
+  else if (key == "influence_matrix_single_precision") d->options.influence_matrix_single_precision = value.toBool();
 }
 
 //-----------------------------------------------------------------------------
@@ -802,6 +892,74 @@ qSlicerIpoptOptimizer::Result qSlicerIpoptOptimizer::getLastResult() const
   return d->lastResult;
 }
 
+//-----------------------------------------------------------------------------
+qSlicerIpoptOptimizer::JacobianSparsityType qSlicerIpoptOptimizer::computeConstraintJacobianSparsity(
+  const std::vector<qSlicerAbstractConstraint*>& constraints,
+  const std::vector<qSlicerAbstractConstraint::SparseJacobianType>& structureInfluenceMatrices)
+{
+  using RowMajorSparse = qSlicerAbstractConstraint::SparseJacobianType;
+  JacobianSparsityType sparsity;
+  int rowOffset = 0;
+  for (size_t i = 0; i < constraints.size() && i < structureInfluenceMatrices.size(); ++i)
+  {
+    const RowMajorSparse& sStruct = structureInfluenceMatrices[i];
+    int nv = static_cast<int>(sStruct.rows());
+
+    // Influence values are non-negative, but the pattern is computed on ones so that no entry can cancel
+    RowMajorSparse voxelPattern = constraints[i]->computeDoseConstraintJacobianPattern(nv);
+    RowMajorSparse sStructPattern = sStruct;
+    voxelPattern.coeffs().setOnes();
+    sStructPattern.coeffs().setOnes();
+    RowMajorSparse bixelPattern = voxelPattern * sStructPattern;
+    for (int ci = 0; ci < bixelPattern.outerSize(); ++ci)
+    {
+      std::vector<int> cols;
+      for (RowMajorSparse::InnerIterator it(bixelPattern, ci); it; ++it)
+        cols.push_back(static_cast<int>(it.col()));
+      std::sort(cols.begin(), cols.end());
+      for (int col : cols)
+        sparsity.emplace_back(rowOffset + ci, col);
+    }
+    rowOffset += static_cast<int>(voxelPattern.rows());
+  }
+  return sparsity;
+}
+
+//-----------------------------------------------------------------------------
+qSlicerIpoptOptimizer::Array qSlicerIpoptOptimizer::computeConstraintJacobianValues(
+  const std::vector<qSlicerAbstractConstraint*>& constraints,
+  const std::vector<qSlicerAbstractConstraint::SparseJacobianType>& structureInfluenceMatrices,
+  const std::vector<Eigen::VectorXd>& structureDoses, const JacobianSparsityType& sparsity, int doseOffset)
+{
+  // The rows of each structure are accumulated in a bixel-space scratch vector, which is cleared at the
+  // pattern entries after reading them
+  using RowMajorSparse = qSlicerAbstractConstraint::SparseJacobianType;
+  Array vals(sparsity.size(), 0.0);
+  int nBixels = (structureInfluenceMatrices.empty() ? 0 : static_cast<int>(structureInfluenceMatrices[0].cols()));
+  Eigen::VectorXd scratch = Eigen::VectorXd::Zero(nBixels);
+  size_t k = 0;
+  int rowOffset = 0;
+  for (size_t i = 0; i < constraints.size() && i < structureInfluenceMatrices.size() && doseOffset + i < structureDoses.size(); ++i)
+  {
+    const RowMajorSparse& sStruct = structureInfluenceMatrices[i];
+    RowMajorSparse Jdose = constraints[i]->computeDoseConstraintJacobianSparse(structureDoses[doseOffset + i]);
+    for (int ci = 0; ci < Jdose.outerSize(); ++ci)
+    {
+      for (RowMajorSparse::InnerIterator jt(Jdose, ci); jt; ++jt)
+        for (RowMajorSparse::InnerIterator st(sStruct, jt.col()); st; ++st)
+          scratch[st.col()] += jt.value() * st.value();
+      for (; k < sparsity.size() && sparsity[k].first == rowOffset + ci; ++k)
+      {
+        int col = sparsity[k].second;
+        vals[k] = scratch[col];
+        scratch[col] = 0.0;
+      }
+    }
+    rowOffset += static_cast<int>(Jdose.rows());
+  }
+  return vals;
+}
+
 //-----------------------------------------------------------------------------
 void qSlicerIpoptOptimizer::setAvailableObjectives()
 {
@@ -1099,51 +1257,106 @@ QString qSlicerIpoptOptimizer::optimizePlanUsingOptimizer(
   if (structObjs.empty() && structConstraints.empty())
     return tr("No valid objectives or constraints could be configured");
 
+  // ── Step 2b: restrict D to the voxels of the objectives and constraints ──
+  // Voxels outside all structures do not contribute to the objectives or constraints, so the
+  // solver uses only the rows of D for the union of the structure voxels (S). The voxel indices
+  // of the structures are remapped to rows of S, which keep the order of the dose grid voxels.
+
+  std::vector<int> voxelToRow(numVoxels, -1);
+  for (const auto& so : structObjs)
+    for (int voxelIndex : so.voxelIndices) voxelToRow[voxelIndex] = 0;
+  for (const auto& sc : structConstraints)
+    for (int voxelIndex : sc.voxelIndices) voxelToRow[voxelIndex] = 0;
+  int numStructureVoxels = 0;
+  for (int& row : voxelToRow)
+    if (row == 0) row = numStructureVoxels++; else row = -1;
+  for (auto& so : structObjs)
+    for (int& voxelIndex : so.voxelIndices) voxelIndex = voxelToRow[voxelIndex];
+  for (auto& sc : structConstraints)
+    for (int& voxelIndex : sc.voxelIndices) voxelIndex = voxelToRow[voxelIndex];
+
+  std::vector<Triplet>().swap(triplets);
+  for (int k = 0; k < D.outerSize(); ++k)
+    for (SparseD::InnerIterator it(D, k); it; ++it)
+      if (voxelToRow[it.row()] >= 0)
+        triplets.emplace_back(voxelToRow[it.row()], static_cast<int>(it.col()), it.value());
+  SparseD S(numStructureVoxels, totalBixels);
+  S.setFromTriplets(triplets.begin(), triplets.end());
+  std::vector<Triplet>().swap(triplets);
+
+  qDebug() << "IPOPT plan optimization uses" << numStructureVoxels << "of" << numVoxels
+           << "dose grid voxels (" << S.nonZeros() << "of" << D.nonZeros() << "influence matrix non-zeros)";
+
   // ── Step 3: wire IPOPT objective and gradient as lambdas ──
-  // f(w) = Σ_i penalty_i * f_i( D[struct_i, :] * w )
-  // ∇f/∂w = Σ_i penalty_i * D[struct_i, :]ᵀ * ∇f_i( D[struct_i, :] * w )
+  // f(w) = Σ_i penalty_i * f_i( S[struct_i, :] * w )
+  // ∇f/∂w = Σ_i penalty_i * S[struct_i, :]ᵀ * ∇f_i( S[struct_i, :] * w )
 
   auto sharedSO = std::make_shared<std::vector<StructObj>>(std::move(structObjs));
-  auto sharedD  = std::make_shared<SparseD>(std::move(D));
+  auto sharedSC = std::make_shared<std::vector<StructConstraint>>(std::move(structConstraints));
+  bool singlePrecision = false;
+  {
+    Q_D(qSlicerIpoptOptimizer);
+    singlePrecision = d->options.influence_matrix_single_precision;
+  }
+  // Multi-threaded S·w and Sᵀ·g
+  auto sharedS  = std::make_shared<qSlicerDoseInfluenceMatrix>(S, singlePrecision);
 
-  setObjectiveFunction([sharedSO, sharedD](const Array& w) -> double
+  // The dose S·w is computed once per iterate. The cache holds the dose gathered for each objective
+  // structure, followed by the dose gathered for each constraint structure.
+  auto doseCache = std::make_shared<qSlicerIpoptOptimizerPrivate::DoseCache>(
+    [sharedSO, sharedSC, sharedS](const Eigen::VectorXd& wv, std::vector<Eigen::VectorXd>& doses)
   {
-    Eigen::VectorXd wv = Eigen::Map<const Eigen::VectorXd>(w.data(), w.size());
-    Eigen::VectorXd dose = (*sharedD) * wv;
+    Eigen::VectorXd dose;
+    sharedS->multiply(wv, dose);
+    doses.resize(sharedSO->size() + sharedSC->size());
+    auto gather = [&dose](const std::vector<int>& voxelIndices, Eigen::VectorXd& dStruct)
+    {
+      dStruct.resize(voxelIndices.size());
+      for (size_t j = 0; j < voxelIndices.size(); ++j)
+        dStruct[j] = dose[voxelIndices[j]];
+    };
+    size_t k = 0;
+    for (const auto& so : *sharedSO)
+      gather(so.voxelIndices, doses[k++]);
+    for (const auto& sc : *sharedSC)
+      gather(sc.voxelIndices, doses[k++]);
+  });
+  {
+    Q_D(qSlicerIpoptOptimizer);
+    d->doseCache = doseCache;
+  }
+  const size_t conDoseOffset = sharedSO->size();
+
+  setObjectiveFunction([sharedSO, doseCache](const Array& w) -> double
+  {
+    const std::vector<Eigen::VectorXd>& doses = doseCache->getDoses(w);
     double total = 0.0;
-    for (auto& so : *sharedSO)
+    for (size_t i = 0; i < sharedSO->size(); ++i)
     {
-      Eigen::VectorXd dStruct(so.voxelIndices.size());
-      for (size_t j = 0; j < so.voxelIndices.size(); ++j)
-        dStruct[j] = dose[so.voxelIndices[j]];
-      total += so.penalty * static_cast<double>(so.obj->computeDoseObjectiveFunction(dStruct));
+      const StructObj& so = (*sharedSO)[i];
+      total += so.penalty * static_cast<double>(so.obj->computeDoseObjectiveFunction(doses[i]));
     }
     return total;
   });
 
-  setGradientFunction([sharedSO, sharedD](const Array& w) -> Array
+  setGradientFunction([sharedSO, sharedS, doseCache](const Array& w) -> Array
   {
     int n = static_cast<int>(w.size());
-    Eigen::VectorXd wv = Eigen::Map<const Eigen::VectorXd>(w.data(), n);
-    Eigen::VectorXd dose = (*sharedD) * wv;
-    Eigen::VectorXd gradW = Eigen::VectorXd::Zero(n);
+    const std::vector<Eigen::VectorXd>& doses = doseCache->getDoses(w);
 
-    for (auto& so : *sharedSO)
+    // Scatter the structure gradients back to the structure voxels, then chain-rule through S once.
+    Eigen::VectorXd gDoseFull = Eigen::VectorXd::Zero(sharedS->rows());
+    for (size_t i = 0; i < sharedSO->size(); ++i)
     {
-      Eigen::VectorXd dStruct(so.voxelIndices.size());
-      for (size_t j = 0; j < so.voxelIndices.size(); ++j)
-        dStruct[j] = dose[so.voxelIndices[j]];
-
+      const StructObj& so = (*sharedSO)[i];
       Eigen::VectorXd gDoseStruct =
-        so.penalty * so.obj->computeDoseObjectiveGradient(dStruct);
+        so.penalty * so.obj->computeDoseObjectiveGradient(doses[i]);
 
-      // Scatter structure gradient back to full voxel space, then chain-rule through D.
-      Eigen::VectorXd gDoseFull = Eigen::VectorXd::Zero(sharedD->rows());
       for (size_t j = 0; j < so.voxelIndices.size(); ++j)
         gDoseFull[so.voxelIndices[j]] += gDoseStruct[j];
-
-      gradW += sharedD->transpose() * gDoseFull;
     }
+    Eigen::VectorXd gradW;
+    sharedS->multiplyTransposed(gDoseFull, gradW);
     return Array(gradW.data(), gradW.data() + n);
   });
 
@@ -1153,13 +1366,41 @@ QString qSlicerIpoptOptimizer::optimizePlanUsingOptimizer(
 
     // Compute total constraint count
     int totalCon = 0;
-    for (auto& sc : structConstraints)
+    for (auto& sc : *sharedSC)
       totalCon += sc.constraint->numConstraints(static_cast<int>(sc.voxelIndices.size()));
     d->numConstraints = totalCon;
+    d->jacSparsityPattern.clear();
+    d->numJacNonzeros = 0;
 
     if (totalCon > 0)
     {
-      auto sharedSC = std::make_shared<std::vector<StructConstraint>>(std::move(structConstraints));
+      // Sparse constraint Jacobian. For the constraints of a structure, dg/dw = (dg/d(dose)) * S_struct,
+      // where S_struct holds the rows of S for the structure voxels. Its sparsity pattern is the product
+      // of the voxel pattern declared by the constraint and the non-zeros of S_struct, computed once here.
+      using RowMajorSparse = qSlicerAbstractConstraint::SparseJacobianType;
+      int nBixels = static_cast<int>(sharedS->cols());
+      const RowMajorSparse sRows = S;
+      auto structMatrices = std::make_shared<std::vector<RowMajorSparse>>();
+      structMatrices->reserve(sharedSC->size());
+      auto constraints = std::make_shared<std::vector<qSlicerAbstractConstraint*>>();
+      constraints->reserve(sharedSC->size());
+      for (const auto& sc : *sharedSC)
+      {
+        int nv = static_cast<int>(sc.voxelIndices.size());
+        RowMajorSparse sStruct(nv, nBixels);
+        std::vector<Triplet> structTriplets;
+        for (int j = 0; j < nv; ++j)
+          for (RowMajorSparse::InnerIterator it(sRows, sc.voxelIndices[j]); it; ++it)
+            structTriplets.emplace_back(j, static_cast<int>(it.col()), it.value());
+        sStruct.setFromTriplets(structTriplets.begin(), structTriplets.end());
+
+        structMatrices->push_back(std::move(sStruct));
+        constraints->push_back(sc.constraint.get());
+      }
+      d->jacSparsityPattern = computeConstraintJacobianSparsity(*constraints, *structMatrices);
+      d->numJacNonzeros = static_cast<int>(d->jacSparsityPattern.size());
+      qDebug() << "IPOPT constraint Jacobian:" << totalCon << "constraints with"
+               << d->numJacNonzeros << "non-zeros (dense:" << static_cast<double>(totalCon) * nBixels << ")";
 
       d->constraintBoundsFunction = [sharedSC, totalCon]()
         -> std::pair<qSlicerIpoptOptimizer::Array, qSlicerIpoptOptimizer::Array>
@@ -1177,54 +1418,35 @@ QString qSlicerIpoptOptimizer::optimizePlanUsingOptimizer(
         return {lb, ub};
       };
 
-      d->constraintFunction = [sharedSC, sharedD, totalCon](const qSlicerIpoptOptimizer::Array& w)
+      d->constraintFunction = [sharedSC, doseCache, conDoseOffset, totalCon](const qSlicerIpoptOptimizer::Array& w)
         -> qSlicerIpoptOptimizer::Array
       {
-        Eigen::VectorXd wv = Eigen::Map<const Eigen::VectorXd>(w.data(), w.size());
-        Eigen::VectorXd dose = (*sharedD) * wv;
+        const std::vector<Eigen::VectorXd>& doses = doseCache->getDoses(w);
         qSlicerIpoptOptimizer::Array g;
         g.reserve(totalCon);
-        for (auto& sc : *sharedSC)
+        for (size_t i = 0; i < sharedSC->size(); ++i)
         {
-          Eigen::VectorXd dStruct(sc.voxelIndices.size());
-          for (size_t j = 0; j < sc.voxelIndices.size(); ++j)
-            dStruct[j] = dose[sc.voxelIndices[j]];
-          Eigen::VectorXd gv = sc.constraint->computeDoseConstraintFunction(dStruct);
-          for (int i = 0; i < gv.size(); ++i) g.push_back(gv[i]);
+          const StructConstraint& sc = (*sharedSC)[i];
+          Eigen::VectorXd gv = sc.constraint->computeDoseConstraintFunction(doses[conDoseOffset + i]);
+          for (int k = 0; k < gv.size(); ++k) g.push_back(gv[k]);
         }
         return g;
       };
 
-      d->constraintJacobianFunction = [sharedSC, sharedD, totalCon](const qSlicerIpoptOptimizer::Array& w)
+      // Values in the order of the sparsity pattern
+      auto sharedPat = std::make_shared<JacobianSparsityType>(d->jacSparsityPattern);
+      d->constraintJacobianFunction = [constraints, structMatrices, sharedPat, doseCache, conDoseOffset](const qSlicerIpoptOptimizer::Array& w)
         -> qSlicerIpoptOptimizer::Array
       {
-        int nBixels = static_cast<int>(sharedD->cols());
-        Eigen::VectorXd wv = Eigen::Map<const Eigen::VectorXd>(w.data(), w.size());
-        Eigen::VectorXd dose = (*sharedD) * wv;
-        qSlicerIpoptOptimizer::Array jac(totalCon * nBixels, 0.0);
-        int rowOffset = 0;
-        for (auto& sc : *sharedSC)
-        {
-          int nv = static_cast<int>(sc.voxelIndices.size());
-          Eigen::VectorXd dStruct(nv);
-          for (int j = 0; j < nv; ++j) dStruct[j] = dose[sc.voxelIndices[j]];
-          Eigen::MatrixXd Jdose = sc.constraint->computeDoseConstraintJacobian(dStruct);
-          int numCon = static_cast<int>(Jdose.rows());
-          for (int ci = 0; ci < numCon; ++ci)
-          {
-            Eigen::VectorXd jFull = Eigen::VectorXd::Zero(sharedD->rows());
-            for (int j = 0; j < nv; ++j) jFull[sc.voxelIndices[j]] = Jdose(ci, j);
-            Eigen::VectorXd jW = sharedD->transpose() * jFull;
-            for (int j = 0; j < nBixels; ++j)
-              jac[(rowOffset + ci) * nBixels + j] = jW[j];
-          }
-          rowOffset += numCon;
-        }
-        return jac;
+        const std::vector<Eigen::VectorXd>& doses = doseCache->getDoses(w);
+        return computeConstraintJacobianValues(*constraints, *structMatrices, doses, *sharedPat, conDoseOffset);
       };
     }
   }
 
+  // S is only needed for setting up the constraint Jacobian
+  SparseD().swap(S);
+
   // ── Step 4: solve ──
   emit progressInfoUpdated(tr("Starting IPOPT optimization..."));
 
@@ -1238,7 +1460,7 @@ QString qSlicerIpoptOptimizer::optimizePlanUsingOptimizer(
   // ── Step 5: compute and store result dose volume ──
   Eigen::VectorXd wOpt = Eigen::Map<Eigen::VectorXd>(
     result.solution.data(), result.solution.size());
-  Eigen::VectorXd doseOpt = (*sharedD) * wOpt;
+  Eigen::VectorXd doseOpt = D * wOpt;
 
   vtkNew<vtkImageData> doseImg;
   doseImg->SetDimensions(doseGridDim);
@@ -3,6 +3,7 @@
 
 // ExternalBeamPlanning includes
 #include "qSlicerAbstractPlanOptimizer.h"
+#include "qSlicerAbstractConstraint.h"
 #include "qSlicerExternalBeamPlanningModuleWidgetsExport.h"
 
 // Qt includes
@@ -87,6 +88,8 @@ public:
     QString limited_memory_initialization = "scalar2";
     QString linear_solver = "mumps";
     QString print_timing_statistics = "yes";
+    /// Not passed to IPOPT: store the influence matrix values of plan optimization in single precision
+    bool influence_matrix_single_precision = false;
   };
 
   struct Result {
@@ -154,6 +157,24 @@ public:
 
   Result getLastResult() const;
 
+  using JacobianSparsityType = std::vector<std::pair<int,int>>;
+
+  /// Sparsity pattern of the constraint Jacobian dg/dw of plan optimization, as (row, column) pairs in row-major order.
+  /// For the constraints of structure i, dg/dw = (dg/d(dose)) * structureInfluenceMatrices[i], where the matrix holds
+  /// the rows of the influence matrix for the structure voxels. The pattern is the product of the voxel pattern
+  /// declared by the constraint and the non-zeros of the structure matrix. The rows of the structures follow each other.
+  static JacobianSparsityType computeConstraintJacobianSparsity(
+    const std::vector<qSlicerAbstractConstraint*>& constraints,
+    const std::vector<qSlicerAbstractConstraint::SparseJacobianType>& structureInfluenceMatrices);
+
+  /// Values of the constraint Jacobian at the entries of \a sparsity (\sa computeConstraintJacobianSparsity), in the same order.
+  /// Exactly one value is returned for each pattern entry.
+  /// \param structureDoses Dose of the structure voxels. Constraint i uses structureDoses[doseOffset + i].
+  static Array computeConstraintJacobianValues(
+    const std::vector<qSlicerAbstractConstraint*>& constraints,
+    const std::vector<qSlicerAbstractConstraint::SparseJacobianType>& structureInfluenceMatrices,
+    const std::vector<Eigen::VectorXd>& structureDoses, const JacobianSparsityType& sparsity, int doseOffset = 0);
+
 signals:
   void iterationUpdate(int iteration, double objectiveValue);
   void optimizationCompleted(bool success, const QString& message);
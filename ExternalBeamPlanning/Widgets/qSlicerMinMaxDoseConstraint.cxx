@@ -106,6 +106,32 @@ qSlicerMinMaxDoseConstraint::computeDoseConstraintJacobian(const DoseType& dose)
   return jac;
 }
 
+qSlicerAbstractConstraint::SparseJacobianType
+qSlicerMinMaxDoseConstraint::computeDoseConstraintJacobianPattern(int numVoxels)
+{
+  int mode = this->constraintParameters["mode"].toInt();
+  if (mode != 1)
+    return Superclass::computeDoseConstraintJacobianPattern(numVoxels);
+
+  // Voxel-wise: each constraint depends on the dose of its own voxel only
+  SparseJacobianType pattern(numVoxels, numVoxels);
+  pattern.setIdentity();
+  return pattern;
+}
+
+qSlicerAbstractConstraint::SparseJacobianType
+qSlicerMinMaxDoseConstraint::computeDoseConstraintJacobianSparse(const DoseType& dose)
+{
+  int mode = this->constraintParameters["mode"].toInt();
+  if (mode != 1)
+    return Superclass::computeDoseConstraintJacobianSparse(dose);
+
+  int n = static_cast<int>(dose.size());
+  SparseJacobianType jac(n, n);
+  jac.setIdentity();
+  return jac;
+}
+
 qSlicerAbstractConstraint::DoseType
 qSlicerMinMaxDoseConstraint::upperBounds(int numVoxels)
 {
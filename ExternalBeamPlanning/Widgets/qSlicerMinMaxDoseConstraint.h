@@ -20,6 +20,8 @@ public:
 
   Q_INVOKABLE DoseType computeDoseConstraintFunction(const DoseType& dose) override;
   Q_INVOKABLE Eigen::MatrixXd computeDoseConstraintJacobian(const DoseType& dose) override;
+  SparseJacobianType computeDoseConstraintJacobianPattern(int numVoxels) override;
+  SparseJacobianType computeDoseConstraintJacobianSparse(const DoseType& dose) override;
   Q_INVOKABLE DoseType upperBounds(int numVoxels) override;
   Q_INVOKABLE DoseType lowerBounds(int numVoxels) override;
 
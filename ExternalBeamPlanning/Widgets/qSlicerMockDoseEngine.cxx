@@ -44,6 +44,9 @@
 // Qt includes
 #include <QDebug>
 
+// STD includes
+#include <random>
+
 //----------------------------------------------------------------------------
 qSlicerMockDoseEngine::qSlicerMockDoseEngine(QObject* parent)
   : qSlicerAbstractDoseEngine(parent)
@@ -51,6 +54,7 @@ qSlicerMockDoseEngine::qSlicerMockDoseEngine(QObject* parent)
   this->m_Name = QString("Mock random");
 
   this->m_IsInverse = true;
+  this->m_IsThreadSafe = true;
 }
 
 //----------------------------------------------------------------------------
@@ -123,13 +127,16 @@ QString qSlicerMockDoseEngine::calculateDoseUsingEngine(vtkMRMLRTBeamNode* beamN
   // Paint voxels touched by beam prescription+noise, all others zero
   float noiseRange = (float)this->doubleParameter(beamNode, "NoiseRange");
   double rxDose = parentPlanNode->GetRxDose();
+  // Use a generator per calculation instead of rand() so that beams can be calculated concurrently
+  std::mt19937 noiseGenerator{ std::random_device{}() };
+  std::uniform_real_distribution<float> noiseDistribution(0.0f, 1.0f);
   unsigned char* beamPtr = (unsigned char*)beamImageData->GetScalarPointer();
   float* floatPtr = (float*)protonDoseImageData->GetScalarPointer();
   for (long i=0; i<protonDoseImageData->GetNumberOfPoints(); ++i)
   {
     if ((*beamPtr) > 0)
     {
-      (*floatPtr) = rxDose + (float)((float)rand()/RAND_MAX)*rxDose * noiseRange/100.0 - noiseRange/200.0;
+      (*floatPtr) = rxDose + noiseDistribution(noiseGenerator)*rxDose * noiseRange/100.0 - noiseRange/200.0;
     }
     else
     {
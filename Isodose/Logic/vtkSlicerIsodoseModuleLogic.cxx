@@ -49,27 +49,42 @@
 #include <vtkMRMLColorLogic.h>
 
 // VTK includes
+#include <vtkCellArray.h>
 #include <vtkColorTransferFunction.h>
+#include <vtkFlyingEdges3D.h>
 #include <vtkGeneralTransform.h>
 #include <vtkImageChangeInformation.h>
 #include <vtkImageData.h>
-#include <vtkImageMarchingCubes.h>
 #include <vtkImageReslice.h>
+#include <vtkImageShrink3D.h>
 #include <vtkLookupTable.h>
 #include <vtkNew.h>
 #include <vtkObjectFactory.h>
+#include <vtkPoints.h>
 #include <vtkPolyDataNormals.h>
+#include <vtkSMPTools.h>
 #include <vtkSmartPointer.h>
+#include <vtkTimerLog.h>
 #include <vtkTransformPolyDataFilter.h>
-#include <vtkTriangleFilter.h>
 #include <vtkWindowedSincPolyDataFilter.h>
 #include <vtkAppendPolyData.h>
+#include <vtkCleanPolyData.h>
 #include <vtkPointData.h>
 #include <vtkUnsignedCharArray.h>
 #include <vtkFloatArray.h>
+#include <vtkWeakPointer.h>
 
 #include "vtksys/SystemTools.hxx"
 
+// STD includes
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <future>
+#include <map>
+#include <sstream>
+#include <vector>
+
 //----------------------------------------------------------------------------
 const char* DEFAULT_ISODOSE_COLOR_TABLE_FILE_NAME = "Isodose_ColorTable.ctbl";
 const char* DEFAULT_ISODOSE_COLOR_TABLE_NODE_NAME = "Isodose_ColorTable_Default";
@@ -78,16 +93,575 @@ const char* RELATIVE_ISODOSE_COLOR_TABLE_NODE_NAME = "Isodose_ColorTable_Relativ
 const std::string vtkSlicerIsodoseModuleLogic::ISODOSE_MODEL_NODE_NAME_POSTFIX = "_IsodoseLevels";
 const std::string vtkSlicerIsodoseModuleLogic::ISODOSE_COLOR_TABLE_NODE_NAME_POSTFIX = "_IsodoseColorTable";
 
+namespace
+{
+//---------------------------------------------------------------------------
+// Split the output of a multi-value contour filter into one polydata per contour value.
+// The contour value of each point is taken from the point scalars, so all the points of a cell
+// belong to the same contour. The contour values need to be sorted.
+void SplitContoursByValue(vtkPolyData* contours, const std::vector<double>& contourValues,
+  std::vector<vtkSmartPointer<vtkPolyData>>& levelPolyDatas)
+{
+  levelPolyDatas.clear();
+  std::vector<vtkSmartPointer<vtkPoints>> levelPoints;
+  std::vector<vtkSmartPointer<vtkCellArray>> levelPolys;
+  for (size_t contourIndex = 0; contourIndex < contourValues.size(); ++contourIndex)
+  {
+    levelPolyDatas.push_back(vtkSmartPointer<vtkPolyData>::New());
+    levelPoints.push_back(vtkSmartPointer<vtkPoints>::New());
+    levelPolys.push_back(vtkSmartPointer<vtkCellArray>::New());
+    levelPolyDatas[contourIndex]->SetPoints(levelPoints[contourIndex]);
+    levelPolyDatas[contourIndex]->SetPolys(levelPolys[contourIndex]);
+  }
+
+  vtkDataArray* contourScalars = (contours ? contours->GetPointData()->GetScalars() : nullptr);
+  if (!contourScalars || contourValues.empty())
+  {
+    return;
+  }
+
+  // Point IDs of the input points in the level polydata they belong to
+  std::vector<vtkIdType> levelPointIds(contours->GetNumberOfPoints(), -1);
+  vtkCellArray* polys = contours->GetPolys();
+  vtkIdType numberOfCellPoints = 0;
+  const vtkIdType* cellPointIds = nullptr;
+  for (polys->InitTraversal(); polys->GetNextCell(numberOfCellPoints, cellPointIds); )
+  {
+    if (numberOfCellPoints < 1)
+    {
+      continue;
+    }
+
+    // Find the contour value closest to the scalar of the cell (scalars may be stored with lower precision)
+    double value = contourScalars->GetTuple1(cellPointIds[0]);
+    size_t contourIndex = std::lower_bound(contourValues.begin(), contourValues.end(), value) - contourValues.begin();
+    if (contourIndex == contourValues.size()
+      || (contourIndex > 0 && value - contourValues[contourIndex-1] < contourValues[contourIndex] - value))
+    {
+      --contourIndex;
+    }
+
+    vtkPoints* points = levelPoints[contourIndex];
+    vtkCellArray* cells = levelPolys[contourIndex];
+    cells->InsertNextCell(numberOfCellPoints);
+    for (vtkIdType cellPointIndex = 0; cellPointIndex < numberOfCellPoints; ++cellPointIndex)
+    {
+      vtkIdType pointId = cellPointIds[cellPointIndex];
+      if (levelPointIds[pointId] < 0)
+      {
+        levelPointIds[pointId] = points->InsertNextPoint(contours->GetPoint(pointId));
+      }
+      cells->InsertCellPoint(levelPointIds[pointId]);
+    }
+  }
+}
+
+//---------------------------------------------------------------------------
+// Dose volume to be contoured
+struct IsodoseDoseSource
+{
+  /// Dose image, contoured in place unless a resample transform is set
+  vtkSmartPointer<vtkImageData> Image;
+  /// Transform from the IJK coordinate system of the contoured grid to that of the dose image.
+  /// If set, the dose is resampled slab by slab through this transform onto the grid of the dose image.
+  vtkSmartPointer<vtkAbstractTransform> ResampleTransform;
+};
+
+//---------------------------------------------------------------------------
+// Extract the surfaces of the given contour values from an image, one polydata per contour value.
+// The contour values need to be sorted and unique.
+void ContourImage(vtkImageData* image, const std::vector<double>& contourValues,
+  std::vector<vtkSmartPointer<vtkPolyData>>& levelPolyDatas)
+{
+  levelPolyDatas.clear();
+  levelPolyDatas.resize(contourValues.size());
+
+  // The contour value of each output point is stored in the scalar type of the image, which tells the levels apart,
+  // unless the image has an integer type and multiple contour values get the same stored value. In that case the
+  // levels are extracted in multiple passes, each pass with values that have different stored values.
+  vtkSmartPointer<vtkDataArray> storedValueArray = vtkSmartPointer<vtkDataArray>::Take(
+    vtkDataArray::CreateDataArray(image->GetScalarType()));
+  storedValueArray->SetNumberOfTuples(1);
+  std::vector<std::vector<size_t>> passContourIndices;
+  std::vector<std::vector<double>> passStoredValues;
+  double lastStoredValue = 0.0;
+  size_t passIndex = 0;
+  for (size_t contourIndex = 0; contourIndex < contourValues.size(); ++contourIndex)
+  {
+    storedValueArray->SetTuple1(0, contourValues[contourIndex]);
+    double storedValue = storedValueArray->GetTuple1(0);
+    passIndex = ((contourIndex > 0 && storedValue == lastStoredValue) ? passIndex + 1 : 0);
+    lastStoredValue = storedValue;
+    if (passIndex >= passContourIndices.size())
+    {
+      passContourIndices.resize(passIndex + 1);
+      passStoredValues.resize(passIndex + 1);
+    }
+    passContourIndices[passIndex].push_back(contourIndex);
+    passStoredValues[passIndex].push_back(storedValue);
+  }
+
+  for (passIndex = 0; passIndex < passContourIndices.size(); ++passIndex)
+  {
+    // Extract all isodose levels of the pass in a single pass over the dose volume
+    vtkNew<vtkFlyingEdges3D> flyingEdges;
+    flyingEdges->SetInputData(image);
+    flyingEdges->SetNumberOfContours(static_cast<int>(passContourIndices[passIndex].size()));
+    for (size_t passContourIndex = 0; passContourIndex < passContourIndices[passIndex].size(); ++passContourIndex)
+    {
+      flyingEdges->SetValue(static_cast<int>(passContourIndex), contourValues[passContourIndices[passIndex][passContourIndex]]);
+    }
+    flyingEdges->ComputeScalarsOn(); // Needed to tell which level each triangle belongs to
+    flyingEdges->ComputeGradientsOff();
+    flyingEdges->ComputeNormalsOff();
+    flyingEdges->Update();
+
+    std::vector<vtkSmartPointer<vtkPolyData>> passPolyDatas;
+    SplitContoursByValue(flyingEdges->GetOutput(), passStoredValues[passIndex], passPolyDatas);
+    for (size_t passContourIndex = 0; passContourIndex < passContourIndices[passIndex].size(); ++passContourIndex)
+    {
+      levelPolyDatas[passContourIndices[passIndex][passContourIndex]] = passPolyDatas[passContourIndex];
+    }
+  }
+}
+
+//---------------------------------------------------------------------------
+// Extract the surfaces of the given contour values from the dose, one polydata per contour value,
+// in the IJK coordinate system of the dose image. The contour values need to be sorted and unique.
+// \param shrinkFactor Downsampling factor along each axis, for computing coarse surfaces quickly
+void ContourDose(const IsodoseDoseSource& source, int shrinkFactor, const std::vector<double>& contourValues,
+  std::vector<vtkSmartPointer<vtkPolyData>>& levelPolyDatas)
+{
+  if (!source.ResampleTransform)
+  {
+    if (shrinkFactor <= 1)
+    {
+      // Contour the image in place
+      ContourImage(source.Image, contourValues, levelPolyDatas);
+      return;
+    }
+    // Subsample instead of averaging so that the dose maximum is not lowered
+    vtkNew<vtkImageShrink3D> shrink;
+    shrink->SetInputData(source.Image);
+    shrink->SetShrinkFactors(shrinkFactor, shrinkFactor, shrinkFactor);
+    shrink->AveragingOff();
+    shrink->Update();
+    ContourImage(shrink->GetOutput(), contourValues, levelPolyDatas);
+    return;
+  }
+
+  // Resample the dose slab by slab, so that only one slab of the resampled dose is in memory at a time.
+  // Adjacent slabs share one slice, so that the surfaces are continuous. The points on the shared slices
+  // are computed from the same voxels in both slabs, so they are merged when the slabs are appended.
+  const int numberOfSlicesPerSlab = 32;
+  int inputExtent[6] = { 0, -1, 0, -1, 0, -1 };
+  source.Image->GetExtent(inputExtent);
+  shrinkFactor = std::max(shrinkFactor, 1);
+  int outputExtent[6] = { 0, -1, 0, -1, 0, -1 };
+  for (int axis = 0; axis < 3; ++axis)
+  {
+    outputExtent[axis*2] = inputExtent[axis*2] / shrinkFactor;
+    outputExtent[axis*2+1] = inputExtent[axis*2+1] / shrinkFactor;
+  }
+
+  // Output grid has the same IJK coordinate system as the dose image (with larger spacing if downsampled)
+  vtkNew<vtkImageReslice> reslice;
+  reslice->SetInputData(source.Image);
+  reslice->SetOutputOrigin(0, 0, 0);
+  reslice->SetOutputSpacing(shrinkFactor, shrinkFactor, shrinkFactor);
+  reslice->SetResliceTransform(source.ResampleTransform);
+
+  std::vector<vtkSmartPointer<vtkAppendPolyData>> levelAppends;
+  for (size_t contourIndex = 0; contourIndex < contourValues.size(); ++contourIndex)
+  {
+    levelAppends.push_back(vtkSmartPointer<vtkAppendPolyData>::New());
+  }
+  for (int slabStart = outputExtent[4]; slabStart < std::max(outputExtent[5], outputExtent[4] + 1); slabStart += numberOfSlicesPerSlab)
+  {
+    int slabEnd = std::min(slabStart + numberOfSlicesPerSlab, outputExtent[5]);
+    reslice->SetOutputExtent(outputExtent[0], outputExtent[1], outputExtent[2], outputExtent[3], slabStart, slabEnd);
+    reslice->Update();
+    vtkNew<vtkImageData> slab;
+    slab->ShallowCopy(reslice->GetOutput());
+
+    std::vector<vtkSmartPointer<vtkPolyData>> slabPolyDatas;
+    ContourImage(slab, contourValues, slabPolyDatas);
+    for (size_t contourIndex = 0; contourIndex < contourValues.size(); ++contourIndex)
+    {
+      if (slabPolyDatas[contourIndex]->GetNumberOfPoints() > 0)
+      {
+        levelAppends[contourIndex]->AddInputData(slabPolyDatas[contourIndex]);
+      }
+    }
+  }
+
+  levelPolyDatas.clear();
+  for (size_t contourIndex = 0; contourIndex < contourValues.size(); ++contourIndex)
+  {
+    if (levelAppends[contourIndex]->GetNumberOfInputConnections(0) == 0)
+    {
+      levelPolyDatas.push_back(vtkSmartPointer<vtkPolyData>::New());
+      continue;
+    }
+    vtkNew<vtkCleanPolyData> merge;
+    merge->SetInputConnection(levelAppends[contourIndex]->GetOutputPort());
+    merge->PointMergingOn();
+    merge->SetTolerance(0.0);
+    merge->Update();
+    levelPolyDatas.push_back(merge->GetOutput());
+  }
+}
+
+//---------------------------------------------------------------------------
+// Compute smoothed surfaces with normals for the given contour values, in the IJK coordinate system of the dose image.
+// The contour values need to be sorted and unique. Levels without surface get a null pointer.
+// Does not access MRML, so it can be called from any thread.
+void ComputeIsodoseLevelSurfaces(const IsodoseDoseSource& source, int shrinkFactor,
+  const std::vector<double>& contourValues, std::vector<vtkSmartPointer<vtkPolyData>>& levelSurfaces)
+{
+  levelSurfaces.clear();
+  levelSurfaces.resize(contourValues.size());
+  if (contourValues.empty())
+  {
+    return;
+  }
+
+  std::vector<vtkSmartPointer<vtkPolyData>> levelPolyDatas;
+  ContourDose(source, shrinkFactor, contourValues, levelPolyDatas);
+
+  // Smooth the isodose levels and compute their normals concurrently
+  auto smoothLevels = [&](vtkIdType beginIndex, vtkIdType endIndex)
+  {
+    for (vtkIdType contourIndex = beginIndex; contourIndex < endIndex; ++contourIndex)
+    {
+      if (levelPolyDatas[contourIndex]->GetNumberOfPoints() < 1)
+      {
+        continue;
+      }
+
+      vtkNew<vtkWindowedSincPolyDataFilter> smootherSinc;
+      smootherSinc->SetPassBand(0.1);
+      smootherSinc->SetInputData(levelPolyDatas[contourIndex]);
+      smootherSinc->SetNumberOfIterations(2);
+      smootherSinc->FeatureEdgeSmoothingOff();
+      smootherSinc->BoundarySmoothingOff();
+      smootherSinc->Update();
+
+      vtkNew<vtkPolyDataNormals> normals;
+      normals->SetInputData(smootherSinc->GetOutput());
+      normals->ComputePointNormalsOn();
+      normals->SetFeatureAngle(60);
+      normals->Update();
+
+      levelSurfaces[contourIndex] = normals->GetOutput();
+    }
+  };
+  // Use grain size of one, as the size of the levels varies greatly
+  vtkSMPTools::For(0, static_cast<vtkIdType>(contourValues.size()), 1, smoothLevels);
+}
+
+//---------------------------------------------------------------------------
+// Append the level surfaces in the order of the colors, transform them to RAS, and set the isolevel scalars.
+// \param isoLevels Isodose level of each color
+// \param contourValues Sorted unique isodose levels
+// \param levelSurfaces Surface of each contour value in IJK coordinate system (null if empty)
+// \return Isodose surfaces, null if all levels are empty
+vtkSmartPointer<vtkPolyData> AppendIsodoseLevelSurfaces(const std::vector<double>& isoLevels,
+  const std::vector<double>& contourValues, const std::vector<vtkSmartPointer<vtkPolyData>>& levelSurfaces,
+  vtkMatrix4x4* ijkToRasMatrix)
+{
+  vtkNew<vtkAppendPolyData> append;
+  vtkNew<vtkFloatArray> colors;
+  colors->SetNumberOfComponents(1);
+  colors->SetName("isolevels");
+  std::vector<bool> contourAppended(contourValues.size(), false);
+  for (size_t i = 0; i < isoLevels.size(); i++)
+  {
+    size_t contourIndex = std::lower_bound(contourValues.begin(), contourValues.end(), isoLevels[i]) - contourValues.begin();
+    if (contourIndex >= levelSurfaces.size() || !levelSurfaces[contourIndex] || contourAppended[contourIndex])
+    {
+      continue;
+    }
+    vtkPolyData* levelSurface = levelSurfaces[contourIndex];
+    contourAppended[contourIndex] = true;
+    for (vtkIdType pointIndex = 0; pointIndex < levelSurface->GetNumberOfPoints(); ++pointIndex)
+    {
+      colors->InsertNextTuple1(static_cast<float>(isoLevels[i]));
+    }
+    append->AddInputData(levelSurface);
+  }
+  if (append->GetNumberOfInputConnections(0) == 0)
+  {
+    return nullptr;
+  }
+
+  // Transform all levels from IJK to RAS at once
+  vtkNew<vtkTransform> inputIJKToRASTransform;
+  inputIJKToRASTransform->Identity();
+  inputIJKToRASTransform->SetMatrix(ijkToRasMatrix);
+
+  vtkNew<vtkTransformPolyDataFilter> transformPolyData;
+  transformPolyData->SetInputConnection(append->GetOutputPort());
+  transformPolyData->SetTransform(inputIJKToRASTransform);
+  transformPolyData->Update();
+
+  vtkSmartPointer<vtkPolyData> isoSurfaces = transformPolyData->GetOutput();
+  isoSurfaces->GetPointData()->SetScalars(colors);
+  return isoSurfaces;
+}
+
+//---------------------------------------------------------------------------
+// Get a string that changes whenever the contoured dose changes
+// \param resampleTransformNode Transform the dose is resampled through, nullptr if the dose is contoured in place
+// \param ijkToRasMatrix IJK to RAS matrix of the dose volume, only used if the dose is resampled
+std::string GetDoseSignature(vtkImageData* doseImage, vtkMRMLTransformNode* resampleTransformNode, vtkMatrix4x4* ijkToRasMatrix)
+{
+  std::stringstream ss;
+  ss << doseImage << ";" << doseImage->GetMTime();
+  if (resampleTransformNode)
+  {
+    ss << ";" << resampleTransformNode << ";" << resampleTransformNode->GetTransformToWorldMTime();
+    for (int row = 0; row < 4; ++row)
+    {
+      for (int column = 0; column < 4; ++column)
+      {
+        ss << ";" << ijkToRasMatrix->GetElement(row, column);
+      }
+    }
+  }
+  return ss.str();
+}
+}
+
+//---------------------------------------------------------------------------
+class vtkSlicerIsodoseModuleLogic::vtkInternal
+{
+public:
+  /// Surfaces of the isodose levels of a dose volume at one resolution, in the IJK coordinate system
+  /// of the dose volume. Levels without surface have a null pointer.
+  struct LevelSurfaceCache
+  {
+    std::string DoseSignature;
+    int ShrinkFactor{1};
+    std::map<double, vtkSmartPointer<vtkPolyData>> Surfaces;
+  };
+
+  /// Full resolution isodose surfaces to be computed in the background and swapped in when ready
+  struct Refinement
+  {
+    bool Requested{false};
+    vtkWeakPointer<vtkMRMLIsodoseNode> ParameterNode;
+    IsodoseDoseSource Dose;
+    std::string DoseSignature;
+    std::vector<double> IsoLevels;
+    std::vector<double> ContourValues;
+    vtkSmartPointer<vtkMatrix4x4> IJKToRASMatrix;
+  };
+
+  /// Maximum downsampling factor along each axis for the coarse surfaces
+  static const int MAXIMUM_SHRINK_FACTOR = 4;
+
+public:
+  /// Get the downsampling factor for which the surfaces are expected to be computed within the latency budget.
+  /// Returns 1 if the full resolution surfaces are all cached.
+  int GetProgressiveShrinkFactor(const IsodoseDoseSource& source, const std::string& doseSignature,
+    const std::vector<double>& contourValues, double latencyBudgetMs)
+  {
+    if (this->FullResolutionCache.DoseSignature == doseSignature && this->IsCached(this->FullResolutionCache, contourValues))
+    {
+      return 1;
+    }
+    double numberOfVoxels = static_cast<double>(source.Image->GetNumberOfPoints());
+    int shrinkFactor = 1;
+    while (shrinkFactor < MAXIMUM_SHRINK_FACTOR
+      && numberOfVoxels / (shrinkFactor * shrinkFactor * shrinkFactor) / this->VoxelsPerMs > latencyBudgetMs)
+    {
+      ++shrinkFactor;
+    }
+    return shrinkFactor;
+  }
+
+  /// Get the level surfaces from the cache, and compute the ones that are not cached
+  void GetLevelSurfaces(const IsodoseDoseSource& source, const std::string& doseSignature, int shrinkFactor,
+    const std::vector<double>& contourValues, std::vector<vtkSmartPointer<vtkPolyData>>& levelSurfaces)
+  {
+    LevelSurfaceCache& cache = (shrinkFactor > 1 ? this->CoarseCache : this->FullResolutionCache);
+    if (cache.DoseSignature != doseSignature || cache.ShrinkFactor != shrinkFactor)
+    {
+      cache.Surfaces.clear();
+      cache.DoseSignature = doseSignature;
+      cache.ShrinkFactor = shrinkFactor;
+    }
+
+    std::vector<double> missingContourValues;
+    for (double contourValue : contourValues)
+    {
+      if (cache.Surfaces.find(contourValue) == cache.Surfaces.end())
+      {
+        missingContourValues.push_back(contourValue);
+      }
+    }
+    if (!missingContourValues.empty())
+    {
+      vtkNew<vtkTimerLog> timer;
+      timer->StartTimer();
+
+      std::vector<vtkSmartPointer<vtkPolyData>> missingSurfaces;
+      ComputeIsodoseLevelSurfaces(source, shrinkFactor, missingContourValues, missingSurfaces);
+      for (size_t contourIndex = 0; contourIndex < missingContourValues.size(); ++contourIndex)
+      {
+        cache.Surfaces[missingContourValues[contourIndex]] = missingSurfaces[contourIndex];
+      }
+
+      // Update the speed estimate used for choosing the downsampling factor
+      timer->StopTimer();
+      double elapsedTimeMs = timer->GetElapsedTime() * 1000.0;
+      if (elapsedTimeMs > 1.0)
+      {
+        double numberOfVoxels = static_cast<double>(source.Image->GetNumberOfPoints()) / (shrinkFactor * shrinkFactor * shrinkFactor);
+        this->VoxelsPerMs = 0.5 * this->VoxelsPerMs + 0.5 * numberOfVoxels / elapsedTimeMs;
+      }
+    }
+
+    // Only keep the current levels in the cache
+    this->PruneCache(cache, contourValues);
+
+    levelSurfaces.clear();
+    for (double contourValue : contourValues)
+    {
+      levelSurfaces.push_back(cache.Surfaces[contourValue]);
+    }
+  }
+
+  /// Request computation of the full resolution surfaces in the background.
+  /// Replaces the previous request if it has not been swapped in yet.
+  void RequestRefinement(vtkMRMLIsodoseNode* parameterNode, const IsodoseDoseSource& source, const std::string& doseSignature,
+    const std::vector<double>& isoLevels, const std::vector<double>& contourValues, vtkMatrix4x4* ijkToRasMatrix)
+  {
+    this->PendingRefinement.Requested = true;
+    this->PendingRefinement.ParameterNode = parameterNode;
+    // Copy the image and the transform so that they are not connected to pipelines and nodes of the main thread.
+    // The scalars are deep copied too, as the dose volume may be updated in place while the refinement is running.
+    this->PendingRefinement.Dose.Image = vtkSmartPointer<vtkImageData>::New();
+    this->PendingRefinement.Dose.Image->DeepCopy(source.Image);
+    this->PendingRefinement.Dose.ResampleTransform = nullptr;
+    if (source.ResampleTransform)
+    {
+      this->PendingRefinement.Dose.ResampleTransform = vtkSmartPointer<vtkGeneralTransform>::New();
+      this->PendingRefinement.Dose.ResampleTransform->DeepCopy(source.ResampleTransform);
+    }
+    this->PendingRefinement.DoseSignature = doseSignature;
+    this->PendingRefinement.IsoLevels = isoLevels;
+    this->PendingRefinement.ContourValues = contourValues;
+    this->PendingRefinement.IJKToRASMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+    this->PendingRefinement.IJKToRASMatrix->DeepCopy(ijkToRasMatrix);
+
+    this->StartRefinement();
+  }
+
+  /// Start computing the missing full resolution surfaces of the pending request,
+  /// unless a computation is already running
+  void StartRefinement()
+  {
+    if (!this->PendingRefinement.Requested || this->RunningRefinement.valid())
+    {
+      return;
+    }
+
+    LevelSurfaceCache& cache = this->FullResolutionCache;
+    if (cache.DoseSignature != this->PendingRefinement.DoseSignature)
+    {
+      cache.Surfaces.clear();
+      cache.DoseSignature = this->PendingRefinement.DoseSignature;
+      cache.ShrinkFactor = 1;
+    }
+    std::vector<double> missingContourValues;
+    for (double contourValue : this->PendingRefinement.ContourValues)
+    {
+      if (cache.Surfaces.find(contourValue) == cache.Surfaces.end())
+      {
+        missingContourValues.push_back(contourValue);
+      }
+    }
+    if (missingContourValues.empty())
+    {
+      return;
+    }
+
+    this->RunningDoseSignature = this->PendingRefinement.DoseSignature;
+    this->RunningContourValues = missingContourValues;
+    IsodoseDoseSource source = this->PendingRefinement.Dose;
+    this->RunningRefinement = std::async(std::launch::async, [source, missingContourValues]()
+    {
+      std::vector<vtkSmartPointer<vtkPolyData>> levelSurfaces;
+      ComputeIsodoseLevelSurfaces(source, 1, missingContourValues, levelSurfaces);
+      return levelSurfaces;
+    });
+  }
+
+  /// Determine whether all the given levels are in the cache
+  bool IsCached(LevelSurfaceCache& cache, const std::vector<double>& contourValues)
+  {
+    for (double contourValue : contourValues)
+    {
+      if (cache.Surfaces.find(contourValue) == cache.Surfaces.end())
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  /// Remove levels from the cache that are not among the given ones
+  void PruneCache(LevelSurfaceCache& cache, const std::vector<double>& contourValues)
+  {
+    for (auto surfaceIt = cache.Surfaces.begin(); surfaceIt != cache.Surfaces.end(); )
+    {
+      if (!std::binary_search(contourValues.begin(), contourValues.end(), surfaceIt->first))
+      {
+        surfaceIt = cache.Surfaces.erase(surfaceIt);
+      }
+      else
+      {
+        ++surfaceIt;
+      }
+    }
+  }
+
+public:
+  /// Full resolution level surfaces of the last computation
+  LevelSurfaceCache FullResolutionCache;
+  /// Downsampled level surfaces of the last progressive computation
+  LevelSurfaceCache CoarseCache;
+  /// Estimated speed of computing level surfaces (voxels per millisecond)
+  double VoxelsPerMs{20000.0};
+
+  /// Latest request for full resolution surfaces
+  Refinement PendingRefinement;
+  /// Full resolution surfaces being computed in the background
+  std::future<std::vector<vtkSmartPointer<vtkPolyData>>> RunningRefinement;
+  std::string RunningDoseSignature;
+  std::vector<double> RunningContourValues;
+};
+
 std::string vtkSlicerIsodoseModuleLogic::IsodoseColorNodeCopyUniqueName = DEFAULT_ISODOSE_COLOR_TABLECOPY_NODE_NAME;
 
 //----------------------------------------------------------------------------
 vtkStandardNewMacro(vtkSlicerIsodoseModuleLogic);
 
 //----------------------------------------------------------------------------
-vtkSlicerIsodoseModuleLogic::vtkSlicerIsodoseModuleLogic() = default;
+vtkSlicerIsodoseModuleLogic::vtkSlicerIsodoseModuleLogic()
+{
+  this->Internal = new vtkInternal();
+}
 
 //----------------------------------------------------------------------------
-vtkSlicerIsodoseModuleLogic::~vtkSlicerIsodoseModuleLogic() = default;
+vtkSlicerIsodoseModuleLogic::~vtkSlicerIsodoseModuleLogic()
+{
+  // Waits for the background computation to finish
+  delete this->Internal;
+  this->Internal = nullptr;
+}
 
 //----------------------------------------------------------------------------
 void vtkSlicerIsodoseModuleLogic::PrintSelf(ostream& os, vtkIndent indent)
@@ -173,6 +747,9 @@ void vtkSlicerIsodoseModuleLogic::OnMRMLSceneEndClose()
     return;
   }
 
+  this->Internal->PendingRefinement = vtkInternal::Refinement();
+  this->ClearIsodoseLevelCache();
+
   this->Modified();
 }
 
@@ -654,41 +1231,44 @@ bool vtkSlicerIsodoseModuleLogic::CreateIsodoseSurfaces(vtkMRMLIsodoseNode* para
   }
 
   // Progress
-  int progressStepCount = colorTableNode->GetNumberOfColors() + 1 /* reslice step */;
+  int progressStepCount = 3 /* setup, contour and append steps */;
   int currentProgressStep = 0;
 
-  // Reslice dose volume
+  // Set up contouring of the dose volume. The surfaces are computed in the IJK coordinate system of the dose volume.
+  // If the dose volume is not transformed or its transform is linear, then the dose image is contoured in place
+  // without copying it, and the transform is applied to the surfaces. Otherwise the dose is resampled through
+  // the transform onto its own grid slab by slab, so that the whole resampled dose is never kept in memory.
   vtkNew<vtkMatrix4x4> inputIJK2RASMatrix;
   doseVolumeNode->GetIJKToRASMatrix(inputIJK2RASMatrix);
-  vtkNew<vtkMatrix4x4> inputRAS2IJKMatrix;
-  doseVolumeNode->GetRASToIJKMatrix(inputRAS2IJKMatrix);
-
-  vtkNew<vtkTransform> outputIJK2IJKResliceTransform;
-  outputIJK2IJKResliceTransform->Identity();
-  outputIJK2IJKResliceTransform->PostMultiply();
-  outputIJK2IJKResliceTransform->SetMatrix(inputIJK2RASMatrix);
-
-  vtkSmartPointer<vtkMRMLTransformNode> inputVolumeNodeTransformNode = doseVolumeNode->GetParentTransformNode();
-  vtkNew<vtkMatrix4x4> inputRAS2RASMatrix;
-  if (inputVolumeNodeTransformNode!=nullptr)
+  vtkNew<vtkMatrix4x4> surfaceIJK2RASMatrix;
+  surfaceIJK2RASMatrix->DeepCopy(inputIJK2RASMatrix);
+
+  IsodoseDoseSource doseSource;
+  doseSource.Image = doseVolumeNode->GetImageData();
+  vtkMRMLTransformNode* resampleTransformNode = nullptr;
+  vtkMRMLTransformNode* inputVolumeNodeTransformNode = doseVolumeNode->GetParentTransformNode();
+  if (inputVolumeNodeTransformNode && inputVolumeNodeTransformNode->IsTransformToWorldLinear())
   {
+    vtkNew<vtkMatrix4x4> inputRAS2RASMatrix;
     inputVolumeNodeTransformNode->GetMatrixTransformToWorld(inputRAS2RASMatrix);
-    outputIJK2IJKResliceTransform->Concatenate(inputRAS2RASMatrix);
+    vtkMatrix4x4::Multiply4x4(inputRAS2RASMatrix, inputIJK2RASMatrix, surfaceIJK2RASMatrix);
+  }
+  else if (inputVolumeNodeTransformNode)
+  {
+    // Output IJK to world RAS, then to the RAS of the dose volume through the inverse of its transform, then to input IJK
+    vtkNew<vtkMatrix4x4> inputRAS2IJKMatrix;
+    doseVolumeNode->GetRASToIJKMatrix(inputRAS2IJKMatrix);
+    vtkNew<vtkGeneralTransform> worldToInputRASTransform;
+    inputVolumeNodeTransformNode->GetTransformFromWorld(worldToInputRASTransform);
+
+    vtkNew<vtkGeneralTransform> outputIJK2IJKResliceTransform;
+    outputIJK2IJKResliceTransform->PostMultiply();
+    outputIJK2IJKResliceTransform->Concatenate(inputIJK2RASMatrix);
+    outputIJK2IJKResliceTransform->Concatenate(worldToInputRASTransform);
+    outputIJK2IJKResliceTransform->Concatenate(inputRAS2IJKMatrix);
+    doseSource.ResampleTransform = outputIJK2IJKResliceTransform.GetPointer();
+    resampleTransformNode = inputVolumeNodeTransformNode;
   }
-
-  outputIJK2IJKResliceTransform->Concatenate(inputRAS2IJKMatrix);
-  outputIJK2IJKResliceTransform->Inverse();
-
-  int dimensions[3] = {0, 0, 0};
-  doseVolumeNode->GetImageData()->GetDimensions(dimensions);
-  vtkNew<vtkImageReslice> reslice;
-  reslice->SetInputData(doseVolumeNode->GetImageData());
-  reslice->SetOutputOrigin(0, 0, 0);
-  reslice->SetOutputSpacing(1, 1, 1);
-  reslice->SetOutputExtent(0, dimensions[0]-1, 0, dimensions[1]-1, 0, dimensions[2]-1);
-  reslice->SetResliceTransform(outputIJK2IJKResliceTransform);
-  reslice->Update();
-  vtkSmartPointer<vtkImageData> reslicedDoseVolumeImage = reslice->GetOutput();
 
   // Report progress
   ++currentProgressStep;
@@ -701,13 +1281,11 @@ bool vtkSlicerIsodoseModuleLogic::CreateIsodoseSurfaces(vtkMRMLIsodoseNode* para
   // reference value for relative representation
   double referenceValue = parameterNode->GetReferenceDoseValue();
 
-  // Create isodose surfaces
-  vtkNew<vtkAppendPolyData> append;
-  vtkNew<vtkFloatArray> colors;
-  colors->SetNumberOfComponents(1);
-  colors->SetName("isolevels");
-
-  for (int i = 0; i < colorTableNode->GetNumberOfColors(); i++)
+  // Collect isodose levels in the order of the colors. Contour values are passed in ascending order
+  // without duplicates, and the colors are mapped to them.
+  int numberOfColors = colorTableNode->GetNumberOfColors();
+  std::vector<double> isoLevels(numberOfColors, 0.0);
+  for (int i = 0; i < numberOfColors; i++)
   {
     const char* strIsoLevel = colorTableNode->GetColorName(i);
     double isoLevel = vtkVariant(strIsoLevel).ToDouble();
@@ -719,67 +1297,55 @@ bool vtkSlicerIsodoseModuleLogic::CreateIsodoseSurfaces(vtkMRMLIsodoseNode* para
         isoLevel = isoLevel * referenceValue / 100.;
       }
     }
+    isoLevels[i] = isoLevel;
+  }
+  std::vector<double> contourValues(isoLevels);
+  std::sort(contourValues.begin(), contourValues.end());
+  contourValues.erase(std::unique(contourValues.begin(), contourValues.end()), contourValues.end());
+
+  // Compute the surfaces of the levels. In progressive mode the surfaces are computed from a downsampled
+  // dose volume first if the full resolution ones are not expected to be ready within the latency budget.
+  std::string doseSignature = GetDoseSignature(doseVolumeNode->GetImageData(), resampleTransformNode, inputIJK2RASMatrix);
+  int shrinkFactor = 1;
+  if (parameterNode->GetProgressive())
+  {
+    shrinkFactor = this->Internal->GetProgressiveShrinkFactor(
+      doseSource, doseSignature, contourValues, parameterNode->GetProgressiveLatencyBudgetMs());
+  }
+  std::vector<vtkSmartPointer<vtkPolyData>> levelSurfaces;
+  this->Internal->GetLevelSurfaces(doseSource, doseSignature, shrinkFactor, contourValues, levelSurfaces);
+  if (shrinkFactor > 1)
+  {
+    // Compute full resolution surfaces in the background, see ProcessIsodoseRefinement
+    this->Internal->RequestRefinement(parameterNode, doseSource, doseSignature,
+      isoLevels, contourValues, surfaceIJK2RASMatrix);
+  }
+  else
+  {
+    // Surfaces are at full resolution, so an earlier refinement must not replace them
+    this->Internal->PendingRefinement = vtkInternal::Refinement();
+  }
 
-    vtkNew<vtkImageMarchingCubes> marchingCubes;
-    marchingCubes->SetInputData(reslicedDoseVolumeImage);
-    marchingCubes->SetNumberOfContours(1);
-    marchingCubes->SetValue(0, isoLevel);
-    marchingCubes->ComputeScalarsOff();
-    marchingCubes->ComputeGradientsOff();
-    marchingCubes->ComputeNormalsOff();
-    marchingCubes->Update();
-
-    vtkSmartPointer<vtkPolyData> isoPolyData = marchingCubes->GetOutput();
-    if (isoPolyData->GetNumberOfPoints() >= 1)
-    {
-      vtkNew<vtkTriangleFilter> triangleFilter;
-      triangleFilter->SetInputData(marchingCubes->GetOutput());
-      triangleFilter->Update();
-
-      vtkNew<vtkWindowedSincPolyDataFilter> smootherSinc;
-      smootherSinc->SetPassBand(0.1);
-      smootherSinc->SetInputData(triangleFilter->GetOutput());
-      smootherSinc->SetNumberOfIterations(2);
-      smootherSinc->FeatureEdgeSmoothingOff();
-      smootherSinc->BoundarySmoothingOff();
-      smootherSinc->Update();
-
-      vtkNew<vtkPolyDataNormals> normals;
-      normals->SetInputData(smootherSinc->GetOutput());
-      normals->ComputePointNormalsOn();
-      normals->SetFeatureAngle(60);
-      normals->Update();
-
-      vtkNew<vtkTransform> inputIJKToRASTransform;
-      inputIJKToRASTransform->Identity();
-      inputIJKToRASTransform->SetMatrix(inputIJK2RASMatrix);
-
-      vtkNew<vtkTransformPolyDataFilter> transformPolyData;
-      transformPolyData->SetInputData(normals->GetOutput());
-      transformPolyData->SetTransform(inputIJKToRASTransform);
-      transformPolyData->Update();
-
-      vtkPolyData* isoSurface = transformPolyData->GetOutput();
-      for (vtkIdType i = 0; i < isoSurface->GetNumberOfPoints(); ++i)
-      {
-        colors->InsertNextTuple1(static_cast<float>(isoLevel));
-      }
+  // Report progress
+  ++currentProgressStep;
+  progress = (double)(currentProgressStep) / (double)progressStepCount;
+  if (!parameterNode->GetRealTime())
+  {
+    this->InvokeEvent(vtkSlicerRtCommon::ProgressUpdated, (void*)&progress);
+  }
 
-      append->AddInputData(isoSurface);
-    }
+  // Append the levels in the order of the colors and transform them to RAS
+  vtkSmartPointer<vtkPolyData> isoSurfaces = AppendIsodoseLevelSurfaces(isoLevels, contourValues, levelSurfaces, surfaceIJK2RASMatrix);
 
-    // Report progress
-    ++currentProgressStep;
-    progress = (double)(currentProgressStep) / (double)progressStepCount;
-    if (!parameterNode->GetRealTime())
-    {
-      this->InvokeEvent(vtkSlicerRtCommon::ProgressUpdated, (void*)&progress);
-    }
-  } // For all isodose levels
+  // Report progress
+  ++currentProgressStep;
+  progress = (double)(currentProgressStep) / (double)progressStepCount;
+  if (!parameterNode->GetRealTime())
+  {
+    this->InvokeEvent(vtkSlicerRtCommon::ProgressUpdated, (void*)&progress);
+  }
 
   // Create or update isodose model node
-  append->Update();
-  vtkPolyData* isoSurfaces = append->GetOutput();
   vtkMRMLModelNode* isodoseModelNode = parameterNode->GetIsosurfacesModelNode();
   if (isoSurfaces != nullptr && isoSurfaces->GetNumberOfPoints() > 0)
   {
@@ -818,7 +1384,6 @@ bool vtkSlicerIsodoseModuleLogic::CreateIsodoseSurfaces(vtkMRMLIsodoseNode* para
       parameterNode->SetAndObserveIsosurfacesModelNode(isodoseModelNode);
     }
 
-    isoSurfaces->GetPointData()->SetScalars(colors);
     isodoseModelNode->SetAndObservePolyData(isoSurfaces);
 
     // Update dose color table based on isodose
@@ -844,6 +1409,101 @@ bool vtkSlicerIsodoseModuleLogic::CreateIsodoseSurfaces(vtkMRMLIsodoseNode* para
   return true;
 }
 
+//---------------------------------------------------------------------------
+bool vtkSlicerIsodoseModuleLogic::ProcessIsodoseRefinement(bool wait/*=false*/)
+{
+  vtkInternal::Refinement& pendingRefinement = this->Internal->PendingRefinement;
+  vtkInternal::LevelSurfaceCache& cache = this->Internal->FullResolutionCache;
+  while (true)
+  {
+    // Collect finished surfaces
+    if (this->Internal->RunningRefinement.valid())
+    {
+      if (!wait && this->Internal->RunningRefinement.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+      {
+        return false;
+      }
+      std::vector<vtkSmartPointer<vtkPolyData>> levelSurfaces = this->Internal->RunningRefinement.get();
+      if (cache.DoseSignature == this->Internal->RunningDoseSignature)
+      {
+        for (size_t contourIndex = 0; contourIndex < this->Internal->RunningContourValues.size(); ++contourIndex)
+        {
+          cache.Surfaces[this->Internal->RunningContourValues[contourIndex]] = levelSurfaces[contourIndex];
+        }
+      }
+    }
+
+    if (!pendingRefinement.Requested)
+    {
+      return false;
+    }
+    if (cache.DoseSignature == pendingRefinement.DoseSignature
+      && this->Internal->IsCached(cache, pendingRefinement.ContourValues))
+    {
+      break;
+    }
+
+    // Surfaces of the latest request are still missing (levels or dose changed while computing)
+    this->Internal->StartRefinement();
+    if (!wait)
+    {
+      return false;
+    }
+  }
+
+  // Swap in the full resolution surfaces
+  vtkInternal::Refinement refinement = pendingRefinement;
+  pendingRefinement = vtkInternal::Refinement();
+  this->Internal->PruneCache(cache, refinement.ContourValues);
+
+  vtkMRMLIsodoseNode* parameterNode = refinement.ParameterNode;
+  vtkMRMLModelNode* isodoseModelNode = (parameterNode ? parameterNode->GetIsosurfacesModelNode() : nullptr);
+  if (!isodoseModelNode)
+  {
+    return false;
+  }
+  std::vector<vtkSmartPointer<vtkPolyData>> levelSurfaces;
+  for (double contourValue : refinement.ContourValues)
+  {
+    levelSurfaces.push_back(cache.Surfaces[contourValue]);
+  }
+  vtkSmartPointer<vtkPolyData> isoSurfaces = AppendIsodoseLevelSurfaces(
+    refinement.IsoLevels, refinement.ContourValues, levelSurfaces, refinement.IJKToRASMatrix);
+  if (!isoSurfaces)
+  {
+    isoSurfaces = vtkSmartPointer<vtkPolyData>::New();
+  }
+  isodoseModelNode->SetAndObservePolyData(isoSurfaces);
+  return true;
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerIsodoseModuleLogic::IsIsodoseRefinementPending()
+{
+  return this->Internal->PendingRefinement.Requested || this->Internal->RunningRefinement.valid();
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerIsodoseModuleLogic::CancelIsodoseRefinement()
+{
+  this->Internal->PendingRefinement = vtkInternal::Refinement();
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerIsodoseModuleLogic::ClearIsodoseLevelCache()
+{
+  this->Internal->FullResolutionCache = vtkInternal::LevelSurfaceCache();
+  this->Internal->CoarseCache = vtkInternal::LevelSurfaceCache();
+}
+
+//---------------------------------------------------------------------------
+vtkPolyData* vtkSlicerIsodoseModuleLogic::GetCachedIsodoseLevelSurface(double contourValue)
+{
+  std::map<double, vtkSmartPointer<vtkPolyData>>& surfaces = this->Internal->FullResolutionCache.Surfaces;
+  std::map<double, vtkSmartPointer<vtkPolyData>>::iterator surfaceIt = surfaces.find(contourValue);
+  return (surfaceIt != surfaces.end() ? surfaceIt->second.GetPointer() : nullptr);
+}
+
 //---------------------------------------------------------------------------
 void vtkSlicerIsodoseModuleLogic::UpdateDoseColorTableFromIsodose(vtkMRMLIsodoseNode* parameterNode)
 {
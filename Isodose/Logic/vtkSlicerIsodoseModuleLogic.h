@@ -39,6 +39,7 @@ class vtkMRMLIsodoseNode;
 class vtkMRMLModelHierarchyNode;
 class vtkMRMLScalarVolumeNode;
 
+class vtkPolyData;
 class vtkSlicerColorLogic;
 
 /// \ingroup SlicerRt_QtModules_Isodose
@@ -62,6 +63,30 @@ public:
   /// \return true if success, false otherwise
   bool CreateIsodoseSurfaces(vtkMRMLIsodoseNode* parameterNode);
 
+  /// Swap in the full resolution isodose surfaces computed in the background in progressive mode
+  /// (see vtkMRMLIsodoseNode::Progressive). Needs to be called periodically from the main thread
+  /// after CreateIsodoseSurfaces returned coarse surfaces.
+  /// \param wait Wait for the background computation to finish if true, return immediately otherwise
+  /// \return true if the isodose model was updated with the full resolution surfaces, false otherwise
+  bool ProcessIsodoseRefinement(bool wait=false);
+
+  /// Determine whether full resolution isodose surfaces are being computed or waiting to be swapped in
+  bool IsIsodoseRefinementPending();
+
+  /// Do not swap in the full resolution isodose surfaces of the last progressive computation, e.g. because
+  /// the parameters have changed since. A running background computation is finished, and its surfaces are
+  /// kept in the level cache.
+  void CancelIsodoseRefinement();
+
+  /// Clear isodose level surfaces that are kept to avoid recomputing unchanged levels
+  void ClearIsodoseLevelCache();
+
+  /// Get the full resolution surface of an isodose level kept in the level cache, in the IJK coordinate system
+  /// of the last contoured dose volume
+  /// \param contourValue Dose value of the isodose level
+  /// \return The cached surface, nullptr if the level is not cached or has no surface
+  vtkPolyData* GetCachedIsodoseLevelSurface(double contourValue);
+
   /// Make sure a dose volume has a valid associated isodose color table node
   vtkMRMLColorTableNode* SetupColorTableNodeForDoseVolumeNode(vtkMRMLScalarVolumeNode* doseVolumeNode);
 
@@ -109,6 +134,9 @@ private:
   void operator=(const vtkSlicerIsodoseModuleLogic&) = delete;
   /// Unique name of the copy of default isodose color table node
   static std::string IsodoseColorNodeCopyUniqueName;
+
+  class vtkInternal;
+  vtkInternal* Internal;
 };
 
 #endif
@@ -69,6 +69,8 @@ void vtkMRMLIsodoseNode::WriteXML(ostream& of, int nIndent)
   vtkMRMLWriteXMLFloatMacro(ReferenceDoseValue, ReferenceDoseValue);
   vtkMRMLWriteXMLBooleanMacro(RelativeRepresentationFlag, RelativeRepresentationFlag);
   vtkMRMLWriteXMLBooleanMacro(RealTime, RealTime);
+  vtkMRMLWriteXMLBooleanMacro(Progressive, Progressive);
+  vtkMRMLWriteXMLFloatMacro(ProgressiveLatencyBudgetMs, ProgressiveLatencyBudgetMs);
 
   vtkMRMLWriteXMLEndMacro();
 }
@@ -87,6 +89,8 @@ void vtkMRMLIsodoseNode::ReadXMLAttributes(const char** atts)
   vtkMRMLReadXMLFloatMacro(ReferenceDoseValue, ReferenceDoseValue);
   vtkMRMLReadXMLBooleanMacro(RelativeRepresentationFlag, RelativeRepresentationFlag);
   vtkMRMLReadXMLBooleanMacro(RealTime, RealTime);
+  vtkMRMLReadXMLBooleanMacro(Progressive, Progressive);
+  vtkMRMLReadXMLFloatMacro(ProgressiveLatencyBudgetMs, ProgressiveLatencyBudgetMs);
   vtkMRMLReadXMLEndMacro();
 
   this->EndModify(disabledModify);
@@ -109,6 +113,8 @@ void vtkMRMLIsodoseNode::Copy(vtkMRMLNode *anode)
   vtkMRMLCopyFloatMacro(ReferenceDoseValue);
   vtkMRMLCopyBooleanMacro(RelativeRepresentationFlag);
   vtkMRMLCopyBooleanMacro(RealTime);
+  vtkMRMLCopyBooleanMacro(Progressive);
+  vtkMRMLCopyFloatMacro(ProgressiveLatencyBudgetMs);
   vtkMRMLCopyEndMacro();
 
   this->EndModify(disabledModify);
@@ -127,6 +133,8 @@ void vtkMRMLIsodoseNode::PrintSelf(ostream& os, vtkIndent indent)
   vtkMRMLPrintFloatMacro(ReferenceDoseValue);
   vtkMRMLPrintBooleanMacro(RelativeRepresentationFlag);
   vtkMRMLPrintBooleanMacro(RealTime);
+  vtkMRMLPrintBooleanMacro(Progressive);
+  vtkMRMLPrintFloatMacro(ProgressiveLatencyBudgetMs);
   vtkMRMLPrintEndMacro();
 }
 
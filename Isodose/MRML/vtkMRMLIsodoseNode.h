@@ -121,6 +121,19 @@ public:
   vtkBooleanMacro(RealTime, bool);
   //@}
 
+  //@{
+  /// Get/Set progressive computation flag
+  vtkGetMacro(Progressive, bool);
+  vtkSetMacro(Progressive, bool);
+  vtkBooleanMacro(Progressive, bool);
+  //@}
+
+  //@{
+  /// Get/Set latency budget of progressive computation (in milliseconds)
+  vtkGetMacro(ProgressiveLatencyBudgetMs, double);
+  vtkSetMacro(ProgressiveLatencyBudgetMs, double);
+  //@}
+
 protected:
   vtkMRMLIsodoseNode();
   ~vtkMRMLIsodoseNode();
@@ -156,6 +169,15 @@ protected:
   /// Instead, top-level isodose model nodes are re-used (by node name) at every computation. It is useful when isodose is needed
   /// to be computed on-the-fly for streamed dose data, when one set of isodose surfaces is all that is needed to be kept and displayed.
   bool RealTime{false};
+
+  /// Flag enabling progressive computation of the isodose surfaces, mainly for real time applications.
+  /// If the full resolution surfaces are not expected to be computed within the latency budget, then
+  /// surfaces from a downsampled dose volume are shown first, and the full resolution surfaces are computed
+  /// in the background. See vtkSlicerIsodoseModuleLogic::ProcessIsodoseRefinement.
+  bool Progressive{false};
+
+  /// Time allowed for computing the surfaces shown first in progressive mode
+  double ProgressiveLatencyBudgetMs{100.0};
 };
 
 #endif
@@ -47,6 +47,8 @@
 
 // STD includes
 #include <iostream>
+#include <string>
+#include <vector>
 
 // VTKSYS includes
 #include <vtksys/SystemTools.hxx>
@@ -133,6 +135,18 @@ int vtkSlicerIsodoseModuleLogicTest1( int argc, char * argv[] )
     return EXIT_FAILURE;
   }
 
+  // Progressive computation (optional)
+  bool progressive = false;
+  if (argc > argIndex+1)
+  {
+    if (STRCASECMP(argv[argIndex], "-Progressive") == 0)
+    {
+      progressive = (vtkVariant(argv[argIndex+1]).ToInt() != 0);
+      std::cout << "Progressive computation: " << (progressive ? "true" : "false") << std::endl;
+      argIndex += 2;
+    }
+  }
+
   // Constraint the criteria to be greater than zero
   if (volumeDifferenceToleranceCc == 0.0)
   {
@@ -191,7 +205,37 @@ int vtkSlicerIsodoseModuleLogicTest1( int argc, char * argv[] )
   paramNode->SetAndObserveColorTableNode(isodoseColorNode);
 
   // Compute isosurface for dose volume
+  if (progressive)
+  {
+    // Zero latency budget forces computing coarse surfaces first
+    paramNode->RealTimeOn();
+    paramNode->ProgressiveOn();
+    paramNode->SetProgressiveLatencyBudgetMs(0.0);
+  }
   bool result = isodoseLogic->CreateIsodoseSurfaces(paramNode);
+  if (progressive)
+  {
+    if (!isodoseLogic->IsIsodoseRefinementPending())
+    {
+      std::cerr << "ERROR: Full resolution isodose surfaces are not computed in progressive mode" << std::endl;
+      return EXIT_FAILURE;
+    }
+    if (!isodoseLogic->ProcessIsodoseRefinement(true))
+    {
+      std::cerr << "ERROR: Failed to swap in full resolution isodose surfaces" << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    // Full resolution surfaces are cached, so they are used directly when computing again
+    vtkIdType numberOfFullResolutionPoints = paramNode->GetIsosurfacesModelNode()->GetPolyData()->GetNumberOfPoints();
+    result = isodoseLogic->CreateIsodoseSurfaces(paramNode) && result;
+    if (isodoseLogic->IsIsodoseRefinementPending()
+      || paramNode->GetIsosurfacesModelNode()->GetPolyData()->GetNumberOfPoints() != numberOfFullResolutionPoints)
+    {
+      std::cerr << "ERROR: Cached full resolution isodose surfaces are not used" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
   mrmlScene->Commit();
   // Check the result and model
   if (result && paramNode->GetIsosurfacesModelNode())
@@ -230,5 +274,72 @@ int vtkSlicerIsodoseModuleLogicTest1( int argc, char * argv[] )
     return EXIT_FAILURE;
   }
 
+  // Editing one of several isodose levels only recomputes the surface of that level
+  paramNode->ProgressiveOff();
+  double doseRange[2] = { 0.0, 0.0 };
+  doseScalarVolumeNode->GetImageData()->GetScalarRange(doseRange);
+  const int numberOfLevels = 3;
+  std::vector<std::string> levelNames;
+  for (int levelIndex = 0; levelIndex < numberOfLevels; ++levelIndex)
+  {
+    levelNames.push_back(vtkVariant(doseRange[1] * (levelIndex + 1) / (numberOfLevels + 1)).ToString());
+  }
+  isodoseColorNode->SetNumberOfColors(numberOfLevels);
+  for (int levelIndex = 0; levelIndex < numberOfLevels; ++levelIndex)
+  {
+    isodoseColorNode->SetColor(levelIndex, levelNames[levelIndex].c_str(), 1.0, 0.5 * levelIndex, 0.0, 1.0);
+  }
+  if (!isodoseLogic->CreateIsodoseSurfaces(paramNode))
+  {
+    std::cerr << "ERROR: Failed to compute isosurfaces for " << numberOfLevels << " levels" << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::vector<vtkPolyData*> levelSurfaces;
+  std::vector<vtkMTimeType> levelSurfaceMTimes;
+  for (int levelIndex = 0; levelIndex < numberOfLevels; ++levelIndex)
+  {
+    vtkPolyData* levelSurface = isodoseLogic->GetCachedIsodoseLevelSurface(vtkVariant(levelNames[levelIndex]).ToDouble());
+    if (!levelSurface || levelSurface->GetNumberOfPoints() == 0)
+    {
+      std::cerr << "ERROR: No surface is computed for isodose level " << levelNames[levelIndex] << std::endl;
+      return EXIT_FAILURE;
+    }
+    levelSurfaces.push_back(levelSurface);
+    levelSurfaceMTimes.push_back(levelSurface->GetMTime());
+  }
+
+  const int editedLevelIndex = 1;
+  std::string editedLevelName = vtkVariant(doseRange[1] * 0.6).ToString();
+  isodoseColorNode->SetColorName(editedLevelIndex, editedLevelName.c_str());
+  if (!isodoseLogic->CreateIsodoseSurfaces(paramNode))
+  {
+    std::cerr << "ERROR: Failed to compute isosurfaces after editing isodose level " << editedLevelIndex << std::endl;
+    return EXIT_FAILURE;
+  }
+  for (int levelIndex = 0; levelIndex < numberOfLevels; ++levelIndex)
+  {
+    if (levelIndex == editedLevelIndex)
+    {
+      continue;
+    }
+    vtkPolyData* levelSurface = isodoseLogic->GetCachedIsodoseLevelSurface(vtkVariant(levelNames[levelIndex]).ToDouble());
+    if (levelSurface != levelSurfaces[levelIndex] || levelSurface->GetMTime() != levelSurfaceMTimes[levelIndex])
+    {
+      std::cerr << "ERROR: Surface of unchanged isodose level " << levelNames[levelIndex] << " is recomputed" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+  vtkPolyData* editedLevelSurface = isodoseLogic->GetCachedIsodoseLevelSurface(vtkVariant(editedLevelName).ToDouble());
+  if (!editedLevelSurface || editedLevelSurface == levelSurfaces[editedLevelIndex] || editedLevelSurface->GetNumberOfPoints() == 0)
+  {
+    std::cerr << "ERROR: Surface of edited isodose level " << editedLevelName << " is not computed" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (isodoseLogic->GetCachedIsodoseLevelSurface(vtkVariant(levelNames[editedLevelIndex]).ToDouble()))
+  {
+    std::cerr << "ERROR: Surface of the previous value of the edited isodose level is still cached" << std::endl;
+    return EXIT_FAILURE;
+  }
+
   return EXIT_SUCCESS;
 }
@@ -22,6 +22,7 @@
 // Qt includes
 #include <QCheckBox>
 #include <QDebug>
+#include <QTimer>
 
 // SlicerQt includes
 #include "qSlicerIsodoseModuleWidget.h"
@@ -74,6 +75,9 @@ public:
   vtkWeakPointer<vtkMRMLIsodoseNode> IsodoseNode;
   vtkWeakPointer<vtkMRMLColorTableNode> IsodoseColorTableNode;
   vtkWeakPointer<vtkMRMLColorLegendDisplayNode> ColorLegendNode;
+
+  /// Timer polling the full resolution isodose surfaces computed in the background in progressive mode
+  QTimer* IsodoseRefinementTimer;
 };
 
 //-----------------------------------------------------------------------------
@@ -82,6 +86,7 @@ public:
 //-----------------------------------------------------------------------------
 qSlicerIsodoseModuleWidgetPrivate::qSlicerIsodoseModuleWidgetPrivate(qSlicerIsodoseModuleWidget& object)
   : q_ptr(&object)
+  , IsodoseRefinementTimer(nullptr)
 {
 }
 
@@ -230,6 +235,7 @@ void qSlicerIsodoseModuleWidget::updateWidgetFromMRML()
     d->checkBox_Isoline->setChecked(d->IsodoseNode->GetShowIsodoseLines());
     d->checkBox_Isosurface->setChecked(d->IsodoseNode->GetShowIsodoseSurfaces());
     d->checkBox_ShowDoseVolumesOnly->setChecked(d->IsodoseNode->GetShowDoseVolumesOnly());
+    d->checkBox_Progressive->setChecked(d->IsodoseNode->GetProgressive());
 
     if (d->IsodoseNode->GetIsosurfacesModelNode())
     {
@@ -263,6 +269,10 @@ void qSlicerIsodoseModuleWidget::setup()
   d->setupUi(this);
   this->Superclass::setup();
 
+  d->IsodoseRefinementTimer = new QTimer(this);
+  d->IsodoseRefinementTimer->setSingleShot(true);
+  d->IsodoseRefinementTimer->setInterval(50);
+
   // Show only dose volumes in the dose volume combobox by default
   d->MRMLNodeComboBox_DoseVolume->addAttribute( QString("vtkMRMLScalarVolumeNode"), vtkSlicerRtCommon::DICOMRTIMPORT_DOSE_VOLUME_IDENTIFIER_ATTRIBUTE_NAME.c_str());
 
@@ -275,6 +285,8 @@ void qSlicerIsodoseModuleWidget::setup()
   connect( d->checkBox_ShowDoseVolumesOnly, SIGNAL( stateChanged(int) ), this, SLOT( showDoseVolumesOnlyCheckboxChanged(int) ) );
   connect( d->checkBox_Isoline, SIGNAL(toggled(bool)), this, SLOT( setIsolineVisibility(bool) ) );
   connect( d->checkBox_Isosurface, SIGNAL(toggled(bool)), this, SLOT( setIsosurfaceVisibility(bool) ) );
+  connect( d->checkBox_Progressive, SIGNAL(toggled(bool)), this, SLOT( setProgressive(bool) ) );
+  connect( d->IsodoseRefinementTimer, SIGNAL(timeout()), this, SLOT( processIsodoseRefinement() ) );
   connect( d->pushButton_Apply, SIGNAL(clicked()), this, SLOT(applyClicked()) );
   connect( d->groupBox_RelativeIsolevels, SIGNAL(toggled(bool)), this, SLOT(setRelativeIsolevelsFlag(bool)));
   connect( d->sliderWidget_ReferenceDose, SIGNAL(valueChanged(double)), this, SLOT(setReferenceDoseValue(double)));
@@ -337,9 +349,14 @@ void qSlicerIsodoseModuleWidget::setDoseVolumeNode(vtkMRMLNode* node)
   {
     qvtkDisconnect(previousColorNode, vtkCommand::ModifiedEvent,
       this, SLOT(updateScalarBarsFromSelectedColorTable()));
+    qvtkDisconnect(previousColorNode, vtkCommand::ModifiedEvent,
+      this, SLOT(cancelIsodoseRefinement()));
     d->IsodoseColorTableNode = nullptr;
   }
 
+  // Surfaces computed in the background are for the previous dose volume
+  this->cancelIsodoseRefinement();
+
   d->IsodoseNode->DisableModifiedEventOn();
   d->IsodoseNode->SetAndObserveDoseVolumeNode(vtkMRMLScalarVolumeNode::SafeDownCast(node));
   d->IsodoseNode->DisableModifiedEventOff();
@@ -418,6 +435,9 @@ void qSlicerIsodoseModuleWidget::setDoseVolumeNode(vtkMRMLNode* node)
 
     qvtkConnect(selectedColorNode, vtkCommand::ModifiedEvent,
       this, SLOT(updateScalarBarsFromSelectedColorTable()));
+    // Editing the isodose levels changes the surfaces to compute
+    qvtkConnect(selectedColorNode, vtkCommand::ModifiedEvent,
+      this, SLOT(cancelIsodoseRefinement()));
     d->IsodoseColorTableNode = selectedColorNode;
   }
   else
@@ -465,6 +485,7 @@ void qSlicerIsodoseModuleWidget::setNumberOfLevels(int newNumber)
     return;
   }
 
+  this->cancelIsodoseRefinement();
   d->logic()->SetNumberOfIsodoseLevels(d->IsodoseNode, newNumber);
 
   if (!d->IsodoseColorTableNode)
@@ -522,6 +543,8 @@ void qSlicerIsodoseModuleWidget::setRelativeIsolevelsFlag(bool useRelativeIsolev
     return;
   }
 
+  this->cancelIsodoseRefinement();
+
   d->IsodoseNode->DisableModifiedEventOn();
   d->IsodoseNode->SetRelativeRepresentationFlag(useRelativeIsolevels);
   d->IsodoseNode->DisableModifiedEventOff();
@@ -569,6 +592,7 @@ void qSlicerIsodoseModuleWidget::setRelativeIsolevelsFlag(bool useRelativeIsolev
     d->spinBox_NumberOfLevels->setValue(selectedColorNode->GetNumberOfColors());
 
     qvtkConnect(selectedColorNode, vtkCommand::ModifiedEvent, this, SLOT(updateScalarBarsFromSelectedColorTable()));
+    qvtkConnect(selectedColorNode, vtkCommand::ModifiedEvent, this, SLOT(cancelIsodoseRefinement()));
     d->IsodoseColorTableNode = selectedColorNode;
   }
   else
@@ -602,6 +626,9 @@ void qSlicerIsodoseModuleWidget::setReferenceDoseValue(double value)
     d->label_PercentageOfMaxVolumeDose->setText("");
   }
 
+  // Relative isodose levels are computed from the reference dose
+  this->cancelIsodoseRefinement();
+
   d->IsodoseNode->DisableModifiedEventOn();
   switch (d->IsodoseNode->GetDoseUnits())
   {
@@ -689,6 +716,53 @@ void qSlicerIsodoseModuleWidget::setIsosurfaceVisibility(bool visible)
   }
 }
 
+//------------------------------------------------------------------------------
+void qSlicerIsodoseModuleWidget::setProgressive(bool progressive)
+{
+  Q_D(qSlicerIsodoseModuleWidget);
+
+  if (!d->IsodoseNode)
+  {
+    return;
+  }
+
+  d->IsodoseNode->DisableModifiedEventOn();
+  d->IsodoseNode->SetProgressive(progressive);
+  d->IsodoseNode->DisableModifiedEventOff();
+}
+
+//------------------------------------------------------------------------------
+void qSlicerIsodoseModuleWidget::processIsodoseRefinement()
+{
+  Q_D(qSlicerIsodoseModuleWidget);
+
+  if (!d->logic())
+  {
+    return;
+  }
+
+  d->logic()->ProcessIsodoseRefinement();
+  if (d->logic()->IsIsodoseRefinementPending())
+  {
+    d->IsodoseRefinementTimer->start();
+  }
+}
+
+//------------------------------------------------------------------------------
+void qSlicerIsodoseModuleWidget::cancelIsodoseRefinement()
+{
+  Q_D(qSlicerIsodoseModuleWidget);
+
+  if (d->IsodoseRefinementTimer)
+  {
+    d->IsodoseRefinementTimer->stop();
+  }
+  if (d->logic())
+  {
+    d->logic()->CancelIsodoseRefinement();
+  }
+}
+
 //-----------------------------------------------------------------------------
 void qSlicerIsodoseModuleWidget::applyClicked()
 {
@@ -710,6 +784,12 @@ void qSlicerIsodoseModuleWidget::applyClicked()
   // Compute the isodose surface for the selected dose volume and create color legend node if isosurfaces
   // model node has been calculated successfully
   bool res = d->logic()->CreateIsodoseSurfaces(d->IsodoseNode);
+
+  // In progressive mode, coarse surfaces are shown until the full resolution ones are ready
+  if (d->logic()->IsIsodoseRefinementPending())
+  {
+    d->IsodoseRefinementTimer->start();
+  }
   if (res && d->IsodoseNode->GetIsosurfacesModelNode())
   {
     vtkMRMLModelNode* modelNode = vtkMRMLModelNode::SafeDownCast(d->MRMLNodeComboBox_IsodoseModel->currentNode());
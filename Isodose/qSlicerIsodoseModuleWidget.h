@@ -87,6 +87,16 @@ protected slots:
   /// Slot for changing isosurface visibility
   void setIsosurfaceVisibility(bool);
 
+  /// Slot handling change of progressive computation checkbox
+  void setProgressive(bool);
+
+  /// Swap in the full resolution isodose surfaces when they are ready in progressive mode,
+  /// and check again later if they are not
+  void processIsodoseRefinement();
+
+  /// Do not swap in full resolution isodose surfaces computed for the parameters before they changed
+  void cancelIsodoseRefinement();
+
   /// Slot handling clicking the Apply button
   void applyClicked();
 
@@ -55,10 +55,10 @@
 //----------------------------------------------------------------------------
 template<class T> 
 static typename itk::Image<T,3>::Pointer
-convert_to_itk (vtkMRMLScalarVolumeNode* inVolumeNode, bool applyWorldTransform)
+convert_to_itk (vtkMRMLScalarVolumeNode* inVolumeNode, bool applyWorldTransform, bool shareBuffer)
 {
   typename itk::Image<T,3>::Pointer image = itk::Image<T,3>::New ();
-  if (!vtkSlicerRtCommon::ConvertVolumeNodeToItkImage<T>(inVolumeNode, image, applyWorldTransform, true))
+  if (!vtkSlicerRtCommon::ConvertVolumeNodeToItkImage<T>(inVolumeNode, image, applyWorldTransform, true, shareBuffer))
   {
     vtkGenericWarningMacro("PlmCommon::convert_to_itk(vtkMRMLScalarVolumeNode): Failed to convert volume node to PlmImage!");
   }
@@ -68,10 +68,10 @@ convert_to_itk (vtkMRMLScalarVolumeNode* inVolumeNode, bool applyWorldTransform)
 //----------------------------------------------------------------------------
 template<class T> 
 static typename itk::Image<T,3>::Pointer
-convert_to_itk (vtkOrientedImageData* inImageData)
+convert_to_itk (vtkOrientedImageData* inImageData, bool shareBuffer)
 {
   typename itk::Image<T,3>::Pointer image = itk::Image<T,3>::New ();
-  if (!vtkSlicerRtCommon::ConvertVtkOrientedImageDataToItkImage<T>(inImageData, image, true))
+  if (!vtkSlicerRtCommon::ConvertVtkOrientedImageDataToItkImage<T>(inImageData, image, true, shareBuffer))
   {
     vtkGenericWarningMacro("PlmCommon::convert_to_itk(vtkOrientedImageData): Failed to convert oriented image data to PlmImage!");
   }
@@ -81,7 +81,7 @@ convert_to_itk (vtkOrientedImageData* inImageData)
 //----------------------------------------------------------------------------
 //----------------------------------------------------------------------------
 Plm_image::Pointer 
-PlmCommon::ConvertVolumeNodeToPlmImage(vtkMRMLScalarVolumeNode* inVolumeNode, bool applyWorldTransform/* = true*/)
+PlmCommon::ConvertVolumeNodeToPlmImage(vtkMRMLScalarVolumeNode* inVolumeNode, bool applyWorldTransform/* = true*/, bool shareBuffer/* = false*/)
 {
   Plm_image::Pointer image = Plm_image::New ();
 
@@ -97,49 +97,49 @@ PlmCommon::ConvertVolumeNodeToPlmImage(vtkMRMLScalarVolumeNode* inVolumeNode, bo
   switch (vtk_type) {
   case VTK_CHAR:
   case VTK_SIGNED_CHAR:
-    image->set_itk (convert_to_itk<char> (inVolumeNode, applyWorldTransform));
+    image->set_itk (convert_to_itk<char> (inVolumeNode, applyWorldTransform, shareBuffer));
     break;
   
   case VTK_UNSIGNED_CHAR:
-    image->set_itk (convert_to_itk<unsigned char> (inVolumeNode, applyWorldTransform));
+    image->set_itk (convert_to_itk<unsigned char> (inVolumeNode, applyWorldTransform, shareBuffer));
     break;
   
   case VTK_SHORT:
-    image->set_itk (convert_to_itk<short> (inVolumeNode, applyWorldTransform));
+    image->set_itk (convert_to_itk<short> (inVolumeNode, applyWorldTransform, shareBuffer));
     break;
   
   case VTK_UNSIGNED_SHORT:
-    image->set_itk (convert_to_itk<unsigned short> (inVolumeNode, applyWorldTransform));
+    image->set_itk (convert_to_itk<unsigned short> (inVolumeNode, applyWorldTransform, shareBuffer));
     break;
   
 #if (CMAKE_SIZEOF_UINT == 4)
   case VTK_INT:
   case VTK_LONG: 
-    image->set_itk (convert_to_itk<int> (inVolumeNode, applyWorldTransform));
+    image->set_itk (convert_to_itk<int> (inVolumeNode, applyWorldTransform, shareBuffer));
     break;
   
   case VTK_UNSIGNED_INT:
   case VTK_UNSIGNED_LONG:
-    image->set_itk (convert_to_itk<unsigned int> (inVolumeNode, applyWorldTransform));
+    image->set_itk (convert_to_itk<unsigned int> (inVolumeNode, applyWorldTransform, shareBuffer));
     break;
 #else
   case VTK_INT:
   case VTK_LONG: 
-    image->set_itk (convert_to_itk<long> (inVolumeNode, applyWorldTransform));
+    image->set_itk (convert_to_itk<long> (inVolumeNode, applyWorldTransform, shareBuffer));
     break;
   
   case VTK_UNSIGNED_INT:
   case VTK_UNSIGNED_LONG:
-    image->set_itk (convert_to_itk<unsigned long> (inVolumeNode, applyWorldTransform));
+    image->set_itk (convert_to_itk<unsigned long> (inVolumeNode, applyWorldTransform, shareBuffer));
     break;
 #endif
   
   case VTK_FLOAT:
-    image->set_itk (convert_to_itk<float> (inVolumeNode, applyWorldTransform));
+    image->set_itk (convert_to_itk<float> (inVolumeNode, applyWorldTransform, shareBuffer));
     break;
   
   case VTK_DOUBLE:
-    image->set_itk (convert_to_itk<double> (inVolumeNode, applyWorldTransform));
+    image->set_itk (convert_to_itk<double> (inVolumeNode, applyWorldTransform, shareBuffer));
     break;
 
   default:
@@ -152,15 +152,15 @@ PlmCommon::ConvertVolumeNodeToPlmImage(vtkMRMLScalarVolumeNode* inVolumeNode, bo
 
 //----------------------------------------------------------------------------
 Plm_image::Pointer 
-PlmCommon::ConvertVolumeNodeToPlmImage(vtkMRMLNode* inNode, bool applyWorldTransform/* = true*/)
+PlmCommon::ConvertVolumeNodeToPlmImage(vtkMRMLNode* inNode, bool applyWorldTransform/* = true*/, bool shareBuffer/* = false*/)
 {
   return PlmCommon::ConvertVolumeNodeToPlmImage(
-    vtkMRMLScalarVolumeNode::SafeDownCast(inNode), applyWorldTransform);
+    vtkMRMLScalarVolumeNode::SafeDownCast(inNode), applyWorldTransform, shareBuffer);
 }
 
 //----------------------------------------------------------------------------
 Plm_image::Pointer 
-PlmCommon::ConvertVtkOrientedImageDataToPlmImage(vtkOrientedImageData* inImageData)
+PlmCommon::ConvertVtkOrientedImageDataToPlmImage(vtkOrientedImageData* inImageData, bool shareBuffer/* = false*/)
 {
   Plm_image::Pointer image = Plm_image::New ();
 
@@ -175,49 +175,49 @@ PlmCommon::ConvertVtkOrientedImageDataToPlmImage(vtkOrientedImageData* inImageDa
   switch (vtk_type) {
   case VTK_CHAR:
   case VTK_SIGNED_CHAR:
-    image->set_itk (convert_to_itk<char> (inImageData));
+    image->set_itk (convert_to_itk<char> (inImageData, shareBuffer));
     break;
   
   case VTK_UNSIGNED_CHAR:
-    image->set_itk (convert_to_itk<unsigned char> (inImageData));
+    image->set_itk (convert_to_itk<unsigned char> (inImageData, shareBuffer));
     break;
   
   case VTK_SHORT:
-    image->set_itk (convert_to_itk<short> (inImageData));
+    image->set_itk (convert_to_itk<short> (inImageData, shareBuffer));
     break;
   
   case VTK_UNSIGNED_SHORT:
-    image->set_itk (convert_to_itk<unsigned short> (inImageData));
+    image->set_itk (convert_to_itk<unsigned short> (inImageData, shareBuffer));
     break;
   
 #if (CMAKE_SIZEOF_UINT == 4)
   case VTK_INT:
   case VTK_LONG: 
-    image->set_itk (convert_to_itk<int> (inImageData));
+    image->set_itk (convert_to_itk<int> (inImageData, shareBuffer));
     break;
   
   case VTK_UNSIGNED_INT:
   case VTK_UNSIGNED_LONG:
-    image->set_itk (convert_to_itk<unsigned int> (inImageData));
+    image->set_itk (convert_to_itk<unsigned int> (inImageData, shareBuffer));
     break;
 #else
   case VTK_INT:
   case VTK_LONG: 
-    image->set_itk (convert_to_itk<long> (inImageData));
+    image->set_itk (convert_to_itk<long> (inImageData, shareBuffer));
     break;
   
   case VTK_UNSIGNED_INT:
   case VTK_UNSIGNED_LONG:
-    image->set_itk (convert_to_itk<unsigned long> (inImageData));
+    image->set_itk (convert_to_itk<unsigned long> (inImageData, shareBuffer));
     break;
 #endif
   
   case VTK_FLOAT:
-    image->set_itk (convert_to_itk<float> (inImageData));
+    image->set_itk (convert_to_itk<float> (inImageData, shareBuffer));
     break;
   
   case VTK_DOUBLE:
-    image->set_itk (convert_to_itk<double> (inImageData));
+    image->set_itk (convert_to_itk<double> (inImageData, shareBuffer));
     break;
 
   default:
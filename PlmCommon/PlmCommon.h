@@ -48,15 +48,21 @@ public:
   /// Convert MRML volume node to Plm image using typed scalar volume node
   /// \param inVolumeNode Scalar volume node to convert
   /// \param applyWorldTransform Flag determining if parent transform is applied to volume node when converting to Plm image. True by default
-  static Plm_image::Pointer ConvertVolumeNodeToPlmImage(vtkMRMLScalarVolumeNode* inVolumeNode, bool applyWorldTransform = true);
+  /// \param shareBuffer Flag determining if the Plm image uses the voxels of the volume node without copying them.
+  ///   The Plm image must not be modified in place then. False by default
+  static Plm_image::Pointer ConvertVolumeNodeToPlmImage(vtkMRMLScalarVolumeNode* inVolumeNode, bool applyWorldTransform = true, bool shareBuffer = false);
 
   /// Convert MRML volume node to Plm image using generic MRML node type
   /// \param inNode Node to convert (must be scalar volume node type)
   /// \param applyWorldTransform Flag determining if parent transform is applied to volume node when converting to Plm image. True by default
-  static Plm_image::Pointer ConvertVolumeNodeToPlmImage(vtkMRMLNode* inNode, bool applyWorldTransform = true);
+  /// \param shareBuffer Flag determining if the Plm image uses the voxels of the volume node without copying them. False by default
+  static Plm_image::Pointer ConvertVolumeNodeToPlmImage(vtkMRMLNode* inNode, bool applyWorldTransform = true, bool shareBuffer = false);
 
   /// Convert VTK oriented image data to Plm image
-  static Plm_image::Pointer ConvertVtkOrientedImageDataToPlmImage(vtkOrientedImageData* inImageData);
+  /// \param inImageData Oriented image data to convert
+  /// \param shareBuffer Flag determining if the Plm image uses the scalars of the image data without copying them.
+  ///   The Plm image must not be modified in place then. False by default
+  static Plm_image::Pointer ConvertVtkOrientedImageDataToPlmImage(vtkOrientedImageData* inImageData, bool shareBuffer = false);
 };
 
 #endif
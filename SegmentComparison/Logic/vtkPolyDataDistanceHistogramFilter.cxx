@@ -11,12 +11,482 @@
 #include <vtkMath.h>
 #include <vtkObjectFactory.h>
 #include <vtkPolyDataPointSampler.h>
+#include <vtkSMPThreadLocal.h>
+#include <vtkSMPTools.h>
 #include <vtkSmartPointer.h>
 #include <vtkSortDataArray.h>
 #include <vtkStreamingDemandDrivenPipeline.h>
+#include <vtkTriangleFilter.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <utility>
+#include <vector>
 
 vtkStandardNewMacro(vtkPolyDataDistanceHistogramFilter);
 
+namespace
+{
+
+//----------------------------------------------------------------------------
+/// Bounding volume hierarchy on the triangles of a poly data for computing the exact signed distance
+/// of points from the surface. The sign is determined using angle-weighted pseudo-normals (Baerentzen
+/// and Aanaes), which give the correct sign also when the closest point is on an edge or a vertex.
+/// After building, queries do not modify the tree, so they can be run concurrently.
+class TriangleBoundingVolumeHierarchy
+{
+public:
+  /// Build hierarchy from the polygons of the poly data
+  /// \return False if the poly data contains no triangles
+  bool Build(vtkPolyData* polyData)
+  {
+    this->Points.clear();
+    this->Triangles.clear();
+    this->Nodes.clear();
+
+    vtkSmartPointer<vtkTriangleFilter> triangleFilter = vtkSmartPointer<vtkTriangleFilter>::New();
+    triangleFilter->SetInputData(polyData);
+    triangleFilter->PassVertsOff();
+    triangleFilter->PassLinesOff();
+    triangleFilter->Update();
+    vtkPolyData* triangles = triangleFilter->GetOutput();
+    if (!triangles->GetPoints() || triangles->GetNumberOfPolys() == 0)
+    {
+      return false;
+    }
+
+    vtkIdType numberOfPoints = triangles->GetNumberOfPoints();
+    this->Points.resize(numberOfPoints);
+    for (vtkIdType pointId = 0; pointId < numberOfPoints; ++pointId)
+    {
+      triangles->GetPoint(pointId, this->Points[pointId].Position);
+    }
+    std::vector<Vector> vertexNormals(numberOfPoints);
+    std::map<std::pair<vtkIdType, vtkIdType>, int> edgeNormalIndices;
+    std::vector<Vector> edgeNormals;
+
+    vtkCellArray* polys = triangles->GetPolys();
+    polys->InitTraversal();
+    vtkIdType numberOfCellPoints = 0;
+    const vtkIdType* cellPointIds = nullptr;
+    while (polys->GetNextCell(numberOfCellPoints, cellPointIds))
+    {
+      if (numberOfCellPoints != 3)
+      {
+        continue;
+      }
+      Triangle triangle;
+      for (int i = 0; i < 3; ++i)
+      {
+        triangle.PointIds[i] = cellPointIds[i];
+      }
+      const double* p[3] = { this->Points[cellPointIds[0]].Position, this->Points[cellPointIds[1]].Position, this->Points[cellPointIds[2]].Position };
+      double e01[3] = { 0.0 };
+      double e02[3] = { 0.0 };
+      vtkMath::Subtract(p[1], p[0], e01);
+      vtkMath::Subtract(p[2], p[0], e02);
+      vtkMath::Cross(e01, e02, triangle.Normal.v);
+      // Degenerate triangles get zero normal, so they do not contribute to the pseudo-normals
+      vtkMath::Normalize(triangle.Normal.v);
+
+      // Vertex pseudo-normals are weighted by the incident angles of the triangle
+      for (int i = 0; i < 3; ++i)
+      {
+        double a[3] = { 0.0 };
+        double b[3] = { 0.0 };
+        vtkMath::Subtract(p[(i + 1) % 3], p[i], a);
+        vtkMath::Subtract(p[(i + 2) % 3], p[i], b);
+        double angle = vtkMath::AngleBetweenVectors(a, b);
+        Vector& vertexNormal = vertexNormals[cellPointIds[i]];
+        for (int c = 0; c < 3; ++c)
+        {
+          vertexNormal.v[c] += angle * triangle.Normal.v[c];
+        }
+      }
+      // Edge pseudo-normals are the sum of the normals of the two adjacent triangles
+      for (int i = 0; i < 3; ++i)
+      {
+        vtkIdType id0 = cellPointIds[i];
+        vtkIdType id1 = cellPointIds[(i + 1) % 3];
+        std::pair<vtkIdType, vtkIdType> edge(std::min(id0, id1), std::max(id0, id1));
+        auto edgeIt = edgeNormalIndices.find(edge);
+        if (edgeIt == edgeNormalIndices.end())
+        {
+          edgeIt = edgeNormalIndices.insert(std::make_pair(edge, static_cast<int>(edgeNormals.size()))).first;
+          edgeNormals.push_back(Vector());
+        }
+        Vector& edgeNormal = edgeNormals[edgeIt->second];
+        for (int c = 0; c < 3; ++c)
+        {
+          edgeNormal.v[c] += triangle.Normal.v[c];
+        }
+        triangle.EdgeNormalIndices[i] = edgeIt->second;
+      }
+
+      for (int c = 0; c < 3; ++c)
+      {
+        triangle.Bounds[2 * c] = std::min(std::min(p[0][c], p[1][c]), p[2][c]);
+        triangle.Bounds[2 * c + 1] = std::max(std::max(p[0][c], p[1][c]), p[2][c]);
+        triangle.Centroid[c] = (p[0][c] + p[1][c] + p[2][c]) / 3.0;
+      }
+      this->Triangles.push_back(triangle);
+    }
+    if (this->Triangles.empty())
+    {
+      return false;
+    }
+
+    for (vtkIdType pointId = 0; pointId < numberOfPoints; ++pointId)
+    {
+      for (int c = 0; c < 3; ++c)
+      {
+        this->Points[pointId].Normal[c] = vertexNormals[pointId].v[c];
+      }
+    }
+    this->EdgeNormals.swap(edgeNormals);
+
+    this->Nodes.reserve(2 * this->Triangles.size() / LeafSize + 1);
+    this->Nodes.push_back(Node());
+    this->BuildNode(0, 0, static_cast<int>(this->Triangles.size()));
+    return true;
+  }
+
+  /// Get signed distance of a point from the surface. Negative inside the surface.
+  double EvaluateSignedDistance(const double point[3]) const
+  {
+    double closestDistance2 = std::numeric_limits<double>::max();
+    double closestPoint[3] = { 0.0 };
+    const Triangle* closestTriangle = nullptr;
+    int closestFeature = FeatureFace;
+
+    int nodeStack[64];
+    int stackSize = 0;
+    nodeStack[stackSize++] = 0;
+    while (stackSize > 0)
+    {
+      const Node& node = this->Nodes[nodeStack[--stackSize]];
+      if (BoundsDistance2(node.Bounds, point) >= closestDistance2)
+      {
+        continue;
+      }
+      if (node.Count > 0)
+      {
+        for (int triangleIndex = node.Start; triangleIndex < node.Start + node.Count; ++triangleIndex)
+        {
+          const Triangle& triangle = this->Triangles[triangleIndex];
+          if (BoundsDistance2(triangle.Bounds, point) >= closestDistance2)
+          {
+            continue;
+          }
+          double trianglePoint[3] = { 0.0 };
+          int feature = this->ClosestPointOnTriangle(point, triangle, trianglePoint);
+          double distance2 = vtkMath::Distance2BetweenPoints(point, trianglePoint);
+          if (distance2 < closestDistance2)
+          {
+            closestDistance2 = distance2;
+            closestTriangle = &triangle;
+            closestFeature = feature;
+            std::copy(trianglePoint, trianglePoint + 3, closestPoint);
+          }
+        }
+        continue;
+      }
+      // Visit the nearer child first (it is pushed last)
+      int nearChild = node.Start;
+      int farChild = node.Start + 1;
+      if (BoundsDistance2(this->Nodes[farChild].Bounds, point) < BoundsDistance2(this->Nodes[nearChild].Bounds, point))
+      {
+        std::swap(nearChild, farChild);
+      }
+      nodeStack[stackSize++] = farChild;
+      nodeStack[stackSize++] = nearChild;
+    }
+    if (!closestTriangle)
+    {
+      return 0.0;
+    }
+
+    const double* pseudoNormal = closestTriangle->Normal.v;
+    if (closestFeature >= FeatureVertex0 && closestFeature <= FeatureVertex2)
+    {
+      pseudoNormal = this->Points[closestTriangle->PointIds[closestFeature - FeatureVertex0]].Normal;
+    }
+    else if (closestFeature >= FeatureEdge01 && closestFeature <= FeatureEdge20)
+    {
+      pseudoNormal = this->EdgeNormals[closestTriangle->EdgeNormalIndices[closestFeature - FeatureEdge01]].v;
+    }
+    double direction[3] = { 0.0 };
+    vtkMath::Subtract(point, closestPoint, direction);
+    double distance = std::sqrt(closestDistance2);
+    return (vtkMath::Dot(direction, pseudoNormal) < 0.0 ? -distance : distance);
+  }
+
+protected:
+  enum
+  {
+    FeatureFace = 0,
+    FeatureVertex0,
+    FeatureVertex1,
+    FeatureVertex2,
+    FeatureEdge01,
+    FeatureEdge12,
+    FeatureEdge20
+  };
+  static const int LeafSize = 4;
+
+  struct Vector
+  {
+    double v[3] = { 0.0, 0.0, 0.0 };
+  };
+  struct Point
+  {
+    double Position[3];
+    /// Angle-weighted pseudo-normal
+    double Normal[3];
+  };
+  struct Triangle
+  {
+    vtkIdType PointIds[3];
+    /// Indices of the pseudo-normals of edges 01, 12, 20
+    int EdgeNormalIndices[3];
+    Vector Normal;
+    double Bounds[6];
+    double Centroid[3];
+  };
+  struct Node
+  {
+    double Bounds[6];
+    /// Index of the first triangle for leaves, index of the first child node for inner nodes
+    int Start;
+    /// Number of triangles for leaves, 0 for inner nodes
+    int Count;
+  };
+
+  /// Build already allocated node containing triangles [start, end) and its subtree.
+  /// The two children of inner nodes are stored next to each other.
+  void BuildNode(int nodeIndex, int start, int end)
+  {
+    double bounds[6] = { VTK_DOUBLE_MAX, VTK_DOUBLE_MIN, VTK_DOUBLE_MAX, VTK_DOUBLE_MIN, VTK_DOUBLE_MAX, VTK_DOUBLE_MIN };
+    double centroidBounds[6] = { VTK_DOUBLE_MAX, VTK_DOUBLE_MIN, VTK_DOUBLE_MAX, VTK_DOUBLE_MIN, VTK_DOUBLE_MAX, VTK_DOUBLE_MIN };
+    for (int triangleIndex = start; triangleIndex < end; ++triangleIndex)
+    {
+      const Triangle& triangle = this->Triangles[triangleIndex];
+      for (int c = 0; c < 3; ++c)
+      {
+        bounds[2 * c] = std::min(bounds[2 * c], triangle.Bounds[2 * c]);
+        bounds[2 * c + 1] = std::max(bounds[2 * c + 1], triangle.Bounds[2 * c + 1]);
+        centroidBounds[2 * c] = std::min(centroidBounds[2 * c], triangle.Centroid[c]);
+        centroidBounds[2 * c + 1] = std::max(centroidBounds[2 * c + 1], triangle.Centroid[c]);
+      }
+    }
+    std::copy(bounds, bounds + 6, this->Nodes[nodeIndex].Bounds);
+    if (end - start <= LeafSize)
+    {
+      this->Nodes[nodeIndex].Start = start;
+      this->Nodes[nodeIndex].Count = end - start;
+      return;
+    }
+
+    // Split at the median centroid along the longest axis
+    int axis = 0;
+    for (int c = 1; c < 3; ++c)
+    {
+      if (centroidBounds[2 * c + 1] - centroidBounds[2 * c] > centroidBounds[2 * axis + 1] - centroidBounds[2 * axis])
+      {
+        axis = c;
+      }
+    }
+    int middle = start + (end - start) / 2;
+    std::nth_element(this->Triangles.begin() + start, this->Triangles.begin() + middle, this->Triangles.begin() + end,
+      [axis](const Triangle& a, const Triangle& b) { return a.Centroid[axis] < b.Centroid[axis]; });
+
+    // Allocate the two child nodes next to each other before building their subtrees
+    int firstChildIndex = static_cast<int>(this->Nodes.size());
+    this->Nodes.push_back(Node());
+    this->Nodes.push_back(Node());
+    this->Nodes[nodeIndex].Start = firstChildIndex;
+    this->Nodes[nodeIndex].Count = 0;
+    this->BuildNode(firstChildIndex, start, middle);
+    this->BuildNode(firstChildIndex + 1, middle, end);
+  }
+
+  /// Squared distance of a point from an axis-aligned box (0 if inside)
+  static double BoundsDistance2(const double bounds[6], const double point[3])
+  {
+    double distance2 = 0.0;
+    for (int c = 0; c < 3; ++c)
+    {
+      double d = std::max(std::max(bounds[2 * c] - point[c], point[c] - bounds[2 * c + 1]), 0.0);
+      distance2 += d * d;
+    }
+    return distance2;
+  }
+
+  /// Closest point on triangle (Ericson, Real-Time Collision Detection, 5.1.5)
+  /// \return Feature of the triangle on which the closest point is
+  int ClosestPointOnTriangle(const double p[3], const Triangle& triangle, double closestPoint[3]) const
+  {
+    const double* a = this->Points[triangle.PointIds[0]].Position;
+    const double* b = this->Points[triangle.PointIds[1]].Position;
+    const double* c = this->Points[triangle.PointIds[2]].Position;
+    double ab[3], ac[3], ap[3], bp[3], cp[3];
+    vtkMath::Subtract(b, a, ab);
+    vtkMath::Subtract(c, a, ac);
+    vtkMath::Subtract(p, a, ap);
+    double d1 = vtkMath::Dot(ab, ap);
+    double d2 = vtkMath::Dot(ac, ap);
+    if (d1 <= 0.0 && d2 <= 0.0)
+    {
+      std::copy(a, a + 3, closestPoint);
+      return FeatureVertex0;
+    }
+    vtkMath::Subtract(p, b, bp);
+    double d3 = vtkMath::Dot(ab, bp);
+    double d4 = vtkMath::Dot(ac, bp);
+    if (d3 >= 0.0 && d4 <= d3)
+    {
+      std::copy(b, b + 3, closestPoint);
+      return FeatureVertex1;
+    }
+    double vc = d1 * d4 - d3 * d2;
+    if (vc <= 0.0 && d1 >= 0.0 && d3 <= 0.0)
+    {
+      double v = d1 / (d1 - d3);
+      for (int i = 0; i < 3; ++i)
+      {
+        closestPoint[i] = a[i] + v * ab[i];
+      }
+      return FeatureEdge01;
+    }
+    vtkMath::Subtract(p, c, cp);
+    double d5 = vtkMath::Dot(ab, cp);
+    double d6 = vtkMath::Dot(ac, cp);
+    if (d6 >= 0.0 && d5 <= d6)
+    {
+      std::copy(c, c + 3, closestPoint);
+      return FeatureVertex2;
+    }
+    double vb = d5 * d2 - d1 * d6;
+    if (vb <= 0.0 && d2 >= 0.0 && d6 <= 0.0)
+    {
+      double w = d2 / (d2 - d6);
+      for (int i = 0; i < 3; ++i)
+      {
+        closestPoint[i] = a[i] + w * ac[i];
+      }
+      return FeatureEdge20;
+    }
+    double va = d3 * d6 - d5 * d4;
+    if (va <= 0.0 && (d4 - d3) >= 0.0 && (d5 - d6) >= 0.0)
+    {
+      double w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+      for (int i = 0; i < 3; ++i)
+      {
+        closestPoint[i] = b[i] + w * (c[i] - b[i]);
+      }
+      return FeatureEdge12;
+    }
+    double denominator = va + vb + vc;
+    if (denominator == 0.0)
+    {
+      // Degenerate triangle, all points are on the edges
+      std::copy(a, a + 3, closestPoint);
+      return FeatureVertex0;
+    }
+    double v = vb / denominator;
+    double w = vc / denominator;
+    for (int i = 0; i < 3; ++i)
+    {
+      closestPoint[i] = a[i] + ab[i] * v + ac[i] * w;
+    }
+    return FeatureFace;
+  }
+
+protected:
+  std::vector<Point> Points;
+  std::vector<Triangle> Triangles;
+  std::vector<Vector> EdgeNormals;
+  std::vector<Node> Nodes;
+};
+
+//----------------------------------------------------------------------------
+/// Evaluate the distance field of the reference poly data at the sampling points using vtkImplicitPolyDataDistance.
+/// vtkImplicitPolyDataDistance is not thread-safe, so each thread sets up its own distance field on a shallow copy
+/// of the reference poly data. Each distance is written to its own place, so the output is the same as in serial.
+class ImplicitDistanceFunctor
+{
+public:
+  ImplicitDistanceFunctor(vtkPolyData* referencePolyData, vtkPoints* samplingPoints, vtkDoubleArray* distanceArray)
+    : ReferencePolyData(referencePolyData)
+    , SamplingPoints(samplingPoints)
+    , DistanceArray(distanceArray)
+  {
+  }
+
+  void Initialize()
+  {
+    vtkSmartPointer<vtkPolyData> referencePolyDataCopy = vtkSmartPointer<vtkPolyData>::New();
+    referencePolyDataCopy->ShallowCopy(this->ReferencePolyData);
+    vtkSmartPointer<vtkImplicitPolyDataDistance> distanceField = vtkSmartPointer<vtkImplicitPolyDataDistance>::New();
+    distanceField->SetInput(referencePolyDataCopy);
+    this->DistanceField.Local() = distanceField;
+  }
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    vtkImplicitPolyDataDistance* distanceField = this->DistanceField.Local();
+    double samplePoint[3] = { 0.0 };
+    for (vtkIdType i = begin; i < end; ++i)
+    {
+      this->SamplingPoints->GetPoint(i, samplePoint);
+      this->DistanceArray->SetValue(i, distanceField->EvaluateFunction(samplePoint));
+    }
+  }
+
+  void Reduce()
+  {
+  }
+
+private:
+  vtkPolyData* ReferencePolyData;
+  vtkPoints* SamplingPoints;
+  vtkDoubleArray* DistanceArray;
+  vtkSMPThreadLocal<vtkSmartPointer<vtkImplicitPolyDataDistance> > DistanceField;
+};
+
+//----------------------------------------------------------------------------
+/// Evaluate the signed distances of the sampling points from the triangles in the bounding volume hierarchy
+class BoundingVolumeHierarchyDistanceFunctor
+{
+public:
+  BoundingVolumeHierarchyDistanceFunctor(const TriangleBoundingVolumeHierarchy& hierarchy, vtkPoints* samplingPoints, vtkDoubleArray* distanceArray)
+    : Hierarchy(hierarchy)
+    , SamplingPoints(samplingPoints)
+    , DistanceArray(distanceArray)
+  {
+  }
+
+  void operator()(vtkIdType begin, vtkIdType end) const
+  {
+    double samplePoint[3] = { 0.0 };
+    for (vtkIdType i = begin; i < end; ++i)
+    {
+      this->SamplingPoints->GetPoint(i, samplePoint);
+      this->DistanceArray->SetValue(i, this->Hierarchy.EvaluateSignedDistance(samplePoint));
+    }
+  }
+
+private:
+  const TriangleBoundingVolumeHierarchy& Hierarchy;
+  vtkPoints* SamplingPoints;
+  vtkDoubleArray* DistanceArray;
+};
+
+} // end anonymous namespace
+
 //----------------------------------------------------------------------------
 const int vtkPolyDataDistanceHistogramFilter::INPUT_PORT_REFERENCE_POLYDATA = 0;
 const int vtkPolyDataDistanceHistogramFilter::INPUT_PORT_COMPARE_POLYDATA = 1;
@@ -33,11 +503,15 @@ vtkPolyDataDistanceHistogramFilter::vtkPolyDataDistanceHistogramFilter()
   , HistogramMinimum(-10.0)
   , HistogramMaximum(10.0)
   , HistogramSpacing(0.2)
+  , ParallelComputation(1)
+  , UseBoundingVolumeHierarchy(0)
+  , ComputeSymmetricDistances(0)
 {
   this->InputComparePolyData = vtkPolyData::New();
   this->InputReferencePolyData = vtkPolyData::New();
   this->OutputHistogram = vtkTable::New();
   this->OutputDistances = vtkDoubleArray::New();
+  this->OutputReverseDistances = vtkDoubleArray::New();
 
   //this->SetNumberOfInputPorts(2);
   //this->SetNumberOfOutputPorts(1); // See below why not 2
@@ -66,6 +540,11 @@ vtkPolyDataDistanceHistogramFilter::~vtkPolyDataDistanceHistogramFilter()
     this->OutputDistances->Delete();
     this->OutputDistances = nullptr;
   }
+  if (this->OutputReverseDistances)
+  {
+    this->OutputReverseDistances->Delete();
+    this->OutputReverseDistances = nullptr;
+  }
 }
 
 //----------------------------------------------------------------------------
@@ -102,6 +581,12 @@ vtkDoubleArray* vtkPolyDataDistanceHistogramFilter::GetOutputDistances()
   return this->OutputDistances;
 }
 
+//----------------------------------------------------------------------------
+vtkDoubleArray* vtkPolyDataDistanceHistogramFilter::GetOutputReverseDistances()
+{
+  return this->OutputReverseDistances;
+}
+
 //----------------------------------------------------------------------------
 vtkTable* vtkPolyDataDistanceHistogramFilter::GetOutputHistogram()
 {
@@ -120,6 +605,20 @@ double vtkPolyDataDistanceHistogramFilter::GetMaximumHausdorffDistance()
 
   return this->OutputDistances->GetMaxNorm();
 }
+
+//----------------------------------------------------------------------------
+double vtkPolyDataDistanceHistogramFilter::GetSymmetricMaximumHausdorffDistance()
+{
+  if (!this->ComputeSymmetricDistances)
+  {
+    vtkErrorMacro("GetSymmetricMaximumHausdorffDistance: Reverse distances are not computed! Need to turn on ComputeSymmetricDistances and call Update.");
+    return 0.0;
+  }
+
+  double forwardMaximum = (this->OutputDistances->GetNumberOfTuples() > 0 ? this->OutputDistances->GetMaxNorm() : 0.0);
+  double reverseMaximum = (this->OutputReverseDistances->GetNumberOfTuples() > 0 ? this->OutputReverseDistances->GetMaxNorm() : 0.0);
+  return std::max(forwardMaximum, reverseMaximum);
+}
   
 //----------------------------------------------------------------------------
 double vtkPolyDataDistanceHistogramFilter::GetAverageHausdorffDistance()
@@ -252,18 +751,46 @@ void vtkPolyDataDistanceHistogramFilter::ComputeDistances(vtkPolyData* reference
   pointSampler->SetInputData(comparePolyData);
   pointSampler->Update();  
   vtkPoints* samplingPoints = pointSampler->GetOutput()->GetPoints();
-  
+  if (!samplingPoints)
+  {
+    return;
+  }
+
+  // Allocate all values up front so that they can be written concurrently
+  vtkIdType numPoints = samplingPoints->GetNumberOfPoints();
+  distanceArray->SetNumberOfValues(numPoints);
+
+  if (this->UseBoundingVolumeHierarchy)
+  {
+    TriangleBoundingVolumeHierarchy hierarchy;
+    if (!hierarchy.Build(referencePolyData))
+    {
+      vtkErrorMacro("ComputeDistances: Reference poly data contains no triangles");
+      distanceArray->SetNumberOfValues(0);
+      return;
+    }
+    BoundingVolumeHierarchyDistanceFunctor functor(hierarchy, samplingPoints, distanceArray);
+    if (this->ParallelComputation)
+    {
+      vtkSMPTools::For(0, numPoints, functor);
+    }
+    else
+    {
+      functor(0, numPoints);
+    }
+    return;
+  }
+
   // generate the distance field
-  vtkSmartPointer<vtkImplicitPolyDataDistance> distanceField = vtkSmartPointer<vtkImplicitPolyDataDistance>::New();
-  distanceField->SetInput(referencePolyData);
-  
-  int numPoints = samplingPoints->GetNumberOfPoints();
-  for (int i = 0; i < numPoints; i++)
+  ImplicitDistanceFunctor functor(referencePolyData, samplingPoints, distanceArray);
+  if (this->ParallelComputation)
   {
-    double samplePoint[3];
-    samplingPoints->GetPoint(i,samplePoint);
-    double newDistance = distanceField->EvaluateFunction(samplePoint);
-    distanceArray->InsertNextTuple1(newDistance);
+    vtkSMPTools::For(0, numPoints, functor);
+  }
+  else
+  {
+    functor.Initialize();
+    functor(0, numPoints);
   }
 }
 
@@ -282,6 +809,14 @@ void vtkPolyDataDistanceHistogramFilter::Update()
   vtkSmartPointer<vtkDoubleArray> distances = vtkSmartPointer<vtkDoubleArray>::New(); // hold the distances in this array until we copy to the output
   distances->SetName("Distances");
   this->ComputeDistances(inputPolyDataReference, inputPolyDataCompare, distances);
+
+  // distances from the reference to the compare poly data for the symmetric Hausdorff distance
+  vtkSmartPointer<vtkDoubleArray> reverseDistances = vtkSmartPointer<vtkDoubleArray>::New();
+  reverseDistances->SetName("ReverseDistances");
+  if (this->ComputeSymmetricDistances)
+  {
+    this->ComputeDistances(inputPolyDataCompare, inputPolyDataReference, reverseDistances);
+  }
   
   // copy the distances into a dummy image
   vtkSmartPointer<vtkImageData> dummyImage = vtkSmartPointer<vtkImageData>::New();
@@ -338,6 +873,7 @@ void vtkPolyDataDistanceHistogramFilter::Update()
   //vtkDoubleArray* outputDistances = vtkDoubleArray::SafeDownCast(outputInfoHistogram->Get(vtkDataObject::DATA_OBJECT()));
   //outputDistances->DeepCopy(distances);
   this->OutputDistances->DeepCopy(distances);
+  this->OutputReverseDistances->DeepCopy(reverseDistances);
 
   // output the histogram
   this->OutputHistogram->DeepCopy(histogram);
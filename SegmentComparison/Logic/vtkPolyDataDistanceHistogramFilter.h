@@ -18,6 +18,11 @@
 /// object. The user can also access the raw distances directly as a 
 /// vtkDoubleArray using GetOutputDistances().
 ///
+/// The distances are evaluated on multiple threads if ParallelComputation is on (default). Instead of
+/// vtkImplicitPolyDataDistance, an exact point-to-triangle distance using a bounding volume hierarchy
+/// can be used (see UseBoundingVolumeHierarchy). If ComputeSymmetricDistances is on, then the distances
+/// from the reference to the compare poly data are also computed (see GetOutputReverseDistances).
+///
 /// This class CANNOT be a part of the VTK pipeline (as a filter) because
 /// it uses the pipeline internally. Creating such a "mini-pipeline" may
 /// result in unexpected requests being sent up the pipeline and other
@@ -58,6 +63,10 @@ public:
   /// Contains as many distance values as there are samples (points, etc.) in the compare mesh
   vtkDoubleArray* GetOutputDistances();
   
+  /// Get the minimum of the distances from each point of the reference mesh to the compare mesh.
+  /// Only computed if ComputeSymmetricDistances is on, empty otherwise.
+  vtkDoubleArray* GetOutputReverseDistances();
+
   /// Get maximum of the absolute of the minimum distances \sa GetOutputDistances from the compare mesh to the reference mesh.
   /// This is what is traditionally called Hausdorff distance.
   double GetMaximumHausdorffDistance();
@@ -73,6 +82,10 @@ public:
   /// (this corresponds to the 'percent Hausdorff distance' in plastimatch: http://plastimatch.org/doxygen/classHausdorff__distance.html )
   double GetPercent95HausdorffDistance();
 
+  /// Get maximum of the absolute of the minimum distances in both directions (symmetric Hausdorff distance).
+  /// Requires ComputeSymmetricDistances to be on.
+  double GetSymmetricMaximumHausdorffDistance();
+
   // Get the Nth percentile of the absolute of the minimum distances \sa GetOutputDistances from the compare mesh to the reference mesh.
   /// (this corresponds to the 'percent Hausdorff distance' in plastimatch: http://plastimatch.org/doxygen/classHausdorff__distance.html )
   double GetNthPercentileHausdorffDistance(double n);
@@ -118,6 +131,30 @@ public:
   /// Get the histogram spacing (width of the bins).
   vtkGetMacro(HistogramSpacing, double);
   
+  /// Set whether the distances are evaluated on multiple threads.
+  vtkSetMacro(ParallelComputation, int);
+  /// Get whether the distances are evaluated on multiple threads.
+  vtkGetMacro(ParallelComputation, int);
+  /// Set whether the distances are evaluated on multiple threads.
+  vtkBooleanMacro(ParallelComputation, int);
+
+  /// Set whether the exact point-to-triangle distance is computed using a bounding volume hierarchy
+  /// instead of vtkImplicitPolyDataDistance.
+  vtkSetMacro(UseBoundingVolumeHierarchy, int);
+  /// Get whether the exact point-to-triangle distance is computed using a bounding volume hierarchy
+  /// instead of vtkImplicitPolyDataDistance.
+  vtkGetMacro(UseBoundingVolumeHierarchy, int);
+  /// Set whether the exact point-to-triangle distance is computed using a bounding volume hierarchy
+  /// instead of vtkImplicitPolyDataDistance.
+  vtkBooleanMacro(UseBoundingVolumeHierarchy, int);
+
+  /// Set whether the distances from the reference to the compare poly data are also computed.
+  vtkSetMacro(ComputeSymmetricDistances, int);
+  /// Get whether the distances from the reference to the compare poly data are also computed.
+  vtkGetMacro(ComputeSymmetricDistances, int);
+  /// Set whether the distances from the reference to the compare poly data are also computed.
+  vtkBooleanMacro(ComputeSymmetricDistances, int);
+
   /// Compute distances an histogram
   void Update();
 
@@ -149,6 +186,8 @@ protected:
   vtkTable* OutputHistogram;
   /// Output distances for each reference vertex in an array
   vtkDoubleArray* OutputDistances;
+  /// Output distances for each sampled point of the reference poly data to the compare poly data
+  vtkDoubleArray* OutputReverseDistances;
 
   /// Flag determining  whether the filter should sample on the vertices of the input vtkPolyData objects.
   /// All vertices from the vtkPolyData will be used, regardless of the sampling distance.
@@ -175,6 +214,19 @@ protected:
   /// Histogram spacing (width of the bins).
   /// Default is 0.1.
   double HistogramSpacing;
+
+  /// Flag determining whether the distances are evaluated on multiple threads.
+  /// The computed distances are the same as with serial evaluation.
+  /// Default is 1 (on).
+  int ParallelComputation;
+  /// Flag determining whether the exact point-to-triangle distance is computed using a bounding volume hierarchy
+  /// built on the triangles of the poly data, instead of vtkImplicitPolyDataDistance. The sign of the distance
+  /// is determined using angle-weighted pseudo-normals, so the poly data needs to be closed and consistently oriented.
+  /// Default is 0 (off).
+  int UseBoundingVolumeHierarchy;
+  /// Flag determining whether the distances from the reference to the compare poly data are also computed.
+  /// Default is 0 (off).
+  int ComputeSymmetricDistances;
   
 private:
   vtkPolyDataDistanceHistogramFilter(const vtkPolyDataDistanceHistogramFilter&) = delete;
@@ -165,11 +165,11 @@ std::string vtkSlicerSegmentComparisonModuleLogicPrivate::GetInputSegmentsAsPlmV
     }
   }
 
-  // Convert inputs to ITK images
+  // Convert inputs to ITK images. The comparisons do not modify the inputs, so the labelmap voxels are not copied
   vtkSmartPointer<vtkTimerLog> timer = vtkSmartPointer<vtkTimerLog>::New();
   checkpointItkConvertStart = timer->GetUniversalTime();
 
-  plmRefSegmentLabelmap = PlmCommon::ConvertVtkOrientedImageDataToPlmImage(referenceSegmentLabelmap);
+  plmRefSegmentLabelmap = PlmCommon::ConvertVtkOrientedImageDataToPlmImage(referenceSegmentLabelmap, true);
   if (!plmRefSegmentLabelmap)
   {
     std::string errorMessage = vtkMRMLTr("vtkSlicerSegmentComparisonModuleLogicPrivate", "Failed to convert reference segment labelmap into Plm_image");
@@ -177,7 +177,7 @@ std::string vtkSlicerSegmentComparisonModuleLogicPrivate::GetInputSegmentsAsPlmV
     return errorMessage;
   }
 
-  plmCmpSegmentLabelmap = PlmCommon::ConvertVtkOrientedImageDataToPlmImage(compareSegmentLabelmap);
+  plmCmpSegmentLabelmap = PlmCommon::ConvertVtkOrientedImageDataToPlmImage(compareSegmentLabelmap, true);
   if (!plmCmpSegmentLabelmap)
   {
     std::string errorMessage = vtkMRMLTr("vtkSlicerSegmentComparisonModuleLogicPrivate", "Failed to convert compare segment labelmap into Plm_image");
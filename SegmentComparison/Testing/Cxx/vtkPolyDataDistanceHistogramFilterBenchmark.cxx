@@ -0,0 +1,167 @@
+// Module includes
+#include "vtkPolyDataDistanceHistogramFilter.h"
+
+// SlicerRT includes
+#include "vtkSlicerRtCommon.h"
+
+// VTK includes
+#include <vtkDoubleArray.h>
+#include <vtkSmartPointer.h>
+#include <vtkSphereSource.h>
+#include <vtkTimerLog.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+namespace
+{
+  //-----------------------------------------------------------------------------
+  /// Compute distances between the two poly data with the given settings and report the average computation time
+  double ComputeDistances(vtkPolyDataDistanceHistogramFilter* filter, bool parallel, bool boundingVolumeHierarchy,
+    int numberOfIterations, vtkDoubleArray* distances, const char* name)
+  {
+    filter->SetParallelComputation(parallel ? 1 : 0);
+    filter->SetUseBoundingVolumeHierarchy(boundingVolumeHierarchy ? 1 : 0);
+
+    vtkSmartPointer<vtkTimerLog> timer = vtkSmartPointer<vtkTimerLog>::New();
+    timer->StartTimer();
+    for (int iteration = 0; iteration < numberOfIterations; ++iteration)
+    {
+      filter->Update();
+    }
+    timer->StopTimer();
+    double averageTimeSec = timer->GetElapsedTime() / numberOfIterations;
+
+    distances->DeepCopy(filter->GetOutputDistances());
+    std::cout << name << ": " << averageTimeSec * 1000.0 << " ms for " << distances->GetNumberOfValues() << " points ("
+      << distances->GetNumberOfValues() / std::max(averageTimeSec, 1e-9) << " points/s)" << std::endl;
+    return averageTimeSec;
+  }
+
+  //-----------------------------------------------------------------------------
+  /// Get maximum absolute difference of two distance arrays, or -1 if their sizes differ
+  double GetMaximumDifference(vtkDoubleArray* distances1, vtkDoubleArray* distances2)
+  {
+    if (distances1->GetNumberOfValues() != distances2->GetNumberOfValues())
+    {
+      return -1.0;
+    }
+    double maximumDifference = 0.0;
+    for (vtkIdType i = 0; i < distances1->GetNumberOfValues(); ++i)
+    {
+      maximumDifference = std::max(maximumDifference, std::fabs(distances1->GetValue(i) - distances2->GetValue(i)));
+    }
+    return maximumDifference;
+  }
+}
+
+//-----------------------------------------------------------------------------
+int vtkPolyDataDistanceHistogramFilterBenchmark( int argc, char* argv[] )
+{
+  int argIndex = 1;
+  int numberOfIterations = 1;
+  if (argc > argIndex+1)
+  {
+    if (STRCASECMP(argv[argIndex], "-NumberOfIterations") == 0)
+    {
+      numberOfIterations = std::max(atoi(argv[argIndex+1]), 1);
+      std::cout << "Number of iterations: " << numberOfIterations << std::endl;
+      argIndex += 2;
+    }
+  }
+
+  // Dense spheres so that the distance computation dominates
+  vtkSmartPointer<vtkSphereSource> sphereSource1 = vtkSmartPointer<vtkSphereSource>::New();
+  sphereSource1->SetRadius(1.0);
+  sphereSource1->SetThetaResolution(200);
+  sphereSource1->SetPhiResolution(200);
+  sphereSource1->Update();
+
+  vtkSmartPointer<vtkSphereSource> sphereSource2 = vtkSmartPointer<vtkSphereSource>::New();
+  sphereSource2->SetRadius(0.8);
+  sphereSource2->SetCenter(0.5, 0.0, 0.0);
+  sphereSource2->SetThetaResolution(150);
+  sphereSource2->SetPhiResolution(150);
+  sphereSource2->Update();
+
+  vtkSmartPointer<vtkPolyDataDistanceHistogramFilter> filter = vtkSmartPointer<vtkPolyDataDistanceHistogramFilter>::New();
+  filter->SetInputReferencePolyData(sphereSource1->GetOutput());
+  filter->SetInputComparePolyData(sphereSource2->GetOutput());
+  filter->SetSamplePolyDataVertices(1);
+  filter->SetSamplePolyDataEdges(1);
+  filter->SetSamplePolyDataFaces(1);
+  filter->SetSamplingDistance(0.01);
+  filter->SetHistogramMinimum(-1.0);
+  filter->SetHistogramMaximum(1.0);
+  filter->SetHistogramSpacing(0.05);
+
+  vtkSmartPointer<vtkDoubleArray> serialDistances = vtkSmartPointer<vtkDoubleArray>::New();
+  double serialTimeSec = ComputeDistances(filter, false, false, numberOfIterations, serialDistances, "Implicit distance, serial");
+  vtkSmartPointer<vtkDoubleArray> parallelDistances = vtkSmartPointer<vtkDoubleArray>::New();
+  double parallelTimeSec = ComputeDistances(filter, true, false, numberOfIterations, parallelDistances, "Implicit distance, parallel");
+  vtkSmartPointer<vtkDoubleArray> serialHierarchyDistances = vtkSmartPointer<vtkDoubleArray>::New();
+  double serialHierarchyTimeSec = ComputeDistances(filter, false, true, numberOfIterations, serialHierarchyDistances, "Bounding volume hierarchy, serial");
+  vtkSmartPointer<vtkDoubleArray> parallelHierarchyDistances = vtkSmartPointer<vtkDoubleArray>::New();
+  double parallelHierarchyTimeSec = ComputeDistances(filter, true, true, numberOfIterations, parallelHierarchyDistances, "Bounding volume hierarchy, parallel");
+
+  std::cout << "Speedup of parallel implicit distance: " << serialTimeSec / std::max(parallelTimeSec, 1e-9) << std::endl;
+  std::cout << "Speedup of serial bounding volume hierarchy: " << serialTimeSec / std::max(serialHierarchyTimeSec, 1e-9) << std::endl;
+  std::cout << "Speedup of parallel bounding volume hierarchy: " << serialTimeSec / std::max(parallelHierarchyTimeSec, 1e-9) << std::endl;
+
+  if (serialDistances->GetNumberOfValues() == 0)
+  {
+    std::cerr << "No distances have been computed" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Parallel evaluation must not change the results
+  if (GetMaximumDifference(serialDistances, parallelDistances) != 0.0)
+  {
+    std::cerr << "Parallel implicit distances differ from the serial ones" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (GetMaximumDifference(serialHierarchyDistances, parallelHierarchyDistances) != 0.0)
+  {
+    std::cerr << "Parallel bounding volume hierarchy distances differ from the serial ones" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Both methods compute the exact distance from the triangles, only rounding may differ
+  double hierarchyDifference = GetMaximumDifference(serialDistances, serialHierarchyDistances);
+  if (hierarchyDifference < 0.0 || hierarchyDifference > 1e-6)
+  {
+    std::cerr << "Bounding volume hierarchy distances differ from the implicit distances by " << hierarchyDifference << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Symmetric Hausdorff distance
+  filter->SetParallelComputation(1);
+  filter->SetUseBoundingVolumeHierarchy(1);
+  filter->ComputeSymmetricDistancesOn();
+  filter->Update();
+  vtkDoubleArray* reverseDistances = filter->GetOutputReverseDistances();
+  if (reverseDistances->GetNumberOfValues() == 0)
+  {
+    std::cerr << "No reverse distances have been computed" << std::endl;
+    return EXIT_FAILURE;
+  }
+  double forwardMaximum = filter->GetMaximumHausdorffDistance();
+  double reverseMaximum = reverseDistances->GetMaxNorm();
+  double symmetricMaximum = filter->GetSymmetricMaximumHausdorffDistance();
+  std::cout << "Hausdorff distance: forward " << forwardMaximum << ", reverse " << reverseMaximum << ", symmetric " << symmetricMaximum << std::endl;
+  if (symmetricMaximum != std::max(forwardMaximum, reverseMaximum))
+  {
+    std::cerr << "Symmetric Hausdorff distance " << symmetricMaximum << " is not the maximum of the directed distances" << std::endl;
+    return EXIT_FAILURE;
+  }
+  // Farthest point of the reference sphere from the compare sphere is at (-1,0,0): 1.5 - 0.8 = 0.7
+  if (std::fabs(reverseMaximum - 0.7) > 0.01)
+  {
+    std::cerr << "Reverse Hausdorff distance " << reverseMaximum << " differs from the expected 0.7" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,205 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Csaba Pinter, PerkLab, Queen's University
+  and was supported through the Applied Cancer Research Unit program of Cancer Care
+  Ontario with funds provided by the Ontario Ministry of Health and Long-Term Care
+
+==============================================================================*/
+
+// SlicerRT includes
+#include "vtkFractionalImageAccumulate.h"
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkImageStencilData.h>
+#include <vtkImageToImageStencil.h>
+#include <vtkMath.h>
+#include <vtkNew.h>
+#include <vtkSMPTools.h>
+#include <vtkTimerLog.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+  //-----------------------------------------------------------------------------
+  bool AreEqualWithTolerance(double a, double b, double relativeTolerance = 1e-9)
+  {
+    double scale = std::max(1.0, std::max(fabs(a), fabs(b)));
+    return fabs(a - b) <= relativeTolerance * scale;
+  }
+}
+
+//-----------------------------------------------------------------------------
+// Accumulate a synthetic dose volume with a fractional labelmap and compare the results to a serial
+// reference computed in the test. Optionally repeat the computation to measure the throughput.
+int vtkFractionalImageAccumulateTest1(int argc, char* argv[])
+{
+  int numberOfIterations = 1;
+  int argIndex = 1;
+  if (argc > argIndex+1)
+  {
+    if (strcmp(argv[argIndex], "-NumberOfIterations") == 0)
+    {
+      numberOfIterations = atoi(argv[argIndex+1]);
+      argIndex += 2;
+    }
+  }
+  if (numberOfIterations < 1)
+  {
+    numberOfIterations = 1;
+  }
+
+  // Create dose volume and a spherical fractional labelmap on the same grid
+  const int dimensions[3] = { 160, 160, 80 };
+  vtkNew<vtkImageData> doseImage;
+  doseImage->SetDimensions(dimensions[0], dimensions[1], dimensions[2]);
+  doseImage->AllocateScalars(VTK_FLOAT, 1);
+  vtkNew<vtkImageData> fractionalLabelmap;
+  fractionalLabelmap->SetDimensions(dimensions[0], dimensions[1], dimensions[2]);
+  fractionalLabelmap->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+
+  float* dosePtr = static_cast<float*>(doseImage->GetScalarPointer());
+  unsigned char* fractionalPtr = static_cast<unsigned char*>(fractionalLabelmap->GetScalarPointer());
+  const double center[3] = { 0.5 * dimensions[0], 0.5 * dimensions[1], 0.5 * dimensions[2] };
+  const double radius = 0.4 * dimensions[2];
+  vtkIdType voxelIndex = 0;
+  for (int k = 0; k < dimensions[2]; ++k)
+  {
+    for (int j = 0; j < dimensions[1]; ++j)
+    {
+      for (int i = 0; i < dimensions[0]; ++i, ++voxelIndex)
+      {
+        double dx = i - center[0];
+        double dy = j - center[1];
+        double dz = k - center[2];
+        double distance = sqrt(dx*dx + dy*dy + dz*dz);
+        dosePtr[voxelIndex] = static_cast<float>(70.0 * exp(-distance*distance / (2.0*radius*radius)) + 0.01 * i);
+        // Fraction falls off linearly over two voxels at the surface of the sphere
+        double fraction = std::min(1.0, std::max(0.0, (radius - distance) / 2.0 + 0.5));
+        fractionalPtr[voxelIndex] = static_cast<unsigned char>(vtkMath::Round(fraction * 255.0));
+      }
+    }
+  }
+
+  vtkNew<vtkImageToImageStencil> stencilFilter;
+  stencilFilter->SetInputData(fractionalLabelmap);
+  stencilFilter->ThresholdByUpper(1);
+  stencilFilter->Update();
+
+  const double binOrigin = 0.0;
+  const double binSpacing = 0.5;
+  const int numberOfBins = 160;
+
+  vtkNew<vtkFractionalImageAccumulate> accumulate;
+  accumulate->SetInputData(doseImage);
+  accumulate->SetStencilData(stencilFilter->GetOutput());
+  accumulate->SetFractionalLabelmap(fractionalLabelmap);
+  accumulate->UseFractionalLabelmapOn();
+  accumulate->SetMinimumFractionalValue(0.0);
+  accumulate->SetMaximumFractionalValue(255.0);
+  accumulate->SetComponentExtent(0, numberOfBins-1, 0, 0, 0, 0);
+  accumulate->SetComponentOrigin(binOrigin, 0, 0);
+  accumulate->SetComponentSpacing(binSpacing, 1, 1);
+
+  vtkNew<vtkTimerLog> timer;
+  timer->StartTimer();
+  for (int iteration = 0; iteration < numberOfIterations; ++iteration)
+  {
+    accumulate->Modified();
+    accumulate->Update();
+  }
+  timer->StopTimer();
+  double elapsedTimeSec = timer->GetElapsedTime();
+  vtkIdType numberOfVoxels = doseImage->GetNumberOfPoints();
+  std::cout << "Accumulated " << numberOfVoxels << " voxels " << numberOfIterations << " times using "
+    << vtkSMPTools::GetEstimatedNumberOfThreads() << " threads in " << elapsedTimeSec << " s ("
+    << (elapsedTimeSec > 0.0 ? numberOfVoxels * numberOfIterations / elapsedTimeSec : 0.0) << " voxels per second)" << std::endl;
+
+  // Compute reference serially
+  double referenceSum = 0.0;
+  double referenceFractionalVoxelCount = 0.0;
+  double referenceMin = VTK_DOUBLE_MAX;
+  double referenceMax = VTK_DOUBLE_MIN;
+  vtkIdType referenceVoxelCount = 0;
+  std::vector<double> referenceBins(numberOfBins, 0.0);
+  for (voxelIndex = 0; voxelIndex < numberOfVoxels; ++voxelIndex)
+  {
+    if (fractionalPtr[voxelIndex] < 1)
+    {
+      continue;
+    }
+    double value = dosePtr[voxelIndex];
+    double fraction = fractionalPtr[voxelIndex] / 255.0;
+    referenceSum += value * fraction;
+    referenceFractionalVoxelCount += fraction;
+    referenceMin = std::min(referenceMin, value);
+    referenceMax = std::max(referenceMax, value);
+    ++referenceVoxelCount;
+    int binIndex = vtkMath::Floor((value - binOrigin) / binSpacing);
+    if (binIndex >= 0 && binIndex < numberOfBins)
+    {
+      referenceBins[binIndex] += fraction;
+    }
+  }
+  double referenceMean = referenceSum / referenceFractionalVoxelCount;
+
+  int numberOfErrors = 0;
+  if (accumulate->GetVoxelCount() != referenceVoxelCount)
+  {
+    std::cerr << "Voxel count mismatch: " << accumulate->GetVoxelCount() << " != " << referenceVoxelCount << std::endl;
+    ++numberOfErrors;
+  }
+  if (!AreEqualWithTolerance(accumulate->GetFractionalVoxelCount(), referenceFractionalVoxelCount))
+  {
+    std::cerr << "Fractional voxel count mismatch: " << accumulate->GetFractionalVoxelCount() << " != " << referenceFractionalVoxelCount << std::endl;
+    ++numberOfErrors;
+  }
+  if (accumulate->GetMin()[0] != referenceMin || accumulate->GetMax()[0] != referenceMax)
+  {
+    std::cerr << "Range mismatch: [" << accumulate->GetMin()[0] << ", " << accumulate->GetMax()[0]
+      << "] != [" << referenceMin << ", " << referenceMax << "]" << std::endl;
+    ++numberOfErrors;
+  }
+  if (!AreEqualWithTolerance(accumulate->GetMean()[0], referenceMean))
+  {
+    std::cerr << "Mean mismatch: " << accumulate->GetMean()[0] << " != " << referenceMean << std::endl;
+    ++numberOfErrors;
+  }
+  double* binsPtr = static_cast<double*>(accumulate->GetOutput()->GetScalarPointer());
+  for (int binIndex = 0; binIndex < numberOfBins; ++binIndex)
+  {
+    if (!AreEqualWithTolerance(binsPtr[binIndex], referenceBins[binIndex]))
+    {
+      std::cerr << "Bin " << binIndex << " mismatch: " << binsPtr[binIndex] << " != " << referenceBins[binIndex] << std::endl;
+      ++numberOfErrors;
+    }
+  }
+
+  if (numberOfErrors > 0)
+  {
+    std::cerr << "vtkFractionalImageAccumulateTest1 failed with " << numberOfErrors << " errors" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "vtkFractionalImageAccumulateTest1 passed" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -30,6 +30,12 @@
 #include <vtkStreamingDemandDrivenPipeline.h>
 #include <vtkFieldData.h>
 #include <vtkMath.h>
+#include <vtkSMPThreadLocal.h>
+#include <vtkSMPTools.h>
+
+// STD includes
+#include <algorithm>
+#include <vector>
 
 vtkStandardNewMacro(vtkFractionalImageAccumulate);
 
@@ -38,6 +44,9 @@ vtkFractionalImageAccumulate::vtkFractionalImageAccumulate()
 {
   this->MinimumFractionalValue = 0;
   this->MaximumFractionalValue = 1.0;
+  this->FractionalLabelmap = nullptr;
+  this->FractionalVoxelCount = 0.0;
+  this->UseFractionalLabelmap = false;
 }
 
 //----------------------------------------------------------------------------
@@ -73,7 +82,10 @@ int vtkFractionalImageAccumulateExecute(vtkFractionalImageAccumulate *self,
                               double *fractionalVoxelCount,
                               int* updateExtent)
 {
-    switch (self->GetFractionalLabelmap()->GetScalarType())
+    // Without fractional labelmap the fractional scalar type is not used, dispatch on the input type then
+    vtkImageData* fractionalLabelmap = ( (self->GetUseFractionalLabelmap() && self->GetFractionalLabelmap())
+      ? self->GetFractionalLabelmap() : inData );
+    switch (fractionalLabelmap->GetScalarType())
     {
     vtkTemplateMacro( vtkFractionalImageAccumulateExecute2( self,
                                                 (BaseImageScalarType*) nullptr,
@@ -94,6 +106,284 @@ int vtkFractionalImageAccumulateExecute(vtkFractionalImageAccumulate *self,
     return 1;
 }
 
+namespace
+{
+
+//----------------------------------------------------------------------------
+/// Statistics and histogram accumulated by one thread
+struct vtkFractionalImageAccumulateStatistics
+{
+  double Sum[3];
+  double SumSqr[3];
+  double Min[3];
+  double Max[3];
+  vtkIdType VoxelCount;
+  double FractionalVoxelCount;
+  std::vector<double> Histogram;
+
+  void Initialize(vtkIdType histogramSize)
+  {
+    for (int idxC = 0; idxC < 3; ++idxC)
+    {
+      this->Sum[idxC] = 0.0;
+      this->SumSqr[idxC] = 0.0;
+      this->Min[idxC] = VTK_DOUBLE_MAX;
+      this->Max[idxC] = VTK_DOUBLE_MIN;
+    }
+    this->VoxelCount = 0;
+    this->FractionalVoxelCount = 0.0;
+    this->Histogram.assign(histogramSize, 0.0);
+  }
+
+  void Add(const vtkFractionalImageAccumulateStatistics& other)
+  {
+    for (int idxC = 0; idxC < 3; ++idxC)
+    {
+      this->Sum[idxC] += other.Sum[idxC];
+      this->SumSqr[idxC] += other.SumSqr[idxC];
+      this->Min[idxC] = std::min(this->Min[idxC], other.Min[idxC]);
+      this->Max[idxC] = std::max(this->Max[idxC], other.Max[idxC]);
+    }
+    this->VoxelCount += other.VoxelCount;
+    this->FractionalVoxelCount += other.FractionalVoxelCount;
+    for (size_t binIndex = 0; binIndex < this->Histogram.size(); ++binIndex)
+    {
+      this->Histogram[binIndex] += other.Histogram[binIndex];
+    }
+  }
+};
+
+//----------------------------------------------------------------------------
+/// Accumulate the image rows of an extent, with per-thread statistics and histograms that are
+/// combined when all rows are processed. Used by vtkSMPTools, rows are indexed as (z, y) pairs.
+template <class BaseImageScalarType, class FractionalImageScalarType>
+class vtkFractionalImageAccumulateFunctor
+{
+public:
+  vtkImageData* InData{nullptr};
+  /// Fractional labelmap (nullptr if each voxel has full weight)
+  vtkImageData* FractionalLabelmap{nullptr};
+  vtkImageStencilData* Stencil{nullptr};
+  bool ReverseStencil{false};
+  bool IgnoreZero{false};
+  double MinimumFractionalValue{0.0};
+  double MaximumFractionalValue{1.0};
+  int NumberOfComponents{1};
+  int UpdateExtent[6];
+
+  // Histogram geometry
+  int OutExtent[6];
+  vtkIdType OutIncs[3];
+  double Origin[3];
+  double Spacing[3];
+  vtkIdType HistogramSize{0};
+
+  vtkSMPThreadLocal<vtkFractionalImageAccumulateStatistics> LocalStatistics;
+  vtkFractionalImageAccumulateStatistics Result;
+
+  void Initialize()
+  {
+    this->LocalStatistics.Local().Initialize(this->HistogramSize);
+  }
+
+  void operator()(vtkIdType beginRow, vtkIdType endRow)
+  {
+    vtkFractionalImageAccumulateStatistics& statistics = this->LocalStatistics.Local();
+    int numberOfRowsPerSlice = this->UpdateExtent[3] - this->UpdateExtent[2] + 1;
+
+    // Process the rows slice by slice, so that one stencil iterator covers all the rows of a slice
+    vtkIdType row = beginRow;
+    while (row < endRow)
+    {
+      int z = this->UpdateExtent[4] + static_cast<int>(row / numberOfRowsPerSlice);
+      int firstY = this->UpdateExtent[2] + static_cast<int>(row % numberOfRowsPerSlice);
+      vtkIdType numberOfRowsInSlice = std::min<vtkIdType>(endRow - row, this->UpdateExtent[3] - firstY + 1);
+      int rowsExtent[6] = { this->UpdateExtent[0], this->UpdateExtent[1],
+        firstY, firstY + static_cast<int>(numberOfRowsInSlice) - 1, z, z };
+      this->AccumulateExtent(rowsExtent, statistics);
+      row += numberOfRowsInSlice;
+    }
+  }
+
+  void Reduce()
+  {
+    this->Result.Initialize(this->HistogramSize);
+    for (typename vtkSMPThreadLocal<vtkFractionalImageAccumulateStatistics>::iterator statisticsIt = this->LocalStatistics.begin();
+      statisticsIt != this->LocalStatistics.end(); ++statisticsIt)
+    {
+      this->Result.Add(*statisticsIt);
+    }
+  }
+
+protected:
+  void AccumulateExtent(int extent[6], vtkFractionalImageAccumulateStatistics& statistics)
+  {
+    vtkImageStencilIterator<BaseImageScalarType> inIter(this->InData, this->Stencil, extent);
+    vtkImageStencilIterator<FractionalImageScalarType> fractionalIter(
+      (this->FractionalLabelmap ? this->FractionalLabelmap : this->InData), this->Stencil, extent);
+
+    while (!inIter.IsAtEnd())
+    {
+      if (inIter.IsInStencil() ^ this->ReverseStencil)
+      {
+        BaseImageScalarType* inPtr = inIter.BeginSpan();
+        BaseImageScalarType* spanEndPtr = inIter.EndSpan();
+        FractionalImageScalarType* fractionalPtr = fractionalIter.BeginSpan();
+        if (this->NumberOfComponents == 1)
+        {
+          this->AccumulateSpan(inPtr, spanEndPtr - inPtr, fractionalPtr, statistics);
+        }
+        else
+        {
+          this->AccumulateSpanMultiComponent(inPtr, spanEndPtr, fractionalPtr, statistics);
+        }
+      }
+      fractionalIter.NextSpan();
+      inIter.NextSpan();
+    }
+  }
+
+  /// Accumulate a span of a single component image.
+  /// The statistics are gathered in independent lanes without branches, so that the compiler can vectorize
+  /// the loop, then the histogram is filled in a second (scalar) loop over the same span.
+  void AccumulateSpan(const BaseImageScalarType* inPtr, vtkIdType spanLength,
+    const FractionalImageScalarType* fractionalPtr, vtkFractionalImageAccumulateStatistics& statistics)
+  {
+    const int numberOfLanes = 4;
+    double sumLanes[numberOfLanes] = { 0.0, 0.0, 0.0, 0.0 };
+    double sumSqrLanes[numberOfLanes] = { 0.0, 0.0, 0.0, 0.0 };
+    double fractionLanes[numberOfLanes] = { 0.0, 0.0, 0.0, 0.0 };
+    double countLanes[numberOfLanes] = { 0.0, 0.0, 0.0, 0.0 };
+    double minLanes[numberOfLanes] = { VTK_DOUBLE_MAX, VTK_DOUBLE_MAX, VTK_DOUBLE_MAX, VTK_DOUBLE_MAX };
+    double maxLanes[numberOfLanes] = { VTK_DOUBLE_MIN, VTK_DOUBLE_MIN, VTK_DOUBLE_MIN, VTK_DOUBLE_MIN };
+    const bool useFractionalLabelmap = (this->FractionalLabelmap != nullptr);
+    const bool ignoreZero = this->IgnoreZero;
+    const double minimumFractionalValue = this->MinimumFractionalValue;
+    const double fractionalRange = this->MaximumFractionalValue - this->MinimumFractionalValue;
+
+    vtkIdType voxelIndex = 0;
+    for (; voxelIndex + numberOfLanes <= spanLength; voxelIndex += numberOfLanes)
+    {
+      for (int lane = 0; lane < numberOfLanes; ++lane)
+      {
+        double v = static_cast<double>(inPtr[voxelIndex + lane]);
+        double f = (useFractionalLabelmap
+          ? (static_cast<double>(fractionalPtr[voxelIndex + lane]) - minimumFractionalValue) / fractionalRange : 1.0);
+        double counted = ((!ignoreZero || v != 0) ? 1.0 : 0.0);
+        sumLanes[lane] += counted * v * f;
+        sumSqrLanes[lane] += counted * v * v * f * f;
+        fractionLanes[lane] += counted * f;
+        countLanes[lane] += counted;
+        minLanes[lane] = (counted != 0.0 && v < minLanes[lane] ? v : minLanes[lane]);
+        maxLanes[lane] = (counted != 0.0 && v > maxLanes[lane] ? v : maxLanes[lane]);
+      }
+    }
+    for (; voxelIndex < spanLength; ++voxelIndex)
+    {
+      double v = static_cast<double>(inPtr[voxelIndex]);
+      double f = (useFractionalLabelmap
+        ? (static_cast<double>(fractionalPtr[voxelIndex]) - minimumFractionalValue) / fractionalRange : 1.0);
+      double counted = ((!ignoreZero || v != 0) ? 1.0 : 0.0);
+      sumLanes[0] += counted * v * f;
+      sumSqrLanes[0] += counted * v * v * f * f;
+      fractionLanes[0] += counted * f;
+      countLanes[0] += counted;
+      minLanes[0] = (counted != 0.0 && v < minLanes[0] ? v : minLanes[0]);
+      maxLanes[0] = (counted != 0.0 && v > maxLanes[0] ? v : maxLanes[0]);
+    }
+    for (int lane = 0; lane < numberOfLanes; ++lane)
+    {
+      statistics.Sum[0] += sumLanes[lane];
+      statistics.SumSqr[0] += sumSqrLanes[lane];
+      statistics.FractionalVoxelCount += fractionLanes[lane];
+      statistics.VoxelCount += static_cast<vtkIdType>(countLanes[lane]);
+      statistics.Min[0] = std::min(statistics.Min[0], minLanes[lane]);
+      statistics.Max[0] = std::max(statistics.Max[0], maxLanes[lane]);
+    }
+
+    // Fill histogram. Ignored voxels have zero weight, so they are skipped.
+    double* histogram = statistics.Histogram.data();
+    for (voxelIndex = 0; voxelIndex < spanLength; ++voxelIndex)
+    {
+      double v = static_cast<double>(inPtr[voxelIndex]);
+      if (ignoreZero && v == 0)
+      {
+        continue;
+      }
+      int outIdx = vtkMath::Floor((v - this->Origin[0]) / this->Spacing[0]);
+      if (outIdx >= this->OutExtent[0] && outIdx <= this->OutExtent[1])
+      {
+        histogram[(outIdx - this->OutExtent[0]) * this->OutIncs[0]] += (useFractionalLabelmap
+          ? (static_cast<double>(fractionalPtr[voxelIndex]) - minimumFractionalValue) / fractionalRange : 1.0);
+      }
+    }
+  }
+
+  /// Accumulate a span of a multi-component image (components turned into x, y and z of the histogram)
+  void AccumulateSpanMultiComponent(const BaseImageScalarType* inPtr, const BaseImageScalarType* spanEndPtr,
+    const FractionalImageScalarType* fractionalPtr, vtkFractionalImageAccumulateStatistics& statistics)
+  {
+    int numC = this->NumberOfComponents;
+    while (inPtr != spanEndPtr)
+    {
+      // find the bin for this pixel.
+      bool outOfBounds = false;
+      vtkIdType outOffset = 0;
+      double total = 0.0;
+
+      for (int idxC = 0; idxC < numC; ++idxC)
+      {
+        double v = static_cast<double>(*inPtr++);
+        double f = 1.0;
+
+        if (this->FractionalLabelmap)
+        {
+          f = ( (*fractionalPtr++) - this->MinimumFractionalValue ) / (this->MaximumFractionalValue - this->MinimumFractionalValue);
+        }
+
+        if (!this->IgnoreZero || v != 0)
+        {
+          // gather statistics
+          statistics.Sum[idxC] += v*f;
+          statistics.SumSqr[idxC] += v*v*f*f;
+          if (v > statistics.Max[idxC])
+          {
+            statistics.Max[idxC] = v;
+          }
+          if (v < statistics.Min[idxC])
+          {
+            statistics.Min[idxC] = v;
+          }
+          statistics.VoxelCount++;
+          statistics.FractionalVoxelCount += f;
+          total += f;
+        }
+
+        // compute the index
+        int outIdx = vtkMath::Floor((v - this->Origin[idxC]) / this->Spacing[idxC]);
+
+        // verify that it is in range
+        if (outIdx >= this->OutExtent[idxC*2] && outIdx <= this->OutExtent[idxC*2+1])
+        {
+          outOffset += (outIdx - this->OutExtent[idxC*2]) * this->OutIncs[idxC];
+        }
+        else
+        {
+          outOfBounds = true;
+        }
+      }
+
+      // increment the bin
+      if (!outOfBounds)
+      {
+        statistics.Histogram[outOffset] += total;
+      }
+    }
+  }
+};
+
+} // end of anonymous namespace
+
 //----------------------------------------------------------------------------
 // This templated function executes the filter for any type of data.
 template <class BaseImageScalarType, class FractionalImageScalarType>
@@ -109,13 +399,9 @@ int vtkFractionalImageAccumulateExecute2(vtkFractionalImageAccumulate *self,
                               double *fractionalVoxelCount,
                               int* updateExtent)
 {
-  // variables used to compute statistics (filter handles max 3 components)
-  double sum[3];
-  sum[0] = sum[1] = sum[2] = 0.0;
-  double sumSqr[3];
-  sumSqr[0] = sumSqr[1] = sumSqr[2] = 0.0;
   min[0] = min[1] = min[2] = VTK_DOUBLE_MAX;
   max[0] = max[1] = max[2] = VTK_DOUBLE_MIN;
+  mean[0] = mean[1] = mean[2] = 0.0;
   standardDeviation[0] = standardDeviation[1] = standardDeviation[2] = 0.0;
   *voxelCount = 0;
   *fractionalVoxelCount = 0;
@@ -132,105 +418,48 @@ int vtkFractionalImageAccumulateExecute2(vtkFractionalImageAccumulate *self,
     return 0;
     }
 
+  vtkFractionalImageAccumulateFunctor<BaseImageScalarType, FractionalImageScalarType> functor;
+  functor.InData = inData;
+  functor.FractionalLabelmap = (self->GetUseFractionalLabelmap() ? self->GetFractionalLabelmap() : nullptr);
+  functor.Stencil = self->GetStencil();
+  functor.ReverseStencil = (self->GetReverseStencil() != 0);
+  functor.IgnoreZero = (self->GetIgnoreZero() != 0);
+  functor.MinimumFractionalValue = self->GetMinimumFractionalValue();
+  functor.MaximumFractionalValue = self->GetMaximumFractionalValue();
+  functor.NumberOfComponents = numC;
+  std::copy(updateExtent, updateExtent + 6, functor.UpdateExtent);
+
   // get information for output data
-  int outExtent[6];
-  outData->GetExtent(outExtent);
-  vtkIdType outIncs[3];
-  outData->GetIncrements(outIncs);
-  double origin[3];
-  outData->GetOrigin(origin);
-  double spacing[3];
-  outData->GetSpacing(spacing);
-
-  // zero count in every bin
-  vtkIdType size = 1;
-  size *= (outExtent[1] - outExtent[0] + 1);
-  size *= (outExtent[3] - outExtent[2] + 1);
-  size *= (outExtent[5] - outExtent[4] + 1);
-  for (vtkIdType j = 0; j < size; j++)
+  outData->GetExtent(functor.OutExtent);
+  outData->GetIncrements(functor.OutIncs);
+  outData->GetOrigin(functor.Origin);
+  outData->GetSpacing(functor.Spacing);
+  functor.HistogramSize = 1;
+  functor.HistogramSize *= (functor.OutExtent[1] - functor.OutExtent[0] + 1);
+  functor.HistogramSize *= (functor.OutExtent[3] - functor.OutExtent[2] + 1);
+  functor.HistogramSize *= (functor.OutExtent[5] - functor.OutExtent[4] + 1);
+
+  // Accumulate the rows of the update extent in parallel
+  vtkIdType numberOfRows = static_cast<vtkIdType>(updateExtent[3] - updateExtent[2] + 1)
+    * static_cast<vtkIdType>(updateExtent[5] - updateExtent[4] + 1);
+  if (updateExtent[1] < updateExtent[0] || numberOfRows <= 0)
     {
-    outPtr[j] = 0;
+    std::fill(outPtr, outPtr + functor.HistogramSize, 0.0);
+    return 1;
     }
+  vtkSMPTools::For(0, numberOfRows, functor);
 
-  vtkImageStencilData *stencil = self->GetStencil();
-  bool reverseStencil = (self->GetReverseStencil() != 0);
-  bool ignoreZero = (self->GetIgnoreZero() != 0);
-
-  vtkImageStencilIterator<BaseImageScalarType> inIter(inData, stencil, updateExtent, self);
-
-  vtkImageData* fractionalLabelmap = self->GetFractionalLabelmap();
-  vtkImageStencilIterator<FractionalImageScalarType> fractionalIter(fractionalLabelmap, stencil, updateExtent, self);
-
-  while (!inIter.IsAtEnd())
+  // copy the combined histogram to the output
+  std::copy(functor.Result.Histogram.begin(), functor.Result.Histogram.end(), outPtr);
+  for (int idxC = 0; idxC < 3; ++idxC)
     {
-    if (inIter.IsInStencil() ^ reverseStencil)
-      {
-      BaseImageScalarType *inPtr = inIter.BeginSpan();
-      BaseImageScalarType *spanEndPtr = inIter.EndSpan();
-
-      FractionalImageScalarType* fractionalPtr = (FractionalImageScalarType*)fractionalIter.BeginSpan();
-
-      while (inPtr != spanEndPtr)
-        {
-        // find the bin for this pixel.
-        bool outOfBounds = false;
-        double *outPtrC = outPtr;
-        double total  = 0.0;
-
-        for (int idxC = 0; idxC < numC; ++idxC)
-          {
-
-          double v = static_cast<double>(*inPtr++);
-          double f = 1.0;
-
-          if (self->GetUseFractionalLabelmap())
-          {
-            f = ( (*fractionalPtr++) - self->GetMinimumFractionalValue() ) / (self->GetMaximumFractionalValue() - self->GetMinimumFractionalValue());
-          }
-
-          if (!ignoreZero || v != 0)
-            {
-            // gather statistics
-            sum[idxC] += v*f;
-            sumSqr[idxC] += v*v*f*f;
-            if (v > max[idxC])
-              {
-              max[idxC] = v;
-              }
-            if (v < min[idxC])
-              {
-              min[idxC] = v;
-              }
-            (*voxelCount)++;
-            (*fractionalVoxelCount)+=f;
-            total+=f;
-            }
-
-          // compute the index
-          int outIdx = vtkMath::Floor((v - origin[idxC]) / spacing[idxC]);
-
-          // verify that it is in range
-          if (outIdx >= outExtent[idxC*2] && outIdx <= outExtent[idxC*2+1])
-            {
-            outPtrC += (outIdx - outExtent[idxC*2]) * outIncs[idxC];
-            }
-          else
-            {
-              outOfBounds = true;
-            }
-
-          }
-
-        // increment the bin
-        if (!outOfBounds)
-          {
-            (*outPtrC) += total;
-          }
-        }
-      }
-    fractionalIter.NextSpan();
-    inIter.NextSpan();
+    min[idxC] = functor.Result.Min[idxC];
+    max[idxC] = functor.Result.Max[idxC];
     }
+  *voxelCount = functor.Result.VoxelCount;
+  *fractionalVoxelCount = functor.Result.FractionalVoxelCount;
+  double* sum = functor.Result.Sum;
+  double* sumSqr = functor.Result.SumSqr;
 
   // initialize the statistics
   mean[0] = 0;
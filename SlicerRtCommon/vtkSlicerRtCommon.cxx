@@ -357,7 +357,7 @@ void vtkSlicerRtCommon::WriteImageDataToFile(vtkMRMLScene* scene, vtkImageData*
 }
 
 //---------------------------------------------------------------------------
-bool vtkSlicerRtCommon::ConvertVolumeNodeToVtkOrientedImageData(vtkMRMLScalarVolumeNode* inVolumeNode, vtkOrientedImageData* outImageData, bool applyRasToWorldConversion/*=true*/)
+bool vtkSlicerRtCommon::ConvertVolumeNodeToVtkOrientedImageData(vtkMRMLScalarVolumeNode* inVolumeNode, vtkOrientedImageData* outImageData, bool applyRasToWorldConversion/*=true*/, bool shallowCopy/*=false*/)
 {
   if (!inVolumeNode || !inVolumeNode->GetImageData())
   {
@@ -370,7 +370,15 @@ bool vtkSlicerRtCommon::ConvertVolumeNodeToVtkOrientedImageData(vtkMRMLScalarVol
     return false;
   }
 
-  outImageData->vtkImageData::DeepCopy(inVolumeNode->GetImageData());
+  if (shallowCopy)
+  {
+    // Resampling by the parent transform below replaces the scalars of the output, so the shared scalars are not modified
+    outImageData->vtkImageData::ShallowCopy(inVolumeNode->GetImageData());
+  }
+  else
+  {
+    outImageData->vtkImageData::DeepCopy(inVolumeNode->GetImageData());
+  }
 
   vtkSmartPointer<vtkMatrix4x4> ijkToRasMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
   inVolumeNode->GetIJKToRASMatrix(ijkToRasMatrix);
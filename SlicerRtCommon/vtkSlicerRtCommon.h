@@ -165,9 +165,10 @@ public:
     \param inVolumeNode Input volume node
     \param outImageData Output oriented image data
     \param applyRasToWorldConversion Apply parent linear transform to image. True by default.
+    \param shallowCopy Share the scalars of the volume node instead of copying them. False by default.
     \return Success
   */
-  static bool ConvertVolumeNodeToVtkOrientedImageData(vtkMRMLScalarVolumeNode* inVolumeNode, vtkOrientedImageData* outImageData, bool applyRasToWorldConversion=true);
+  static bool ConvertVolumeNodeToVtkOrientedImageData(vtkMRMLScalarVolumeNode* inVolumeNode, vtkOrientedImageData* outImageData, bool applyRasToWorldConversion=true, bool shallowCopy=false);
 
   /*!
     Convert volume MRML node to ITK image
@@ -175,18 +176,22 @@ public:
     \param outItkVolume Output ITK image
     \param applyRasToWorldConversion Apply parent linear transform to image. True by default
     \param applyRasToLpsConversion Apply RAS (Slicer) to LPS (ITK, DICOM) coordinate frame conversion. True by default
+    \param shareBuffer Use the voxel buffer of the volume in the ITK image instead of copying it (unless the volume
+      needs to be resampled due to its parent transform). The ITK image must not be modified then. False by default
     \return Success
   */
-  template<typename T> static bool ConvertVolumeNodeToItkImage(vtkMRMLScalarVolumeNode* inVolumeNode, typename itk::Image<T, 3>::Pointer outItkImage, bool applyRasToWorldConversion=true, bool applyRasToLpsConversion=true);
+  template<typename T> static bool ConvertVolumeNodeToItkImage(vtkMRMLScalarVolumeNode* inVolumeNode, typename itk::Image<T, 3>::Pointer outItkImage, bool applyRasToWorldConversion=true, bool applyRasToLpsConversion=true, bool shareBuffer=false);
 
   /*!
     Convert oriented image data to ITK image
     \param inImageData Input oriented image data
     \param outItkVolume Output ITK image
     \param applyRasToLpsConversion Apply RAS (Slicer) to LPS (ITK, DICOM) coordinate frame conversion. True by default
+    \param shareBuffer Use the scalar array of the input in the ITK image instead of copying it. The ITK image keeps a
+      reference to the array, so it remains valid after the input is deleted. The ITK image must not be modified then. False by default
     \return Success
   */
-  template<typename T> static bool ConvertVtkOrientedImageDataToItkImage(vtkOrientedImageData* inImageData, typename itk::Image<T, 3>::Pointer outItkImage, bool applyRasToLpsConversion=true);
+  template<typename T> static bool ConvertVtkOrientedImageDataToItkImage(vtkOrientedImageData* inImageData, typename itk::Image<T, 3>::Pointer outItkImage, bool applyRasToLpsConversion=true, bool shareBuffer=false);
 
   /*!
     Convert ITK image to VTK image data. The image geometry is not considered!
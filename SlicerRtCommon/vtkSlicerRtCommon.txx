@@ -26,13 +26,19 @@
 
 // VTK includes
 #include <vtkSmartPointer.h>
+#include <vtkDataArray.h>
 #include <vtkImageData.h>
 #include <vtkImageExport.h>
 #include <vtkImageThreshold.h>
+#include <vtkPointData.h>
 #include <vtkTransform.h>
+#include <vtkTypeTraits.h>
 
 // ITK includes
-#include <itkImageRegionIteratorWithIndex.h>
+#include <itkImportImageContainer.h>
+
+// STD includes
+#include <algorithm>
 
 // Segmentations includes
 #include "vtkOrientedImageData.h"
@@ -51,8 +57,36 @@ namespace
   }
 }
 
+//---------------------------------------------------------------------------
+/// ITK pixel container that uses the memory of a VTK data array without copying it.
+/// Keeps a reference to the data array, so the memory is valid as long as the container exists.
+template<typename TElement>
+class vtkSlicerRtCommonVtkArrayImageContainer : public itk::ImportImageContainer<itk::SizeValueType, TElement>
+{
+public:
+  typedef vtkSlicerRtCommonVtkArrayImageContainer Self;
+  typedef itk::ImportImageContainer<itk::SizeValueType, TElement> Superclass;
+  typedef itk::SmartPointer<Self> Pointer;
+  typedef itk::SmartPointer<const Self> ConstPointer;
+  itkNewMacro(Self);
+
+  /// Use the memory of the given single-component data array as pixel buffer
+  void SetDataArray(vtkDataArray* dataArray)
+  {
+    this->DataArray = dataArray;
+    this->SetImportPointer(static_cast<TElement*>(dataArray->GetVoidPointer(0)), dataArray->GetNumberOfTuples(), false);
+  }
+
+protected:
+  vtkSlicerRtCommonVtkArrayImageContainer() = default;
+  ~vtkSlicerRtCommonVtkArrayImageContainer() override = default;
+
+protected:
+  vtkSmartPointer<vtkDataArray> DataArray;
+};
+
 //----------------------------------------------------------------------------
-template<typename T> bool vtkSlicerRtCommon::ConvertVolumeNodeToItkImage(vtkMRMLScalarVolumeNode* inVolumeNode, typename itk::Image<T, 3>::Pointer outItkImage, bool applyRasToWorldConversion/*=true*/, bool applyRasToLpsConversion/*=true*/)
+template<typename T> bool vtkSlicerRtCommon::ConvertVolumeNodeToItkImage(vtkMRMLScalarVolumeNode* inVolumeNode, typename itk::Image<T, 3>::Pointer outItkImage, bool applyRasToWorldConversion/*=true*/, bool applyRasToLpsConversion/*=true*/, bool shareBuffer/*=false*/)
 {
   if (inVolumeNode == NULL)
   {
@@ -76,20 +110,20 @@ template<typename T> bool vtkSlicerRtCommon::ConvertVolumeNodeToItkImage(vtkMRML
     return false; 
   }
   
-  // Convert volume to oriented image data
+  // Convert volume to oriented image data. If the buffer is shared, then the voxels are not copied here either
   vtkSmartPointer<vtkOrientedImageData> orientedImageData = vtkSmartPointer<vtkOrientedImageData>::New();
-  if (!vtkSlicerRtCommon::ConvertVolumeNodeToVtkOrientedImageData(inVolumeNode, orientedImageData, applyRasToWorldConversion))
+  if (!vtkSlicerRtCommon::ConvertVolumeNodeToVtkOrientedImageData(inVolumeNode, orientedImageData, applyRasToWorldConversion, shareBuffer))
   {
     vtkErrorWithObjectMacro(inVolumeNode, "ConvertVolumeNodeToItkImage: Failed to convert volume node to oriented image data!");
     return false; 
   }
   
   // Convert vtkOrientedImageData to itkImage
-  return vtkSlicerRtCommon::ConvertVtkOrientedImageDataToItkImage<T>(orientedImageData, outItkImage, applyRasToLpsConversion);
+  return vtkSlicerRtCommon::ConvertVtkOrientedImageDataToItkImage<T>(orientedImageData, outItkImage, applyRasToLpsConversion, shareBuffer);
 }
 
 //----------------------------------------------------------------------------
-template<typename T> bool vtkSlicerRtCommon::ConvertVtkOrientedImageDataToItkImage(vtkOrientedImageData* inImageData, typename itk::Image<T, 3>::Pointer outItkImage, bool applyRasToLpsConversion/*=true*/)
+template<typename T> bool vtkSlicerRtCommon::ConvertVtkOrientedImageDataToItkImage(vtkOrientedImageData* inImageData, typename itk::Image<T, 3>::Pointer outItkImage, bool applyRasToLpsConversion/*=true*/, bool shareBuffer/*=false*/)
 {
   if (inImageData == NULL)
   {
@@ -107,11 +141,6 @@ template<typename T> bool vtkSlicerRtCommon::ConvertVtkOrientedImageDataToItkIma
     return false; 
   }
 
-  // Convert vtkOrientedImageData to itkImage 
-  vtkSmartPointer<vtkImageExport> imageExport = vtkSmartPointer<vtkImageExport>::New(); 
-  imageExport->SetInputData(inImageData);
-  imageExport->Update(); 
-
   // Determine input image to world transform
   vtkSmartPointer<vtkMatrix4x4> inImageToWorldRasMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
   inImageData->GetImageToWorldMatrix(inImageToWorldRasMatrix);
@@ -194,6 +223,20 @@ template<typename T> bool vtkSlicerRtCommon::ConvertVtkOrientedImageDataToItkIma
   region.SetIndex(start);
   outItkImage->SetRegions(region);
 
+  // Use the scalar array of the input as pixel buffer if requested. The voxel order of VTK and ITK images is the same.
+  // The buffer is only shared if the scalar type matches the requested pixel type, otherwise the voxels are copied.
+  vtkDataArray* inScalars = inImageData->GetPointData()->GetScalars();
+  if (shareBuffer && inScalars && inScalars->GetNumberOfComponents() == 1
+    && inScalars->GetDataType() == vtkTypeTraits<T>::VTKTypeID()
+    && inScalars->GetDataTypeSize() == static_cast<int>(sizeof(T))
+    && static_cast<itk::SizeValueType>(inScalars->GetNumberOfTuples()) == region.GetNumberOfPixels())
+  {
+    typename vtkSlicerRtCommonVtkArrayImageContainer<T>::Pointer pixelContainer = vtkSlicerRtCommonVtkArrayImageContainer<T>::New();
+    pixelContainer->SetDataArray(inScalars);
+    outItkImage->SetPixelContainer(pixelContainer);
+    return true;
+  }
+
   // Create and export ITK image
   try
   {
@@ -205,6 +248,9 @@ template<typename T> bool vtkSlicerRtCommon::ConvertVtkOrientedImageDataToItkIma
     return false;
   }
 
+  vtkSmartPointer<vtkImageExport> imageExport = vtkSmartPointer<vtkImageExport>::New(); 
+  imageExport->SetInputData(inImageData);
+  imageExport->Update(); 
   imageExport->Export( outItkImage->GetBufferPointer() );
 
   return true;
@@ -230,17 +276,16 @@ template<typename T> bool vtkSlicerRtCommon::ConvertItkImageToVtkImageData(typen
   int extent[6]={0, (int) imageSize[0]-1, 0, (int) imageSize[1]-1, 0, (int) imageSize[2]-1};
   outVtkImageData->SetExtent(extent);
   outVtkImageData->AllocateScalars(vtkType, 1);
-
-  T* outVtkImageDataPtr = (T*)outVtkImageData->GetScalarPointer();
-  typename itk::ImageRegionIteratorWithIndex< itk::Image<T, 3> > itInItkImage(
-    inItkImage, inItkImage->GetLargestPossibleRegion() );
-  for ( itInItkImage.GoToBegin(); !itInItkImage.IsAtEnd(); ++itInItkImage )
+  if (outVtkImageData->GetScalarSize() != sizeof(T))
   {
-    typename itk::Image<T, 3>::IndexType i = itInItkImage.GetIndex();
-    (*outVtkImageDataPtr) = inItkImage->GetPixel(i);
-    outVtkImageDataPtr++;
+    vtkErrorWithObjectMacro(outVtkImageData, "ConvertItkImageToVtkImageData: Requested VTK type has a different scalar size than input type!");
+    return false;
   }
 
+  // The voxel order of the ITK buffer is the same as that of the VTK image, so it is copied at once
+  const T* inItkImagePtr = inItkImage->GetBufferPointer();
+  std::copy(inItkImagePtr, inItkImagePtr + region.GetNumberOfPixels(), static_cast<T*>(outVtkImageData->GetScalarPointer()));
+
   return true;
 }
 